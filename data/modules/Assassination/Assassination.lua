@@ -115,14 +115,14 @@ local nearbysystems
 local makeAdvert = function (station)
 	local ass_flavours = Translate:GetFlavours('Assassination')
 	if nearbysystems == nil then
-		nearbysystems = Game.system:GetNearbySystems(max_ass_dist, function (s) return #s:GetStationPaths() > 0 end)
+		nearbysystems = Game.system:GetNearbySystemPaths(max_ass_dist, function (p) return p:GetSystemSummary().numStarports > 0 end)
 	end
 	if #nearbysystems == 0 then return end
 	local client = Character.New()
 	local targetIsfemale = Engine.rand:Integer(1) == 1
 	local target = t('TITLE')[Engine.rand:Integer(1, #t('TITLE'))] .. " " .. NameGen.FullName(targetIsfemale)
 	local flavour = Engine.rand:Integer(1, #ass_flavours)
-	local nearbysystem = nearbysystems[Engine.rand:Integer(1,#nearbysystems)]
+	local nearbysystem = nearbysystems[Engine.rand:Integer(1,#nearbysystems)]:GetStarSystem()
 	local nearbystations = nearbysystem:GetStationPaths()
 	local location = nearbystations[Engine.rand:Integer(1,#nearbystations)]
 	local dist = location:DistanceTo(Game.system)
@@ -337,12 +337,12 @@ local onAICompleted = function (ship, ai_error)
 		   mission.ship == ship then
 			if mission.shipstate == 'outbound' then
 				local stats = ship:GetStats()
-				local systems = Game.system:GetNearbySystems(stats.hyperspaceRange, function (s) return #s:GetStationPaths() > 0 end)
+				local systems = Game.system:GetNearbySystemPaths(stats.hyperspaceRange, function (p) return p:GetSystemSummary().numStarports > 0 end)
 				if #systems == 0 then return end
 				local system = systems[Engine.rand:Integer(1,#systems)]
 
 				mission.shipstate = 'inbound'
-				ship:HyperspaceTo(system.path)
+				ship:HyperspaceTo(system)
 			-- the only other states are flying and inbound, and there is no AI to complete for inbound
 			elseif ai_error == 'NONE' then
 				Timer:CallAt(Game.time + 60 * 60 * 8, function ()
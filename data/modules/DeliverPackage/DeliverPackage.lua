@@ -121,10 +121,10 @@ local makeAdvert = function (station)
 		due = Game.time + ((4*24*60*60) * (Engine.rand:Number(1.5,3.5) - urgency))
 	else
 		if nearbysystems == nil then
-			nearbysystems = Game.system:GetNearbySystems(max_delivery_dist, function (s) return #s:GetStationPaths() > 0 end)
+			nearbysystems = Game.system:GetNearbySystemPaths(max_delivery_dist, function (p) return p:GetSystemSummary().numStarports > 0 end)
 		end
 		if #nearbysystems == 0 then return end
-		nearbysystem = nearbysystems[Engine.rand:Integer(1,#nearbysystems)]
+		nearbysystem = nearbysystems[Engine.rand:Integer(1,#nearbysystems)]:GetStarSystem()
 		dist = nearbysystem:DistanceTo(Game.system)
 		local nearbystations = nearbysystem:GetStationPaths()
 		location = nearbystations[Engine.rand:Integer(1,#nearbystations)]
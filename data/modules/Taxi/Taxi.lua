@@ -144,10 +144,10 @@ local makeAdvert = function (station)
 	end
 
 	if nearbysystems == nil then
-		nearbysystems = Game.system:GetNearbySystems(max_taxi_dist, function (s) return #s:GetStationPaths() > 0 end)
+		nearbysystems = Game.system:GetNearbySystemPaths(max_taxi_dist, function (p) return p:GetSystemSummary().numStarports > 0 end)
 	end
 	if #nearbysystems == 0 then return end
-	location = nearbysystems[Engine.rand:Integer(1,#nearbysystems)]
+	location = nearbysystems[Engine.rand:Integer(1,#nearbysystems)]:GetStarSystem()
 	local dist = location:DistanceTo(Game.system)
 	reward = ((dist / max_taxi_dist) * typical_reward * (group / 2) * (1+risk) * (1+3*urgency) * Engine.rand:Number(0.8,1.2))
 	due = Game.time + ((dist / max_taxi_dist) * typical_travel_time * (1.5-urgency) * Engine.rand:Number(0.9,1.1))
@@ -337,14 +337,11 @@ local spawnInitialShips = function (game_start)
 	-- the base number of seconds between ships spawned in hyperspace
 	trade_ships['interval'] = (864000 / (num_trade_ships / 4))
 	-- get nearby system paths for hyperspace spawns to come from
-	local from_systems, dist = {}, 10
-	while #from_systems < 10 do
-		dist = dist + 5
-		from_systems = Game.system:GetNearbySystems(dist)
-	end
+	local dist = 10
 	from_paths = {}
-	for _, system in ipairs(from_systems) do
-		table.insert(from_paths, system.path)
+	while #from_paths < 10 do
+		dist = dist + 5
+		from_paths = Game.system:GetNearbySystemPaths(dist)
 	end
 
 	-- spawn the initial trade ships
@@ -835,14 +832,11 @@ local onGameStart = function ()
 		end
 
 		-- rebuild nearby system paths for hyperspace spawns to come from
-		local from_systems, dist = {}, 10
-		while #from_systems < 10 do
-			dist = dist + 5
-			from_systems = Game.system:GetNearbySystems(dist)
-		end
+		local dist = 10
 		from_paths = {}
-		for _, system in ipairs(from_systems) do
-			table.insert(from_paths, system.path)
+		while #from_paths < 10 do
+			dist = dist + 5
+			from_paths = Game.system:GetNearbySystemPaths(dist)
 		end
 
 		-- check if any trade ships were waiting on a timer
@@ -0,0 +1,93 @@
+#!/usr/bin/env python
+# vim: set ts=8 sts=4 sw=4 expandtab autoindent fileencoding=utf-8:
+
+# Converts a .hmap heightmap to the tiled .thmap format the game maps
+# straight from disk (see src/terrain/TiledHeightMap.h). The game prefers
+# foo.thmap over foo.hmap when both are present.
+#
+# usage: tile_heightmap.py [-t type] [-s tilesize] [-o output] input.hmap
+
+import sys
+import os
+import struct
+from optparse import OptionParser
+from array import array
+
+VERSION = 1
+TILE_DATA_OFFSET = 4096
+HEADER = '<4s5I2d'
+
+def read_hmap(data, maptype):
+    if maptype == 0:
+        sizex, sizey = struct.unpack_from('<2H', data, 0)
+        scaling, minh = 0.0, 0.0
+        offset = 4
+    else:
+        # x and y are the other way round in this one
+        sizey, sizex, scaling, minh = struct.unpack_from('<2H2d', data, 0)
+        offset = 20
+    count = sizex * sizey
+    if len(data) < offset + count * 2:
+        raise ValueError('truncated heightmap')
+    samples = array('H')
+    # frombytes is python 3, fromstring python 2
+    (getattr(samples, 'frombytes', None) or samples.fromstring)(data[offset:offset + count * 2])
+    if sys.byteorder != 'little':
+        samples.byteswap()
+    return sizex, sizey, scaling, minh, samples
+
+def tile(sizex, sizey, samples, tilesize):
+    tilesx = (sizex + tilesize - 1) // tilesize
+    tilesy = (sizey + tilesize - 1) // tilesize
+    out = array('H')
+    for ty in range(tilesy):
+        for tx in range(tilesx):
+            for y in range(tilesize):
+                sy = min(ty * tilesize + y, sizey - 1)
+                row = sy * sizex
+                x0 = tx * tilesize
+                x1 = min(x0 + tilesize, sizex)
+                out.extend(samples[row + x0:row + x1])
+                # past the edge of the map, repeat the last sample
+                out.extend(array('H', [samples[row + sizex - 1]]) * (tilesize - (x1 - x0)))
+    return out
+
+def main():
+    parser = OptionParser(usage='%prog [options] input.hmap')
+    parser.add_option('-t', '--type', type='int', dest='maptype', default=0,
+            help='heightmap type, as heightMapFractal in the system definition: 0 (earth style, signed) or 1 (moon style, scaled) [default: %default]')
+    parser.add_option('-s', '--tile-size', type='int', dest='tilesize', default=64,
+            help='tile edge in samples, a power of two [default: %default]')
+    parser.add_option('-o', '--output', dest='output',
+            help='output file [default: input with a .thmap extension]')
+    (options, args) = parser.parse_args()
+
+    if len(args) != 1:
+        parser.error('expected one input file')
+    if options.maptype not in (0, 1):
+        parser.error('type must be 0 or 1')
+    ts = options.tilesize
+    if ts <= 0 or ts > 4096 or (ts & (ts - 1)) != 0:
+        parser.error('tile size must be a power of two, at most 4096')
+
+    infile = args[0]
+    outfile = options.output or (os.path.splitext(infile)[0] + '.thmap')
+
+    with open(infile, 'rb') as f:
+        data = f.read()
+    sizex, sizey, scaling, minh, samples = read_hmap(data, options.maptype)
+    tiles = tile(sizex, sizey, samples, ts)
+    if sys.byteorder != 'little':
+        tiles.byteswap()
+
+    header = struct.pack(HEADER, b'PHMT', VERSION, options.maptype, sizex, sizey, ts, scaling, minh)
+    with open(outfile, 'wb') as f:
+        f.write(header)
+        f.write(b'\0' * (TILE_DATA_OFFSET - len(header)))
+        tiles.tofile(f)
+
+    print('%s: %dx%d, %d tiles of %dx%d' % (outfile, sizex, sizey,
+        ((sizex + ts - 1) // ts) * ((sizey + ts - 1) // ts), ts, ts))
+
+if __name__ == '__main__':
+    main()
@@ -17,6 +17,7 @@
 #include "Space.h"
 #include "Game.h"
 #include "LuaEvent.h"
+#include <algorithm>
 
 Body::Body()
 {
@@ -26,10 +27,61 @@ Body::Body()
 	m_frame = 0;
 	m_flags = 0;
 	m_dead = false;
+	m_inBodyList = false;
+	m_activityStride = 1;
+	m_activityTicks = 0;
+	m_activityPending = 0.0f;
+	m_stepping = true;
+	m_stepTime = 0.0f;
 }
 
 Body::~Body()
 {
+	ReleaseWatches(false);
+}
+
+bool Body::s_deferWatches = false;
+
+void Body::Watch(Body *b)
+{
+	if (!b || b == this) return;
+	if (s_deferWatches) {
+		m_deferredWatches.push_back(b);
+		return;
+	}
+	if (std::find(m_watching.begin(), m_watching.end(), b) != m_watching.end()) return;
+	m_watching.push_back(b);
+	b->m_watchers.push_back(this);
+}
+
+static void erase_one(std::vector<Body*> &v, const Body *b)
+{
+	std::vector<Body*>::iterator i = std::find(v.begin(), v.end(), b);
+	if (i != v.end()) v.erase(i);
+}
+
+void Body::ReleaseWatches(bool notify)
+{
+	// a watcher can start watching something else while it's told
+	std::vector<Body*> watchers;
+	watchers.swap(m_watchers);
+	for (std::vector<Body*>::const_iterator i = watchers.begin(); i != watchers.end(); ++i) {
+		erase_one((*i)->m_watching, this);
+		if (notify) (*i)->NotifyRemoved(this);
+	}
+
+	for (std::vector<Body*>::const_iterator i = m_watching.begin(); i != m_watching.end(); ++i)
+		erase_one((*i)->m_watchers, this);
+	m_watching.clear();
+	m_deferredWatches.clear();
+}
+
+void Body::ApplyDeferredWatches()
+{
+	std::vector<Body*> watches;
+	watches.swap(m_deferredWatches);
+	for (std::vector<Body*>::const_iterator i = watches.begin(); i != watches.end(); ++i)
+		Watch(*i);
 }
 
 void Body::Save(Serializer::Writer &wr, Space *space)
@@ -42,6 +94,9 @@ void Body::Save(Serializer::Writer &wr, Space *space)
 	for (int i=0; i<9; i++) wr.Double(m_orient[i]);
 	wr.Double(m_physRadius);
 	wr.Double(m_clipRadius);
+	// time skipped and not caught up yet. it's caught up on the first step
+	// after loading
+	wr.Float(m_activityPending);
 }
 
 void Body::Load(Serializer::Reader &rd, Space *space)
@@ -54,6 +109,7 @@ void Body::Load(Serializer::Reader &rd, Space *space)
 	for (int i=0; i<9; i++) m_orient[i] = rd.Double();
 	m_physRadius = rd.Double();
 	m_clipRadius = rd.Double();
+	m_activityPending = rd.Float();
 }
 
 void Body::Serialize(Serializer::Writer &_wr, Space *space)
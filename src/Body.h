@@ -10,6 +10,8 @@
 #include "Frame.h"
 #include "Serializer.h"
 #include <string>
+#include <list>
+#include <vector>
 
 class ObjMesh;
 class Space;
@@ -44,8 +46,13 @@ public:
 	virtual bool OnDamage(Object *attacker, float kgDamage) { return false; }
 	virtual void OnHaveKilled(Body *guyWeKilled) {}
 	// Note: Does not mean killed, just deleted.
-	// Override to clear any pointers you hold to the body
+	// Override to clear any pointers you hold to the body. only called for
+	// bodies this one is watching
 	virtual void NotifyRemoved(const Body* const removedBody) {}
+	// call when taking a pointer to b, to have NotifyRemoved(b) called when
+	// it's removed from space. lasts until either body is removed; watching
+	// a body twice, or one no longer pointed at, is harmless
+	void Watch(Body *b);
 
 	// before all bodies have had TimeStepUpdate (their moving step),
 	// StaticUpdate() is called. Good for special collision testing (Projectiles)
@@ -77,6 +84,21 @@ public:
 	void MarkDead() { m_dead = true; }
 	bool IsDead() const { return m_dead; }
 
+	// how much is going on with the body, for BodyActivity to decide how
+	// often it has to step
+	enum Activity {
+		ACTIVE,		// steps every time
+		COASTING,	// moving under gravity alone, can take longer steps when nothing's near
+		RESTING,	// docked or landed with nothing to do, can sleep
+	};
+	virtual Activity GetActivity() const { return ACTIVE; }
+	// have the body step every time again from the next step on. time it
+	// skipped is caught up then
+	void Wake() { m_activityStride = 1; }
+	// whether the body's stepping this time, and how long its step is
+	bool IsStepping() const { return m_stepping; }
+	float GetStepTime() const { return m_stepTime; }
+
 	// all Bodies are in space... except where they're not (Ships hidden in hyperspace clouds)
 	virtual bool IsInSpace() const { return true; }
 
@@ -110,6 +132,27 @@ protected:
 	vector3d m_interpPos;
 	matrix3x3d m_interpOrient;
 private:
+	friend class Space;
+	friend class BodyActivity;
+
+	// tell watchers this body is going if notify, and drop all watches
+	// either way
+	void ReleaseWatches(bool notify);
+	// while watches are deferred, Watch only records the watch on the
+	// watcher and leaves the watched body alone, so bodies thinking in
+	// parallel don't write to each other. ApplyDeferredWatches then sets
+	// them up for real, on one thread
+	static void SetDeferWatches(bool defer) { s_deferWatches = defer; }
+	void ApplyDeferredWatches();
+
+	std::vector<Body*> m_watchers;	// bodies watching this one
+	std::vector<Body*> m_watching;	// bodies this one watches
+	std::vector<Body*> m_deferredWatches;
+	static bool s_deferWatches;
+	// where this body is in its space's body list, if m_inBodyList
+	std::list<Body*>::iterator m_bodyListEntry;
+	bool m_inBodyList;
+
 	vector3d m_pos;
 	matrix3x3d m_orient;
 	Frame *m_frame;				// frame of reference
@@ -117,6 +160,13 @@ private:
 	bool m_dead;				// Checked in destructor to make sure body has been marked dead.
 	double m_clipRadius;
 	double m_physRadius;
+
+	// see BodyActivity
+	Uint32 m_activityStride;	// steps taken at once
+	Uint32 m_activityTicks;		// steps skipped so far
+	float m_activityPending;	// time skipped so far
+	bool m_stepping;
+	float m_stepTime;
 };
 
 #endif /* _BODY_H */
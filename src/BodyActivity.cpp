@@ -0,0 +1,108 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "BodyActivity.h"
+#include "Body.h"
+#include "DynamicBody.h"
+#include "Frame.h"
+#include "ProximityIndex.h"
+
+// steps a resting body takes at once. nothing it does depends on taking
+// them one at a time
+static const Uint32 REST_STRIDE = 16;
+// most steps a coasting body takes at once
+static const Uint32 COAST_STRIDE = 8;
+// furthest round its orbit (radians) a coasting body may go in one step
+static const double MAX_COAST_ANGLE = 0.01;
+// how far a coasting body stays from anything else, on top of how far
+// either of them could go before its next step
+static const double COAST_CLEARANCE = 10000.0;
+// and from the player, to keep well out of sight
+static const double COAST_PLAYER_CLEARANCE = 1000000.0;
+
+void BodyActivity::Begin(const std::list<Body*> &bodies, float step)
+{
+	for (std::list<Body*>::const_iterator i = bodies.begin(); i != bodies.end(); ++i) {
+		Body *b = *i;
+		b->m_activityPending += step;
+
+		if (++b->m_activityTicks < b->m_activityStride) {
+			b->m_stepping = false;
+			// nothing to interpolate from while it's waiting
+			if (b->IsType(Object::DYNAMICBODY)) {
+				DynamicBody *db = static_cast<DynamicBody*>(b);
+				db->m_oldPos = db->GetPosition();
+				db->m_oldAngDisplacement = vector3d(0.0);
+			}
+			continue;
+		}
+
+		b->m_stepping = true;
+		b->m_stepTime = b->m_activityPending;
+		b->m_activityPending = 0.0f;
+		b->m_activityTicks = 0;
+	}
+}
+
+void BodyActivity::Assess(const std::list<Body*> &bodies, const ProximityIndex &proximity, const Body *player, float step)
+{
+	for (std::list<Body*>::const_iterator i = bodies.begin(); i != bodies.end(); ++i) {
+		Body *b = *i;
+		if (!b->m_stepping || b->IsDead()) continue;
+
+		switch (b->GetActivity()) {
+			case Body::RESTING: b->m_activityStride = REST_STRIDE; break;
+			case Body::COASTING: b->m_activityStride = CoastStride(b, proximity, player, step); break;
+			default: b->m_activityStride = 1; break;
+		}
+	}
+}
+
+namespace {
+	class CoastReach : public ProximityIndex::Reach {
+	public:
+		CoastReach(double reach) : m_reach(reach) {}
+		virtual double operator()(double physRadius) const { return physRadius + m_reach; }
+	private:
+		double m_reach;
+	};
+}
+
+Uint32 BodyActivity::CoastStride(const Body *b, const ProximityIndex &proximity, const Body *player, float step)
+{
+	if (!b->IsType(Object::DYNAMICBODY) || !b->GetFrame()) return 1;
+	const DynamicBody *db = static_cast<const DynamicBody*>(b);
+	if (!db->IsMoving()) return 1;
+
+	// rotating frames are where the atmospheres and the fast orbits are
+	const Frame *f = b->GetFrame();
+	if (f->IsRotFrame()) return 1;
+
+	// a longer step is a coarser orbit, so keep how far round the orbit
+	// each one goes small. gravity is only ever from the frame's body, so
+	// the body's distance from the frame centre is its orbital radius
+	double stride = COAST_STRIDE;
+	const double r = b->GetPosition().Length();
+	const double accel = db->GetGravityForce().Length() / db->GetMass();
+	if (r > 0.0 && accel > 0.0)
+		stride = std::min(stride, MAX_COAST_ANGLE / (sqrt(accel / r) * step));
+	if (stride < 2.0) return 1;
+
+	const double travel = b->GetVelocity().Length() * step * stride;
+
+	if (player && player != b && player->GetFrame()) {
+		const double dist = b->GetPositionRelTo(player).Length();
+		const double closing = b->GetVelocityRelTo(player).Length() * step * stride;
+		if (dist < COAST_PLAYER_CLEARANCE + closing) return 1;
+	}
+
+	// anything else that could get near, the body it's coasting around
+	// included. the other body's own speed isn't known here, so allow for
+	// twice our own
+	std::vector<Body*> near;
+	proximity.FindInReach(f, b->GetPosition(), CoastReach(b->GetPhysRadius() + 2.0 * travel + COAST_CLEARANCE), Object::BODY, near);
+	for (std::vector<Body*>::const_iterator i = near.begin(); i != near.end(); ++i)
+		if (*i != b) return 1;
+
+	return Uint32(stride);
+}
@@ -0,0 +1,46 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _BODYACTIVITY_H
+#define _BODYACTIVITY_H
+
+#include "libs.h"
+#include <list>
+
+class Body;
+class ProximityIndex;
+
+/*
+ * Lets bodies with nothing going on skip steps, which is where a crowded
+ * system spends its time at high time acceleration. Each body has a
+ * stride, the number of steps it takes in one go. It skips UpdateFrame,
+ * StaticUpdate and TimeStepUpdate until its stride is up, then steps once
+ * for all the time it skipped and has its stride worked out again.
+ *
+ * Ships docked or landed with no AI command (Body::RESTING) sleep for
+ * REST_STRIDE steps; the station keeps docked ones in place meanwhile.
+ * Bodies coasting under gravity alone (Body::COASTING), AI ships cruising
+ * with their thrusters off included (AICommand::IsCoasting), take up to
+ * COAST_STRIDE steps at once, if the longer step only carries them a
+ * little way round their orbit, they're out of any rotating frame and
+ * nothing, the player included, could come near them before it's up.
+ * Everything else steps every time.
+ *
+ * A body's stride goes back to one as soon as something happens to it
+ * (Body::Wake): new AI orders, thrust, damage, a collision, undocking and
+ * the like.
+ */
+class BodyActivity {
+public:
+	// which bodies step this time and for how long. at the start of the
+	// step, before anything moves
+	static void Begin(const std::list<Body*> &bodies, float step);
+	// new strides for the bodies stepping this time, from where everything
+	// was at the start of it
+	static void Assess(const std::list<Body*> &bodies, const ProximityIndex &proximity, const Body *player, float step);
+
+private:
+	static Uint32 CoastStride(const Body *b, const ProximityIndex &proximity, const Body *player, float step);
+};
+
+#endif /* _BODYACTIVITY_H */
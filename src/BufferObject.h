@@ -15,6 +15,9 @@ public:
 	BufferObject() {
 		m_elementsTempDirty = false;
 		m_vertexPos = 0;
+		m_vertexArrayBufferObject = m_elementArrayBufferObject = 0;
+		// headless, there's nothing to upload to and nothing gets drawn
+		if (!Graphics::IsContextAvailable()) return;
 		glGenBuffersARB(1, &m_vertexArrayBufferObject);
 		glGenBuffersARB(1, &m_elementArrayBufferObject);
 		Graphics::BindArrayBuffer(m_vertexArrayBufferObject);
@@ -23,6 +26,7 @@ public:
 	}
 
 	~BufferObject() {
+		if (!m_vertexArrayBufferObject) return;
 		glDeleteBuffersARB(1, &m_vertexArrayBufferObject);
 		glDeleteBuffersARB(1, &m_elementArrayBufferObject);
 	}
@@ -35,10 +39,12 @@ public:
 	int AddGeometry(int numVertices, void *vtxData, int numIndices, Uint16 *idxData) {
 		assert(GetVertexSpaceLeft() >= numVertices);
 
-		Graphics::BindArrayBuffer(m_vertexArrayBufferObject);
-		glBufferSubDataARB(GL_ARRAY_BUFFER_ARB, m_vertexPos*VERTEX_SIZE,
-			numVertices * VERTEX_SIZE, vtxData);
-		Graphics::BindArrayBuffer(0);
+		if (m_vertexArrayBufferObject) {
+			Graphics::BindArrayBuffer(m_vertexArrayBufferObject);
+			glBufferSubDataARB(GL_ARRAY_BUFFER_ARB, m_vertexPos*VERTEX_SIZE,
+				numVertices * VERTEX_SIZE, vtxData);
+			Graphics::BindArrayBuffer(0);
+		}
 
 		const int indexBase = m_elementsTemp.size();
 		for (int i=0; i<numIndices; i++) {
@@ -16,6 +16,7 @@ public:
 	CargoBody(Equip::Type t);
 	CargoBody() {}
 	Equip::Type GetCargoType() const { return m_type; }
+	virtual Activity GetActivity() const { return COASTING; }
 	virtual void Render(Graphics::Renderer *r, const Camera *camera, const vector3d &viewCoords, const matrix4x4d &viewTransform);
 	virtual bool OnCollision(Object *o, Uint32 flags, double relVel);
 	virtual bool OnDamage(Object *attacker, float kgDamage);
@@ -227,6 +227,7 @@ vector3d DynamicBody::GetVelocity() const
 void DynamicBody::SetVelocity(const vector3d &v)
 {
 	m_vel = v;
+	Wake();
 }
 
 vector3d DynamicBody::GetAngVelocity() const
@@ -237,6 +238,7 @@ vector3d DynamicBody::GetAngVelocity() const
 void DynamicBody::SetAngVelocity(const vector3d &v)
 {
 	m_angVel = v;
+	Wake();
 }
 
 #define KINETIC_ENERGY_MULT	0.00001f
@@ -51,6 +51,8 @@ protected:
 	virtual void Save(Serializer::Writer &wr, Space *space);
 	virtual void Load(Serializer::Reader &rd, Space *space);
 private:
+	friend class BodyActivity;
+
 	vector3d m_oldPos;
 	vector3d m_oldAngDisplacement;
 
@@ -338,6 +338,18 @@ void Faction::Init()
 	StarSystem::ShrinkCache();    // clear the star system cache of anything we used for faction generation
 }
 
+void Faction::InitHomeSectors()
+{
+	// systems are generated on worker threads later, and they all want
+	// these, so they're built now rather than on first use
+	for (FactionIterator it = s_factions.begin(); it != s_factions.end(); ++it) {
+		Faction *fac = *it;
+		if (!fac->hasHomeworld) continue;
+		fac->m_homesector = new Sector(fac->homeworld.sectorX, fac->homeworld.sectorY, fac->homeworld.sectorZ);
+		assert(size_t(fac->homeworld.systemIndex) < fac->m_homesector->m_systems.size());
+	}
+}
+
 void Faction::Uninit()
 {
 	for (FactionIterator it = s_factions.begin(); it != s_factions.end(); ++it) {
@@ -375,7 +387,7 @@ const Uint32 Faction::GetNumFactions()
 	if it is, then the passed distance will also be updated to be the distance
 	from the factions homeworld to the sysPath.
 */
-const bool Faction::IsCloserAndContains(double& closestFactionDist, const Sector sec, Uint32 sysIndex)
+const bool Faction::IsCloserAndContains(double& closestFactionDist, const Sector &sec, Uint32 sysIndex)
 {
 	/*	Treat factions without homeworlds as if they are of effectively infinite radius,
 		so every world is potentially within their borders, but also treat them as if
@@ -394,7 +406,8 @@ const bool Faction::IsCloserAndContains(double& closestFactionDist, const Sector
 		/* ...otherwise we need to calculate whether the world is inside the
 		   the faction border, and how far away it is. */
 		else {
-			if (!m_homesector) m_homesector = new Sector(homeworld.sectorX, homeworld.sectorY, homeworld.sectorZ);
+			assert(m_homesector);
+			assert(size_t(homeworld.systemIndex) < m_homesector->m_systems.size());
 			distance = Sector::DistanceBetween(m_homesector, homeworld.systemIndex, &sec, sysIndex);
 			inside   = distance < Radius();
 		}
@@ -412,7 +425,7 @@ const bool Faction::IsCloserAndContains(double& closestFactionDist, const Sector
 	}
 }
 
-Faction* Faction::GetNearestFaction(const Sector sec, Uint32 sysIndex)
+Faction* Faction::GetNearestFaction(const Sector &sec, Uint32 sysIndex)
 {
 	/* firstly if this a custom StarSystem it may already have a faction assigned
 	*/
@@ -424,9 +437,9 @@ Faction* Faction::GetNearestFaction(const Sector sec, Uint32 sysIndex)
 	*/
 	Faction*    result             = &s_no_faction;
 	double      closestFactionDist = HUGE_VAL;
-	FactionList candidates         = s_spatial_index.CandidateFactions(sec, sysIndex);
+	const FactionList &candidates  = s_spatial_index.CandidateFactions(sec, sysIndex);
 
-	for (FactionIterator it = candidates.begin(); it != candidates.end(); ++it) {
+	for (FactionList::const_iterator it = candidates.begin(); it != candidates.end(); ++it) {
 		if ((*it)->IsCloserAndContains(closestFactionDist, sec, sysIndex)) result = *it;
 	}
 	return result;
@@ -538,7 +551,7 @@ void FactionOctsapling::Add(Faction* faction)
 		This part happens at faction generation time so shouldn't be too performance
 		critical
 	*/
-	Sector sec = Sector(faction->homeworld.sectorX, faction->homeworld.sectorY, faction->homeworld.sectorZ);
+	const Sector sec(faction->homeworld.sectorX, faction->homeworld.sectorY, faction->homeworld.sectorZ);
 
 	/* only factions with homeworlds that are available at faction generation time can
 	   be added to specific cells...
@@ -546,7 +559,7 @@ void FactionOctsapling::Add(Faction* faction)
 	if (faction->hasHomeworld && (faction->homeworld.systemIndex < sec.m_systems.size())) {
 		/* calculate potential indexes for the octbox cells the faction needs to go into
 		*/
-		Sector::System sys = sec.m_systems[faction->homeworld.systemIndex];
+		const Sector::System &sys = sec.m_systems[faction->homeworld.systemIndex];
 
 		int xmin = BoxIndex(Sint32(sys.FullPosition().x - float((faction->Radius()))));
 		int xmax = BoxIndex(Sint32(sys.FullPosition().x + float((faction->Radius()))));
@@ -603,12 +616,12 @@ void FactionOctsapling::PruneDuplicates(const int bx, const int by, const int bz
 	octbox[bx][by][bz].erase(std::unique( octbox[bx][by][bz].begin(), octbox[bx][by][bz].end() ), octbox[bx][by][bz].end() );
 }
 
-std::vector<Faction*> FactionOctsapling::CandidateFactions(const Sector sec, Uint32 sysIndex)
+const std::vector<Faction*> &FactionOctsapling::CandidateFactions(const Sector &sec, Uint32 sysIndex) const
 {
 	/* answer the factions that we've put in the same octobox cell as the one the
 	   system would go in. This part happens every time we do GetNearest faction
 	   so *is* performance criticale.e
 	*/
-	Sector::System sys = sec.m_systems[sysIndex];
+	const Sector::System &sys = sec.m_systems[sysIndex];
 	return octbox[BoxIndex(sys.sx)][BoxIndex(sys.sy)][BoxIndex(sys.sz)];
 }
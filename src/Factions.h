@@ -17,12 +17,15 @@
 class Faction : public DeleteEmitter {
 public:
 	static void Init();
+	// home sectors include custom systems, so this has to wait for
+	// CustomSystem::Init. it must run before anything generates systems
+	static void InitHomeSectors();
 	static void Uninit();
 
 	// XXX this is not as const-safe as it should be
 	static Faction *GetFaction       (const Uint32 index);
 	static Faction *GetFaction       (const std::string factionName);
-	static Faction *GetNearestFaction(const Sector sec, Uint32 sysIndex);
+	static Faction *GetNearestFaction(const Sector &sec, Uint32 sysIndex);
 	static bool     IsHomeSystem     (const SystemPath& sysPath);
 
 	static const Uint32 GetNumFactions();
@@ -76,8 +79,8 @@ public:
 private:
 	static const double FACTION_CURRENT_YEAR;	// used to calculate faction radius
 
-	Sector* m_homesector;						// cache of home sector to use in distance calculations
-	const bool IsCloserAndContains(double& closestFactionDist, const Sector sec, Uint32 sysIndex);
+	Sector* m_homesector;						// home sector to use in distance calculations, without factions assigned. built by InitHomeSectors
+	const bool IsCloserAndContains(double& closestFactionDist, const Sector &sec, Uint32 sysIndex);
 };
 
 /* One day it might grow up to become a full tree, on the  other hand it might be
@@ -88,11 +91,11 @@ private:
 class FactionOctsapling {
 public:
 	void Add(Faction* faction);
-	std::vector<Faction*> CandidateFactions(const Sector sec, Uint32 sysIndex);
+	const std::vector<Faction*> &CandidateFactions(const Sector &sec, Uint32 sysIndex) const;
 
 private:
 	std::vector<Faction*> octbox[2][2][2];
-	const int BoxIndex(Sint32 sectorIndex) { return sectorIndex < 0 ? 0: 1; };
+	const int BoxIndex(Sint32 sectorIndex) const { return sectorIndex < 0 ? 0: 1; };
 	void PruneDuplicates(const int bx, const int by, const int bz);
 };
 
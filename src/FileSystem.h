@@ -155,6 +155,11 @@ namespace FileSystem {
 		virtual RefCountedPtr<FileData> ReadFile(const std::string &path) = 0;
 		virtual bool ReadDirectory(const std::string &path, std::vector<FileInfo> &output) = 0;
 
+		// like ReadFile, but the data may be mapped straight from the file
+		// and only read in by the OS as it's touched. sources that can't
+		// do that just read the file
+		virtual RefCountedPtr<FileData> MapFile(const std::string &path) { return ReadFile(path); }
+
 		bool IsTrusted() const { return m_trusted; }
 
 	protected:
@@ -173,6 +178,7 @@ namespace FileSystem {
 		virtual FileInfo Lookup(const std::string &path);
 		virtual RefCountedPtr<FileData> ReadFile(const std::string &path);
 		virtual bool ReadDirectory(const std::string &path, std::vector<FileInfo> &output);
+		virtual RefCountedPtr<FileData> MapFile(const std::string &path);
 
 		bool MakeDirectory(const std::string &path);
 
@@ -184,6 +190,8 @@ namespace FileSystem {
 		FILE* OpenReadStream(const std::string &path);
 		// similar to fopen(path, "wb")
 		FILE* OpenWriteStream(const std::string &path, int flags = 0);
+		// deletes a file (not a directory); returns false if it couldn't
+		bool RemoveFile(const std::string &path);
 	};
 
 	class FileSourceUnion : public FileSource {
@@ -201,6 +209,7 @@ namespace FileSystem {
 		virtual FileInfo Lookup(const std::string &path);
 		virtual RefCountedPtr<FileData> ReadFile(const std::string &path);
 		virtual bool ReadDirectory(const std::string &path, std::vector<FileInfo> &output);
+		virtual RefCountedPtr<FileData> MapFile(const std::string &path);
 
 	private:
 		std::vector<FileSource*> m_sources;
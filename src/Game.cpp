@@ -24,7 +24,7 @@
 #include "FileSystem.h"
 #include "graphics/Renderer.h"
 
-static const int  s_saveVersion   = 60;
+static const int  s_saveVersion   = 61;
 static const char s_saveStart[]   = "PIONEER";
 static const char s_saveEnd[]     = "END";
 
@@ -240,7 +240,7 @@ void Game::TimeStep(float step)
 	m_space->TimeStep(step);
 
 	// XXX ui updates, not sure if they belong here
-	Pi::cpan->TimeStepUpdate(step);
+	if (Pi::cpan) Pi::cpan->TimeStepUpdate(step);
 	Sfx::TimeStepAll(step, m_space->GetRootFrame());
 
 	if (m_state == STATE_HYPERSPACE) {
@@ -261,6 +261,17 @@ void Game::TimeStep(float step)
 	}
 }
 
+// the furthest a body of a given radius can be and still hold timeaccel
+// down, going by the checks in UpdateTimeAccel
+namespace {
+	class TimeAccelReach : public ProximityIndex::Reach {
+	public:
+		virtual double operator()(double rad) const {
+			return std::max(1000.0, std::min(rad+0.1*AU, rad*1000.0));
+		}
+	};
+}
+
 bool Game::UpdateTimeAccel()
 {
 	// don't modify the timeaccel if the game is paused
@@ -294,7 +305,9 @@ bool Game::UpdateTimeAccel()
 
 		else if (!m_forceTimeAccel) {
 			// check we aren't too near to objects for timeaccel //
-			for (Space::BodyIterator i = m_space->BodiesBegin(); i != m_space->BodiesEnd(); ++i) {
+			std::vector<Body*> nearby;
+			m_space->GetProximityIndex().FindInReach(m_player->GetFrame(), m_player->GetPosition(), TimeAccelReach(), Object::BODY, nearby);
+			for (std::vector<Body*>::const_iterator i = nearby.begin(); i != nearby.end(); ++i) {
 				if ((*i) == m_player) continue;
 				if ((*i)->IsType(Object::HYPERSPACECLOUD)) continue;
 
@@ -593,6 +606,9 @@ void Game::CreateViews()
 	Pi::game = this;
 	Pi::player = m_player.Get();
 
+	// nothing to show them on
+	if (Pi::IsHeadless()) return;
+
 	Pi::cpan = new ShipCpanel(Pi::renderer);
 	Pi::sectorView = new SectorView();
 	Pi::worldView = new WorldView();
@@ -627,6 +643,14 @@ void Game::LoadViews(Serializer::Reader &rd)
 	Pi::game = this;
 	Pi::player = m_player.Get();
 
+	// nothing to show them on, but the sections still need reading past
+	if (Pi::IsHeadless()) {
+		rd.RdSection("ShipCpanel");
+		rd.RdSection("SectorView");
+		rd.RdSection("WorldView");
+		return;
+	}
+
 	Serializer::Reader section = rd.RdSection("ShipCpanel");
 	Pi::cpan = new ShipCpanel(section, Pi::renderer);
 
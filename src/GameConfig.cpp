@@ -17,6 +17,14 @@ GameConfig::GameConfig()
 	map["ScrHeight"] = "600";
 	map["DetailCities"] = "1";
 	map["DetailPlanets"] = "1";
+	map["TerrainWorkerThreads"] = "0"; // 0 = pick from core count
+	map["TerrainSplitsPerFrame"] = "16";
+	map["TerrainCacheSizeMB"] = "128"; // 0 = no terrain cache
+	map["TerrainCacheColors"] = "1";
+	map["SimWorkerThreads"] = "0"; // 0 = pick from core count
+	map["SectorCacheSizeMB"] = "64"; // 0 = build sectors afresh each time
+	map["StarSystemCacheSizeMB"] = "16"; // 0 = keep only systems in use
+	map["GalaxyWorkerThreads"] = "0"; // 0 = pick from core count
 	map["SfxVolume"] = "0.8";
 	map["EnableJoystick"] = "1";
 	map["InvertMouseY"] = "0";
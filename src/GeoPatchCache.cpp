@@ -0,0 +1,353 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "GeoPatchCache.h"
+#include "FileSystem.h"
+#include "CRC32.h"
+#include <list>
+#include <cstring>
+
+extern "C" {
+#include "miniz/miniz.h"
+}
+
+namespace GeoPatchCache {
+
+static const char CACHE_DIR[] = "terrain_cache";
+static const char INDEX_FILE[] = "index";
+static const Uint32 s_cacheVersion = 1;
+
+struct Entry {
+	std::string name;
+	Uint32 size;
+};
+typedef std::list<Entry> EntryList;
+
+// most recently used first
+static EntryList s_entries;
+static std::map<std::string, EntryList::iterator> s_entriesByName;
+static Uint64 s_totalSize = 0;
+static Uint64 s_maxSize = 0;
+static bool s_storeColors = false;
+static SDL_mutex *s_lock = 0;
+
+template <typename T>
+static void append_pod(std::string &out, const T &v)
+{
+	out.append(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+static void append_string(std::string &out, const std::string &s)
+{
+	append_pod(out, Uint32(s.size()));
+	out.append(s);
+}
+
+// the key is written out in full at the top of each entry, so a clash
+// between file names is caught when it's loaded
+static std::string serialize_key(const Key &key)
+{
+	std::string out;
+	append_pod(out, key.body.sectorX);
+	append_pod(out, key.body.sectorY);
+	append_pod(out, key.body.sectorZ);
+	append_pod(out, key.body.systemIndex);
+	append_pod(out, key.body.bodyIndex);
+	append_pod(out, key.seed);
+	append_string(out, key.heightFractal);
+	append_string(out, key.colorFractal);
+	append_pod(out, Sint32(key.edgeLen));
+	append_pod(out, Sint32(key.fracmult));
+	append_pod(out, Sint32(key.textures));
+	append_pod(out, key.patchPath);
+	return out;
+}
+
+static std::string entry_name(const std::string &keyData)
+{
+	CRC32 crc;
+	crc.AddData(keyData.data(), int(keyData.size()));
+	// fnv-1a
+	Uint32 fnv = 2166136261u;
+	for (size_t i = 0; i < keyData.size(); i++) {
+		fnv ^= Uint8(keyData[i]);
+		fnv *= 16777619u;
+	}
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%08x%08x.bin", crc.GetChecksum(), fnv);
+	return buf;
+}
+
+// must hold s_lock. pops entries off the cold end until we're under the
+// cap, leaving their files for the caller to delete outside the lock
+static void evict(std::vector<std::string> &removed)
+{
+	while (s_totalSize > s_maxSize && !s_entries.empty()) {
+		const Entry &e = s_entries.back();
+		s_totalSize -= e.size;
+		removed.push_back(e.name);
+		s_entriesByName.erase(e.name);
+		s_entries.pop_back();
+	}
+}
+
+static void remove_files(const std::vector<std::string> &names)
+{
+	for (std::vector<std::string>::const_iterator i = names.begin(); i != names.end(); ++i)
+		FileSystem::userFiles.RemoveFile(FileSystem::JoinPath(CACHE_DIR, *i));
+}
+
+static void forget(const std::string &name)
+{
+	PiVerify(SDL_mutexP(s_lock)==0);
+	std::map<std::string, EntryList::iterator>::iterator i = s_entriesByName.find(name);
+	const bool found = (i != s_entriesByName.end());
+	if (found) {
+		s_totalSize -= i->second->size;
+		s_entries.erase(i->second);
+		s_entriesByName.erase(i);
+	}
+	PiVerify(SDL_mutexV(s_lock)!=-1);
+	if (found)
+		FileSystem::userFiles.RemoveFile(FileSystem::JoinPath(CACHE_DIR, name));
+}
+
+static Uint32 file_size(const std::string &name)
+{
+	FILE *f = FileSystem::userFiles.OpenReadStream(FileSystem::JoinPath(CACHE_DIR, name));
+	if (!f) return 0;
+	fseek(f, 0, SEEK_END);
+	const long size = ftell(f);
+	fclose(f);
+	return (size > 0) ? Uint32(size) : 0;
+}
+
+// the index keeps the order entries were last used in between runs.
+// anything in the directory that the index doesn't know about (say, after
+// a crash) is taken on as least recently used
+static void load_index()
+{
+	std::vector<std::pair<std::string,Uint32> > indexed;
+	bool versionOk = false;
+
+	FILE *f = FileSystem::userFiles.OpenReadStream(FileSystem::JoinPath(CACHE_DIR, INDEX_FILE));
+	if (f) {
+		unsigned int version;
+		if (fscanf(f, "%u", &version) == 1 && version == s_cacheVersion) {
+			versionOk = true;
+			char name[64];
+			unsigned int size;
+			while (fscanf(f, "%63s %u", name, &size) == 2)
+				indexed.push_back(std::make_pair(std::string(name), Uint32(size)));
+		}
+		fclose(f);
+	}
+
+	std::vector<FileSystem::FileInfo> files;
+	FileSystem::userFiles.ReadDirectory(CACHE_DIR, files);
+	std::map<std::string,bool> present;
+	std::vector<std::string> stale;
+	for (std::vector<FileSystem::FileInfo>::const_iterator i = files.begin(); i != files.end(); ++i) {
+		if (!i->IsFile()) continue;
+		const std::string name = i->GetName();
+		if (name == INDEX_FILE) continue;
+		if (versionOk)
+			present[name] = false;
+		else
+			stale.push_back(name);
+	}
+	remove_files(stale);
+
+	for (std::vector<std::pair<std::string,Uint32> >::const_iterator i = indexed.begin(); i != indexed.end(); ++i) {
+		std::map<std::string,bool>::iterator p = present.find(i->first);
+		if (p == present.end() || p->second) continue;
+		p->second = true;
+		Entry e;
+		e.name = i->first;
+		e.size = i->second;
+		s_entriesByName[e.name] = s_entries.insert(s_entries.end(), e);
+		s_totalSize += e.size;
+	}
+	for (std::map<std::string,bool>::const_iterator p = present.begin(); p != present.end(); ++p) {
+		if (p->second) continue;
+		Entry e;
+		e.name = p->first;
+		e.size = file_size(e.name);
+		s_entriesByName[e.name] = s_entries.insert(s_entries.end(), e);
+		s_totalSize += e.size;
+	}
+
+	// the cap may have come down since last time
+	std::vector<std::string> removed;
+	evict(removed);
+	remove_files(removed);
+}
+
+static void save_index()
+{
+	FILE *f = FileSystem::userFiles.OpenWriteStream(FileSystem::JoinPath(CACHE_DIR, INDEX_FILE), FileSystem::FileSourceFS::WRITE_TEXT);
+	if (!f) return;
+	fprintf(f, "%u\n", s_cacheVersion);
+	for (EntryList::const_iterator i = s_entries.begin(); i != s_entries.end(); ++i)
+		fprintf(f, "%s %u\n", i->name.c_str(), i->size);
+	fclose(f);
+}
+
+void Init(Uint64 maxBytes, bool storeColors)
+{
+	s_maxSize = maxBytes;
+	s_storeColors = storeColors;
+	if (!IsEnabled()) return;
+
+	s_lock = SDL_CreateMutex();
+	FileSystem::userFiles.MakeDirectory(CACHE_DIR);
+	load_index();
+}
+
+void Uninit()
+{
+	if (!IsEnabled()) return;
+
+	save_index();
+	s_entries.clear();
+	s_entriesByName.clear();
+	s_totalSize = 0;
+	s_maxSize = 0;
+	SDL_DestroyMutex(s_lock);
+	s_lock = 0;
+}
+
+bool IsEnabled()
+{
+	return (s_maxSize > 0);
+}
+
+// heights are stored byte-plane by byte-plane: the sign, exponent and top of
+// the mantissa hardly change across a patch, so those planes squash well
+static void shuffle_heights(const double *heights, int numHeights, Uint8 *out)
+{
+	const Uint8 *in = reinterpret_cast<const Uint8*>(heights);
+	for (int b = 0; b < int(sizeof(double)); b++)
+		for (int i = 0; i < numHeights; i++)
+			*out++ = in[i*sizeof(double) + b];
+}
+
+static void unshuffle_heights(const Uint8 *in, int numHeights, double *heights)
+{
+	Uint8 *out = reinterpret_cast<Uint8*>(heights);
+	for (int b = 0; b < int(sizeof(double)); b++)
+		for (int i = 0; i < numHeights; i++)
+			out[i*sizeof(double) + b] = *in++;
+}
+
+static bool read_entry(FILE *f, const std::string &keyData, double *heights, int numHeights, Uint8 *colors, int numColors, bool &gotColors)
+{
+	Uint32 header[5];
+	if (fread(header, sizeof(Uint32), 2, f) != 2) return false;
+	if (header[0] != s_cacheVersion || header[1] != keyData.size()) return false;
+
+	std::vector<char> storedKey(keyData.size());
+	if (fread(&storedKey[0], 1, storedKey.size(), f) != storedKey.size()) return false;
+	if (memcmp(&storedKey[0], keyData.data(), keyData.size()) != 0) return false;
+
+	if (fread(&header[2], sizeof(Uint32), 3, f) != 3) return false;
+	const Uint32 storedHeights = header[2], storedColors = header[3], compressedSize = header[4];
+	if (storedHeights != Uint32(numHeights)) return false;
+	if (storedColors != 0 && (!colors || storedColors != Uint32(numColors))) return false;
+	if (compressedSize == 0) return false;
+
+	std::vector<Uint8> compressed(compressedSize);
+	if (fread(&compressed[0], 1, compressedSize, f) != compressedSize) return false;
+
+	const Uint32 rawSize = storedHeights*sizeof(double) + storedColors*3;
+	std::vector<Uint8> raw(rawSize);
+	mz_ulong outSize = rawSize;
+	if (mz_uncompress(&raw[0], &outSize, &compressed[0], compressedSize) != MZ_OK || outSize != rawSize)
+		return false;
+
+	unshuffle_heights(&raw[0], numHeights, heights);
+	gotColors = (storedColors != 0);
+	if (gotColors)
+		memcpy(colors, &raw[storedHeights*sizeof(double)], storedColors*3);
+	return true;
+}
+
+bool Load(const Key &key, double *heights, int numHeights, Uint8 *colors, int numColors, bool &gotColors)
+{
+	if (!IsEnabled()) return false;
+
+	const std::string keyData = serialize_key(key);
+	const std::string name = entry_name(keyData);
+
+	PiVerify(SDL_mutexP(s_lock)==0);
+	std::map<std::string, EntryList::iterator>::iterator i = s_entriesByName.find(name);
+	const bool found = (i != s_entriesByName.end());
+	if (found)
+		s_entries.splice(s_entries.begin(), s_entries, i->second);
+	PiVerify(SDL_mutexV(s_lock)!=-1);
+	if (!found) return false;
+
+	FILE *f = FileSystem::userFiles.OpenReadStream(FileSystem::JoinPath(CACHE_DIR, name));
+	bool ok = false;
+	if (f) {
+		ok = read_entry(f, keyData, heights, numHeights, colors, numColors, gotColors);
+		fclose(f);
+	}
+	// whatever's there is no use to us; the caller will store a fresh one
+	if (!ok) forget(name);
+	return ok;
+}
+
+void Store(const Key &key, const double *heights, int numHeights, const Uint8 *colors, int numColors)
+{
+	if (!IsEnabled()) return;
+	if (!s_storeColors || !colors) numColors = 0;
+
+	const std::string keyData = serialize_key(key);
+	const std::string name = entry_name(keyData);
+
+	const Uint32 rawSize = numHeights*sizeof(double) + numColors*3;
+	std::vector<Uint8> raw(rawSize);
+	shuffle_heights(heights, numHeights, &raw[0]);
+	if (numColors)
+		memcpy(&raw[numHeights*sizeof(double)], colors, numColors*3);
+
+	mz_ulong compressedSize = mz_compressBound(rawSize);
+	std::vector<Uint8> compressed(compressedSize);
+	if (mz_compress(&compressed[0], &compressedSize, &raw[0], rawSize) != MZ_OK)
+		return;
+
+	FILE *f = FileSystem::userFiles.OpenWriteStream(FileSystem::JoinPath(CACHE_DIR, name));
+	if (!f) return;
+	const Uint32 header[2] = { s_cacheVersion, Uint32(keyData.size()) };
+	const Uint32 sizes[3] = { Uint32(numHeights), Uint32(numColors), Uint32(compressedSize) };
+	bool ok = (fwrite(header, sizeof(Uint32), 2, f) == 2);
+	ok = ok && (fwrite(keyData.data(), 1, keyData.size(), f) == keyData.size());
+	ok = ok && (fwrite(sizes, sizeof(Uint32), 3, f) == 3);
+	ok = ok && (fwrite(&compressed[0], 1, compressedSize, f) == compressedSize);
+	ok = (fclose(f) == 0) && ok;
+	if (!ok) {
+		FileSystem::userFiles.RemoveFile(FileSystem::JoinPath(CACHE_DIR, name));
+		return;
+	}
+
+	Entry e;
+	e.name = name;
+	e.size = sizeof(header) + keyData.size() + sizeof(sizes) + compressedSize;
+
+	std::vector<std::string> removed;
+	PiVerify(SDL_mutexP(s_lock)==0);
+	std::map<std::string, EntryList::iterator>::iterator i = s_entriesByName.find(name);
+	if (i != s_entriesByName.end()) {
+		s_totalSize -= i->second->size;
+		s_entries.erase(i->second);
+	}
+	s_entriesByName[name] = s_entries.insert(s_entries.begin(), e);
+	s_totalSize += e.size;
+	evict(removed);
+	PiVerify(SDL_mutexV(s_lock)!=-1);
+
+	remove_files(removed);
+}
+
+}
@@ -0,0 +1,46 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _GEOPATCHCACHE_H
+#define _GEOPATCHCACHE_H
+
+#include "libs.h"
+#include "galaxy/SystemPath.h"
+
+/*
+ * On-disk cache of generated terrain patches, kept in the user dir. Entries
+ * hold a patch's heights (and optionally its colours), compressed, and are
+ * thrown out least recently used first once the cache grows past its size
+ * cap. Safe to call from any thread.
+ */
+
+namespace GeoPatchCache
+{
+	// everything that decides what a patch's heights come out as
+	struct Key {
+		SystemPath body;
+		Uint32 seed;
+		std::string heightFractal;
+		std::string colorFractal;
+		int edgeLen;
+		int fracmult;
+		int textures;
+		// 1, then the root patch (3 bits), then the kid taken at each
+		// level (2 bits each)
+		Uint64 patchPath;
+	};
+
+	// maxBytes of 0 turns the cache off
+	void Init(Uint64 maxBytes, bool storeColors);
+	void Uninit();
+
+	bool IsEnabled();
+
+	// fills in heights, and colors (3 bytes per colour) if the entry has
+	// them. returns false on a miss, or if the entry is a different size
+	bool Load(const Key &key, double *heights, int numHeights, Uint8 *colors, int numColors, bool &gotColors);
+	// colors may be 0
+	void Store(const Key &key, const double *heights, int numHeights, const Uint8 *colors, int numColors);
+}
+
+#endif /* _GEOPATCHCACHE_H */
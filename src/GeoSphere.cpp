@@ -12,17 +12,24 @@
 #include "graphics/Graphics.h"
 #include "graphics/VertexArray.h"
 #include "graphics/gl2/GeoSphereMaterial.h"
+#include "JobQueue.h"
+#include "GeoPatchCache.h"
 #include "vcacheopt/vcacheopt.h"
-#include <deque>
 #include <algorithm>
 
 // tri edge lengths
 #define GEOPATCH_SUBDIVIDE_AT_CAMDIST	5.0
 #define GEOPATCH_MAX_DEPTH  15 + (2*Pi::detail.fracmult) //15
-#define GEOSPHERE_USE_THREADING
 
 static const int GEOPATCH_MAX_EDGELEN = 55;
-int GeoSphere::s_vtxGenCount = 0;
+
+// collision heights come from a lattice laid out on each face of the cube
+// the sphere is blown up from, in steps of at most this many metres along
+// the face (which is never more than that across the sphere). lattice
+// points are keyed by their face and coordinates on it
+static const double LATTICE_SPACING = 25.0;
+static const int LATTICE_COORD_BITS = 21;
+static const int LATTICE_MAX_CACHED = 65536;
 RefCountedPtr<GeoPatchContext> GeoSphere::s_patchContext;
 
 // must be odd numbers
@@ -32,19 +39,51 @@ static const int detail_edgeLen[5] = {
 
 #define PRINT_VECTOR(_v) printf("%f,%f,%f\n", (_v).x, (_v).y, (_v).z);
 
+// a patch keeps its vertices in the form the vbo wants them, so they can be
+// uploaded as they are. positions are relative to the patch's clipCentroid,
+// which keeps floats precise enough even for the deepest patches
 #pragma pack(4)
-struct VBOVertex
+struct GeoPatchVertex
 {
 	float x,y,z;
-	float nx,ny,nz;
 	unsigned char col[4];
-	float padding;
+	Sint16 nx,ny,nz;
+	Sint16 padding;
 };
 #pragma pack()
 
 // hold the 16 possible terrain edge connections
 const int NUM_INDEX_LISTS = 16;
 
+// the render thread walks the patch tree without taking any locks. a worker
+// fills in a patch's kids completely and then publishes them with a single
+// pointer store; these make sure everything written before the store is seen
+// by a reader that sees the pointer
+#if defined(_MSC_VER)
+// x86 keeps stores in order and loads in order, so it's only the compiler
+// that needs holding back
+#include <intrin.h>
+#pragma intrinsic(_ReadWriteBarrier)
+#define GEOSPHERE_WRITE_BARRIER() _ReadWriteBarrier()
+#define GEOSPHERE_READ_BARRIER() _ReadWriteBarrier()
+#elif defined(__i386__) || defined(__x86_64__)
+#define GEOSPHERE_WRITE_BARRIER() __sync_synchronize()
+#define GEOSPHERE_READ_BARRIER() __asm__ __volatile__("" ::: "memory")
+#else
+#define GEOSPHERE_WRITE_BARRIER() __sync_synchronize()
+#define GEOSPHERE_READ_BARRIER() __sync_synchronize()
+#endif
+
+class GeoPatch;
+
+// a patch's four kids, as seen by the render thread. never changed once
+// published; a merge unpublishes the whole block and hands it to
+// GeoSphere::RetireKids(), which frees it once the render thread can no
+// longer be looking at it
+struct GeoPatchKids {
+	GeoPatch *kid[4];
+};
+
 class GeoPatchContext : public RefCounted {
 public:
 	int edgeLen;
@@ -70,14 +109,46 @@ public:
 	GLuint indices_list[NUM_INDEX_LISTS];
 	GLuint indices_tri_count;
 	GLuint indices_tri_counts[NUM_INDEX_LISTS];
-	VBOVertex *vbotemp;
+
+	// patch vertex storage. patches come and go by the thousand when flying
+	// low, so their vertices are carved out of slabs and recycled through a
+	// free list instead of going back to the heap each time
+	enum { PATCHES_PER_SLAB = 16 };
+	SDL_mutex *poolLock;
+	std::vector<GeoPatchVertex*> slabs;
+	std::vector<GeoPatchVertex*> freeVertices;
 
 	GeoPatchContext(int _edgeLen) : edgeLen(_edgeLen) {
+		poolLock = SDL_CreateMutex();
 		Init();
 	}
 
 	~GeoPatchContext() {
 		Cleanup();
+		assert(freeVertices.size() == slabs.size()*PATCHES_PER_SLAB);
+		for (std::vector<GeoPatchVertex*>::iterator i = slabs.begin(); i != slabs.end(); ++i)
+			delete [] *i;
+		SDL_DestroyMutex(poolLock);
+	}
+
+	GeoPatchVertex *AllocVertices() {
+		PiVerify(SDL_mutexP(poolLock)==0);
+		if (freeVertices.empty()) {
+			GeoPatchVertex *slab = new GeoPatchVertex[NUMVERTICES()*PATCHES_PER_SLAB];
+			slabs.push_back(slab);
+			for (int i=PATCHES_PER_SLAB-1; i>=0; i--)
+				freeVertices.push_back(slab + i*NUMVERTICES());
+		}
+		GeoPatchVertex *v = freeVertices.back();
+		freeVertices.pop_back();
+		PiVerify(SDL_mutexV(poolLock)!=-1);
+		return v;
+	}
+
+	void FreeVertices(GeoPatchVertex *v) {
+		PiVerify(SDL_mutexP(poolLock)==0);
+		freeVertices.push_back(v);
+		PiVerify(SDL_mutexV(poolLock)!=-1);
 	}
 
 	void Refresh() {
@@ -99,7 +170,6 @@ public:
 				glDeleteBuffersARB(1, &indices_list[i]);
 			}
 		}
-		delete [] vbotemp;
 	}
 
 	void updateIndexBufferId(const GLuint edge_hi_flags) {
@@ -146,8 +216,6 @@ public:
 	void Init() {
 		frac = 1.0 / double(edgeLen-1);
 
-		vbotemp = new VBOVertex[NUMVERTICES()];
-
 		unsigned short *idx;
 		midIndices.Reset(new unsigned short[VBO_COUNT_MID_IDX()]);
 		for (int i=0; i<4; i++) {
@@ -329,45 +397,24 @@ public:
 		}
 	}
 
-	void GetEdge(vector3d *array, int edge, vector3d *ev) {
-		if (edge == 0) {
-			for (int x=0; x<edgeLen; x++) ev[x] = array[x];
-		} else if (edge == 1) {
-			const int x = edgeLen-1;
-			for (int y=0; y<edgeLen; y++) ev[y] = array[x + y*edgeLen];
-		} else if (edge == 2) {
-			const int y = edgeLen-1;
-			for (int x=0; x<edgeLen; x++) ev[x] = array[(edgeLen-1)-x + y*edgeLen];
-		} else {
-			for (int y=0; y<edgeLen; y++) ev[y] = array[0 + ((edgeLen-1)-y)*edgeLen];
-		}
-	}
-
-	void SetEdge(vector3d *array, int edge, const vector3d *ev) {
-		if (edge == 0) {
-			for (int x=0; x<edgeLen; x++) array[x] = ev[x];
-		} else if (edge == 1) {
-			const int x = edgeLen-1;
-			for (int y=0; y<edgeLen; y++) array[x + y*edgeLen] = ev[y];
-		} else if (edge == 2) {
-			const int y = edgeLen-1;
-			for (int x=0; x<edgeLen; x++) array[(edgeLen-1)-x + y*edgeLen] = ev[x];
-		} else {
-			for (int y=0; y<edgeLen; y++) array[0 + ((edgeLen-1)-y)*edgeLen] = ev[y];
-		}
+	// index of the i'th vertex along an edge, going anticlockwise
+	int EdgeIndex(int edge, int i) const {
+		if (edge == 0) return i;
+		else if (edge == 1) return (edgeLen-1) + i*edgeLen;
+		else if (edge == 2) return (edgeLen-1)-i + (edgeLen-1)*edgeLen;
+		else return ((edgeLen-1)-i)*edgeLen;
 	}
 };
 
 
 class GeoPatch {
 public:
-	RefCountedPtr<GeoPatchContext> ctx;
+	GeoPatchContext *ctx;
 	vector3d v[4];
-	vector3d *vertices;
-	vector3d *normals;
-	vector3d *colors;
+	GeoPatchVertex *vertices;
 	GLuint m_vbo;
 	GeoPatch *kids[4];
+	GeoPatchKids *volatile m_renderKids;
 	GeoPatch *parent;
 	GeoPatch *edgeFriend[4]; // [0]=v01, [1]=v12, [2]=v20
 	GeoSphere *geosphere;
@@ -375,18 +422,18 @@ public:
 	vector3d clipCentroid, centroid;
 	double clipRadius;
 	int m_depth;
-	SDL_mutex *m_kidsLock;
+	// address in the quadtree, for the patch cache. see GeoPatchCache::Key
+	Uint64 m_path;
 	bool m_needUpdateVBOs;
 	double m_distMult;
 
-	GeoPatch(const RefCountedPtr<GeoPatchContext> &_ctx, GeoSphere *gs, vector3d v0, vector3d v1, vector3d v2, vector3d v3, int depth) {
+	GeoPatch(GeoPatchContext *_ctx, GeoSphere *gs, vector3d v0, vector3d v1, vector3d v2, vector3d v3, int depth) {
 		memset(this, 0, sizeof(GeoPatch));
 
 		ctx = _ctx;
 
 		geosphere = gs;
 
-		m_kidsLock = SDL_CreateMutex();
 		v[0] = v0; v[1] = v1; v[2] = v2; v[3] = v3;
 		//depth -= Pi::detail.fracmult;
 		m_depth = depth;
@@ -402,21 +449,26 @@ public:
  		}
 		m_roughLength = GEOPATCH_SUBDIVIDE_AT_CAMDIST / pow(2.0, depth) * m_distMult;
 		m_needUpdateVBOs = false;
-		normals = new vector3d[ctx->NUMVERTICES()];
-		vertices = new vector3d[ctx->NUMVERTICES()];
-		colors = new vector3d[ctx->NUMVERTICES()];
+		vertices = ctx->AllocVertices();
 	}
 
 	~GeoPatch() {
-		SDL_DestroyMutex(m_kidsLock);
+		Unlink();
+		for (int i=0; i<4; i++) if (kids[i]) delete kids[i];
+		delete m_renderKids;
+		ctx->FreeVertices(vertices);
+		geosphere->AddVBOToDestroy(m_vbo);
+	}
+
+	// cut this patch and everything under it off from its neighbours. done
+	// (with the tree lock held) when the patch is merged away, which can be
+	// long before it's actually deleted
+	void Unlink() {
 		for (int i=0; i<4; i++) {
 			if (edgeFriend[i]) edgeFriend[i]->NotifyEdgeFriendDeleted(this);
+			edgeFriend[i] = 0;
 		}
-		for (int i=0; i<4; i++) if (kids[i]) delete kids[i];
-		delete[] vertices;
-		delete[] normals;
-		delete[] colors;
-		geosphere->AddVBOToDestroy(m_vbo);
+		for (int i=0; i<4; i++) if (kids[i]) kids[i]->Unlink();
 	}
 
 	void UpdateVBOs() {
@@ -428,40 +480,58 @@ public:
 			if (!m_vbo) glGenBuffersARB(1, &m_vbo);
 			m_needUpdateVBOs = false;
 			glBindBufferARB(GL_ARRAY_BUFFER, m_vbo);
-			glBufferDataARB(GL_ARRAY_BUFFER, sizeof(VBOVertex)*ctx->NUMVERTICES(), 0, GL_DYNAMIC_DRAW);
-			for (int i=0; i<ctx->NUMVERTICES(); i++)
-			{
-				clipRadius = std::max(clipRadius, (vertices[i]-clipCentroid).Length());
-				VBOVertex *pData = ctx->vbotemp + i;
-				pData->x = float(vertices[i].x - clipCentroid.x);
-				pData->y = float(vertices[i].y - clipCentroid.y);
-				pData->z = float(vertices[i].z - clipCentroid.z);
-				pData->nx = float(normals[i].x);
-				pData->ny = float(normals[i].y);
-				pData->nz = float(normals[i].z);
-				pData->col[0] = static_cast<unsigned char>(Clamp(colors[i].x*255.0, 0.0, 255.0));
-				pData->col[1] = static_cast<unsigned char>(Clamp(colors[i].y*255.0, 0.0, 255.0));
-				pData->col[2] = static_cast<unsigned char>(Clamp(colors[i].z*255.0, 0.0, 255.0));
-				pData->col[3] = 255;
-			}
-			glBufferDataARB(GL_ARRAY_BUFFER, sizeof(VBOVertex)*ctx->NUMVERTICES(), ctx->vbotemp, GL_DYNAMIC_DRAW);
+			glBufferDataARB(GL_ARRAY_BUFFER, sizeof(GeoPatchVertex)*ctx->NUMVERTICES(), vertices, GL_DYNAMIC_DRAW);
 			glBindBufferARB(GL_ARRAY_BUFFER, 0);
 		}
 	}
+
+	vector3d GetVertex(int i) const {
+		return clipCentroid + vector3d(vertices[i].x, vertices[i].y, vertices[i].z);
+	}
+	void SetVertex(int i, const vector3d &p) {
+		const vector3d rel = p - clipCentroid;
+		vertices[i].x = float(rel.x);
+		vertices[i].y = float(rel.y);
+		vertices[i].z = float(rel.z);
+		clipRadius = std::max(clipRadius, rel.Length());
+	}
+	// vertices sit at (height+1) along their sphere point
+	double GetVertexHeight(int i) const {
+		return GetVertex(i).Length() - 1.0;
+	}
+
+	vector3d GetNormal(int i) const {
+		return vector3d(vertices[i].nx, vertices[i].ny, vertices[i].nz) * (1.0/32767.0);
+	}
+	void SetNormal(int i, const vector3d &n) {
+		vertices[i].nx = Sint16(Clamp(n.x, -1.0, 1.0) * 32767.0);
+		vertices[i].ny = Sint16(Clamp(n.y, -1.0, 1.0) * 32767.0);
+		vertices[i].nz = Sint16(Clamp(n.z, -1.0, 1.0) * 32767.0);
+	}
+
+	vector3d GetColor(int i) const {
+		return vector3d(vertices[i].col[0], vertices[i].col[1], vertices[i].col[2]) * (1.0/255.0);
+	}
+	void SetColor(int i, const vector3d &c) {
+		vertices[i].col[0] = static_cast<unsigned char>(Clamp(c.x*255.0, 0.0, 255.0));
+		vertices[i].col[1] = static_cast<unsigned char>(Clamp(c.y*255.0, 0.0, 255.0));
+		vertices[i].col[2] = static_cast<unsigned char>(Clamp(c.z*255.0, 0.0, 255.0));
+		vertices[i].col[3] = 255;
+	}
 	/* not quite edge, since we share edge vertices so that would be
 	 * fucking pointless. one position inwards. used to make edge normals
 	 * for adjacent tiles */
 	void GetEdgeMinusOneVerticesFlipped(int edge, vector3d *ev) {
 		if (edge == 0) {
-			for (int x=0; x<ctx->edgeLen; x++) ev[ctx->edgeLen-1-x] = vertices[x + ctx->edgeLen];
+			for (int x=0; x<ctx->edgeLen; x++) ev[ctx->edgeLen-1-x] = GetVertex(x + ctx->edgeLen);
 		} else if (edge == 1) {
 			const int x = ctx->edgeLen-2;
-			for (int y=0; y<ctx->edgeLen; y++) ev[ctx->edgeLen-1-y] = vertices[x + y*ctx->edgeLen];
+			for (int y=0; y<ctx->edgeLen; y++) ev[ctx->edgeLen-1-y] = GetVertex(x + y*ctx->edgeLen);
 		} else if (edge == 2) {
 			const int y = ctx->edgeLen-2;
-			for (int x=0; x<ctx->edgeLen; x++) ev[ctx->edgeLen-1-x] = vertices[(ctx->edgeLen-1)-x + y*ctx->edgeLen];
+			for (int x=0; x<ctx->edgeLen; x++) ev[ctx->edgeLen-1-x] = GetVertex((ctx->edgeLen-1)-x + y*ctx->edgeLen);
 		} else {
-			for (int y=0; y<ctx->edgeLen; y++) ev[ctx->edgeLen-1-y] = vertices[1 + ((ctx->edgeLen-1)-y)*ctx->edgeLen];
+			for (int y=0; y<ctx->edgeLen; y++) ev[ctx->edgeLen-1-y] = GetVertex(1 + ((ctx->edgeLen-1)-y)*ctx->edgeLen);
 		}
 	}
 	int GetEdgeIdxOf(GeoPatch *e) {
@@ -478,61 +548,61 @@ public:
 		switch (edge) {
 		case 0:
 			for (x=1; x<ctx->edgeLen-1; x++) {
-				const vector3d x1 = vertices[x-1];
-				const vector3d x2 = vertices[x+1];
+				const vector3d x1 = GetVertex(x-1);
+				const vector3d x2 = GetVertex(x+1);
 				const vector3d y1 = ev[x];
-				const vector3d y2 = vertices[x + ctx->edgeLen];
+				const vector3d y2 = GetVertex(x + ctx->edgeLen);
 				const vector3d norm = (x2-x1).Cross(y2-y1).Normalized();
-				normals[x] = norm;
+				SetNormal(x, norm);
 				// make color
 				const vector3d p = GetSpherePoint(x*ctx->frac, 0);
-				const double height = colors[x].x;
-				colors[x] = geosphere->GetColor(p, height, norm);
+				const double height = GetVertexHeight(x);
+				SetColor(x, geosphere->GetColor(p, height, norm));
 			}
 			break;
 		case 1:
 			x = ctx->edgeLen-1;
 			for (y=1; y<ctx->edgeLen-1; y++) {
-				const vector3d x1 = vertices[(x-1) + y*ctx->edgeLen];
+				const vector3d x1 = GetVertex((x-1) + y*ctx->edgeLen);
 				const vector3d x2 = ev[y];
-				const vector3d y1 = vertices[x + (y-1)*ctx->edgeLen];
-				const vector3d y2 = vertices[x + (y+1)*ctx->edgeLen];
+				const vector3d y1 = GetVertex(x + (y-1)*ctx->edgeLen);
+				const vector3d y2 = GetVertex(x + (y+1)*ctx->edgeLen);
 				const vector3d norm = (x2-x1).Cross(y2-y1).Normalized();
-				normals[x + y*ctx->edgeLen] = norm;
+				SetNormal(x + y*ctx->edgeLen, norm);
 				// make color
 				const vector3d p = GetSpherePoint(x*ctx->frac, y*ctx->frac);
-				const double height = colors[x + y*ctx->edgeLen].x;
-				colors[x + y*ctx->edgeLen] = geosphere->GetColor(p, height, norm);
+				const double height = GetVertexHeight(x + y*ctx->edgeLen);
+				SetColor(x + y*ctx->edgeLen, geosphere->GetColor(p, height, norm));
 	//			colors[x+y*ctx->edgeLen] = vector3d(1,0,0);
 			}
 			break;
 		case 2:
 			y = ctx->edgeLen-1;
 			for (x=1; x<ctx->edgeLen-1; x++) {
-				const vector3d x1 = vertices[x-1 + y*ctx->edgeLen];
-				const vector3d x2 = vertices[x+1 + y*ctx->edgeLen];
-				const vector3d y1 = vertices[x + (y-1)*ctx->edgeLen];
+				const vector3d x1 = GetVertex(x-1 + y*ctx->edgeLen);
+				const vector3d x2 = GetVertex(x+1 + y*ctx->edgeLen);
+				const vector3d y1 = GetVertex(x + (y-1)*ctx->edgeLen);
 				const vector3d y2 = ev[ctx->edgeLen-1-x];
 				const vector3d norm = (x2-x1).Cross(y2-y1).Normalized();
-				normals[x + y*ctx->edgeLen] = norm;
+				SetNormal(x + y*ctx->edgeLen, norm);
 				// make color
 				const vector3d p = GetSpherePoint(x*ctx->frac, y*ctx->frac);
-				const double height = colors[x + y*ctx->edgeLen].x;
-				colors[x + y*ctx->edgeLen] = geosphere->GetColor(p, height, norm);
+				const double height = GetVertexHeight(x + y*ctx->edgeLen);
+				SetColor(x + y*ctx->edgeLen, geosphere->GetColor(p, height, norm));
 			}
 			break;
 		case 3:
 			for (y=1; y<ctx->edgeLen-1; y++) {
 				const vector3d x1 = ev[ctx->edgeLen-1-y];
-				const vector3d x2 = vertices[1 + y*ctx->edgeLen];
-				const vector3d y1 = vertices[(y-1)*ctx->edgeLen];
-				const vector3d y2 = vertices[(y+1)*ctx->edgeLen];
+				const vector3d x2 = GetVertex(1 + y*ctx->edgeLen);
+				const vector3d y1 = GetVertex((y-1)*ctx->edgeLen);
+				const vector3d y2 = GetVertex((y+1)*ctx->edgeLen);
 				const vector3d norm = (x2-x1).Cross(y2-y1).Normalized();
-				normals[y*ctx->edgeLen] = norm;
+				SetNormal(y*ctx->edgeLen, norm);
 				// make color
 				const vector3d p = GetSpherePoint(0, y*ctx->frac);
-				const double height = colors[y*ctx->edgeLen].x;
-				colors[y*ctx->edgeLen] = geosphere->GetColor(p, height, norm);
+				const double height = GetVertexHeight(y*ctx->edgeLen);
+				SetColor(y*ctx->edgeLen, geosphere->GetColor(p, height, norm));
 	//			colors[y*ctx->edgeLen] = vector3d(0,1,0);
 			}
 			break;
@@ -555,9 +625,12 @@ public:
 		vector3d ev2[GEOPATCH_MAX_EDGELEN];
 		vector3d en2[GEOPATCH_MAX_EDGELEN];
 		vector3d ec2[GEOPATCH_MAX_EDGELEN];
-		ctx->GetEdge(parent->vertices, edge, ev);
-		ctx->GetEdge(parent->normals, edge, en);
-		ctx->GetEdge(parent->colors, edge, ec);
+		for (int i=0; i<ctx->edgeLen; i++) {
+			const int idx = ctx->EdgeIndex(edge, i);
+			ev[i] = parent->GetVertex(idx);
+			en[i] = parent->GetNormal(idx);
+			ec[i] = parent->GetColor(idx);
+		}
 
 		int kid_idx = parent->GetChildIdx(this);
 		if (edge == kid_idx) {
@@ -581,9 +654,12 @@ public:
 			en2[i] = (en2[i-1]+en2[i+1]).Normalized();
 			ec2[i] = (ec2[i-1]+ec2[i+1]) * 0.5;
 		}
-		ctx->SetEdge(this->vertices, edge, ev2);
-		ctx->SetEdge(this->normals, edge, en2);
-		ctx->SetEdge(this->colors, edge, ec2);
+		for (int i=0; i<ctx->edgeLen; i++) {
+			const int idx = ctx->EdgeIndex(edge, i);
+			SetVertex(idx, ev2[i]);
+			SetNormal(idx, en2[i]);
+			SetColor(idx, ec2[i]);
+		}
 	}
 
 	template <int corner>
@@ -593,61 +669,61 @@ public:
 		switch (corner) {
 		case 0: {
 			x1 = ev[ctx->edgeLen-1];
-			x2 = vertices[1];
+			x2 = GetVertex(1);
 			y1 = ev2[0];
-			y2 = vertices[ctx->edgeLen];
+			y2 = GetVertex(ctx->edgeLen);
 			const vector3d norm = (x2-x1).Cross(y2-y1).Normalized();
-			normals[0] = norm;
+			SetNormal(0, norm);
 			// make color
 			const vector3d pt = GetSpherePoint(0, 0);
-		//	const double height = colors[0].x;
+		//	const double height = GetVertexHeight(0);
 			const double height = geosphere->GetHeight(pt);
-			colors[0] = geosphere->GetColor(pt, height, norm);
+			SetColor(0, geosphere->GetColor(pt, height, norm));
 			}
 			break;
 		case 1: {
 			p = ctx->edgeLen-1;
-			x1 = vertices[p-1];
+			x1 = GetVertex(p-1);
 			x2 = ev2[0];
 			y1 = ev[ctx->edgeLen-1];
-			y2 = vertices[p + ctx->edgeLen];
+			y2 = GetVertex(p + ctx->edgeLen);
 			const vector3d norm = (x2-x1).Cross(y2-y1).Normalized();
-			normals[p] = norm;
+			SetNormal(p, norm);
 			// make color
 			const vector3d pt = GetSpherePoint(p*ctx->frac, 0);
-		//	const double height = colors[p].x;
+		//	const double height = GetVertexHeight(p);
 			const double height = geosphere->GetHeight(pt);
-			colors[p] = geosphere->GetColor(pt, height, norm);
+			SetColor(p, geosphere->GetColor(pt, height, norm));
 			}
 			break;
 		case 2: {
 			p = ctx->edgeLen-1;
-			x1 = vertices[(p-1) + p*ctx->edgeLen];
+			x1 = GetVertex((p-1) + p*ctx->edgeLen);
 			x2 = ev[ctx->edgeLen-1];
-			y1 = vertices[p + (p-1)*ctx->edgeLen];
+			y1 = GetVertex(p + (p-1)*ctx->edgeLen);
 			y2 = ev2[0];
 			const vector3d norm = (x2-x1).Cross(y2-y1).Normalized();
-			normals[p + p*ctx->edgeLen] = norm;
+			SetNormal(p + p*ctx->edgeLen, norm);
 			// make color
 			const vector3d pt = GetSpherePoint(p*ctx->frac, p*ctx->frac);
-		//	const double height = colors[p + p*ctx->edgeLen].x;
+		//	const double height = GetVertexHeight(p + p*ctx->edgeLen);
 			const double height = geosphere->GetHeight(pt);
-			colors[p + p*ctx->edgeLen] = geosphere->GetColor(pt, height, norm);
+			SetColor(p + p*ctx->edgeLen, geosphere->GetColor(pt, height, norm));
 			}
 			break;
 		case 3: {
 			p = ctx->edgeLen-1;
 			x1 = ev2[0];
-			x2 = vertices[1 + p*ctx->edgeLen];
-			y1 = vertices[(p-1)*ctx->edgeLen];
+			x2 = GetVertex(1 + p*ctx->edgeLen);
+			y1 = GetVertex((p-1)*ctx->edgeLen);
 			y2 = ev[ctx->edgeLen-1];
 			const vector3d norm = (x2-x1).Cross(y2-y1).Normalized();
-			normals[p*ctx->edgeLen] = norm;
+			SetNormal(p*ctx->edgeLen, norm);
 			// make color
 			const vector3d pt = GetSpherePoint(0, p*ctx->frac);
-		//	const double height = colors[p*ctx->edgeLen].x;
+		//	const double height = GetVertexHeight(p*ctx->edgeLen);
 			const double height = geosphere->GetHeight(pt);
-			colors[p*ctx->edgeLen] = geosphere->GetColor(pt, height, norm);
+			SetColor(p*ctx->edgeLen, geosphere->GetColor(pt, height, norm));
 			}
 			break;
 		}
@@ -730,7 +806,7 @@ public:
 				FixEdgeFromParentInterpolated(i);
 				// XXX needed for corners... probably not
 				// correct
-				ctx->GetEdge(vertices, i, ev[i]);
+				for (int j=0; j<ctx->edgeLen; j++) ev[i][j] = GetVertex(ctx->EdgeIndex(i, j));
 			}
 		}
 
@@ -749,48 +825,134 @@ public:
 			    (1.0-x)*y*(v[3]-v[0])).Normalized();
 	}
 
+	void MakeCacheKey(GeoPatchCache::Key &key) const {
+		key.body = geosphere->m_sbody->path;
+		key.seed = geosphere->m_sbody->seed;
+		key.heightFractal = geosphere->m_terrain->GetHeightFractalName();
+		key.colorFractal = geosphere->m_terrain->GetColorFractalName();
+		key.edgeLen = ctx->edgeLen;
+		key.fracmult = Pi::detail.fracmult;
+		key.textures = Pi::detail.textures;
+		key.patchPath = m_path;
+	}
+
+	/* normals & colors for the non-edge vertices of a row, which never
+	 * change. needs the rows either side of it in place. colours come from
+	 * cachedColors if given, else from the terrain */
+	void GenerateInnerRow(int row, const double *rowHeights, const Uint8 *cachedColors) {
+		double px[GEOPATCH_MAX_EDGELEN], py[GEOPATCH_MAX_EDGELEN], pz[GEOPATCH_MAX_EDGELEN];
+		double nx[GEOPATCH_MAX_EDGELEN], ny[GEOPATCH_MAX_EDGELEN], nz[GEOPATCH_MAX_EDGELEN];
+		vector3d cols[GEOPATCH_MAX_EDGELEN];
+		for (int x=1; x<ctx->edgeLen-1; x++) {
+			// normal
+			vector3d x1 = GetVertex(x-1 + row*ctx->edgeLen);
+			vector3d x2 = GetVertex(x+1 + row*ctx->edgeLen);
+			vector3d y1 = GetVertex(x + (row-1)*ctx->edgeLen);
+			vector3d y2 = GetVertex(x + (row+1)*ctx->edgeLen);
+
+			const vector3d n = (x2-x1).Cross(y2-y1).Normalized();
+			SetNormal(x + row*ctx->edgeLen, n);
+			if (cachedColors) continue;
+			nx[x-1] = n.x; ny[x-1] = n.y; nz[x-1] = n.z;
+			// color
+			const vector3d p = GetSpherePoint(x*ctx->frac, row*ctx->frac);
+			px[x-1] = p.x; py[x-1] = p.y; pz[x-1] = p.z;
+		}
+		if (cachedColors) {
+			for (int x=1; x<ctx->edgeLen-1; x++) {
+				unsigned char *col = vertices[x + row*ctx->edgeLen].col;
+				const Uint8 *c = &cachedColors[3*(x-1)];
+				col[0] = c[0]; col[1] = c[1]; col[2] = c[2]; col[3] = 255;
+			}
+			return;
+		}
+		geosphere->GetColors(px, py, pz, &rowHeights[1], nx, ny, nz, cols, ctx->edgeLen-2);
+		for (int x=1; x<ctx->edgeLen-1; x++)
+			SetColor(x + row*ctx->edgeLen, cols[x-1]);
+	}
+
+	// the heights of all the vertices, and then the centroid, are what
+	// goes in the cache
+	bool GenerateMeshFromCache(const GeoPatchCache::Key &key) {
+		const int numVertices = ctx->NUMVERTICES();
+		const int innerEdgeLen = ctx->edgeLen-2;
+		std::vector<double> heights(numVertices+1);
+		std::vector<Uint8> colors(3*innerEdgeLen*innerEdgeLen);
+		bool gotColors;
+		if (!GeoPatchCache::Load(key, &heights[0], numVertices+1, &colors[0], innerEdgeLen*innerEdgeLen, gotColors))
+			return false;
+
+		centroid = (1.0 + heights[numVertices]) * clipCentroid.Normalized();
+		double yfrac = 0;
+		for (int y=0; y<ctx->edgeLen; y++) {
+			double xfrac = 0;
+			for (int x=0; x<ctx->edgeLen; x++) {
+				const int i = x + y*ctx->edgeLen;
+				SetVertex(i, GetSpherePoint(xfrac, yfrac) * (heights[i] + 1.0));
+				xfrac += ctx->frac;
+			}
+			yfrac += ctx->frac;
+		}
+		for (int row=1; row<ctx->edgeLen-1; row++)
+			GenerateInnerRow(row, &heights[row*ctx->edgeLen], gotColors ? &colors[3*(row-1)*innerEdgeLen] : 0);
+		return true;
+	}
+
 	/** Generates full-detail vertices, and also non-edge normals and
-	 * colors */
-	void GenerateMesh() {
+	 * colors. Returns the number of heights taken from the terrain */
+	int GenerateMesh() {
+		GeoPatchCache::Key key;
+		const bool useCache = GeoPatchCache::IsEnabled();
+		if (useCache) {
+			MakeCacheKey(key);
+			if (GenerateMeshFromCache(key)) return 0;
+		}
+
 		centroid = clipCentroid.Normalized();
-		centroid = (1.0 + geosphere->GetHeight(centroid)) * centroid;
-		vector3d *vts = vertices;
-		vector3d *col = colors;
+		const double centroidHeight = geosphere->GetHeight(centroid);
+		centroid = (1.0 + centroidHeight) * centroid;
+		// heights are generated a row at a time through the terrain's batch
+		// interface. a row's normals and colours can be done as soon as the
+		// rows either side of it are in, so only three rows of heights are
+		// kept around, unless they're all wanted for the cache
+		double px[GEOPATCH_MAX_EDGELEN], py[GEOPATCH_MAX_EDGELEN], pz[GEOPATCH_MAX_EDGELEN];
+		double heights[3][GEOPATCH_MAX_EDGELEN];
+		std::vector<double> allHeights;
+		if (useCache) allHeights.resize(ctx->NUMVERTICES()+1);
 		double xfrac;
 		double yfrac = 0;
 		for (int y=0; y<ctx->edgeLen; y++) {
 			xfrac = 0;
 			for (int x=0; x<ctx->edgeLen; x++) {
-				vector3d p = GetSpherePoint(xfrac, yfrac);
-				double height = geosphere->GetHeight(p);
-				*(vts++) = p * (height + 1.0);
-				// remember this -- we will need it later
-				(col++)->x = height;
+				const vector3d p = GetSpherePoint(xfrac, yfrac);
+				px[x] = p.x; py[x] = p.y; pz[x] = p.z;
 				xfrac += ctx->frac;
 			}
+			double *rowHeights = useCache ? &allHeights[y*ctx->edgeLen] : heights[y%3];
+			geosphere->GetHeights(px, py, pz, rowHeights, ctx->edgeLen);
+			for (int x=0; x<ctx->edgeLen; x++)
+				SetVertex(x + y*ctx->edgeLen, vector3d(px[x], py[x], pz[x]) * (rowHeights[x] + 1.0));
 			yfrac += ctx->frac;
+
+			if (y < 2) continue;
+			const int row = y-1;
+			GenerateInnerRow(row, useCache ? &allHeights[row*ctx->edgeLen] : heights[row%3], 0);
 		}
-		assert(vts == &vertices[ctx->NUMVERTICES()]);
-		// Generate normals & colors for non-edge vertices since they never change
-		for (int y=1; y<ctx->edgeLen-1; y++) {
-			for (int x=1; x<ctx->edgeLen-1; x++) {
-				// normal
-				vector3d x1 = vertices[x-1 + y*ctx->edgeLen];
-				vector3d x2 = vertices[x+1 + y*ctx->edgeLen];
-				vector3d y1 = vertices[x + (y-1)*ctx->edgeLen];
-				vector3d y2 = vertices[x + (y+1)*ctx->edgeLen];
-
-				vector3d n = (x2-x1).Cross(y2-y1);
-				normals[x + y*ctx->edgeLen] = n.Normalized();
-				// color
-				vector3d p = GetSpherePoint(x*ctx->frac, y*ctx->frac);
-				vector3d &col_r = colors[x + y*ctx->edgeLen];
-				const double height = col_r.x;
-				const vector3d &norm = normals[x + y*ctx->edgeLen];
-				col_r = geosphere->GetColor(p, height, norm);
+
+		if (useCache) {
+			allHeights[ctx->NUMVERTICES()] = centroidHeight;
+			const int innerEdgeLen = ctx->edgeLen-2;
+			std::vector<Uint8> colors(3*innerEdgeLen*innerEdgeLen);
+			Uint8 *c = &colors[0];
+			for (int y=1; y<ctx->edgeLen-1; y++) {
+				for (int x=1; x<ctx->edgeLen-1; x++) {
+					const unsigned char *col = vertices[x + y*ctx->edgeLen].col;
+					*c++ = col[0]; *c++ = col[1]; *c++ = col[2];
+				}
 			}
+			GeoPatchCache::Store(key, &allHeights[0], ctx->NUMVERTICES()+1, &colors[0], innerEdgeLen*innerEdgeLen);
 		}
-
+		return ctx->NUMVERTICES()+1;
 	}
 	void OnEdgeFriendChanged(int edge, GeoPatch *e) {
 		edgeFriend[edge] = e;
@@ -798,48 +960,24 @@ public:
 		int we_are = e->GetEdgeIdxOf(this);
 		e->GetEdgeMinusOneVerticesFlipped(we_are, ev);
 		/* now we have a valid edge, fix the edge vertices */
-		if (edge == 0) {
-			for (int x=0; x<ctx->edgeLen; x++) {
-				vector3d p = GetSpherePoint(x * ctx->frac, 0);
-				double height = geosphere->GetHeight(p);
-				vertices[x] = p * (height + 1.0);
-				// XXX These bounds checks in each edge case are
-				// only necessary while the "All these 'if's"
-				// comment in FixCOrnerNormalsByEdge stands
-				if ((x>0) && (x<ctx->edgeLen-1)) {
-					colors[x].x = height;
-				}
-			}
-		} else if (edge == 1) {
-			for (int y=0; y<ctx->edgeLen; y++) {
-				vector3d p = GetSpherePoint(1.0, y * ctx->frac);
-				double height = geosphere->GetHeight(p);
-				int pos = (ctx->edgeLen-1) + y*ctx->edgeLen;
-				vertices[pos] = p * (height + 1.0);
-				if ((y>0) && (y<ctx->edgeLen-1)) {
-					colors[pos].x = height;
-				}
-			}
-		} else if (edge == 2) {
-			for (int x=0; x<ctx->edgeLen; x++) {
-				vector3d p = GetSpherePoint(x * ctx->frac, 1.0);
-				double height = geosphere->GetHeight(p);
-				int pos = x + (ctx->edgeLen-1)*ctx->edgeLen;
-				vertices[pos] = p * (height + 1.0);
-				if ((x>0) && (x<ctx->edgeLen-1)) {
-					colors[pos].x = height;
-				}
-			}
-		} else {
-			for (int y=0; y<ctx->edgeLen; y++) {
-				vector3d p = GetSpherePoint(0, y * ctx->frac);
-				double height = geosphere->GetHeight(p);
-				int pos = y * ctx->edgeLen;
-				vertices[pos] = p * (height + 1.0);
-				if ((y>0) && (y<ctx->edgeLen-1)) {
-					colors[pos].x = height;
-				}
-			}
+		double px[GEOPATCH_MAX_EDGELEN], py[GEOPATCH_MAX_EDGELEN], pz[GEOPATCH_MAX_EDGELEN];
+		double heights[GEOPATCH_MAX_EDGELEN];
+		for (int i=0; i<ctx->edgeLen; i++) {
+			vector3d p;
+			if (edge == 0) p = GetSpherePoint(i * ctx->frac, 0);
+			else if (edge == 1) p = GetSpherePoint(1.0, i * ctx->frac);
+			else if (edge == 2) p = GetSpherePoint(i * ctx->frac, 1.0);
+			else p = GetSpherePoint(0, i * ctx->frac);
+			px[i] = p.x; py[i] = p.y; pz[i] = p.z;
+		}
+		geosphere->GetHeights(px, py, pz, heights, ctx->edgeLen);
+		for (int i=0; i<ctx->edgeLen; i++) {
+			int pos;
+			if (edge == 0) pos = i;
+			else if (edge == 1) pos = (ctx->edgeLen-1) + i*ctx->edgeLen;
+			else if (edge == 2) pos = i + (ctx->edgeLen-1)*ctx->edgeLen;
+			else pos = i * ctx->edgeLen;
+			SetVertex(pos, vector3d(px[i], py[i], pz[i]) * (heights[i] + 1.0));
 		}
 
 		FixEdgeNormals(edge, ev);
@@ -912,12 +1050,11 @@ public:
 	}
 
 	void Render(vector3d &campos, const Graphics::Frustum &frustum) {
-		PiVerify(SDL_mutexP(m_kidsLock)==0);
-		if (kids[0]) {
-			for (int i=0; i<4; i++) kids[i]->Render(campos, frustum);
-			SDL_mutexV(m_kidsLock);
+		GeoPatchKids *renderKids = m_renderKids;
+		GEOSPHERE_READ_BARRIER();
+		if (renderKids) {
+			for (int i=0; i<4; i++) renderKids->kid[i]->Render(campos, frustum);
 		} else {
-			SDL_mutexV(m_kidsLock);
 			_UpdateVBOs();
 
 			if (!frustum.TestPoint(clipCentroid, clipRadius))
@@ -936,9 +1073,9 @@ public:
 			ctx->updateIndexBufferId(determineIndexbuffer());
 
 			glBindBufferARB(GL_ARRAY_BUFFER, m_vbo);
-			glVertexPointer(3, GL_FLOAT, sizeof(VBOVertex), 0);
-			glNormalPointer(GL_FLOAT, sizeof(VBOVertex), reinterpret_cast<void *>(3*sizeof(float)));
-			glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(VBOVertex), reinterpret_cast<void *>(6*sizeof(float)));
+			glVertexPointer(3, GL_FLOAT, sizeof(GeoPatchVertex), 0);
+			glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(GeoPatchVertex), reinterpret_cast<void *>(offsetof(GeoPatchVertex, col)));
+			glNormalPointer(GL_SHORT, sizeof(GeoPatchVertex), reinterpret_cast<void *>(offsetof(GeoPatchVertex, nx)));
 			glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER, ctx->indices_vbo);
 			glDrawElements(GL_TRIANGLES, ctx->indices_tri_count*3, GL_UNSIGNED_SHORT, 0);
 			glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
@@ -951,24 +1088,17 @@ public:
 		}
 	}
 
-	void LODUpdate(vector3d &campos) {
+	void LODUpdate(const vector3d &campos) {
 		// if we've been asked to abort then get out as quickly as possible
 		// this function is recursive so we might be very deep. this is about
 		// as fast as we can go
-		SDL_mutexP(geosphere->m_abortLock);
-		bool abort = geosphere->m_abort;
-		SDL_mutexV(geosphere->m_abortLock);
-		if (abort)
+		if (geosphere->IsAborting())
 			return;
 
-		bool canSplit = true;
-		for (int i=0; i<4; i++) {
-			if (!edgeFriend[i]) { canSplit = false; break; }
-			if (edgeFriend[i] && (edgeFriend[i]->m_depth < m_depth)) {
-				canSplit = false;
-				break;
-			}
-		}
+		// neighbours are being split and merged by other workers, so only
+		// look at them with the tree locked
+		PiVerify(SDL_mutexP(geosphere->m_treeLock)==0);
+		bool canSplit = CanSplit();
 		if (!(canSplit && (m_depth < GEOPATCH_MAX_DEPTH) &&
 		    ((campos - centroid).Length() < m_roughLength)))
 			canSplit = false;
@@ -979,56 +1109,153 @@ public:
 		bool canMerge = true;
 
 		if (canSplit) {
+			PiVerify(SDL_mutexV(geosphere->m_treeLock)!=-1);
 			if (!kids[0]) {
-				vector3d v01, v12, v23, v30, cn;
-				cn = centroid.Normalized();
-				v01 = (v[0]+v[1]).Normalized();
-				v12 = (v[1]+v[2]).Normalized();
-				v23 = (v[2]+v[3]).Normalized();
-				v30 = (v[3]+v[0]).Normalized();
-				GeoPatch *_kids[4];
-				_kids[0] = new GeoPatch(ctx, geosphere, v[0], v01, cn, v30, m_depth+1);
-				_kids[1] = new GeoPatch(ctx, geosphere, v01, v[1], v12, cn, m_depth+1);
-				_kids[2] = new GeoPatch(ctx, geosphere, cn, v12, v[2], v23, m_depth+1);
-				_kids[3] = new GeoPatch(ctx, geosphere, v30, cn, v23, v[3], m_depth+1);
-				// hm.. edges. Not right to pass this
-				// edgeFriend...
-				_kids[0]->edgeFriend[0] = GetEdgeFriendForKid(0, 0);
-				_kids[0]->edgeFriend[1] = _kids[1];
-				_kids[0]->edgeFriend[2] = _kids[3];
-				_kids[0]->edgeFriend[3] = GetEdgeFriendForKid(0, 3);
-				_kids[1]->edgeFriend[0] = GetEdgeFriendForKid(1, 0);
-				_kids[1]->edgeFriend[1] = GetEdgeFriendForKid(1, 1);
-				_kids[1]->edgeFriend[2] = _kids[2];
-				_kids[1]->edgeFriend[3] = _kids[0];
-				_kids[2]->edgeFriend[0] = _kids[1];
-				_kids[2]->edgeFriend[1] = GetEdgeFriendForKid(2, 1);
-				_kids[2]->edgeFriend[2] = GetEdgeFriendForKid(2, 2);
-				_kids[2]->edgeFriend[3] = _kids[3];
-				_kids[3]->edgeFriend[0] = _kids[0];
-				_kids[3]->edgeFriend[1] = _kids[2];
-				_kids[3]->edgeFriend[2] = GetEdgeFriendForKid(3, 2);
-				_kids[3]->edgeFriend[3] = GetEdgeFriendForKid(3, 3);
-				_kids[0]->parent = _kids[1]->parent = _kids[2]->parent = _kids[3]->parent = this;
-				for (int i=0; i<4; i++) _kids[i]->GenerateMesh();
-				PiVerify(SDL_mutexP(m_kidsLock)==0);
-				for (int i=0; i<4; i++) kids[i] = _kids[i];
-				for (int i=0; i<4; i++) edgeFriend[i]->NotifyEdgeFriendSplit(this);
-				for (int i=0; i<4; i++) {
-					kids[i]->GenerateEdgeNormalsAndColors();
-					kids[i]->UpdateVBOs();
-				}
-				PiVerify(SDL_mutexV(m_kidsLock)!=-1);
+				// making the kids is the expensive bit, so it waits its
+				// turn to go to the pool. the job carries on down from
+				// the new kids once they're in.
+				geosphere->QueueSplit(this, campos);
+				return;
 			}
 			for (int i=0; i<4; i++) kids[i]->LODUpdate(campos);
 		} else {
 			if (canMerge && kids[0]) {
-				PiVerify(SDL_mutexP(m_kidsLock)==0);
-				for (int i=0; i<4; i++) { delete kids[i]; kids[i] = 0; }
-				PiVerify(SDL_mutexV(m_kidsLock)!=-1);
+				// the render thread may be in the kids right now, so
+				// they're only unhooked here and deleted later
+				GeoPatchKids *oldKids = m_renderKids;
+				m_renderKids = 0;
+				for (int i=0; i<4; i++) { kids[i]->Unlink(); kids[i] = 0; }
+				geosphere->RetireKids(oldKids);
 			}
+			PiVerify(SDL_mutexV(geosphere->m_treeLock)!=-1);
 		}
 	}
+
+	// how badly this patch wants to split as seen from campos, or 0 if it
+	// fails the LODUpdate distance test and doesn't want to at all. the
+	// nearer the camera is inside the split distance, the bigger the error
+	// on screen. patches facing away from the camera are held back so the
+	// visible surface fills in first
+	double GetSplitPriority(const vector3d &campos) const {
+		// the roots always split
+		if (!parent) return HUGE_VAL;
+		const vector3d toCam = campos - centroid;
+		const double dist = toCam.Length();
+		if (dist >= m_roughLength) return 0.0;
+		double priority = m_roughLength / std::max(dist, 1e-12);
+		if (centroid.Dot(toCam) < 0.0) priority *= 0.25;
+		return priority;
+	}
+
+	// must hold the tree lock
+	bool CanSplit() const {
+		for (int i=0; i<4; i++) {
+			if (!edgeFriend[i]) return false;
+			if (edgeFriend[i]->m_depth < m_depth) return false;
+		}
+		return true;
+	}
+
+	// run from a split job. nothing can reach the new kids until they're
+	// linked in below, so their meshes are generated without any locks held.
+	// returns the number of heights generated for them
+	int Split(const vector3d &campos) {
+		if (geosphere->IsAborting())
+			return 0;
+
+		assert(!kids[0]);
+		vector3d v01, v12, v23, v30, cn;
+		cn = centroid.Normalized();
+		v01 = (v[0]+v[1]).Normalized();
+		v12 = (v[1]+v[2]).Normalized();
+		v23 = (v[2]+v[3]).Normalized();
+		v30 = (v[3]+v[0]).Normalized();
+		GeoPatch *_kids[4];
+		_kids[0] = new GeoPatch(ctx, geosphere, v[0], v01, cn, v30, m_depth+1);
+		_kids[1] = new GeoPatch(ctx, geosphere, v01, v[1], v12, cn, m_depth+1);
+		_kids[2] = new GeoPatch(ctx, geosphere, cn, v12, v[2], v23, m_depth+1);
+		_kids[3] = new GeoPatch(ctx, geosphere, v30, cn, v23, v[3], m_depth+1);
+		int vtxGenCount = 0;
+		for (int i=0; i<4; i++) {
+			_kids[i]->m_path = (m_path << 2) | i;
+			vtxGenCount += _kids[i]->GenerateMesh();
+		}
+
+		PiVerify(SDL_mutexP(geosphere->m_treeLock)==0);
+		// a neighbour may have been merged away while we were working
+		if (geosphere->IsAborting() || !CanSplit()) {
+			PiVerify(SDL_mutexV(geosphere->m_treeLock)!=-1);
+			for (int i=0; i<4; i++) delete _kids[i];
+			return vtxGenCount;
+		}
+		// hm.. edges. Not right to pass this
+		// edgeFriend...
+		_kids[0]->edgeFriend[0] = GetEdgeFriendForKid(0, 0);
+		_kids[0]->edgeFriend[1] = _kids[1];
+		_kids[0]->edgeFriend[2] = _kids[3];
+		_kids[0]->edgeFriend[3] = GetEdgeFriendForKid(0, 3);
+		_kids[1]->edgeFriend[0] = GetEdgeFriendForKid(1, 0);
+		_kids[1]->edgeFriend[1] = GetEdgeFriendForKid(1, 1);
+		_kids[1]->edgeFriend[2] = _kids[2];
+		_kids[1]->edgeFriend[3] = _kids[0];
+		_kids[2]->edgeFriend[0] = _kids[1];
+		_kids[2]->edgeFriend[1] = GetEdgeFriendForKid(2, 1);
+		_kids[2]->edgeFriend[2] = GetEdgeFriendForKid(2, 2);
+		_kids[2]->edgeFriend[3] = _kids[3];
+		_kids[3]->edgeFriend[0] = _kids[0];
+		_kids[3]->edgeFriend[1] = _kids[2];
+		_kids[3]->edgeFriend[2] = GetEdgeFriendForKid(3, 2);
+		_kids[3]->edgeFriend[3] = GetEdgeFriendForKid(3, 3);
+		_kids[0]->parent = _kids[1]->parent = _kids[2]->parent = _kids[3]->parent = this;
+		for (int i=0; i<4; i++) kids[i] = _kids[i];
+		for (int i=0; i<4; i++) edgeFriend[i]->NotifyEdgeFriendSplit(this);
+		for (int i=0; i<4; i++) {
+			kids[i]->GenerateEdgeNormalsAndColors();
+			kids[i]->UpdateVBOs();
+		}
+		// only now are the kids complete enough to draw
+		GeoPatchKids *renderKids = new GeoPatchKids;
+		for (int i=0; i<4; i++) renderKids->kid[i] = kids[i];
+		GEOSPHERE_WRITE_BARRIER();
+		m_renderKids = renderKids;
+		PiVerify(SDL_mutexV(geosphere->m_treeLock)!=-1);
+
+		for (int i=0; i<4; i++) kids[i]->LODUpdate(campos);
+		return vtxGenCount;
+	}
+};
+
+// Work queued on behalf of a GeoSphere. The sphere counts its outstanding
+// jobs so it can wait for them before touching the patch tree itself. The
+// count is dropped on deletion rather than after running, since the queue
+// may throw a job away without running it.
+class GeoSphereJob : public Job {
+public:
+	GeoSphereJob(GeoSphere *gs, GeoPatch *patch, const vector3d &campos) :
+		m_geosphere(gs), m_patch(patch), m_campos(campos) { gs->OnJobQueued(); }
+	virtual ~GeoSphereJob() { m_geosphere->OnJobFinished(); }
+protected:
+	GeoSphere *m_geosphere;
+	GeoPatch *m_patch;
+	vector3d m_campos;
+};
+
+class GeoPatchLODUpdateJob : public GeoSphereJob {
+public:
+	GeoPatchLODUpdateJob(GeoSphere *gs, GeoPatch *patch, const vector3d &campos) : GeoSphereJob(gs, patch, campos) {}
+	virtual void OnRun() { m_patch->LODUpdate(m_campos); }
+};
+
+class GeoPatchSplitJob : public GeoSphereJob {
+public:
+	GeoPatchSplitJob(GeoSphere *gs, GeoPatch *patch, const vector3d &campos) : GeoSphereJob(gs, patch, campos) {}
+	virtual void OnRun() {
+		GeoSphere::OnSplitFinished(m_patch->Split(m_campos));
+	}
+
+	GeoSphere *GetGeoSphere() const { return m_geosphere; }
+	GeoPatch *GetPatch() const { return m_patch; }
+	void SetCampos(const vector3d &campos) { m_campos = campos; }
 };
 
 static const int geo_sphere_edge_friends[6][4] = {
@@ -1041,91 +1268,62 @@ static const int geo_sphere_edge_friends[6][4] = {
 };
 
 static std::vector<GeoSphere*> s_allGeospheres;
-static std::deque<GeoSphere*> s_geosphereUpdateQueue;
-static GeoSphere* s_currentlyUpdatingGeoSphere = 0;
-static SDL_mutex *s_geosphereUpdateQueueLock = 0;
-static SDL_cond *s_geosphereUpdateQueueCondition = 0;		///< Condition variable for s_geosphereUpdateQueue and s_exitFlag. Allows waking up the thread when useful.
-static SDL_Thread *s_updateThread = 0;
-
-static bool s_exitFlag = false;
-
-/* Thread that updates geosphere level of detail thingies */
-int GeoSphere::UpdateLODThread(void *data)
-{
-	SDL_mutexP(s_geosphereUpdateQueueLock);
-
-	while (true) {
-
-		// check for exit. doing it here to avoid needing another lock
-		if (s_exitFlag)
-			break;
-
-		assert(s_currentlyUpdatingGeoSphere == 0);
-
-		if (! s_geosphereUpdateQueue.empty()) {
-			// pull the next GeoSphere off the queue
-			s_currentlyUpdatingGeoSphere = s_geosphereUpdateQueue.front();
-			s_geosphereUpdateQueue.pop_front();
-
-			assert(s_currentlyUpdatingGeoSphere);
-
-			GeoSphere *gs = s_currentlyUpdatingGeoSphere;
-			// overlap locks to ensure gs doesn't die before we've locked it
-			SDL_mutexP(gs->m_updateLock);
-			SDL_mutexV(s_geosphereUpdateQueueLock);
-
-			// update the patches
-			for (int n=0; n<6; n++)
-				gs->m_patches[n]->LODUpdate(gs->m_tempCampos);
-
-			// overlap locks again
-			SDL_mutexP(s_geosphereUpdateQueueLock);
-			assert(s_currentlyUpdatingGeoSphere == gs);
-			s_currentlyUpdatingGeoSphere = 0;
-
-			SDL_mutexV(gs->m_updateLock);
-		} else {
-			// queue is empty; wait to be signalled
-			// note: SDL_CondWait unlocks the mutex while it's blocked
-			SDL_CondWait(s_geosphereUpdateQueueCondition, s_geosphereUpdateQueueLock);
-		}
-	}
-
-	SDL_mutexV(s_geosphereUpdateQueueLock);
-	return 0;
-}
+static JobQueue *s_jobQueue = 0;
+
+// splits wait here until UpdateAllGeoSpheres() hands the most urgent ones to
+// the workers. only a few are let out at a time so that what's queued can
+// still be reordered as the camera moves
+struct PendingSplit {
+	GeoPatchSplitJob *job;
+	double priority;
+	bool operator<(const PendingSplit &other) const { return priority > other.priority; }
+};
+static std::vector<PendingSplit> s_pendingSplits;
+static SDL_mutex *s_pendingSplitsLock = 0;
+static int s_splitsInFlight = 0;
+static int s_maxSplitsPerFrame = 0;
+// heights generated for patch meshes. split jobs add theirs when they
+// finish, so this is under the split lock too
+static int s_vtxGenCount = 0;
 
 void GeoSphere::Init()
 {
-	s_geosphereUpdateQueueLock = SDL_CreateMutex();
-	s_geosphereUpdateQueueCondition = SDL_CreateCond();
+	// geospheres cancel their splits as they go, so the split lock is
+	// needed whenever they can exist. the rest is only for drawing
+	s_pendingSplitsLock = SDL_CreateMutex();
+	if (Pi::IsHeadless()) return;
 
 	s_patchContext.Reset(new GeoPatchContext(detail_edgeLen[Pi::detail.planets > 4 ? 4 : Pi::detail.planets]));
 	assert(s_patchContext->edgeLen <= GEOPATCH_MAX_EDGELEN);
 
-#ifdef GEOSPHERE_USE_THREADING
-	s_updateThread = SDL_CreateThread(&GeoSphere::UpdateLODThread, 0);
-#endif /* GEOSPHERE_USE_THREADING */
+	int numWorkers = Pi::config->Int("TerrainWorkerThreads");
+	if (numWorkers <= 0) numWorkers = JobQueue::GetDefaultNumWorkers();
+	s_jobQueue = new JobQueue(numWorkers);
+
+	s_maxSplitsPerFrame = std::max(Pi::config->Int("TerrainSplitsPerFrame"), 1);
+
+	const int cacheSizeMB = std::max(Pi::config->Int("TerrainCacheSizeMB"), 0);
+	GeoPatchCache::Init(Uint64(cacheSizeMB) << 20, Pi::config->Int("TerrainCacheColors") != 0);
 }
 
 void GeoSphere::Uninit()
 {
-#ifdef GEOSPHERE_USE_THREADING
-	// instruct the thread to exit
-	assert(s_geosphereUpdateQueue.empty());
-	SDL_mutexP(s_geosphereUpdateQueueLock);
-	s_exitFlag = true;
-	SDL_mutexV(s_geosphereUpdateQueueLock);
-	SDL_CondBroadcast(s_geosphereUpdateQueueCondition);
+	for (std::vector<PendingSplit>::iterator i = s_pendingSplits.begin(); i != s_pendingSplits.end(); ++i)
+		delete i->job;
+	s_pendingSplits.clear();
+
+	delete s_jobQueue;
+	s_jobQueue = 0;
 
-	SDL_WaitThread(s_updateThread, 0);
-#endif /* GEOSPHERE_USE_THREADING */
+	SDL_DestroyMutex(s_pendingSplitsLock);
+	s_pendingSplitsLock = 0;
+	s_splitsInFlight = 0;
+	if (Pi::IsHeadless()) return;
+
+	GeoPatchCache::Uninit();
 
 	assert (s_patchContext.Unique());
 	s_patchContext.Reset();
-
-	SDL_DestroyCond(s_geosphereUpdateQueueCondition);
-	SDL_DestroyMutex(s_geosphereUpdateQueueLock);
 }
 
 static void print_info(const SystemBody *sbody, const Terrain *terrain)
@@ -1140,30 +1338,23 @@ static void print_info(const SystemBody *sbody, const Terrain *terrain)
 
 void GeoSphere::OnChangeDetailLevel()
 {
-	s_patchContext.Reset(new GeoPatchContext(detail_edgeLen[Pi::detail.planets > 4 ? 4 : Pi::detail.planets]));
-	assert(s_patchContext->edgeLen <= GEOPATCH_MAX_EDGELEN);
-
-	// cancel all queued updates
-	SDL_mutexP(s_geosphereUpdateQueueLock);
-	s_geosphereUpdateQueue.clear();
-	GeoSphere *gs = s_currentlyUpdatingGeoSphere;
-	SDL_mutexV(s_geosphereUpdateQueueLock);
-
-	// if a terrain is currently being updated, then abort the update
-	if (gs) {
-		SDL_mutexP(gs->m_abortLock);
-		gs->m_abort = true;
-		SDL_mutexV(gs->m_abortLock);
+	// abort all updates in progress at once, then wait for them all
+	for(std::vector<GeoSphere*>::iterator i = s_allGeospheres.begin();
+			i != s_allGeospheres.end(); ++i) {
+		SDL_mutexP((*i)->m_abortLock);
+		(*i)->m_abort = true;
+		SDL_mutexV((*i)->m_abortLock);
 	}
 
-	// reinit the geosphere terrain data
+	// patches hold a bare pointer to the context, so they must all be gone
+	// before it's replaced
 	for(std::vector<GeoSphere*>::iterator i = s_allGeospheres.begin();
 			i != s_allGeospheres.end(); ++i) {
 
-		// we need the update lock so we don't delete working data out from
-		// under the thread. it should finish very quickly since we told it to
+		// the workers should finish very quickly since we told them to
 		// abort quickly
-		SDL_mutexP((*i)->m_updateLock);
+		(*i)->CancelPendingSplits();
+		(*i)->WaitForJobs();
 
 		for (int p=0; p<6; p++) {
 			// delete patches
@@ -1172,6 +1363,16 @@ void GeoSphere::OnChangeDetailLevel()
 				(*i)->m_patches[p] = 0;
 			}
 		}
+		// and any that were merged away but not yet freed
+		(*i)->DestroyVBOs();
+	}
+
+	s_patchContext.Reset(new GeoPatchContext(detail_edgeLen[Pi::detail.planets > 4 ? 4 : Pi::detail.planets]));
+	assert(s_patchContext->edgeLen <= GEOPATCH_MAX_EDGELEN);
+
+	// reinit the geosphere terrain data
+	for(std::vector<GeoSphere*>::iterator i = s_allGeospheres.begin();
+			i != s_allGeospheres.end(); ++i) {
 
 		// reinit the terrain with the new settings
 		delete (*i)->m_terrain;
@@ -1179,10 +1380,9 @@ void GeoSphere::OnChangeDetailLevel()
 		print_info((*i)->m_sbody, (*i)->m_terrain);
 
 		// clear the abort for the next run (with the new settings)
+		SDL_mutexP((*i)->m_abortLock);
 		(*i)->m_abort = false;
-
-		// finished update
-		SDL_mutexV((*i)->m_updateLock);
+		SDL_mutexV((*i)->m_abortLock);
 	}
 }
 
@@ -1192,14 +1392,21 @@ GeoSphere::GeoSphere(const SystemBody *body)
 {
 	m_terrain = Terrain::InstanceTerrain(body);
 	print_info(body, m_terrain);
+	// keep the coordinates within the key
+	m_latticeStep = std::max(LATTICE_SPACING / body->GetRadius(), 4.0 / double(1 << LATTICE_COORD_BITS));
+	m_latticeTick = 0;
 
 	m_vbosToDestroyLock = SDL_CreateMutex();
 	m_sbody = body;
 	memset(m_patches, 0, 6*sizeof(GeoPatch*));
 
-	m_updateLock = SDL_CreateMutex();
+	m_treeLock = SDL_CreateMutex();
+	m_jobsLock = SDL_CreateMutex();
+	m_jobsFinished = SDL_CreateCond();
+	m_numJobs = 0;
 	m_abortLock = SDL_CreateMutex();
 	m_abort = false;
+	m_campos = vector3d(0.0);
 
 	s_allGeospheres.push_back(this);
 
@@ -1208,28 +1415,23 @@ GeoSphere::GeoSphere(const SystemBody *body)
 
 GeoSphere::~GeoSphere()
 {
-	// tell the thread to finish up with this geosphere
+	// tell the workers to finish up with this geosphere
 	SDL_mutexP(m_abortLock);
 	m_abort = true;
 	SDL_mutexV(m_abortLock);
 
-	SDL_mutexP(s_geosphereUpdateQueueLock);
-	assert(std::count(s_allGeospheres.begin(), s_allGeospheres.end(), this) <= 1);
-	s_geosphereUpdateQueue.erase(
-		std::remove(s_geosphereUpdateQueue.begin(), s_geosphereUpdateQueue.end(), this),
-		s_geosphereUpdateQueue.end());
-	SDL_mutexV(s_geosphereUpdateQueueLock);
+	// wait until they're all done
+	CancelPendingSplits();
+	WaitForJobs();
 
-	// wait until it completes update
-	SDL_mutexP(m_updateLock);
-	SDL_mutexV(m_updateLock);
-
-	// update thread should not be able to access us now, so we can safely continue to delete
+	// workers should not be able to access us now, so we can safely continue to delete
 	assert(std::count(s_allGeospheres.begin(), s_allGeospheres.end(), this) == 1);
 	s_allGeospheres.erase(std::find(s_allGeospheres.begin(), s_allGeospheres.end(), this));
 
 	SDL_DestroyMutex(m_abortLock);
-	SDL_DestroyMutex(m_updateLock);
+	SDL_DestroyCond(m_jobsFinished);
+	SDL_DestroyMutex(m_jobsLock);
+	SDL_DestroyMutex(m_treeLock);
 
 	for (int i=0; i<6; i++) if (m_patches[i]) delete m_patches[i];
 	DestroyVBOs();
@@ -1238,6 +1440,142 @@ GeoSphere::~GeoSphere()
 	delete m_terrain;
 }
 
+void GeoSphere::QueueLODUpdate(const vector3d &campos)
+{
+	// a pass runs until every split it started has been linked in, and the
+	// next can't start before then: a patch's kids may only be merged by
+	// the same pass that visits the patch
+	SDL_mutexP(m_jobsLock);
+	const bool busy = (m_numJobs > 0);
+	SDL_mutexV(m_jobsLock);
+	if (busy || IsAborting())
+		return;
+
+	for (int i=0; i<6; i++)
+		s_jobQueue->Queue(new GeoPatchLODUpdateJob(this, m_patches[i], campos));
+}
+
+void GeoSphere::QueueSplit(GeoPatch *patch, const vector3d &campos)
+{
+	GeoPatchSplitJob *job = new GeoPatchSplitJob(this, patch, campos);
+	PiVerify(SDL_mutexP(s_pendingSplitsLock)==0);
+	// checked with the lock held so CancelPendingSplits() can't miss it
+	if (IsAborting())
+		delete job;
+	else {
+		PendingSplit split = { job, 0.0 };
+		s_pendingSplits.push_back(split);
+	}
+	PiVerify(SDL_mutexV(s_pendingSplitsLock)!=-1);
+}
+
+void GeoSphere::CancelPendingSplits()
+{
+	assert(IsAborting());
+	PiVerify(SDL_mutexP(s_pendingSplitsLock)==0);
+	std::vector<PendingSplit>::iterator keep = s_pendingSplits.begin();
+	for (std::vector<PendingSplit>::iterator i = s_pendingSplits.begin(); i != s_pendingSplits.end(); ++i) {
+		if (i->job->GetGeoSphere() == this)
+			delete i->job;
+		else
+			*(keep++) = *i;
+	}
+	s_pendingSplits.erase(keep, s_pendingSplits.end());
+	PiVerify(SDL_mutexV(s_pendingSplitsLock)!=-1);
+}
+
+void GeoSphere::OnSplitFinished(int vtxGenCount)
+{
+	PiVerify(SDL_mutexP(s_pendingSplitsLock)==0);
+	assert(s_splitsInFlight > 0);
+	s_splitsInFlight--;
+	s_vtxGenCount += vtxGenCount;
+	PiVerify(SDL_mutexV(s_pendingSplitsLock)!=-1);
+}
+
+int GeoSphere::GetVtxGenCount()
+{
+	PiVerify(SDL_mutexP(s_pendingSplitsLock)==0);
+	const int count = s_vtxGenCount;
+	PiVerify(SDL_mutexV(s_pendingSplitsLock)!=-1);
+	return count;
+}
+
+void GeoSphere::ClearVtxGenCount()
+{
+	PiVerify(SDL_mutexP(s_pendingSplitsLock)==0);
+	s_vtxGenCount = 0;
+	PiVerify(SDL_mutexV(s_pendingSplitsLock)!=-1);
+}
+
+void GeoSphere::UpdateAllGeoSpheres()
+{
+	if (!s_jobQueue) return;
+
+	PiVerify(SDL_mutexP(s_pendingSplitsLock)==0);
+
+	// rank everything against where the camera is now. anything that no
+	// longer wants to split is dropped, which also lets the pass that asked
+	// for it finish so a new one can start from the new position
+	std::vector<PendingSplit>::iterator keep = s_pendingSplits.begin();
+	for (std::vector<PendingSplit>::iterator i = s_pendingSplits.begin(); i != s_pendingSplits.end(); ++i) {
+		i->priority = i->job->GetPatch()->GetSplitPriority(i->job->GetGeoSphere()->m_campos);
+		if (i->priority <= 0.0)
+			delete i->job;
+		else
+			*(keep++) = *i;
+	}
+	s_pendingSplits.erase(keep, s_pendingSplits.end());
+
+	// keep the workers fed, but no more than that
+	const int room = std::min(2*s_jobQueue->GetNumWorkers() - s_splitsInFlight, s_maxSplitsPerFrame);
+	if (room > 0 && !s_pendingSplits.empty()) {
+		const int n = std::min(room, int(s_pendingSplits.size()));
+		std::partial_sort(s_pendingSplits.begin(), s_pendingSplits.begin()+n, s_pendingSplits.end());
+		for (int i = 0; i < n; i++) {
+			GeoPatchSplitJob *job = s_pendingSplits[i].job;
+			job->SetCampos(job->GetGeoSphere()->m_campos);
+			s_jobQueue->Queue(job);
+		}
+		s_splitsInFlight += n;
+		s_pendingSplits.erase(s_pendingSplits.begin(), s_pendingSplits.begin()+n);
+	}
+
+	PiVerify(SDL_mutexV(s_pendingSplitsLock)!=-1);
+}
+
+void GeoSphere::OnJobQueued()
+{
+	SDL_mutexP(m_jobsLock);
+	m_numJobs++;
+	SDL_mutexV(m_jobsLock);
+}
+
+void GeoSphere::OnJobFinished()
+{
+	SDL_mutexP(m_jobsLock);
+	assert(m_numJobs > 0);
+	if (--m_numJobs == 0)
+		SDL_CondBroadcast(m_jobsFinished);
+	SDL_mutexV(m_jobsLock);
+}
+
+void GeoSphere::WaitForJobs()
+{
+	SDL_mutexP(m_jobsLock);
+	while (m_numJobs > 0)
+		SDL_CondWait(m_jobsFinished, m_jobsLock);
+	SDL_mutexV(m_jobsLock);
+}
+
+bool GeoSphere::IsAborting()
+{
+	SDL_mutexP(m_abortLock);
+	const bool abort = m_abort;
+	SDL_mutexV(m_abortLock);
+	return abort;
+}
+
 void GeoSphere::AddVBOToDestroy(GLuint vbo)
 {
 	SDL_mutexP(m_vbosToDestroyLock);
@@ -1245,8 +1583,26 @@ void GeoSphere::AddVBOToDestroy(GLuint vbo)
 	SDL_mutexV(m_vbosToDestroyLock);
 }
 
+void GeoSphere::RetireKids(GeoPatchKids *kids)
+{
+	SDL_mutexP(m_vbosToDestroyLock);
+	m_kidsToDestroy.push_back(kids);
+	SDL_mutexV(m_vbosToDestroyLock);
+}
+
+// only called from the render thread, between frames
 void GeoSphere::DestroyVBOs()
 {
+	// merged patches first, since deleting them gives us more vbos
+	SDL_mutexP(m_vbosToDestroyLock);
+	std::vector<GeoPatchKids*> kidsToDestroy;
+	kidsToDestroy.swap(m_kidsToDestroy);
+	SDL_mutexV(m_vbosToDestroyLock);
+	for (std::vector<GeoPatchKids*>::iterator i = kidsToDestroy.begin(); i != kidsToDestroy.end(); ++i) {
+		for (int k=0; k<4; k++) delete (*i)->kid[k];
+		delete *i;
+	}
+
 	SDL_mutexP(m_vbosToDestroyLock);
 	for (std::list<GLuint>::iterator i = m_vbosToDestroy.begin();
 			i != m_vbosToDestroy.end(); ++i) {
@@ -1276,22 +1632,129 @@ void GeoSphere::BuildFirstPatches()
 	p7 = p7.Normalized();
 	p8 = p8.Normalized();
 
-	m_patches[0] = new GeoPatch(s_patchContext, this, p1, p2, p3, p4, 0);
-	m_patches[1] = new GeoPatch(s_patchContext, this, p4, p3, p7, p8, 0);
-	m_patches[2] = new GeoPatch(s_patchContext, this, p1, p4, p8, p5, 0);
-	m_patches[3] = new GeoPatch(s_patchContext, this, p2, p1, p5, p6, 0);
-	m_patches[4] = new GeoPatch(s_patchContext, this, p3, p2, p6, p7, 0);
-	m_patches[5] = new GeoPatch(s_patchContext, this, p8, p7, p6, p5, 0);
+	m_patches[0] = new GeoPatch(s_patchContext.Get(), this, p1, p2, p3, p4, 0);
+	m_patches[1] = new GeoPatch(s_patchContext.Get(), this, p4, p3, p7, p8, 0);
+	m_patches[2] = new GeoPatch(s_patchContext.Get(), this, p1, p4, p8, p5, 0);
+	m_patches[3] = new GeoPatch(s_patchContext.Get(), this, p2, p1, p5, p6, 0);
+	m_patches[4] = new GeoPatch(s_patchContext.Get(), this, p3, p2, p6, p7, 0);
+	m_patches[5] = new GeoPatch(s_patchContext.Get(), this, p8, p7, p6, p5, 0);
 	for (int i=0; i<6; i++) {
 		for (int j=0; j<4; j++) {
 			m_patches[i]->edgeFriend[j] = m_patches[geo_sphere_edge_friends[i][j]];
 		}
 	}
-	for (int i=0; i<6; i++) m_patches[i]->GenerateMesh();
+	int vtxGenCount = 0;
+	for (int i=0; i<6; i++) {
+		m_patches[i]->m_path = 8 | i;
+		vtxGenCount += m_patches[i]->GenerateMesh();
+	}
+	PiVerify(SDL_mutexP(s_pendingSplitsLock)==0);
+	s_vtxGenCount += vtxGenCount;
+	PiVerify(SDL_mutexV(s_pendingSplitsLock)!=-1);
 	for (int i=0; i<6; i++) m_patches[i]->GenerateEdgeNormalsAndColors();
 	for (int i=0; i<6; i++) m_patches[i]->UpdateVBOs();
 }
 
+static Sint64 lattice_key(int face, int i, int j)
+{
+	const Sint64 bias = Sint64(1) << (LATTICE_COORD_BITS-1);
+	return (((Sint64(face) << LATTICE_COORD_BITS) | (i + bias)) << LATTICE_COORD_BITS) | (j + bias);
+}
+
+static vector3d lattice_point(Sint64 key, double step)
+{
+	const Sint64 mask = (Sint64(1) << LATTICE_COORD_BITS) - 1;
+	const Sint64 bias = Sint64(1) << (LATTICE_COORD_BITS-1);
+	const int j = int((key & mask) - bias);
+	const int i = int(((key >> LATTICE_COORD_BITS) & mask) - bias);
+	const int face = int(key >> (2*LATTICE_COORD_BITS));
+	const int axis = face >> 1;
+	double c[3];
+	c[axis] = (face & 1) ? -1.0 : 1.0;
+	c[(axis+1)%3] = Clamp(i*step, -1.0, 1.0);
+	c[(axis+2)%3] = Clamp(j*step, -1.0, 1.0);
+	return vector3d(c[0], c[1], c[2]).Normalized();
+}
+
+void GeoSphere::GetLatticeHeights(const vector3d *dirs, double *heights, int count)
+{
+	const double step = m_latticeStep;
+	m_latticeTick++;
+
+	// the cell each point is in and where it is within it. corners that
+	// haven't been sampled yet go to the terrain in one batch
+	std::vector<Sint64> keys(4*count);
+	std::vector<double> fracs(2*count);
+	std::vector<Sint64> missKeys;
+	for (int n=0; n<count; n++) {
+		const vector3d &d = dirs[n];
+		const double a[3] = { fabs(d.x), fabs(d.y), fabs(d.z) };
+		const int axis = (a[0] >= a[1] && a[0] >= a[2]) ? 0 : (a[1] >= a[2] ? 1 : 2);
+		const double c[3] = { d.x, d.y, d.z };
+		const int face = 2*axis + (c[axis] < 0.0 ? 1 : 0);
+		const double u = c[(axis+1)%3] / (a[axis] * step);
+		const double v = c[(axis+2)%3] / (a[axis] * step);
+		const int i = int(floor(u));
+		const int j = int(floor(v));
+		fracs[2*n] = u - i;
+		fracs[2*n+1] = v - j;
+		for (int k=0; k<4; k++) {
+			const Sint64 key = lattice_key(face, i + (k & 1), j + (k >> 1));
+			keys[4*n+k] = key;
+			if (m_latticeHeights.find(key) == m_latticeHeights.end())
+				missKeys.push_back(key);
+		}
+	}
+
+	if (!missKeys.empty()) {
+		// neighbouring points share corners
+		std::sort(missKeys.begin(), missKeys.end());
+		missKeys.erase(std::unique(missKeys.begin(), missKeys.end()), missKeys.end());
+		const int numMisses = int(missKeys.size());
+		std::vector<double> x(numMisses), y(numMisses), z(numMisses), h(numMisses);
+		for (int n=0; n<numMisses; n++) {
+			const vector3d p = lattice_point(missKeys[n], step);
+			x[n] = p.x; y[n] = p.y; z[n] = p.z;
+		}
+		GetHeights(&x[0], &y[0], &z[0], &h[0], numMisses);
+		for (int n=0; n<numMisses; n++) {
+			LatticeHeight &lh = m_latticeHeights[missKeys[n]];
+			lh.height = h[n];
+			lh.lastUsed = m_latticeTick;
+		}
+	}
+
+	for (int n=0; n<count; n++) {
+		double h[4];
+		for (int k=0; k<4; k++) {
+			LatticeHeight &lh = m_latticeHeights[keys[4*n+k]];
+			lh.lastUsed = m_latticeTick;
+			h[k] = lh.height;
+		}
+		const double fx = fracs[2*n], fy = fracs[2*n+1];
+		heights[n] = (1.0-fy)*((1.0-fx)*h[0] + fx*h[1]) + fy*((1.0-fx)*h[2] + fx*h[3]);
+	}
+
+	if (m_latticeHeights.size() > size_t(LATTICE_MAX_CACHED))
+		EvictLatticeHeights();
+}
+
+void GeoSphere::EvictLatticeHeights()
+{
+	// drop the least recently used half. everything used by the last call
+	// is newest, so the points bodies are sitting on stay
+	std::vector<Uint32> ages;
+	ages.reserve(m_latticeHeights.size());
+	for (std::map<Sint64,LatticeHeight>::const_iterator i = m_latticeHeights.begin(); i != m_latticeHeights.end(); ++i)
+		ages.push_back(i->second.lastUsed);
+	std::nth_element(ages.begin(), ages.begin() + ages.size()/2, ages.end());
+	const Uint32 cutoff = ages[ages.size()/2];
+	for (std::map<Sint64,LatticeHeight>::iterator i = m_latticeHeights.begin(); i != m_latticeHeights.end(); ) {
+		if (i->second.lastUsed < cutoff) m_latticeHeights.erase(i++);
+		else ++i;
+	}
+}
+
 static const float g_ambient[4] = { 0, 0, 0, 1.0 };
 
 static void DrawAtmosphereSurface(Graphics::Renderer *renderer,
@@ -1433,31 +1896,12 @@ void GeoSphere::Render(Graphics::Renderer *renderer, vector3d campos, const floa
 
 	renderer->SetAmbientColor(oldAmbient);
 
-	// if the update thread has deleted any geopatches, destroy the vbos
+	// if the workers have deleted any geopatches, destroy the vbos
 	// associated with them
 	DestroyVBOs();
-		/*this->m_tempCampos = campos;
-		UpdateLODThread(this);
-		return;*/
-
-	bool added(false);		// Tells if something has been queued.
-	SDL_mutexP(s_geosphereUpdateQueueLock);
-	bool onQueue =
-		(std::find(s_geosphereUpdateQueue.begin(), s_geosphereUpdateQueue.end(), this)
-			!= s_geosphereUpdateQueue.end());
-	// put ourselves on the update queue, unless we're already there or already being updated
-	if (!onQueue && (s_currentlyUpdatingGeoSphere != this)) {
-		this->m_tempCampos = campos;
-		s_geosphereUpdateQueue.push_back(this);
-		added = true;
-	}
-	SDL_mutexV(s_geosphereUpdateQueueLock);
-	if (added) SDL_CondBroadcast(s_geosphereUpdateQueueCondition);
-
-#ifndef GEOSPHERE_USE_THREADING
-	m_tempCampos = campos;
-	_UpdateLODs();
-#endif /* !GEOSPHERE_USE_THREADING */
+
+	m_campos = campos;
+	QueueLODUpdate(campos);
 }
 
 void GeoSphere::SetUpMaterials()
@@ -16,6 +16,7 @@ namespace Graphics { class Renderer; }
 class SystemBody;
 class GeoPatch;
 class GeoPatchContext;
+struct GeoPatchKids;
 class GeoSphere {
 public:
 	GeoSphere(const SystemBody *body);
@@ -23,7 +24,6 @@ public:
 	void Render(Graphics::Renderer *r, vector3d campos, const float radius, const float scale);
 	inline double GetHeight(vector3d p) {
 		const double h = m_terrain->GetHeight(p);
-		s_vtxGenCount++;
 #ifdef DEBUG
 		// XXX don't remove this. Fix your fractals instead
 		// Fractals absolutely MUST return heights >= 0.0 (one planet radius)
@@ -32,14 +32,29 @@ public:
 #endif /* DEBUG */
 		return h;
 	}
+	inline void GetHeights(const double *x, const double *y, const double *z, double *heights, int count) {
+		m_terrain->GetHeights(x, y, z, heights, count);
+#ifdef DEBUG
+		for (int i = 0; i < count; i++) assert(heights[i] >= 0.0);
+#endif /* DEBUG */
+	}
+	// heights at the given (unit) directions, interpolated between terrain
+	// heights taken on a fixed lattice, 25m apart at most. nothing to do
+	// with what's been drawn, so the answers are the same wherever the
+	// camera is, or without one. lattice heights are kept between calls,
+	// the least recently used going first. main thread only
+	void GetLatticeHeights(const vector3d *dirs, double *heights, int count);
 	friend class GeoPatch;
 	static void Init();
 	static void Uninit();
 	static void OnChangeDetailLevel();
+	// hands the most urgent patch splits to the workers. once per frame
+	static void UpdateAllGeoSpheres();
 	// in sbody radii
 	double GetMaxFeatureHeight() const { return m_terrain->GetMaxHeight(); }
-	static int GetVtxGenCount() { return s_vtxGenCount; }
-	static void ClearVtxGenCount() { s_vtxGenCount = 0; }
+	// terrain heights generated for patch meshes since the last clear
+	static int GetVtxGenCount();
+	static void ClearVtxGenCount();
 
 private:
 	void BuildFirstPatches();
@@ -49,27 +64,68 @@ private:
 	/* all variables for GetHeight(), GetColor() */
 	Terrain *m_terrain;
 
+	// terrain heights at lattice points, for GetLatticeHeights
+	struct LatticeHeight {
+		double height;
+		Uint32 lastUsed;
+	};
+	void EvictLatticeHeights();
+	std::map<Sint64,LatticeHeight> m_latticeHeights;
+	double m_latticeStep;		// in radii
+	Uint32 m_latticeTick;		// GetLatticeHeights calls so far
+
 	///////////////////////////
 	// threading rubbbbbish
-	// update thread can't do it since only 1 thread can molest opengl
-	static int UpdateLODThread(void *data);
+	// LOD updates run on a pool of workers (s_jobQueue). each split of a
+	// patch is a separate job, so one planet's terrain is generated on all
+	// the cores. the workers can't do the vbo work since only 1 thread can
+	// molest opengl
+	friend class GeoSphereJob;
+	friend class GeoPatchSplitJob;
+	void QueueLODUpdate(const vector3d &campos);
+	// splits don't go straight to the workers; they wait in a queue shared
+	// by all geospheres and are let out in order of priority by
+	// UpdateAllGeoSpheres()
+	void QueueSplit(GeoPatch *patch, const vector3d &campos);
+	void CancelPendingSplits();
+	// vtxGenCount is the number of heights the split generated
+	static void OnSplitFinished(int vtxGenCount);
+	void OnJobQueued();
+	void OnJobFinished();
+	void WaitForJobs();
+	bool IsAborting();
+
+	// patches merged away by the workers, and the vbos of deleted patches,
+	// are freed by the render thread between frames
 	std::list<GLuint> m_vbosToDestroy;
+	std::vector<GeoPatchKids*> m_kidsToDestroy;
 	SDL_mutex *m_vbosToDestroyLock;
 	void AddVBOToDestroy(GLuint vbo);
+	void RetireKids(GeoPatchKids *kids);
 	void DestroyVBOs();
 
-	vector3d m_tempCampos;
+	// held by workers while they change the shape of the patch tree
+	// (splitting, merging and edge fixups between neighbours)
+	SDL_mutex *m_treeLock;
+
+	SDL_mutex *m_jobsLock;
+	SDL_cond *m_jobsFinished;
+	int m_numJobs;
 
-	SDL_mutex *m_updateLock;
 	SDL_mutex *m_abortLock;
 	bool m_abort;
+
+	// camera position as of the last Render(), for ranking splits
+	vector3d m_campos;
 	//////////////////////////////
 
 	inline vector3d GetColor(const vector3d &p, double height, const vector3d &norm) {
 		return m_terrain->GetColor(p, height, norm);
 	}
-
-	static int s_vtxGenCount;
+	inline void GetColors(const double *x, const double *y, const double *z, const double *heights,
+			const double *nx, const double *ny, const double *nz, vector3d *colors, int count) {
+		m_terrain->GetColors(x, y, z, heights, nx, ny, nz, colors, count);
+	}
 
 	static RefCountedPtr<GeoPatchContext> s_patchContext;
 
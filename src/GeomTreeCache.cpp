@@ -0,0 +1,78 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "GeomTreeCache.h"
+#include "FileSystem.h"
+#include "CRC32.h"
+#include "collider/GeomTree.h"
+
+namespace GeomTreeCache {
+
+static const char CACHE_DIR[] = "model_cache/geomtrees";
+
+class KeyHash {
+public:
+	KeyHash() : m_fnv(2166136261u) {}
+
+	void Add(const void *data, size_t size) {
+		const char *p = static_cast<const char*>(data);
+		m_crc.AddData(p, int(size));
+		// fnv-1a
+		for (size_t i = 0; i < size; i++) {
+			m_fnv ^= Uint8(p[i]);
+			m_fnv *= 16777619u;
+		}
+	}
+
+	std::string GetName() {
+		char buf[32];
+		snprintf(buf, sizeof(buf), "%08x%08x.bin", m_crc.GetChecksum(), m_fnv);
+		return buf;
+	}
+
+private:
+	CRC32 m_crc;
+	Uint32 m_fnv;
+};
+
+// hashed before welding, which is what the caller hands us each time
+static std::string entry_name(int numVerts, int numTris, const float *vertices, const int *indices, const unsigned int *triflags)
+{
+	KeyHash h;
+	const Sint32 counts[2] = { numVerts, numTris };
+	h.Add(counts, sizeof(counts));
+	h.Add(vertices, sizeof(float) * 3 * numVerts);
+	h.Add(indices, sizeof(int) * 3 * numTris);
+	h.Add(triflags, sizeof(unsigned int) * numTris);
+	return h.GetName();
+}
+
+GeomTree *Build(int numVerts, int numTris, float *vertices, int *indices, unsigned int *triflags)
+{
+	const std::string path = FileSystem::JoinPath(CACHE_DIR, entry_name(numVerts, numTris, vertices, indices, triflags));
+
+	if (FileSystem::userFiles.Lookup(path).IsFile()) {
+		RefCountedPtr<FileSystem::FileData> data = FileSystem::userFiles.MapFile(path);
+		if (data) {
+			GeomTree *t = GeomTree::Load(numVerts, numTris, vertices, indices, triflags, data->GetData(), data->GetSize());
+			if (t) return t;
+		}
+	}
+
+	GeomTree *t = new GeomTree(numVerts, numTris, vertices, indices, triflags);
+
+	std::vector<char> blob;
+	t->Save(blob);
+	FileSystem::userFiles.MakeDirectory("model_cache");
+	FileSystem::userFiles.MakeDirectory(CACHE_DIR);
+	FILE *f = FileSystem::userFiles.OpenWriteStream(path);
+	if (f) {
+		const bool ok = (fwrite(&blob[0], blob.size(), 1, f) == 1);
+		fclose(f);
+		// don't leave half an entry about; it'd only be rebuilt next time
+		if (!ok) FileSystem::userFiles.RemoveFile(path);
+	}
+	return t;
+}
+
+}
@@ -0,0 +1,25 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _GEOMTREECACHE_H
+#define _GEOMTREECACHE_H
+
+#include "libs.h"
+
+class GeomTree;
+
+/*
+ * On-disk cache of built collision trees, kept in the user dir. Entries are
+ * named after a hash of the mesh they were built from, so an edited model
+ * simply misses and gets a new entry. Entries that fail to load (old
+ * version, truncated) are rebuilt and overwritten.
+ */
+
+namespace GeomTreeCache
+{
+	// takes the same arguments as the GeomTree constructor, and like it
+	// welds indices in place
+	GeomTree *Build(int numVerts, int numTris, float *vertices, int *indices, unsigned int *triflags);
+}
+
+#endif /* _GEOMTREECACHE_H */
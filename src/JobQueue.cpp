@@ -0,0 +1,224 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "JobQueue.h"
+#include "OS.h"
+#include <algorithm>
+
+JobQueue::JobQueue(int numWorkers) :
+	m_numQueued(0),
+	m_quit(false)
+{
+	assert(numWorkers > 0);
+
+	m_inboxLock = SDL_CreateMutex();
+	m_queuedLock = SDL_CreateMutex();
+	m_jobAvailable = SDL_CreateCond();
+
+	// all workers must exist before any of them goes looking for work to steal
+	for (int i = 0; i < numWorkers; i++) {
+		Worker *w = new Worker;
+		w->queue = this;
+		w->thread = 0;
+		w->threadId = 0;
+		w->lock = SDL_CreateMutex();
+		m_workers.push_back(w);
+	}
+	// thread ids are set here rather than by the workers themselves, so
+	// they're never written once anyone can read them. nothing is queued
+	// until we return
+	for (std::vector<Worker*>::iterator i = m_workers.begin(); i != m_workers.end(); ++i) {
+		Worker *w = *i;
+		w->thread = SDL_CreateThread(&JobQueue::WorkerThread, w);
+		w->threadId = SDL_GetThreadID(w->thread);
+	}
+}
+
+JobQueue::~JobQueue()
+{
+	SDL_mutexP(m_queuedLock);
+	m_quit = true;
+	SDL_mutexV(m_queuedLock);
+	SDL_CondBroadcast(m_jobAvailable);
+
+	for (std::vector<Worker*>::iterator i = m_workers.begin(); i != m_workers.end(); ++i)
+		SDL_WaitThread((*i)->thread, 0);
+
+	// anything that never got to run is discarded
+	for (std::vector<Worker*>::iterator i = m_workers.begin(); i != m_workers.end(); ++i) {
+		Worker *w = *i;
+		for (std::deque<Job*>::iterator j = w->jobs.begin(); j != w->jobs.end(); ++j)
+			delete *j;
+		SDL_DestroyMutex(w->lock);
+		delete w;
+	}
+	for (std::deque<Job*>::iterator j = m_inbox.begin(); j != m_inbox.end(); ++j)
+		delete *j;
+
+	SDL_DestroyCond(m_jobAvailable);
+	SDL_DestroyMutex(m_queuedLock);
+	SDL_DestroyMutex(m_inboxLock);
+}
+
+int JobQueue::GetDefaultNumWorkers()
+{
+	return std::max(OS::GetNumCores() - 1, 1);
+}
+
+void JobQueue::Queue(Job *job)
+{
+	Worker *w = GetCurrentWorker();
+	if (w) {
+		SDL_mutexP(w->lock);
+		w->jobs.push_back(job);
+		SDL_mutexV(w->lock);
+	} else {
+		SDL_mutexP(m_inboxLock);
+		m_inbox.push_back(job);
+		SDL_mutexV(m_inboxLock);
+	}
+
+	// only count the job once it can be found, so a woken worker never has
+	// to wait for it
+	SDL_mutexP(m_queuedLock);
+	m_numQueued++;
+	SDL_mutexV(m_queuedLock);
+	SDL_CondSignal(m_jobAvailable);
+}
+
+JobQueue::Worker *JobQueue::GetCurrentWorker() const
+{
+	const Uint32 id = SDL_ThreadID();
+	for (std::vector<Worker*>::const_iterator i = m_workers.begin(); i != m_workers.end(); ++i)
+		if ((*i)->threadId == id) return *i;
+	return 0;
+}
+
+Job *JobQueue::TakeJob(Worker *w)
+{
+	Job *job = 0;
+
+	// own work first, newest first
+	SDL_mutexP(w->lock);
+	if (!w->jobs.empty()) {
+		job = w->jobs.back();
+		w->jobs.pop_back();
+	}
+	SDL_mutexV(w->lock);
+	if (job) return job;
+
+	SDL_mutexP(m_inboxLock);
+	if (!m_inbox.empty()) {
+		job = m_inbox.front();
+		m_inbox.pop_front();
+	}
+	SDL_mutexV(m_inboxLock);
+	if (job) return job;
+
+	// steal the oldest job from someone else; it's likely the biggest
+	for (std::vector<Worker*>::iterator i = m_workers.begin(); i != m_workers.end() && !job; ++i) {
+		Worker *victim = *i;
+		if (victim == w) continue;
+		SDL_mutexP(victim->lock);
+		if (!victim->jobs.empty()) {
+			job = victim->jobs.front();
+			victim->jobs.pop_front();
+		}
+		SDL_mutexV(victim->lock);
+	}
+	return job;
+}
+
+void JobQueue::RunWorker(Worker *w)
+{
+	while (true) {
+		SDL_mutexP(m_queuedLock);
+		while (!m_quit && m_numQueued <= 0)
+			SDL_CondWait(m_jobAvailable, m_queuedLock);
+		const bool quit = m_quit;
+		SDL_mutexV(m_queuedLock);
+		if (quit) break;
+
+		// something's queued, but another worker may get to it first, in
+		// which case it's back to sleep
+		Job *job = TakeJob(w);
+		if (!job) continue;
+		SDL_mutexP(m_queuedLock);
+		m_numQueued--;
+		SDL_mutexV(m_queuedLock);
+
+		job->OnRun();
+		delete job;
+	}
+}
+
+int JobQueue::WorkerThread(void *data)
+{
+	Worker *w = reinterpret_cast<Worker*>(data);
+	w->queue->RunWorker(w);
+	return 0;
+}
+
+// runs a job for a set, then tells the set. a job thrown away without
+// running is done too, as far as the set is concerned
+class JobSet::SetJob : public Job {
+public:
+	SetJob(JobSet *set, Job *job) : m_set(set), m_job(job) {}
+	virtual ~SetJob() {
+		if (!m_job) return;
+		delete m_job;
+		m_set->JobDone();
+	}
+
+	virtual void OnRun() {
+		m_job->OnRun();
+		delete m_job;
+		m_job = 0;
+		m_set->JobDone();
+	}
+
+private:
+	JobSet *m_set;
+	Job *m_job;
+};
+
+JobSet::JobSet(JobQueue *queue) :
+	m_queue(queue),
+	m_numOutstanding(0)
+{
+	m_lock = SDL_CreateMutex();
+	m_done = SDL_CreateCond();
+}
+
+JobSet::~JobSet()
+{
+	Wait();
+	SDL_DestroyCond(m_done);
+	SDL_DestroyMutex(m_lock);
+}
+
+void JobSet::Queue(Job *job)
+{
+	SDL_mutexP(m_lock);
+	m_numOutstanding++;
+	SDL_mutexV(m_lock);
+	m_queue->Queue(new SetJob(this, job));
+}
+
+void JobSet::Wait()
+{
+	SDL_mutexP(m_lock);
+	while (m_numOutstanding > 0)
+		SDL_CondWait(m_done, m_lock);
+	SDL_mutexV(m_lock);
+}
+
+void JobSet::JobDone()
+{
+	// signal with the lock held, since the waiter may destroy the set the
+	// moment it sees the count hit zero
+	SDL_mutexP(m_lock);
+	if (--m_numOutstanding == 0)
+		SDL_CondBroadcast(m_done);
+	SDL_mutexV(m_lock);
+}
@@ -0,0 +1,92 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _JOBQUEUE_H
+#define _JOBQUEUE_H
+
+#include "libs.h"
+#include <deque>
+
+// A unit of work to be run on a JobQueue worker thread. Once queued the job
+// belongs to the queue, which deletes it after OnRun() returns (or without
+// running it at all, if the queue is shut down first).
+class Job {
+public:
+	Job() {}
+	virtual ~Job() {}
+
+	virtual void OnRun() = 0;
+};
+
+// A fixed pool of worker threads that share work by stealing. Each worker has
+// its own deque: jobs queued from inside a running job go on the back of the
+// current worker's deque and that worker takes them back LIFO, so a job's
+// children run hot in cache. An idle worker takes from the front of the
+// shared inbox (fed by non-worker threads) or, failing that, from the front
+// of another worker's deque.
+class JobQueue {
+public:
+	JobQueue(int numWorkers);
+	~JobQueue();
+
+	void Queue(Job *job);
+
+	int GetNumWorkers() const { return int(m_workers.size()); }
+
+	// one worker per core, leaving one for the main thread
+	static int GetDefaultNumWorkers();
+
+private:
+	struct Worker {
+		JobQueue *queue;
+		SDL_Thread *thread;
+		Uint32 threadId;
+		SDL_mutex *lock;
+		std::deque<Job*> jobs;
+	};
+
+	static int WorkerThread(void *data);
+	void RunWorker(Worker *w);
+	Worker *GetCurrentWorker() const;
+	Job *TakeJob(Worker *w);
+
+	std::vector<Worker*> m_workers;
+
+	SDL_mutex *m_inboxLock;
+	std::deque<Job*> m_inbox;
+
+	// m_numQueued counts jobs sitting in any deque. a job is counted once
+	// it's in and uncounted once it's been taken out, so it can be taken
+	// (and the count dip below zero) before it's counted. workers sleep on
+	// m_jobAvailable while there's nothing counted.
+	SDL_mutex *m_queuedLock;
+	SDL_cond *m_jobAvailable;
+	int m_numQueued;
+	bool m_quit;
+};
+
+// Jobs that one thread queues and then waits for. Jobs given to the set
+// belong to it until they've run. The set must outlive its jobs, so its
+// destructor waits for any that are still out. A job the queue throws away
+// without running still counts as done, so a set never waits on a queue
+// that has been shut down.
+class JobSet {
+public:
+	JobSet(JobQueue *queue);
+	~JobSet();
+
+	void Queue(Job *job);
+	// returns once every job queued so far has run
+	void Wait();
+
+private:
+	class SetJob;
+	void JobDone();
+
+	JobQueue *m_queue;
+	SDL_mutex *m_lock;
+	SDL_cond *m_done;
+	int m_numOutstanding;
+};
+
+#endif
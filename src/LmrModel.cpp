@@ -18,6 +18,7 @@
 #include "ShipType.h"
 #include "FileSystem.h"
 #include "CRC32.h"
+#include "GeomTreeCache.h"
 #include "graphics/Graphics.h"
 #include "graphics/Material.h"
 #include "graphics/Renderer.h"
@@ -1635,7 +1636,7 @@ LmrCollMesh::LmrCollMesh(LmrModel *m, const LmrObjParams *params)
 	, pFlag(0)
 {
 	m->GetCollMeshGeometry(this, matrix4x4f::Identity(), params);
-	m_geomTree = new GeomTree(nv, m_numTris, pVertex, pIndex, pFlag);
+	m_geomTree = GeomTreeCache::Build(nv, m_numTris, pVertex, pIndex, pFlag);
 }
 
 /** returns number of tris found (up to 'num') */
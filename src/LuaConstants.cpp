@@ -266,6 +266,26 @@ void LuaConstants::Register(lua_State *l)
 	_create_constant_table_nonconsecutive(l, "BodySuperType", ENUM_BodySuperType);
 
 
+	/*
+	 * Constants: EconType
+	 *
+	 * What a system's economy is mainly based on.
+	 *
+	 * MINING - mining
+	 * AGRICULTURE - farming
+	 * INDUSTRY - manufacturing
+	 *
+	 * Availability:
+	 *
+	 *   alpha 31
+	 *
+	 * Status:
+	 *
+	 *   experimental
+	 */
+	_create_constant_table_nonconsecutive(l, "EconType", ENUM_EconType);
+
+
 	/*
 	 * Constants: PolitCrime
 	 *
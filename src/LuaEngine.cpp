@@ -77,6 +77,11 @@ static int l_engine_attr_ticks(lua_State *l)
  */
 static int l_engine_attr_ui(lua_State *l)
 {
+	// none when running headless
+	if (!Pi::ui) {
+		lua_pushnil(l);
+		return 1;
+	}
 	LuaObject<UI::Context>::PushToLua(Pi::ui.Get());
 	return 1;
 }
@@ -18,6 +18,8 @@
 #include "Planet.h"
 #include "SpaceStation.h"
 #include "galaxy/Sector.h"
+#include "galaxy/SectorCache.h"
+#include "galaxy/SystemIndex.h"
 #include "Factions.h"
 
 /*
@@ -233,46 +235,97 @@ static int l_starsystem_get_nearby_systems(lua_State *l)
 
 	lua_newtable(l);
 
-	SystemPath here = s->GetPath();
-
-	int here_x = here.sectorX;
-	int here_y = here.sectorY;
-	int here_z = here.sectorZ;
-	Uint32 here_idx = here.systemIndex;
-	Sector here_sec(here_x, here_y, here_z);
-
-	int diff_sec = int(ceil(dist_ly/Sector::SIZE));
-
-	for (int x = here_x-diff_sec; x <= here_x+diff_sec; x++) {
-		for (int y = here_y-diff_sec; y <= here_y+diff_sec; y++) {
-			for (int z = here_z-diff_sec; z <= here_z+diff_sec; z++) {
-				Sector sec(x, y, z);
-
-				for (unsigned int idx = 0; idx < sec.m_systems.size(); idx++) {
-					if (x == here_x && y == here_y && z == here_z && idx == here_idx)
-						continue;
-
-					if (Sector::DistanceBetween(&here_sec, here_idx, &sec, idx) > dist_ly)
-						continue;
-
-					RefCountedPtr<StarSystem> sys = StarSystem::GetCached(SystemPath(x, y, z, idx));
-					if (filter) {
-						lua_pushvalue(l, 3);
-						LuaStarSystem::PushToLua(sys.Get());
-						lua_call(l, 1, 1);
-						if (!lua_toboolean(l, -1)) {
-							lua_pop(l, 1);
-							continue;
-						}
-						lua_pop(l, 1);
-					}
-
-					lua_pushinteger(l, lua_rawlen(l, -1)+1);
-					LuaStarSystem::PushToLua(sys.Get());
-					lua_rawset(l, -3);
-				}
+	std::vector<SystemPath> paths;
+	SystemIndex::FindInRange(s->GetPath(), dist_ly, paths);
+
+	for (std::vector<SystemPath>::const_iterator i = paths.begin(); i != paths.end(); ++i) {
+		RefCountedPtr<StarSystem> sys = StarSystem::GetCached(*i);
+		if (filter) {
+			lua_pushvalue(l, 3);
+			LuaStarSystem::PushToLua(sys.Get());
+			lua_call(l, 1, 1);
+			if (!lua_toboolean(l, -1)) {
+				lua_pop(l, 1);
+				continue;
 			}
+			lua_pop(l, 1);
 		}
+
+		lua_pushinteger(l, lua_rawlen(l, -1)+1);
+		LuaStarSystem::PushToLua(sys.Get());
+		lua_rawset(l, -3);
+	}
+
+	LUA_DEBUG_END(l, 1);
+
+	return 1;
+}
+
+/*
+ * Method: GetNearbySystemPaths
+ *
+ * Get a list of the paths to nearby systems that match some criteria,
+ * without generating the systems
+ *
+ * > paths = system:GetNearbySystemPaths(range, filter)
+ *
+ * Parameters:
+ *
+ *   range - distance from this system to search, in light years
+ *
+ *   filter - an optional function. If specified the function will be called
+ *            once for each candidate system with its <SystemPath> passed as
+ *            the only parameter. If the filter function returns true then
+ *            the path will be included in the array returned by
+ *            <GetNearbySystemPaths>, otherwise it will be omitted. If no
+ *            filter function is specified then all systems in range are
+ *            returned.
+ *
+ * Return:
+ *
+ *  paths - an array of paths to the systems in range that matched the filter
+ *
+ * Availability:
+ *
+ *   alpha 31
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_starsystem_get_nearby_system_paths(lua_State *l)
+{
+	LUA_DEBUG_START(l);
+
+	StarSystem *s = LuaStarSystem::CheckFromLua(1);
+	double dist_ly = luaL_checknumber(l, 2);
+
+	bool filter = false;
+	if (lua_gettop(l) >= 3) {
+		luaL_checktype(l, 3, LUA_TFUNCTION); // any type of function
+		filter = true;
+	}
+
+	lua_newtable(l);
+
+	std::vector<SystemPath> paths;
+	SystemIndex::FindInRange(s->GetPath(), dist_ly, paths);
+
+	for (std::vector<SystemPath>::iterator i = paths.begin(); i != paths.end(); ++i) {
+		if (filter) {
+			lua_pushvalue(l, 3);
+			LuaSystemPath::PushToLua(&(*i));
+			lua_call(l, 1, 1);
+			if (!lua_toboolean(l, -1)) {
+				lua_pop(l, 1);
+				continue;
+			}
+			lua_pop(l, 1);
+		}
+
+		lua_pushinteger(l, lua_rawlen(l, -1)+1);
+		LuaSystemPath::PushToLua(&(*i));
+		lua_rawset(l, -3);
 	}
 
 	LUA_DEBUG_END(l, 1);
@@ -316,10 +369,10 @@ static int l_starsystem_distance_to(lua_State *l)
 		loc2 = &(s2->GetPath());
 	}
 
-	Sector sec1(loc1->sectorX, loc1->sectorY, loc1->sectorZ);
-	Sector sec2(loc2->sectorX, loc2->sectorY, loc2->sectorZ);
+	RefCountedPtr<const Sector> sec1 = SectorCache::Get(*loc1);
+	RefCountedPtr<const Sector> sec2 = SectorCache::Get(*loc2);
 
-	double dist = Sector::DistanceBetween(&sec1, loc1->systemIndex, &sec2, loc2->systemIndex);
+	double dist = Sector::DistanceBetween(sec1.Get(), loc1->systemIndex, sec2.Get(), loc2->systemIndex);
 
 	lua_pushnumber(l, dist);
 
@@ -466,6 +519,7 @@ template <> void LuaObject<StarSystem>::RegisterClass()
 		{ "IsCommodityLegal",                 l_starsystem_is_commodity_legal                   },
 
 		{ "GetNearbySystems", l_starsystem_get_nearby_systems },
+		{ "GetNearbySystemPaths", l_starsystem_get_nearby_system_paths },
 
 		{ "DistanceTo", l_starsystem_distance_to },
 
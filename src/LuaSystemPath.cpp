@@ -9,6 +9,11 @@
 #include "galaxy/SystemPath.h"
 #include "galaxy/StarSystem.h"
 #include "galaxy/Sector.h"
+#include "galaxy/SectorCache.h"
+#include "galaxy/StarSystemSummary.h"
+#include "LuaConstants.h"
+#include "LuaFaction.h"
+#include "Factions.h"
 
 /*
  * Class: SystemPath
@@ -73,8 +78,8 @@ static int l_sbodypath_new(lua_State *l)
 		path.systemIndex = luaL_checkinteger(l, 4);
 
 		// if this is a system path, then check that the system exists
-		Sector s(sector_x, sector_y, sector_z);
-		if (size_t(path.systemIndex) >= s.m_systems.size())
+		RefCountedPtr<const Sector> s = SectorCache::Get(path);
+		if (size_t(path.systemIndex) >= s->m_systems.size())
 			luaL_error(l, "System %d in sector <%d,%d,%d> does not exist", path.systemIndex, sector_x, sector_y, sector_z);
 
 		if (lua_gettop(l) > 4) {
@@ -243,10 +248,10 @@ static int l_sbodypath_distance_to(lua_State *l)
 		loc2 = &(s2->GetPath());
 	}
 
-	Sector sec1(loc1->sectorX, loc1->sectorY, loc1->sectorZ);
-	Sector sec2(loc2->sectorX, loc2->sectorY, loc2->sectorZ);
+	RefCountedPtr<const Sector> sec1 = SectorCache::Get(*loc1);
+	RefCountedPtr<const Sector> sec2 = SectorCache::Get(*loc2);
 
-	double dist = Sector::DistanceBetween(&sec1, loc1->systemIndex, &sec2, loc2->systemIndex);
+	double dist = Sector::DistanceBetween(sec1.Get(), loc1->systemIndex, sec2.Get(), loc2->systemIndex);
 
 	lua_pushnumber(l, dist);
 
@@ -326,6 +331,78 @@ static int l_sbodypath_get_system_body(lua_State *l)
 	return 1;
 }
 
+/*
+ * Method: GetSystemSummary
+ *
+ * Get what most scripts want to know about the system this path points to,
+ * without keeping its bodies around
+ *
+ * > summary = path:GetSystemSummary()
+ *
+ * The system is generated the first time its summary is asked for, but
+ * the summary is remembered long after the system itself is gone.
+ *
+ * Return:
+ *
+ *   summary - a table with these fields:
+ *
+ *     name - the system's name
+ *     starTypes - an array of the <Constants.BodyType> of each star
+ *     faction - the <Faction> that controls the system, or nil
+ *     explored - true if the system has been explored
+ *     lawlessness - the system's lawlessness
+ *     population - the system's population, in billions of people
+ *     econType - the system's <Constants.EconType>, or nil if nobody
+ *                lives there
+ *     numStarports - how many starports the system has
+ *
+ * Availability:
+ *
+ *   alpha 31
+ *
+ * Status:
+ *
+ *   experimental
+ */
+static int l_sbodypath_get_system_summary(lua_State *l)
+{
+	SystemPath *path = LuaSystemPath::CheckFromLua(1);
+
+	if (path->IsSectorPath()) {
+		luaL_error(l, "Path <%d,%d,%d> does not name a system", path->sectorX, path->sectorY, path->sectorZ);
+		return 0;
+	}
+
+	LUA_DEBUG_START(l);
+
+	const StarSystemSummary summary = StarSystemSummary::Get(*path);
+
+	lua_newtable(l);
+	pi_lua_settable(l, "name", summary.name.c_str());
+
+	lua_newtable(l);
+	for (int i = 0; i < summary.numStars; i++)
+		pi_lua_settable(l, i+1, LuaConstants::GetConstantString(l, "BodyType", summary.starType[i]));
+	lua_setfield(l, -2, "starTypes");
+
+	if (summary.faction->IsValid()) {
+		LuaFaction::PushToLua(summary.faction);
+		lua_setfield(l, -2, "faction");
+	}
+
+	lua_pushboolean(l, summary.explored);
+	lua_setfield(l, -2, "explored");
+	pi_lua_settable(l, "lawlessness", summary.lawlessness.ToDouble());
+	pi_lua_settable(l, "population", summary.population.ToDouble());
+	if (summary.econType)
+		pi_lua_settable(l, "econType", LuaConstants::GetConstantString(l, "EconType", summary.econType));
+	pi_lua_settable(l, "numStarports", int(summary.numStarports));
+
+	LUA_DEBUG_END(l, 1);
+
+	return 1;
+}
+
 
 /*
  * Attribute: sectorX
@@ -481,6 +558,7 @@ template <> void LuaObject<LuaUncopyable<SystemPath> >::RegisterClass()
 
 		{ "GetStarSystem", l_sbodypath_get_star_system },
 		{ "GetSystemBody", l_sbodypath_get_system_body },
+		{ "GetSystemSummary", l_sbodypath_get_system_summary },
 
 		{ 0, 0 }
 	};
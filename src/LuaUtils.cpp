@@ -346,14 +346,22 @@ void pi_lua_dofile(lua_State *l, const std::string &path)
 
 void pi_lua_dofile_recursive(lua_State *l, const std::string &basepath)
 {
+	pi_lua_dofile_recursive(l, basepath, std::set<std::string>());
+}
+
+void pi_lua_dofile_recursive(lua_State *l, const std::string &basepath, const std::set<std::string> &skip)
+{
+	if (skip.count(basepath)) return;
+
 	LUA_DEBUG_START(l);
 
 	for (FileSystem::FileEnumerator files(FileSystem::gameDataFiles, basepath, FileSystem::FileEnumerator::IncludeDirs); !files.Finished(); files.Next())
 	{
 		const FileSystem::FileInfo &info = files.Current();
 		const std::string &fpath = info.GetPath();
+		if (skip.count(fpath)) continue;
 		if (info.IsDir()) {
-			pi_lua_dofile_recursive(l, fpath);
+			pi_lua_dofile_recursive(l, fpath, skip);
 		} else {
 			assert(info.IsFile());
 			if (ends_with(fpath, ".lua")) {
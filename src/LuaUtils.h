@@ -4,6 +4,7 @@
 #ifndef _LUAUTILS_H
 #define _LUAUTILS_H
 
+#include <set>
 #include <string>
 #include "lua/lua.hpp"
 #include "utils.h"
@@ -61,6 +62,8 @@ int  pi_lua_panic(lua_State *l) __attribute((noreturn));
 void pi_lua_protected_call(lua_State* state, int nargs, int nresults);
 void pi_lua_dofile(lua_State *l, const std::string &path);
 void pi_lua_dofile_recursive(lua_State *l, const std::string &basepath);
+// as above, but not the files or directories (paths as FileInfo::GetPath gives them) in skip
+void pi_lua_dofile_recursive(lua_State *l, const std::string &basepath, const std::set<std::string> &skip);
 int  pi_load_lua(lua_State *l);
 
 void pi_lua_warn(lua_State *l, const char *format, ...) __attribute((format(printf,2,3)));
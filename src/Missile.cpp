@@ -20,6 +20,8 @@ Missile::Missile(ShipType::Id shipId, Body *owner, Body *target): Ship(shipId)
 
 	m_owner = owner;
 	m_target = target;
+	Watch(m_owner);
+	Watch(m_target);
 	m_distToTarget = FLT_MAX;
 	SetLabel(Lang::MISSILE);
 
@@ -38,6 +40,8 @@ void Missile::PostLoadFixup(Space *space)
 	Ship::PostLoadFixup(space);
 	m_owner = space->GetBodyByIndex(m_ownerIndex);
 	m_target = space->GetBodyByIndex(m_targetIndex);
+	Watch(m_owner);
+	Watch(m_target);
 }
 
 void Missile::Save(Serializer::Writer &wr, Space *space)
@@ -96,7 +100,9 @@ void Missile::Explode()
 	const double damageRadius = 200.0;
 	const double kgDamage = 10000.0;
 
-	for (Space::BodyIterator i = Pi::game->GetSpace()->BodiesBegin(); i != Pi::game->GetSpace()->BodiesEnd(); ++i) {
+	std::vector<Body*> hit;
+	Pi::game->GetSpace()->GetProximityIndex().FindInRadius(GetFrame(), GetPosition(), damageRadius, Object::BODY, hit, true);
+	for (std::vector<Body*>::const_iterator i = hit.begin(); i != hit.end(); ++i) {
 		if ((*i)->GetFrame() != GetFrame()) continue;
 		double dist = ((*i)->GetPosition() - GetPosition()).Length();
 		if (dist < damageRadius) {
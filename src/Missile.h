@@ -15,6 +15,7 @@ public:
 	Missile() {}
 	virtual ~Missile() {}
 	void TimeStepUpdate(const float timeStep);
+	virtual Activity GetActivity() const { return ACTIVE; }
 	virtual bool OnCollision(Object *o, Uint32 flags, double relVel);
 	virtual bool OnDamage(Object *attacker, float kgDamage);
 	virtual void NotifyRemoved(const Body* const removedBody);
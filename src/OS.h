@@ -29,6 +29,9 @@ namespace OS {
 	// should not be considered reliable
 	Uint64 HFTimerFreq();
 	Uint64 HFTimer();
+
+	// Number of logical processors available to the process, at least 1
+	int GetNumCores();
 }
 
 #endif
@@ -14,6 +14,7 @@
 #include "Game.h"
 #include "GameMenuView.h"
 #include "GeoSphere.h"
+#include "JobQueue.h"
 #include "Intro.h"
 #include "Lang.h"
 #include "LmrModel.h"
@@ -76,6 +77,9 @@
 #include "WorldView.h"
 #include "galaxy/CustomSystem.h"
 #include "galaxy/Galaxy.h"
+#include "galaxy/SectorCache.h"
+#include "galaxy/SystemIndex.h"
+#include "galaxy/StarSystemSummary.h"
 #include "galaxy/StarSystem.h"
 #include "gameui/Lua.h"
 #include "graphics/Graphics.h"
@@ -134,6 +138,7 @@ bool Pi::joystickEnabled;
 bool Pi::mouseYInvert;
 std::vector<Pi::JoystickState> Pi::joysticks;
 bool Pi::navTunnelDisplayed;
+bool Pi::headless = false;
 Gui::Fixed *Pi::menu;
 const char * const Pi::combatRating[] = {
 	Lang::HARMLESS,
@@ -149,6 +154,7 @@ const char * const Pi::combatRating[] = {
 Graphics::Renderer *Pi::renderer;
 RefCountedPtr<UI::Context> Pi::ui;
 ModelCache *Pi::modelCache;
+JobQueue *Pi::simJobQueue;
 
 #if WITH_OBJECTVIEWER
 ObjectViewerView *Pi::objectViewerView;
@@ -172,6 +178,8 @@ int Pi::CombatRating(int kills)
 
 static void draw_progress(float progress)
 {
+	if (Pi::IsHeadless()) return;
+
 	float w, h;
 	Pi::renderer->BeginFrame();
 	Pi::renderer->EndFrame();
@@ -183,7 +191,7 @@ static void draw_progress(float progress)
 	Pi::renderer->SwapBuffers();
 }
 
-static void LuaInit()
+static void LuaInit(const std::set<std::string> &skip = std::set<std::string>())
 {
 	LuaBody::RegisterClass();
 	LuaShip::RegisterClass();
@@ -226,9 +234,9 @@ static void LuaInit()
 
 	// XXX load everything. for now, just modules
 	lua_State *l = Lua::manager->GetLuaState();
-	pi_lua_dofile_recursive(l, "libs");
-	pi_lua_dofile_recursive(l, "ui");
-	pi_lua_dofile_recursive(l, "modules");
+	pi_lua_dofile_recursive(l, "libs", skip);
+	pi_lua_dofile_recursive(l, "ui", skip);
+	pi_lua_dofile_recursive(l, "modules", skip);
 
 	Pi::luaNameGen = new LuaNameGen(Lua::manager);
 }
@@ -265,6 +273,53 @@ ModelBase *Pi::FindModel(const std::string &name)
 
 const char Pi::SAVE_DIR_NAME[] = "savefiles";
 
+// the galaxy, factions, models and everything else the simulation needs
+static void init_world()
+{
+	draw_progress(0.1f);
+
+	Galaxy::Init();
+	draw_progress(0.2f);
+
+	Faction::Init();
+	draw_progress(0.3f);
+
+	CustomSystem::Init();
+	Faction::InitHomeSectors();
+	SectorCache::Init(Uint64(std::max(Pi::config->Int("SectorCacheSizeMB"), 0)) << 20);
+	SystemIndex::Init();
+	StarSystemSummary::Init();
+	StarSystem::Init();
+	draw_progress(0.4f);
+
+	LmrModelCompilerInit(Pi::renderer);
+	Pi::modelCache = new ModelCache(Pi::renderer);
+	draw_progress(0.5f);
+
+//unsigned int control_word;
+//_clearfp();
+//_controlfp_s(&control_word, _EM_INEXACT | _EM_UNDERFLOW | _EM_ZERODIVIDE, _MCW_EM);
+//double fpexcept = Pi::timeAccelRates[1] / Pi::timeAccelRates[0];
+
+	ShipType::Init();
+	draw_progress(0.6f);
+
+	GeoSphere::Init();
+	draw_progress(0.7f);
+
+	const int simWorkers = Pi::config->Int("SimWorkerThreads");
+	Pi::simJobQueue = new JobQueue(simWorkers > 0 ? simWorkers : JobQueue::GetDefaultNumWorkers());
+
+	CityOnPlanet::Init();
+	draw_progress(0.8f);
+
+	SpaceStation::Init();
+	draw_progress(0.9f);
+
+	Sfx::Init(Pi::renderer);
+	draw_progress(0.95f);
+}
+
 std::string Pi::GetSaveDir()
 {
 	return FileSystem::JoinPath(FileSystem::GetUserDir(), Pi::SAVE_DIR_NAME);
@@ -372,40 +427,7 @@ void Pi::Init()
 	// that the capability exists. (Gui does not use VBOs so far)
 	Gui::Init(renderer, Graphics::GetScreenWidth(), Graphics::GetScreenHeight(), 800, 600);
 
-	draw_progress(0.1f);
-
-	Galaxy::Init();
-	draw_progress(0.2f);
-
-	Faction::Init();
-	draw_progress(0.3f);
-
-	CustomSystem::Init();
-	draw_progress(0.4f);
-
-	LmrModelCompilerInit(Pi::renderer);
-	modelCache = new ModelCache(Pi::renderer);
-	draw_progress(0.5f);
-
-//unsigned int control_word;
-//_clearfp();
-//_controlfp_s(&control_word, _EM_INEXACT | _EM_UNDERFLOW | _EM_ZERODIVIDE, _MCW_EM);
-//double fpexcept = Pi::timeAccelRates[1] / Pi::timeAccelRates[0];
-
-	ShipType::Init();
-	draw_progress(0.6f);
-
-	GeoSphere::Init();
-	draw_progress(0.7f);
-
-	CityOnPlanet::Init();
-	draw_progress(0.8f);
-
-	SpaceStation::Init();
-	draw_progress(0.9f);
-
-	Sfx::Init(Pi::renderer);
-	draw_progress(0.95f);
+	init_world();
 
 	if (!config->Int("DisableSound")) {
 		Sound::Init();
@@ -540,6 +562,52 @@ void Pi::Init()
 	config->Save();
 }
 
+void Pi::InitHeadless(const std::set<std::string> &skipLua)
+{
+	headless = true;
+
+	FileSystem::Init();
+	FileSystem::userFiles.MakeDirectory(""); // ensure the config directory exists
+
+	Pi::config = new GameConfig();
+	KeyBindings::InitBindings();
+
+	ModManager::Init();
+
+	if (!Lang::LoadStrings(config->String("Lang")))
+		abort();
+
+	Pi::detail.planets = config->Int("DetailPlanets");
+	Pi::detail.textures = config->Int("Textures");
+	Pi::detail.fracmult = config->Int("FractalMultiple");
+	Pi::detail.cities = config->Int("DetailCities");
+
+	// no video, just threads and timers
+	if (SDL_Init(SDL_INIT_TIMER) < 0) {
+		OS::Error("SDL initialization failed: %s\n", SDL_GetError());
+	}
+
+	Graphics::Settings videoSettings = {};
+	videoSettings.width = config->Int("ScrWidth");
+	videoSettings.height = config->Int("ScrHeight");
+	Pi::renderer = Graphics::InitNull(videoSettings);
+
+	Pi::scrAspect = videoSettings.width / float(videoSettings.height);
+
+	Pi::rng.seed(time(0));
+
+	// there's no Pi::ui, so nothing that builds UI at load time, and no
+	// music to play
+	std::set<std::string> skip(skipLua);
+	skip.insert("ui");
+	skip.insert("modules/MusicPlayer.lua");
+
+	Lua::Init();
+	LuaInit(skip);
+
+	init_world();
+}
+
 bool Pi::IsConsoleActive()
 {
 	return luaConsole && luaConsole->IsActive();
@@ -572,12 +640,17 @@ void Pi::Quit()
 	SpaceStation::Uninit();
 	CityOnPlanet::Uninit();
 	GeoSphere::Uninit();
+	delete Pi::simJobQueue;
 	LmrModelCompilerUninit();
+	StarSystem::Uninit();
+	StarSystemSummary::Uninit();
+	SystemIndex::Uninit();
+	SectorCache::Uninit();
 	Galaxy::Uninit();
 	Graphics::Uninit();
 	Pi::ui.Reset(0);
 	LuaUninit();
-	Gui::Uninit();
+	if (!headless) Gui::Uninit();
 	delete Pi::modelCache;
 	delete Pi::renderer;
 	StarSystem::ShrinkCache();
@@ -845,7 +918,7 @@ void Pi::InitGame()
 		std::fill(stick->axes.begin(), stick->axes.end(), 0.f);
 	}
 
-	if (!config->Int("DisableSound")) AmbientSounds::Init();
+	if (!headless && !config->Int("DisableSound")) AmbientSounds::Init();
 
 	LuaInitGame();
 }
@@ -966,7 +1039,7 @@ void Pi::MainLoop()
 	Uint32 last_stats = SDL_GetTicks();
 	int frame_stat = 0;
 	int phys_stat = 0;
-	char fps_readout[256];
+	char fps_readout[512];
 	memset(fps_readout, 0, sizeof(fps_readout));
 #endif
 
@@ -1074,10 +1147,10 @@ void Pi::MainLoop()
 			// XXX should this really be limited to while the player is alive?
 			// this is something we need not do every turn...
 			if (!config->Int("DisableSound")) AmbientSounds::Update();
-			StarSystem::ShrinkCache();
 		}
 		cpan->Update();
 		musicPlayer.Update();
+		GeoSphere::UpdateAllGeoSpheres();
 
 #if WITH_DEVKEYS
 		if (Pi::showDebugInfo && SDL_GetTicks() - last_stats > 1000) {
@@ -1088,13 +1161,18 @@ void Pi::MainLoop()
 
 			Pi::statSceneTris += LmrModelGetStatsTris();
 
+			StarSystem::CacheStats systems;
+			StarSystem::GetCacheStats(systems);
+
 			snprintf(
 				fps_readout, sizeof(fps_readout),
 				"%d fps (%.1f ms/f), %d phys updates, %d triangles, %.3f M tris/sec, %d terrain vtx/sec, %d glyphs/sec\n"
-				"Lua mem usage: %d MB + %d KB + %d bytes",
+				"Lua mem usage: %d MB + %d KB + %d bytes\n"
+				"Systems cached: %d (%d KB), %u hits, %u misses",
 				frame_stat, (1000.0/frame_stat), phys_stat, Pi::statSceneTris, Pi::statSceneTris*frame_stat*1e-6,
 				GeoSphere::GetVtxGenCount(), Text::TextureFont::GetGlyphCount(),
-				lua_memMB, lua_memKB, lua_memB
+				lua_memMB, lua_memKB, lua_memB,
+				systems.numSystems, int(systems.size >> 10), systems.hits, systems.misses
 			);
 			frame_stat = 0;
 			phys_stat = 0;
@@ -1164,6 +1242,8 @@ float Pi::CalcHyperspaceFuelOut(int hyperclass, float dist, float hyperspace_ran
 
 void Pi::Message(const std::string &message, const std::string &from, enum MsgLevel level)
 {
+	if (!Pi::cpan) return;
+
 	if (level == MSG_IMPORTANT) {
 		Pi::cpan->MsgLog()->ImportantMessage(from, message);
 	} else {
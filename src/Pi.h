@@ -14,6 +14,7 @@
 #include "CargoBody.h"
 #include "Space.h"
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -35,6 +36,7 @@ class GameMenuView;
 class LuaConsole;
 class LuaNameGen;
 class ModelCache;
+class JobQueue;
 class ModelBase;
 namespace Graphics { class Renderer; }
 namespace Sound { class MusicPlayer; }
@@ -62,6 +64,11 @@ class Game;
 class Pi {
 public:
 	static void Init();
+	// just what the simulation needs, for running it from tools: no window,
+	// GL, UI or sound. skipLua are Lua files or directories under data
+	// (eg "modules/TradeShips.lua") not to load
+	static void InitHeadless(const std::set<std::string> &skipLua = std::set<std::string>());
+	static bool IsHeadless() { return headless; }
 	static void InitGame();
 	static void StarportStart(Uint32 starport);
 	static void StartGame();
@@ -146,6 +153,8 @@ public:
 	static Sound::MusicPlayer &GetMusicPlayer() { return musicPlayer; }
 	static Graphics::Renderer *renderer; // blargh
 	static ModelCache *modelCache;
+	// for work the simulation spreads over threads within a step
+	static JobQueue *simJobQueue;
 
 #if WITH_OBJECTVIEWER
 	static ObjectViewerView *objectViewerView;
@@ -163,6 +172,7 @@ private:
 	static void InitJoysticks();
 
 	static bool menuDone;
+	static bool headless;
 
 	static View *currentView;
 
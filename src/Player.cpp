@@ -68,7 +68,7 @@ void Player::SetDockedWith(SpaceStation *s, int port)
 {
 	Ship::SetDockedWith(s, port);
 	if (s) {
-		if (Pi::CombatRating(m_killCount) > Pi::CombatRating(m_knownKillCount)) {
+		if (Pi::cpan && Pi::CombatRating(m_killCount) > Pi::CombatRating(m_knownKillCount)) {
 			Pi::cpan->MsgLog()->ImportantMessage(Lang::PIONEERING_PILOTS_GUILD, Lang::RIGHT_ON_COMMANDER);
 		}
 		m_knownKillCount = m_killCount;
@@ -100,6 +100,12 @@ bool Player::FireMissile(int idx, Ship *target)
 //XXX do in lua, or use the alert concept for all ships
 void Player::SetAlertState(Ship::AlertState as)
 {
+	// no one to tell when running headless
+	if (!Pi::cpan) {
+		Ship::SetAlertState(as);
+		return;
+	}
+
 	Ship::AlertState prev = GetAlertState();
 
 	switch (as) {
@@ -201,7 +207,7 @@ void Player::OnEnterHyperspace()
 	SetNavTarget(0);
 	SetCombatTarget(0);
 
-	Pi::worldView->HideTargetActions(); // hide the comms menu
+	if (Pi::worldView) Pi::worldView->HideTargetActions(); // hide the comms menu
 	m_controller->SetFlightControlState(CONTROL_MANUAL); //could set CONTROL_HYPERDRIVE
 	ClearThrusterState();
 	Pi::game->WantHyperspace();
@@ -211,7 +217,7 @@ void Player::OnEnterSystem()
 {
 	m_controller->SetFlightControlState(CONTROL_MANUAL);
 	//XXX don't call sectorview from here, use signals instead
-	Pi::sectorView->ResetHyperspaceTarget();
+	if (Pi::sectorView) Pi::sectorView->ResetHyperspaceTarget();
 }
 
 //temporary targeting stuff
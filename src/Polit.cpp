@@ -6,6 +6,7 @@
 #include "Polit.h"
 #include "galaxy/StarSystem.h"
 #include "galaxy/Sector.h"
+#include "galaxy/SectorCache.h"
 #include "Factions.h"
 #include "Space.h"
 #include "Ship.h"
@@ -132,8 +133,9 @@ void NotifyOfCrime(Ship *s, enum Crime crime)
 		// too far away for crime to be noticed :)
 		if (dist > 100000.0) return;
 		const int crimeIdx = GetCrimeIdxFromEnum(crime);
-		Pi::cpan->MsgLog()->ImportantMessage(station->GetLabel(),
-				stringf(Lang::X_CANNOT_BE_TOLERATED_HERE, formatarg("crime", crimeNames[crimeIdx])));
+		if (Pi::cpan)
+			Pi::cpan->MsgLog()->ImportantMessage(station->GetLabel(),
+					stringf(Lang::X_CANNOT_BE_TOLERATED_HERE, formatarg("crime", crimeNames[crimeIdx])));
 
 		float lawlessness = Pi::game->GetSpace()->GetStarSystem()->GetSysPolit().lawlessness.ToFloat();
 		Sint64 oldCrimes, oldFine;
@@ -190,13 +192,13 @@ void GetSysPolitStarSystem(const StarSystem *s, const fixed human_infestedness,
 	const unsigned long _init[5] = { Uint32(path.sectorX), Uint32(path.sectorY), Uint32(path.sectorZ), path.systemIndex, POLIT_SEED };
 	MTRand rand(_init, 5);
 
-	Sector sec(path.sectorX, path.sectorY, path.sectorZ);
+	RefCountedPtr<const Sector> sec = SectorCache::Get(path);
 
 	GovType a = GOV_INVALID;
 
 	/* from custom system definition */
-	if (sec.m_systems[path.systemIndex].customSys) {
-		Polit::GovType t = sec.m_systems[path.systemIndex].customSys->govType;
+	if (sec->m_systems[path.systemIndex].customSys) {
+		Polit::GovType t = sec->m_systems[path.systemIndex].customSys->govType;
 		a = t;
 	}
 	if (a == GOV_INVALID) {
@@ -107,6 +107,7 @@ Projectile::Projectile(): Body()
 	m_type = 1;
 	m_age = 0;
 	m_parent = 0;
+	m_traced = false;
 	m_flags |= FLAG_DRAW_LAST;
 }
 
@@ -138,6 +139,7 @@ void Projectile::PostLoadFixup(Space *space)
 {
 	Body::PostLoadFixup(space);
 	m_parent = space->GetBodyByIndex(m_parentIndex);
+	Watch(m_parent);
 }
 
 void Projectile::UpdateInterpTransform(double alpha)
@@ -200,11 +202,47 @@ static void MiningLaserSpawnTastyStuff(Frame *f, const SystemBody *asteroid, con
 	Pi::game->GetSpace()->AddBody(cargo);
 }
 
+void Projectile::TraceRays(const std::list<Body*> &bodies, float timeStep)
+{
+	std::map<CollisionSpace*, std::vector<Projectile*> > bySpace;
+	for (std::list<Body*>::const_iterator i = bodies.begin(); i != bodies.end(); ++i) {
+		if (!(*i)->IsType(Object::PROJECTILE)) continue;
+		Projectile *p = static_cast<Projectile*>(*i);
+		p->m_traced = false;
+		bySpace[p->GetFrame()->GetCollisionSpace()].push_back(p);
+	}
+
+	std::vector<CollisionRay> rays;
+	std::vector<CollisionContact> contacts;
+	for (std::map<CollisionSpace*, std::vector<Projectile*> >::const_iterator s = bySpace.begin(); s != bySpace.end(); ++s) {
+		const std::vector<Projectile*> &projectiles = s->second;
+		rays.resize(projectiles.size());
+		contacts.assign(projectiles.size(), CollisionContact());
+		for (unsigned int i = 0; i < projectiles.size(); i++) {
+			const vector3d vel = (projectiles[i]->m_baseVel + projectiles[i]->m_dirVel) * timeStep;
+			rays[i].start = projectiles[i]->GetPosition();
+			rays[i].dir = vel.Normalized();
+			rays[i].len = vel.Length();
+			rays[i].ignore = 0;
+		}
+		s->first->TraceRays(int(rays.size()), &rays[0], &contacts[0]);
+		for (unsigned int i = 0; i < projectiles.size(); i++) {
+			projectiles[i]->m_contact = contacts[i];
+			projectiles[i]->m_traced = true;
+		}
+	}
+}
+
 void Projectile::StaticUpdate(const float timeStep)
 {
 	CollisionContact c;
-	vector3d vel = (m_baseVel+m_dirVel) * timeStep;
-	GetFrame()->GetCollisionSpace()->TraceRay(GetPosition(), vel.Normalized(), vel.Length(), &c, 0);
+	if (m_traced) {
+		c = m_contact;
+		m_traced = false;
+	} else {
+		vector3d vel = (m_baseVel+m_dirVel) * timeStep;
+		GetFrame()->GetCollisionSpace()->TraceRay(GetPosition(), vel.Normalized(), vel.Length(), &c, 0);
+	}
 
 	if (c.userData1) {
 		Object *o = static_cast<Object*>(c.userData1);
@@ -228,7 +266,7 @@ void Projectile::StaticUpdate(const float timeStep)
 			Planet *const planet = static_cast<Planet*>(GetFrame()->GetBody());
 			const SystemBody *b = planet->GetSystemBody();
 			vector3d pos = GetPosition();
-			double terrainHeight = planet->GetTerrainHeight(pos.Normalized());
+			double terrainHeight = planet->QueryTerrainHeight(pos.Normalized());
 			if (terrainHeight > pos.Length()) {
 				// hit the fucker
 				if (b->type == SystemBody::TYPE_PLANET_ASTEROID) {
@@ -308,6 +346,7 @@ void Projectile::Add(Body *parent, Equip::Type type, const vector3d &pos, const
 {
 	Projectile *p = new Projectile();
 	p->m_parent = parent;
+	p->Watch(parent);
 	p->m_type = Equip::types[type].tableIndex;
 	p->SetFrame(parent->GetFrame());
 
@@ -8,6 +8,7 @@
 #include "EquipType.h"
 #include "graphics/Material.h"
 #include "SmartPtr.h"
+#include "collider/CollisionContact.h"
 
 class Frame;
 namespace Graphics {
@@ -32,6 +33,11 @@ public:
 
 	static void FreeModel();
 
+	// casts the rays for every projectile in bodies for this step, one
+	// batch per collision space, for their StaticUpdates to pick up.
+	// anything added after this traces its own ray
+	static void TraceRays(const std::list<Body*> &bodies, float timeStep);
+
 protected:
 	virtual void Save(Serializer::Writer &wr, Space *space);
 	virtual void Load(Serializer::Reader &rd, Space *space);
@@ -44,6 +50,10 @@ private:
 	float m_age;
 	int m_type;
 
+	// from TraceRays
+	CollisionContact m_contact;
+	bool m_traced;
+
 	int m_parentIndex; // deserialisation
 
 	static void BuildModel();
@@ -0,0 +1,261 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "ProximityIndex.h"
+#include "Body.h"
+#include "Frame.h"
+#include <algorithm>
+
+namespace {
+	struct AxisLess {
+		int axis;
+		AxisLess(int a) : axis(a) {}
+		template <typename T>
+		bool operator()(const T &a, const T &b) const { return a.pos[axis] < b.pos[axis]; }
+	};
+
+	class ConstantReach : public ProximityIndex::Reach {
+	public:
+		ConstantReach(double r) : m_r(r) {}
+		virtual double operator()(double) const { return m_r; }
+	private:
+		double m_r;
+	};
+
+	double dist_to_aabb(const Aabb &a, const vector3d &p)
+	{
+		const vector3d d(
+			std::max(std::max(a.min.x - p.x, p.x - a.max.x), 0.0),
+			std::max(std::max(a.min.y - p.y, p.y - a.max.y), 0.0),
+			std::max(std::max(a.min.z - p.z, p.z - a.max.z), 0.0));
+		return d.Length();
+	}
+
+	// pos in frame from, seen from frame to
+	vector3d to_frame(const Frame *from, const vector3d &pos, const Frame *to)
+	{
+		if (from == to) return pos;
+		return from->GetPositionRelTo(to) + from->GetOrientRelTo(to) * pos;
+	}
+}
+
+template <typename T>
+static bool by_seq(const T &a, const T &b)
+{
+	return a.seq < b.seq;
+}
+
+ProximityIndex::ProximityIndex() :
+	m_built(false),
+	m_nextSeq(0)
+{
+}
+
+void ProximityIndex::Clear()
+{
+	m_groups.clear();
+	m_groupForFrame.clear();
+	m_nextSeq = 0;
+	m_built = false;
+}
+
+ProximityIndex::Group &ProximityIndex::GetGroup(const Frame *f)
+{
+	std::map<const Frame*,int>::const_iterator i = m_groupForFrame.find(f);
+	if (i != m_groupForFrame.end())
+		return m_groups[i->second];
+
+	m_groupForFrame.insert(std::make_pair(f, int(m_groups.size())));
+	m_groups.push_back(Group());
+	m_groups.back().frame = f;
+	return m_groups.back();
+}
+
+ProximityIndex::Entry ProximityIndex::MakeEntry(Body *b)
+{
+	Entry e;
+	e.pos = b->GetPosition();
+	e.physRadius = b->GetPhysRadius();
+	e.body = b;
+	e.seq = m_nextSeq++;
+	return e;
+}
+
+void ProximityIndex::Build(const std::list<Body*> &bodies)
+{
+	Clear();
+	for (std::list<Body*>::const_iterator i = bodies.begin(); i != bodies.end(); ++i) {
+		if (!(*i)->GetFrame()) {
+			m_nextSeq++;
+			continue;
+		}
+		GetGroup((*i)->GetFrame()).entries.push_back(MakeEntry(*i));
+	}
+
+	for (std::vector<Group>::iterator g = m_groups.begin(); g != m_groups.end(); ++g) {
+		g->nodes.reserve(2 * g->entries.size() / LEAF_SIZE + 1);
+		BuildNode(*g, 0, int(g->entries.size()));
+	}
+
+	m_built = true;
+}
+
+void ProximityIndex::Add(Body *b)
+{
+	if (!m_built || !b->GetFrame()) return;
+	GetGroup(b->GetFrame()).extra.push_back(MakeEntry(b));
+}
+
+// split at the median along the longest side until the leaves are small
+int ProximityIndex::BuildNode(Group &g, int first, int count)
+{
+	const int index = int(g.nodes.size());
+	g.nodes.push_back(Node());
+
+	Node n;
+	n.maxPhysRadius = 0.0;
+	for (int i = first; i < first + count; i++) {
+		n.aabb.Update(g.entries[i].pos);
+		n.maxPhysRadius = std::max(n.maxPhysRadius, g.entries[i].physRadius);
+	}
+	n.first = first;
+	n.count = count;
+	n.right = -1;
+
+	if (count > LEAF_SIZE) {
+		const vector3d size = n.aabb.max - n.aabb.min;
+		const int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+		const int half = count / 2;
+		std::vector<Entry>::iterator begin = g.entries.begin() + first;
+		std::nth_element(begin, begin + half, begin + count, AxisLess(axis));
+
+		BuildNode(g, first, half);
+		n.right = BuildNode(g, first + half, count - half);
+	}
+
+	g.nodes[index] = n;
+	return index;
+}
+
+void ProximityIndex::ReachNode(const Group &g, int node, const vector3d &pos, const Reach &reach, Object::Type t, std::vector<Hit> &hits) const
+{
+	const Node &n = g.nodes[node];
+	// reach only grows with the radius, so nothing under here is close enough
+	if (dist_to_aabb(n.aabb, pos) >= reach(n.maxPhysRadius))
+		return;
+
+	if (n.right >= 0) {
+		ReachNode(g, node+1, pos, reach, t, hits);
+		ReachNode(g, n.right, pos, reach, t, hits);
+		return;
+	}
+
+	for (int i = n.first; i < n.first + n.count; i++) {
+		const Entry &e = g.entries[i];
+		const double dist = (e.pos - pos).Length();
+		if (dist < reach(e.physRadius) && e.body->IsType(t)) {
+			const Hit h = { dist, e.seq, e.body };
+			hits.push_back(h);
+		}
+	}
+}
+
+void ProximityIndex::FindInRadius(const Frame *f, const vector3d &pos, double radius, Object::Type t, std::vector<Body*> &out, bool sameFrameOnly) const
+{
+	FindInReach(f, pos, ConstantReach(radius), t, out, sameFrameOnly);
+}
+
+void ProximityIndex::FindInReach(const Frame *f, const vector3d &pos, const Reach &reach, Object::Type t, std::vector<Body*> &out, bool sameFrameOnly) const
+{
+	assert(m_built);
+	out.clear();
+
+	std::vector<Hit> hits;
+	for (std::vector<Group>::const_iterator g = m_groups.begin(); g != m_groups.end(); ++g) {
+		if (sameFrameOnly && g->frame != f) continue;
+		const vector3d p = to_frame(f, pos, g->frame);
+
+		if (!g->nodes.empty())
+			ReachNode(*g, 0, p, reach, t, hits);
+
+		for (std::vector<Entry>::const_iterator e = g->extra.begin(); e != g->extra.end(); ++e) {
+			const double dist = (e->pos - p).Length();
+			if (dist < reach(e->physRadius) && e->body->IsType(t)) {
+				const Hit h = { dist, e->seq, e->body };
+				hits.push_back(h);
+			}
+		}
+	}
+
+	std::sort(hits.begin(), hits.end(), by_seq<Hit>);
+	out.reserve(hits.size());
+	for (std::vector<Hit>::const_iterator h = hits.begin(); h != hits.end(); ++h)
+		out.push_back(h->body);
+}
+
+// heap is a max-heap of the k best so far, and h beats the worst of them
+void ProximityIndex::OfferHit(const Hit &h, size_t k, std::vector<Hit> &heap)
+{
+	if (heap.size() == k) {
+		std::pop_heap(heap.begin(), heap.end());
+		heap.pop_back();
+	}
+	heap.push_back(h);
+	std::push_heap(heap.begin(), heap.end());
+}
+
+void ProximityIndex::NearestNode(const Group &g, int node, const vector3d &pos, Object::Type t, size_t k, std::vector<Hit> &heap) const
+{
+	const Node &n = g.nodes[node];
+	if (heap.size() == k && dist_to_aabb(n.aabb, pos) > heap.front().dist)
+		return;
+
+	if (n.right >= 0) {
+		// nearer side first, so the far side is more likely to be skipped
+		const int left = node+1;
+		if (dist_to_aabb(g.nodes[n.right].aabb, pos) < dist_to_aabb(g.nodes[left].aabb, pos)) {
+			NearestNode(g, n.right, pos, t, k, heap);
+			NearestNode(g, left, pos, t, k, heap);
+		} else {
+			NearestNode(g, left, pos, t, k, heap);
+			NearestNode(g, n.right, pos, t, k, heap);
+		}
+		return;
+	}
+
+	for (int i = n.first; i < n.first + n.count; i++) {
+		const Entry &e = g.entries[i];
+		const Hit h = { (e.pos - pos).Length(), e.seq, e.body };
+		if (heap.size() == k && !(h < heap.front())) continue;
+		if (e.body->IsDead() || !e.body->IsType(t)) continue;
+		OfferHit(h, k, heap);
+	}
+}
+
+void ProximityIndex::FindNearest(const Frame *f, const vector3d &pos, Object::Type t, int k, std::vector<Body*> &out) const
+{
+	assert(m_built);
+	out.clear();
+	if (k <= 0) return;
+
+	std::vector<Hit> heap;
+	heap.reserve(k+1);
+	for (std::vector<Group>::const_iterator g = m_groups.begin(); g != m_groups.end(); ++g) {
+		const vector3d p = to_frame(f, pos, g->frame);
+
+		if (!g->nodes.empty())
+			NearestNode(*g, 0, p, t, size_t(k), heap);
+
+		for (std::vector<Entry>::const_iterator e = g->extra.begin(); e != g->extra.end(); ++e) {
+			const Hit h = { (e->pos - p).Length(), e->seq, e->body };
+			if (heap.size() == size_t(k) && !(h < heap.front())) continue;
+			if (e->body->IsDead() || !e->body->IsType(t)) continue;
+			OfferHit(h, size_t(k), heap);
+		}
+	}
+
+	std::sort_heap(heap.begin(), heap.end());
+	out.reserve(heap.size());
+	for (std::vector<Hit>::const_iterator h = heap.begin(); h != heap.end(); ++h)
+		out.push_back(h->body);
+}
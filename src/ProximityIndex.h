@@ -0,0 +1,102 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _PROXIMITYINDEX_H
+#define _PROXIMITYINDEX_H
+
+#include "libs.h"
+#include "Object.h"
+#include "Aabb.h"
+#include <list>
+#include <map>
+
+class Body;
+class Frame;
+
+/*
+ * Where every body in Space was at the start of the step, for "what's near
+ * here" questions that would otherwise walk the whole body list. Bodies are
+ * grouped by frame and each group is split into a tree of boxes around
+ * their positions, in frame coordinates, so frames moving on their rails
+ * don't spoil it. A query in one frame is carried into the others by their
+ * frame transforms.
+ *
+ * Space builds it once a step before the AI runs, when nothing has moved
+ * since, and throws it away once bodies move. Bodies added during the step
+ * are found where they were added. A body moved or switched frame by hand
+ * mid-step is found where it was, so callers check distances themselves.
+ */
+class ProximityIndex {
+public:
+	// how close a body has to be to count, given its phys radius. must
+	// never get smaller as the radius grows
+	class Reach {
+	public:
+		virtual ~Reach() {}
+		virtual double operator()(double physRadius) const = 0;
+	};
+
+	ProximityIndex();
+
+	void Build(const std::list<Body*> &bodies);
+	void Add(Body *b);
+	void Clear();
+	bool IsBuilt() const { return m_built; }
+
+	// bodies of type t (by IsType) whose centre is within radius of pos,
+	// pos being in frame f. only bodies in f itself if sameFrameOnly.
+	// results are in the order the bodies went into Space
+	void FindInRadius(const Frame *f, const vector3d &pos, double radius, Object::Type t, std::vector<Body*> &out, bool sameFrameOnly = false) const;
+	// as above, but how close each body has to be depends on its size
+	void FindInReach(const Frame *f, const vector3d &pos, const Reach &reach, Object::Type t, std::vector<Body*> &out, bool sameFrameOnly = false) const;
+	// the k nearest live bodies of type t, nearest first
+	void FindNearest(const Frame *f, const vector3d &pos, Object::Type t, int k, std::vector<Body*> &out) const;
+
+private:
+	enum { LEAF_SIZE = 8 };
+
+	struct Entry {
+		vector3d pos;
+		double physRadius;
+		Body *body;
+		// place in Space's body list, to keep results in a fixed order
+		Uint32 seq;
+	};
+
+	struct Node {
+		Aabb aabb;
+		double maxPhysRadius;
+		int first, count;
+		// the left kid follows its parent; -1 for leaves
+		int right;
+	};
+
+	struct Group {
+		const Frame *frame;
+		std::vector<Entry> entries;
+		std::vector<Node> nodes;
+		// added since the build, searched one by one
+		std::vector<Entry> extra;
+	};
+
+	struct Hit {
+		double dist;
+		Uint32 seq;
+		Body *body;
+		bool operator<(const Hit &o) const { return dist < o.dist || (!(o.dist < dist) && seq < o.seq); }
+	};
+
+	Group &GetGroup(const Frame *f);
+	Entry MakeEntry(Body *b);
+	int BuildNode(Group &g, int first, int count);
+	void ReachNode(const Group &g, int node, const vector3d &pos, const Reach &reach, Object::Type t, std::vector<Hit> &hits) const;
+	static void OfferHit(const Hit &h, size_t k, std::vector<Hit> &heap);
+	void NearestNode(const Group &g, int node, const vector3d &pos, Object::Type t, size_t k, std::vector<Hit> &heap) const;
+
+	bool m_built;
+	Uint32 m_nextSeq;
+	std::vector<Group> m_groups;
+	std::map<const Frame*,int> m_groupForFrame;
+};
+
+#endif /* _PROXIMITYINDEX_H */
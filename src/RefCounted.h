@@ -19,6 +19,35 @@ private:
 	int m_refCount;
 };
 
+// as RefCounted, but the count may be changed from several threads at once.
+// the count is mutable so RefCountedPtr<const T> can share out read-only
+// objects
+#if defined(_MSC_VER)
+#include <intrin.h>
+#pragma intrinsic(_InterlockedIncrement, _InterlockedDecrement)
+#define REFCOUNT_ATOMIC_INC(p) _InterlockedIncrement(p)
+#define REFCOUNT_ATOMIC_DEC(p) _InterlockedDecrement(p)
+#else
+#define REFCOUNT_ATOMIC_INC(p) __sync_add_and_fetch(p, 1)
+#define REFCOUNT_ATOMIC_DEC(p) __sync_sub_and_fetch(p, 1)
+#endif
+
+class AtomicRefCounted {
+public:
+	AtomicRefCounted() : m_refCount(0) {}
+	// a copy is a new object, with no references to it yet
+	AtomicRefCounted(const AtomicRefCounted &) : m_refCount(0) {}
+	AtomicRefCounted &operator=(const AtomicRefCounted &) { return *this; }
+	virtual ~AtomicRefCounted() {}
+
+	inline void IncRefCount() const { REFCOUNT_ATOMIC_INC(&m_refCount); }
+	inline void DecRefCount() const { assert(m_refCount > 0); if (! REFCOUNT_ATOMIC_DEC(&m_refCount)) delete this; }
+	inline int GetRefCount() const { return int(m_refCount); }
+
+private:
+	mutable volatile long m_refCount;
+};
+
 template <typename T>
 class RefCountedPtr : public SmartPtrBase<RefCountedPtr<T>, T> {
 	typedef RefCountedPtr<T> this_type;
@@ -6,6 +6,8 @@
 #include "Pi.h"
 #include "SectorView.h"
 #include "galaxy/Sector.h"
+#include "galaxy/SectorCache.h"
+#include "galaxy/StarSystemSummary.h"
 #include "galaxy/StarSystem.h"
 #include "SystemInfoView.h"
 #include "LuaFaction.h"
@@ -98,12 +100,6 @@ void SectorView::InitDefaults()
 
 	m_secPosFar  = vector3f(INT_MAX, INT_MAX, INT_MAX);
 	m_radiusFar  = 0;
-	m_cacheXMin = 0;
-	m_cacheXMax = 0;
-	m_cacheYMin = 0;
-	m_cacheYMax = 0;
-	m_cacheYMin = 0;
-	m_cacheYMax = 0;
 }
 
 void SectorView::InitObject()
@@ -276,58 +272,64 @@ void SectorView::OnSearchBoxKeyPress(const SDL_keysym *keysym)
 
 	bool gotMatch = false, gotStartMatch = false;
 	SystemPath bestMatch;
-	const std::string *bestMatchName = 0;
-
-	for (std::map<SystemPath,Sector*>::iterator i = m_sectorCache.begin(); i != m_sectorCache.end(); ++i)
-
-		for (unsigned int systemIndex = 0; systemIndex < (*i).second->m_systems.size(); systemIndex++) {
-			const Sector::System *ss = &((*i).second->m_systems[systemIndex]);
-
-			// compare with the start of the current system
-			if (strncasecmp(search.c_str(), ss->name.c_str(), search.size()) == 0) {
-
-				// matched, see if they're the same size
-				if (search.size() == ss->name.size()) {
-
-					// exact match, take it and go
-					SystemPath path = (*i).first;
-					path.systemIndex = systemIndex;
-					Pi::cpan->MsgLog()->Message("", stringf(Lang::EXACT_MATCH_X, formatarg("system", ss->name)));
-					GotoSystem(path);
-					return;
-				}
+	std::string bestMatchName;
+
+	// look through the sectors in view
+	const int searchRadius = GetDrawRadius();
+	const int cx = int(floorf(m_pos.x)), cy = int(floorf(m_pos.y)), cz = int(floorf(m_pos.z));
+	for (int sx = cx-searchRadius; sx <= cx+searchRadius; sx++) {
+		for (int sy = cy-searchRadius; sy <= cy+searchRadius; sy++) {
+			for (int sz = cz-searchRadius; sz <= cz+searchRadius; sz++) {
+				RefCountedPtr<const Sector> sec = GetCached(sx, sy, sz);
+
+				for (unsigned int systemIndex = 0; systemIndex < sec->m_systems.size(); systemIndex++) {
+					const Sector::System *ss = &(sec->m_systems[systemIndex]);
+
+					// compare with the start of the current system
+					if (strncasecmp(search.c_str(), ss->name.c_str(), search.size()) == 0) {
+
+						// matched, see if they're the same size
+						if (search.size() == ss->name.size()) {
+
+							// exact match, take it and go
+							const SystemPath path(sx, sy, sz, systemIndex);
+							Pi::cpan->MsgLog()->Message("", stringf(Lang::EXACT_MATCH_X, formatarg("system", ss->name)));
+							GotoSystem(path);
+							return;
+						}
 
-				// partial match at start of name
-				if (!gotMatch || !gotStartMatch || bestMatchName->size() > ss->name.size()) {
+						// partial match at start of name
+						if (!gotMatch || !gotStartMatch || bestMatchName.size() > ss->name.size()) {
 
-					// don't already have one or its shorter than the previous
-					// one, take it
-					bestMatch = (*i).first;
-					bestMatch.systemIndex = systemIndex;
-					bestMatchName = &(ss->name);
-					gotMatch = gotStartMatch = true;
-				}
+							// don't already have one or its shorter than the previous
+							// one, take it
+							bestMatch = SystemPath(sx, sy, sz, systemIndex);
+							bestMatchName = ss->name;
+							gotMatch = gotStartMatch = true;
+						}
 
-				continue;
-			}
+						continue;
+					}
 
-			// look for the search term somewhere within the current system
-			if (pi_strcasestr(ss->name.c_str(), search.c_str())) {
+					// look for the search term somewhere within the current system
+					if (pi_strcasestr(ss->name.c_str(), search.c_str())) {
 
-				// found it
-				if (!gotMatch || !gotStartMatch || bestMatchName->size() > ss->name.size()) {
+						// found it
+						if (!gotMatch || !gotStartMatch || bestMatchName.size() > ss->name.size()) {
 
-					// best we've found so far, take it
-					bestMatch = (*i).first;
-					bestMatch.systemIndex = systemIndex;
-					bestMatchName = &(ss->name);
-					gotMatch = true;
+							// best we've found so far, take it
+							bestMatch = SystemPath(sx, sy, sz, systemIndex);
+							bestMatchName = ss->name;
+							gotMatch = true;
+						}
+					}
 				}
 			}
 		}
+	}
 
 	if (gotMatch) {
-		Pi::cpan->MsgLog()->Message("", stringf(Lang::NOT_FOUND_BEST_MATCH_X, formatarg("system", *bestMatchName)));
+		Pi::cpan->MsgLog()->Message("", stringf(Lang::NOT_FOUND_BEST_MATCH_X, formatarg("system", bestMatchName)));
 		GotoSystem(bestMatch);
 	}
 
@@ -425,7 +427,7 @@ void SectorView::GotoSector(const SystemPath &path)
 
 void SectorView::GotoSystem(const SystemPath &path)
 {
-	Sector* ps = GetCached(path.sectorX, path.sectorY, path.sectorZ);
+	RefCountedPtr<const Sector> ps = GetCached(path);
 	const vector3f &p = ps->m_systems[path.systemIndex].p;
 	m_posMovingTo.x = path.sectorX + p.x/Sector::SIZE;
 	m_posMovingTo.y = path.sectorY + p.y/Sector::SIZE;
@@ -456,10 +458,11 @@ void SectorView::OnClickSystem(const SystemPath &path)
 		SetSelectedSystem(path);
 }
 
-void SectorView::PutSystemLabels(Sector *sec, const vector3f &origin, int drawRadius)
+void SectorView::PutSystemLabels(const Sector *sec, const vector3f &origin, int drawRadius)
 {
+	RefCountedPtr<const Sector> playerSec = GetCached(m_current);
 	Uint32 sysIdx = 0;
-	for (std::vector<Sector::System>::iterator sys = sec->m_systems.begin(); sys !=sec->m_systems.end(); ++sys, ++sysIdx) {
+	for (std::vector<Sector::System>::const_iterator sys = sec->m_systems.begin(); sys !=sec->m_systems.end(); ++sys, ++sysIdx) {
 		// skip the system if it doesn't fall within the sphere we're viewing.
 		if ((m_pos*Sector::SIZE - (*sys).FullPosition()).Length() > drawRadius) continue;
 
@@ -472,12 +475,12 @@ void SectorView::PutSystemLabels(Sector *sec, const vector3f &origin, int drawRa
 		vector3d screenPos;
 		if (Gui::Screen::Project(systemPos, screenPos)) {
 			// work out the colour
-			float dist = Sector::DistanceBetween(sec, sysIdx, GetCached(m_current.sectorX, m_current.sectorY, m_current.sectorZ), m_current.systemIndex);
-			Color labelColor = (*sys).faction->AdjustedColour((*sys).population, dist <= m_playerHyperspaceRange);
-
 			// get a system path to pass to the event handler when the label is licked
 			SystemPath sysPath = SystemPath((*sys).sx, (*sys).sy, (*sys).sz, sysIdx);
 
+			float dist = Sector::DistanceBetween(sec, sysIdx, playerSec.Get(), m_current.systemIndex);
+			Color labelColor = (*sys).faction->AdjustedColour(GetPopulation(sysPath), dist <= m_playerHyperspaceRange);
+
 			// setup the label
 			m_clickableLabels->Add((*sys).name, sigc::bind(sigc::mem_fun(this, &SectorView::OnClickSystem), sysPath), screenPos.x, screenPos.y, labelColor);
 		}
@@ -491,7 +494,8 @@ void SectorView::PutFactionLabels(const vector3f &origin)
 	for (std::set<Faction*>::iterator it = m_visibleFactions.begin(); it != m_visibleFactions.end(); ++it) {
 		if ((*it)->hasHomeworld && m_hiddenFactions.find((*it)) == m_hiddenFactions.end()) {
 
-			Sector::System sys = GetCached((*it)->homeworld)->m_systems[(*it)->homeworld.systemIndex];
+			RefCountedPtr<const Sector> homeSec = GetCached((*it)->homeworld);
+			const Sector::System &sys = homeSec->m_systems[(*it)->homeworld.systemIndex];
 			if ((m_pos*Sector::SIZE - sys.FullPosition()).Length() > (m_zoomClamped/FAR_THRESHOLD )*OUTER_RADIUS) continue;
 
 			vector3d pos;
@@ -536,13 +540,13 @@ void SectorView::PutFactionLabels(const vector3f &origin)
 
 void SectorView::UpdateSystemLabels(SystemLabels &labels, const SystemPath &path)
 {
-	Sector *sec = GetCached(path.sectorX, path.sectorY, path.sectorZ);
-	Sector *playerSec = GetCached(m_current.sectorX, m_current.sectorY, m_current.sectorZ);
+	RefCountedPtr<const Sector> sec = GetCached(path);
+	RefCountedPtr<const Sector> playerSec = GetCached(m_current);
 
 	char format[256];
 
 	if (m_inSystem) {
-		const float dist = Sector::DistanceBetween(sec, path.systemIndex, playerSec, m_current.systemIndex);
+		const float dist = Sector::DistanceBetween(sec.Get(), path.systemIndex, playerSec.Get(), m_current.systemIndex);
 
 		int fuelRequired;
 		double dur;
@@ -588,7 +592,24 @@ void SectorView::UpdateSystemLabels(SystemLabels &labels, const SystemPath &path
 	else
 		labels.distance->SetText("");
 
-	RefCountedPtr<StarSystem> sys = StarSystem::GetCached(path);
+	// the rest needs the whole system. until it's been generated there's
+	// only the name to show
+	labels.request = StarSystem::RequestCached(path);
+	if (labels.request->IsReady())
+		UpdateSystemDesc(labels);
+	else {
+		labels.starType->SetText("");
+		labels.systemName->SetText(sec->m_systems[path.systemIndex].name);
+		labels.shortDesc->SetText("");
+	}
+
+	if (m_detailBoxVisible == DETAILBOX_INFO) m_infoBox->ShowAll();
+}
+
+void SectorView::UpdateSystemDesc(SystemLabels &labels)
+{
+	RefCountedPtr<StarSystem> sys = labels.request->Get();
+	labels.request.Reset();
 
 	std::string desc;
 	if (sys->GetNumStars() == 4) {
@@ -604,8 +625,6 @@ void SectorView::UpdateSystemLabels(SystemLabels &labels, const SystemPath &path
 
 	labels.systemName->SetText(sys->GetName());
 	labels.shortDesc->SetText(sys->GetShortDescription());
-
-	if (m_detailBoxVisible == DETAILBOX_INFO) m_infoBox->ShowAll();
 }
 
 void SectorView::OnToggleFaction(Gui::ToggleButton* button, bool pressed, Faction* faction)
@@ -663,7 +682,7 @@ void SectorView::DrawNearSectors(matrix4x4f modelview)
 {
 	m_visibleFactions.clear();
 
-	Sector *playerSec = GetCached(m_current.sectorX, m_current.sectorY, m_current.sectorZ);
+	RefCountedPtr<const Sector> playerSec = GetCached(m_current);
 	vector3f playerPos = Sector::SIZE * vector3f(float(m_current.sectorX), float(m_current.sectorY), float(m_current.sectorZ)) + playerSec->m_systems[m_current.systemIndex].p;
 
 	for (int sx = -DRAW_RAD; sx <= DRAW_RAD; sx++) {
@@ -684,7 +703,7 @@ void SectorView::DrawNearSectors(matrix4x4f modelview)
 	for (int sx = -DRAW_RAD; sx <= DRAW_RAD; sx++) {
 		for (int sy = -DRAW_RAD; sy <= DRAW_RAD; sy++) {
 			for (int sz = -DRAW_RAD; sz <= DRAW_RAD; sz++) {
-				PutSystemLabels(GetCached(sx + secOrigin.x, sy + secOrigin.y, sz + secOrigin.z), Sector::SIZE * secOrigin, Sector::SIZE * DRAW_RAD);
+				PutSystemLabels(GetCached(sx + secOrigin.x, sy + secOrigin.y, sz + secOrigin.z).Get(), Sector::SIZE * secOrigin, Sector::SIZE * DRAW_RAD);
 			}
 		}
 	}
@@ -694,7 +713,7 @@ void SectorView::DrawNearSectors(matrix4x4f modelview)
 void SectorView::DrawNearSector(int sx, int sy, int sz, const vector3f &playerAbsPos,const matrix4x4f &trans)
 {
 	m_renderer->SetTransform(trans);
-	Sector* ps = GetCached(sx, sy, sz);
+	RefCountedPtr<const Sector> ps = GetCached(sx, sy, sz);
 
 	int cz = int(floor(m_pos.z+0.5f));
 
@@ -711,7 +730,7 @@ void SectorView::DrawNearSector(int sx, int sy, int sz, const vector3f &playerAb
 	}
 
 	Uint32 sysIdx = 0;
-	for (std::vector<Sector::System>::iterator i = ps->m_systems.begin(); i != ps->m_systems.end(); ++i, ++sysIdx) {
+	for (std::vector<Sector::System>::const_iterator i = ps->m_systems.begin(); i != ps->m_systems.end(); ++i, ++sysIdx) {
 		// calculate where the system is in relation the centre of the view...
 		const vector3f sysAbsPos = Sector::SIZE*vector3f(float(sx), float(sy), float(sz)) + (*i).p;
 		const vector3f toCentreOfView = m_pos*Sector::SIZE - sysAbsPos;
@@ -728,7 +747,9 @@ void SectorView::DrawNearSector(int sx, int sy, int sz, const vector3f &playerAb
 		// don't worry about looking for inhabited systems if they're
 		// unexplored (same calculation as in StarSystem.cpp) or we've
 		// already retrieved their population.
-		if ((*i).population < 0 && isqrt(1 + sx*sx + sy*sy + sz*sz) <= 90) {
+		const SystemPath current = SystemPath(sx, sy, sz, sysIdx);
+		StarSystemSummary summary;
+		if (!StarSystemSummary::GetIfKnown(current, summary) && isqrt(1 + sx*sx + sy*sy + sz*sz) <= 90) {
 
 			// only do this once we've pretty much stopped moving.
 			vector3f diff = vector3f(
@@ -736,12 +757,10 @@ void SectorView::DrawNearSector(int sx, int sy, int sz, const vector3f &playerAb
 					fabs(m_posMovingTo.y - m_pos.y),
 					fabs(m_posMovingTo.z - m_pos.z));
 
-			// Ideally, since this takes so f'ing long, it wants to be done as a threaded job but haven't written that yet.
-			if( (diff.x < 0.001f && diff.y < 0.001f && diff.z < 0.001f) ) {
-				SystemPath current = SystemPath(sx, sy, sz, sysIdx);
-				RefCountedPtr<StarSystem> pSS = StarSystem::GetCached(current);
-				(*i).population = pSS->GetTotalPop();
-			}
+			// it's generated on a worker. the label keeps the faction's
+			// plain colour until the summary turns up
+			if( (diff.x < 0.001f && diff.y < 0.001f && diff.z < 0.001f) )
+				StarSystem::RequestCached(current);
 
 		}
 
@@ -831,7 +850,7 @@ void SectorView::DrawFarSectors(matrix4x4f modelview)
 			for (int sy = secOrigin.y-buildRadius; sy <= secOrigin.y+buildRadius; sy++) {
 				for (int sz = secOrigin.z-buildRadius; sz <= secOrigin.z+buildRadius; sz++) {
 						if ((vector3f(sx,sy,sz) - secOrigin).Length() <= buildRadius){
-							BuildFarSector(GetCached(sx, sy, sz), Sector::SIZE * secOrigin, m_farstars, m_farstarsColor);
+							BuildFarSector(GetCached(sx, sy, sz).Get(), Sector::SIZE * secOrigin, m_farstars, m_farstarsColor);
 						}
 					}
 				}
@@ -851,10 +870,10 @@ void SectorView::DrawFarSectors(matrix4x4f modelview)
 	PutFactionLabels(Sector::SIZE * secOrigin);
 }
 
-void SectorView::BuildFarSector(Sector* sec, const vector3f &origin, std::vector<vector3f> &points, std::vector<Color> &colors)
+void SectorView::BuildFarSector(const Sector *sec, const vector3f &origin, std::vector<vector3f> &points, std::vector<Color> &colors)
 {
 	Color starColor;
-	for (std::vector<Sector::System>::iterator i = sec->m_systems.begin(); i != sec->m_systems.end(); ++i) {
+	for (std::vector<Sector::System>::const_iterator i = sec->m_systems.begin(); i != sec->m_systems.end(); ++i) {
 		// skip the system if it doesn't fall within the sphere we're viewing.
 		if ((m_pos*Sector::SIZE - (*i).FullPosition()).Length() > (m_zoomClamped/FAR_THRESHOLD )*OUTER_RADIUS) continue;
 
@@ -993,6 +1012,13 @@ void SectorView::Update()
 		UpdateSystemLabels(m_targetSystemLabels, m_hyperspaceTarget);
 	}
 
+	if (m_currentSystemLabels.request && m_currentSystemLabels.request->IsReady())
+		UpdateSystemDesc(m_currentSystemLabels);
+	if (m_selectedSystemLabels.request && m_selectedSystemLabels.request->IsReady())
+		UpdateSystemDesc(m_selectedSystemLabels);
+	if (m_targetSystemLabels.request && m_targetSystemLabels.request->IsReady())
+		UpdateSystemDesc(m_targetSystemLabels);
+
 	const float frameTime = Pi::GetFrameTime();
 
 	matrix4x4f rot = matrix4x4f::Identity();
@@ -1070,7 +1096,7 @@ void SectorView::Update()
 	if (m_selectionFollowsMovement) {
 		SystemPath new_selected = SystemPath(int(floor(m_pos.x)), int(floor(m_pos.y)), int(floor(m_pos.z)), 0);
 
-		Sector* ps = GetCached(new_selected.sectorX, new_selected.sectorY, new_selected.sectorZ);
+		RefCountedPtr<const Sector> ps = GetCached(new_selected);
 		if (ps->m_systems.size()) {
 			float px = FFRAC(m_pos.x)*Sector::SIZE;
 			float py = FFRAC(m_pos.y)*Sector::SIZE;
@@ -1078,7 +1104,7 @@ void SectorView::Update()
 
 			float min_dist = FLT_MAX;
 			for (unsigned int i=0; i<ps->m_systems.size(); i++) {
-				Sector::System *ss = &ps->m_systems[i];
+				const Sector::System *ss = &ps->m_systems[i];
 				float dx = px - ss->p.x;
 				float dy = py - ss->p.y;
 				float dz = pz - ss->p.z;
@@ -1094,8 +1120,6 @@ void SectorView::Update()
 		}
 	}
 
-	ShrinkCache();
-
 	m_playerHyperspaceRange = Pi::player->GetStats().hyperspace_range;
 }
 
@@ -1116,62 +1140,24 @@ void SectorView::MouseButtonDown(int button, int x, int y)
 	}
 }
 
-Sector* SectorView::GetCached(const SystemPath& loc)
+RefCountedPtr<const Sector> SectorView::GetCached(const SystemPath& loc)
 {
-	Sector *s = 0;
-
-	std::map<SystemPath,Sector*>::iterator i = m_sectorCache.find(loc);
-	if (i != m_sectorCache.end())
-		return (*i).second;
-
-	s = new Sector(loc.sectorX, loc.sectorY, loc.sectorZ);
-	m_sectorCache.insert( std::pair<SystemPath,Sector*>(loc, s) );
-	s->AssignFactions();
-
-	return s;
+	return SectorCache::Get(loc);
 }
 
-Sector* SectorView::GetCached(const int sectorX, const int sectorY, const int sectorZ)
+RefCountedPtr<const Sector> SectorView::GetCached(const int sectorX, const int sectorY, const int sectorZ)
 {
-	const SystemPath loc(sectorX, sectorY, sectorZ);
-	return GetCached(loc);
+	return SectorCache::Get(sectorX, sectorY, sectorZ);
 }
 
-void SectorView::ShrinkCache()
+fixed SectorView::GetPopulation(const SystemPath &path) const
 {
-	// we're going to use these to determine if our sectors are within the range that we'll ever render
-	int drawRadius = ceilf((m_zoomClamped/FAR_THRESHOLD) * 3);
-	if (m_zoomClamped <= FAR_THRESHOLD) drawRadius = DRAW_RAD;
-
-	const int xmin = int(floorf(m_pos.x))-drawRadius;
-	const int xmax = int(floorf(m_pos.x))+drawRadius;
-	const int ymin = int(floorf(m_pos.y))-drawRadius;
-	const int ymax = int(floorf(m_pos.y))+drawRadius;
-	const int zmin = int(floorf(m_pos.z))-drawRadius;
-	const int zmax = int(floorf(m_pos.z))+drawRadius;
-
-	// XXX don't clear the current/selected/target sectors
-
-	if  (xmin != m_cacheXMin || xmax != m_cacheXMax
-	  || ymin != m_cacheYMin || ymax != m_cacheYMax
-	  || zmin != m_cacheZMin || zmax != m_cacheZMax) {
-		std::map<SystemPath,Sector*>::iterator iter = m_sectorCache.begin();
-		while (iter != m_sectorCache.end())	{
-			Sector *s = (*iter).second;
-			//check_point_in_box
-			if (s && !s->WithinBox( xmin, xmax, ymin, ymax, zmin, zmax )) {
-				delete s;
-				m_sectorCache.erase( iter++ );
-			} else {
-				iter++;
-			}
-		}
+	StarSystemSummary summary;
+	return StarSystemSummary::GetIfKnown(path, summary) ? summary.population : fixed(-1);
+}
 
-		m_cacheXMin = xmin;
-		m_cacheXMax = xmax;
-		m_cacheYMin = ymin;
-		m_cacheYMax = ymax;
-		m_cacheZMin = zmin;
-		m_cacheZMax = zmax;
-	}
+int SectorView::GetDrawRadius() const
+{
+	if (m_zoomClamped <= FAR_THRESHOLD) return DRAW_RAD;
+	return int(ceilf((m_zoomClamped/FAR_THRESHOLD) * 3));
 }
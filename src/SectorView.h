@@ -50,28 +50,34 @@ private:
 		Gui::Label *distance;
 		Gui::Label *starType;
 		Gui::Label *shortDesc;
+		// the system, while it's being generated
+		RefCountedPtr<StarSystemRequest> request;
 	};
 
 	void DrawNearSectors(matrix4x4f modelview);
 	void DrawNearSector(int x, int y, int z, const vector3f &playerAbsPos, const matrix4x4f &trans);
-	void PutSystemLabels(Sector *sec, const vector3f &origin, int drawRadius);
+	void PutSystemLabels(const Sector *sec, const vector3f &origin, int drawRadius);
 
 	void DrawFarSectors(matrix4x4f modelview);
-	void BuildFarSector(Sector *sec, const vector3f &origin, std::vector<vector3f> &points, std::vector<Color> &colors);
+	void BuildFarSector(const Sector *sec, const vector3f &origin, std::vector<vector3f> &points, std::vector<Color> &colors);
 	void PutFactionLabels(const vector3f &secPos);
 
 	void SetSelectedSystem(const SystemPath &path);
 	void OnClickSystem(const SystemPath &path);
 
 	void UpdateSystemLabels(SystemLabels &labels, const SystemPath &path);
+	void UpdateSystemDesc(SystemLabels &labels);
 	void UpdateFactionToggles();
 	void RefreshDetailBoxVisibility();
 
 	void UpdateHyperspaceLockLabel();
 
-	Sector* GetCached(const SystemPath& loc);
-	Sector* GetCached(const int sectorX, const int sectorY, const int sectorZ);
-	void ShrinkCache();
+	RefCountedPtr<const Sector> GetCached(const SystemPath& loc);
+	RefCountedPtr<const Sector> GetCached(const int sectorX, const int sectorY, const int sectorZ);
+	// -1 until it's been looked up
+	fixed GetPopulation(const SystemPath &path) const;
+	// how many sectors out from the middle of the view get drawn
+	int GetDrawRadius() const;
 
 	void MouseButtonDown(int button, int x, int y);
 	void OnKeyPressed(SDL_keysym *keysym);
@@ -132,7 +138,6 @@ private:
 	sigc::connection m_onMouseButtonDown;
 	sigc::connection m_onKeyPressConnection;
 
-	std::map<SystemPath,Sector*> m_sectorCache;
 	std::string m_previousSearch;
 
 	float m_playerHyperspaceRange;
@@ -147,13 +152,6 @@ private:
 	int      m_radiusFar;
 	bool     m_toggledFaction;
 
-	int m_cacheXMin;
-	int m_cacheXMax;
-	int m_cacheYMin;
-	int m_cacheYMax;
-	int m_cacheZMin;
-	int m_cacheZMax;
-
 };
 
 #endif /* _SECTORVIEW_H */
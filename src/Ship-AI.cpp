@@ -14,6 +14,7 @@
 #include "LuaConstants.h"
 #include "LuaEvent.h"
 #include "KeyBindings.h"
+#include "OS.h"
 
 
 void Ship::AIModelCoordsMatchAngVel(vector3d desiredAngVel, double softness)
@@ -77,14 +78,45 @@ bool Ship::AITimeStep(float timeStep)
 	if (m_curAICmd->TimeStepUpdate()) {
 		AIClearInstructions();
 //		ClearThrusterState();		// otherwise it does one timestep at 10k and gravity is fatal
-		LuaEvent::Queue("onAICompleted", this, LuaConstants::GetConstantString(Lua::manager->GetLuaState(), "ShipAIError", AIMessage()));
+		// Lua can only be touched from the main thread
+		if (m_aiThought) m_aiCompletedInThink = true;
+		else LuaEvent::Queue("onAICompleted", this, LuaConstants::GetConstantString(Lua::manager->GetLuaState(), "ShipAIError", AIMessage()));
 		return true;
 	}
 	else return false;
 }
 
+bool Ship::CanAIThink() const
+{
+	if (IsDead() || m_flightState != FLYING) return false;
+	if (m_controller->GetType() != ShipController::AI) return false;
+	return m_curAICmd && m_curAICmd->CanThinkInParallel();
+}
+
+void Ship::AIThink(float timeStep)
+{
+	assert(CanAIThink());
+	OS::EnableFPE();
+	m_aiThought = true;
+	AITimeStep(timeStep);
+	OS::DisableFPE();
+}
+
+bool Ship::AIFinishThink()
+{
+	if (!m_aiThought) return false;
+	m_aiThought = false;
+	if (m_aiCompletedInThink) {
+		m_aiCompletedInThink = false;
+		LuaEvent::Queue("onAICompleted", this, LuaConstants::GetConstantString(Lua::manager->GetLuaState(), "ShipAIError", AIMessage()));
+	}
+	return true;
+}
+
 void Ship::AIClearInstructions()
 {
+	// every new command comes through here first
+	Wake();
 	if (!m_curAICmd) return;
 
 	delete m_curAICmd;		// rely on destructor to kill children
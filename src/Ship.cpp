@@ -14,6 +14,7 @@
 #include "Sound.h"
 #include "Sfx.h"
 #include "galaxy/Sector.h"
+#include "galaxy/SectorCache.h"
 #include "Frame.h"
 #include "WorldView.h"
 #include "HyperspaceCloud.h"
@@ -133,6 +134,8 @@ void Ship::Load(Serializer::Reader &rd, Space *space)
 	if(rd.Int32()) m_curAICmd = AICommand::Load(rd);
 	else m_curAICmd = 0;
 	m_aiMessage = AIError(rd.Int32());
+	m_decelerating = m_wasDecelerating = false;
+	m_aiThought = m_aiCompletedInThink = false;
 	SetFuel(rd.Double());
 	m_stats.fuel_tank_mass_left = GetShipType().fuelTankMass * GetFuel();
 	m_reserveFuel = rd.Double();
@@ -219,6 +222,9 @@ Ship::Ship(ShipType::Id shipId): DynamicBody(),
 	m_curAICmd = 0;
 	m_aiMessage = AIERROR_NONE;
 	m_decelerating = false;
+	m_wasDecelerating = false;
+	m_aiThought = false;
+	m_aiCompletedInThink = false;
 	m_equipment.onChange.connect(sigc::mem_fun(this, &Ship::OnEquipmentChange));
 
 	Init();
@@ -285,6 +291,7 @@ double Ship::GetSpeedReachedWithFuel()
 
 bool Ship::OnDamage(Object *attacker, float kgDamage)
 {
+	Wake();
 	if (!IsDead()) {
 		float dam = kgDamage*0.001f;
 		if (m_stats.shield_mass_left > 0.0f) {
@@ -396,6 +403,7 @@ void Ship::SetThrusterState(const vector3d &levels)
 		m_thrusters.y = Clamp(levels.y, -1.0, 1.0);
 		m_thrusters.z = Clamp(levels.z, -1.0, 1.0);
 	}
+	Wake();
 }
 
 void Ship::SetAngThrusterState(const vector3d &levels)
@@ -403,6 +411,7 @@ void Ship::SetAngThrusterState(const vector3d &levels)
 	m_angThrusters.x = Clamp(levels.x, -1.0, 1.0);
 	m_angThrusters.y = Clamp(levels.y, -1.0, 1.0);
 	m_angThrusters.z = Clamp(levels.z, -1.0, 1.0);
+	Wake();
 }
 
 vector3d Ship::GetMaxThrust(const vector3d &dir) const
@@ -501,10 +510,10 @@ static float distance_to_system(const SystemPath &dest)
 	assert(here.HasValidSystem());
 	assert(dest.HasValidSystem());
 
-	Sector sec1(here.sectorX, here.sectorY, here.sectorZ);
-	Sector sec2(dest.sectorX, dest.sectorY, dest.sectorZ);
+	RefCountedPtr<const Sector> sec1 = SectorCache::Get(here);
+	RefCountedPtr<const Sector> sec2 = SectorCache::Get(dest);
 
-	return Sector::DistanceBetween(&sec1, here.systemIndex, &sec2, dest.systemIndex);
+	return Sector::DistanceBetween(sec1.Get(), here.systemIndex, sec2.Get(), dest.systemIndex);
 }
 
 Ship::HyperjumpStatus Ship::GetHyperspaceDetails(const SystemPath &dest, int &outFuelRequired, double &outDurationSecs)
@@ -570,6 +579,7 @@ Ship::HyperjumpStatus Ship::StartHyperspaceCountdown(const SystemPath &dest)
 		return status;
 
 	m_hyperspace.dest = dest;
+	Wake();
 
 	Equip::Type t = m_equipment.Get(Equip::SLOT_ENGINE);
 	m_hyperspace.countdown = 1.0f + Equip::types[t].pval;
@@ -606,9 +616,10 @@ void Ship::UseECM()
 		// damage neaby missiles
 		const float ECM_RADIUS = 4000.0f;
 
-		for (Space::BodyIterator i = Pi::game->GetSpace()->BodiesBegin(); i != Pi::game->GetSpace()->BodiesEnd(); ++i) {
+		std::vector<Body*> missiles;
+		Pi::game->GetSpace()->GetProximityIndex().FindInRadius(GetFrame(), GetPosition(), ECM_RADIUS, Object::MISSILE, missiles, true);
+		for (std::vector<Body*>::const_iterator i = missiles.begin(); i != missiles.end(); ++i) {
 			if ((*i)->GetFrame() != GetFrame()) continue;
-			if (!(*i)->IsType(Object::MISSILE)) continue;
 
 			double dist = ((*i)->GetPosition() - GetPosition()).Length();
 			if (dist < ECM_RADIUS) {
@@ -657,6 +668,7 @@ bool Ship::FireMissile(int idx, Ship *target)
 void Ship::SetFlightState(Ship::FlightState newState)
 {
 	if (m_flightState == newState) return;
+	Wake();
 	if (IsHyperspaceActive() && (newState != FLYING))
 		ResetHyperspaceCountdown();
 
@@ -680,6 +692,22 @@ void Ship::SetFlightState(Ship::FlightState newState)
 	}
 }
 
+Body::Activity Ship::GetActivity() const
+{
+	if (IsHyperspaceActive()) return ACTIVE;
+	if (m_curAICmd && !m_curAICmd->IsCoasting()) return ACTIVE;
+	if (m_flightState == DOCKED || m_flightState == LANDED) return RESTING;
+	if (m_flightState != FLYING) return ACTIVE;
+
+	// anything that changes the ship's motion or counts down in steps
+	if (m_testLanded || m_wheelTransition || m_launchLockTimeout > 0.0f) return ACTIVE;
+	if (!is_zero_exact(m_thrusters.LengthSqr()) || !is_zero_exact(m_angThrusters.LengthSqr())) return ACTIVE;
+	for (int i=0; i<ShipType::GUNMOUNT_MAX; i++)
+		if (m_gunState[i]) return ACTIVE;
+
+	return COASTING;
+}
+
 void Ship::Blastoff()
 {
 	if (m_flightState != LANDED) return;
@@ -733,6 +761,8 @@ void Ship::TimeStepUpdate(const float timeStep)
 	// If docked, station is responsible for updating position/orient of ship
 	// but we call this crap anyway and hope it doesn't do anything bad
 
+	m_wasDecelerating = m_decelerating;
+
 	vector3d maxThrust = GetMaxThrust(m_thrusters);
 	vector3d thrust = vector3d(maxThrust.x*m_thrusters.x, maxThrust.y*m_thrusters.y,
 		maxThrust.z*m_thrusters.z);
@@ -864,10 +894,12 @@ void Ship::UpdateAlertState()
 	}
 
 	bool ship_is_near = false, ship_is_firing = false;
-	for (Space::BodyIterator i = Pi::game->GetSpace()->BodiesBegin(); i != Pi::game->GetSpace()->BodiesEnd(); ++i)
+	std::vector<Body*> ships;
+	Pi::game->GetSpace()->GetProximityIndex().FindInRadius(GetFrame(), GetPosition(), 100000.0, Object::SHIP, ships);
+	for (std::vector<Body*>::const_iterator i = ships.begin(); i != ships.end(); ++i)
 	{
 		if ((*i) == this) continue;
-		if (!(*i)->IsType(Object::SHIP) || (*i)->IsType(Object::MISSILE)) continue;
+		if ((*i)->IsType(Object::MISSILE)) continue;
 
 		Ship *ship = static_cast<Ship*>(*i);
 
@@ -952,7 +984,7 @@ void Ship::UpdateFuel(const float timeStep, const vector3d &thrust)
 void Ship::StaticUpdate(const float timeStep)
 {
 	// do player sounds before dead check, so they also turn off
-	if (IsType(Object::PLAYER)) DoThrusterSounds();
+	if (IsType(Object::PLAYER) && Pi::worldView) DoThrusterSounds();
 
 	if (IsDead()) return;
 
@@ -1085,6 +1117,7 @@ void Ship::NotifyRemoved(const Body* const removedBody)
 
 bool Ship::Undock()
 {
+	Wake();
 	return (m_dockedWith && m_dockedWith->LaunchShip(this, m_dockedWithPort));
 }
 
@@ -1107,6 +1140,7 @@ void Ship::SetGunState(int idx, int state)
 {
 	if (m_equipment.Get(Equip::SLOT_LASER, idx) != Equip::NONE) {
 		m_gunState[idx] = state;
+		Wake();
 	}
 }
 
@@ -1216,7 +1250,7 @@ void Ship::ResetFlavour(const ShipFlavour *f)
 	SetLabel(f->regid);
 	Init();
 	onFlavourChanged.emit();
-	if (IsType(Object::PLAYER))
+	if (IsType(Object::PLAYER) && Pi::worldView)
 		Pi::worldView->SetCamType(Pi::worldView->GetCamType());
 	LuaEvent::Queue("onShipFlavourChanged", this);
 }
@@ -70,10 +70,11 @@ public:
 	void SetThrusterState(int axis, double level) {
 		if (m_thrusterFuel <= 0.f) level = 0.0;
 		m_thrusters[axis] = Clamp(level, -1.0, 1.0);
+		Wake();
 	}
 	void SetThrusterState(const vector3d &levels);
 	vector3d GetThrusterState() const { return m_thrusters; }
-	void SetAngThrusterState(int axis, double level) { m_angThrusters[axis] = Clamp(level, -1.0, 1.0); }
+	void SetAngThrusterState(int axis, double level) { m_angThrusters[axis] = Clamp(level, -1.0, 1.0); Wake(); }
 	void SetAngThrusterState(const vector3d &levels);
 	vector3d GetAngThrusterState() const { return m_angThrusters; }
 	void ClearThrusterState();
@@ -101,11 +102,16 @@ public:
 
 	void TimeAccelAdjust(const float timeStep);
 	void SetDecelerating(bool decel) { m_decelerating = decel; }
-	bool IsDecelerating() const { return m_decelerating; }
+	// as of the last step, so that other ships' AI can ask while this
+	// ship's AI is running
+	bool IsDecelerating() const { return m_wasDecelerating; }
 
 	virtual void NotifyRemoved(const Body* const removedBody);
 	virtual bool OnCollision(Object *o, Uint32 flags, double relVel);
 	virtual bool OnDamage(Object *attacker, float kgDamage);
+	// resting when docked or landed, coasting when flying with nothing
+	// on, as long as there's no AI command or hyperspace countdown
+	virtual Activity GetActivity() const;
 
 	enum FlightState { // <enum scope='Ship' name=ShipFlightState>
 		FLYING,     // open flight (includes autopilot)
@@ -203,6 +209,15 @@ public:
 
 	void AIBodyDeleted(const Body* const body) {};		// todo: signals
 
+	// whether this step's AI can run in Space's parallel think phase: an
+	// AI controlled ship in flight on a command that's safe to
+	bool CanAIThink() const;
+	// runs this step's AI ahead of StaticUpdate, maybe on a worker thread
+	void AIThink(float timeStep);
+	// true if AIThink already ran this step, in which case the bits of it
+	// that have to be on the main thread are done now
+	bool AIFinishThink();
+
 	SerializableEquipSet m_equipment;			// shouldn't be public?...
 
 	virtual void PostLoadFixup(Space *space);
@@ -308,6 +323,11 @@ private:
 	AICommand *m_curAICmd;
 	AIError m_aiMessage;
 	bool m_decelerating;
+	bool m_wasDecelerating;
+	// set by AIThink until the controller's StaticUpdate picks it up
+	bool m_aiThought;
+	// AIThink finished its command and onAICompleted is still to be queued
+	bool m_aiCompletedInThink;
 
 	double m_thrusterFuel; 	// remaining fuel 0.0-1.0
 	double m_reserveFuel;	// 0-1, fuel not to touch for the current AI program
@@ -16,6 +16,13 @@
 static const double VICINITY_MIN = 15000.0;
 static const double VICINITY_MUL = 4.0;
 
+// a cruising ship only cuts its thrusters if it's at least this many steps
+// from having to slow down, well over the most a coasting ship skips
+static const double COAST_MARGIN_STEPS = 32.0;
+// and it's flying straight at its target and not turning
+static const double COAST_MAX_DRIFT = 0.001;	// sideways over forward speed
+static const double COAST_MAX_ANGVEL = 1e-4;	// rad/s
+
 AICommand *AICommand::Load(Serializer::Reader &rd)
 {
 	CmdName name = CmdName(rd.Int32());
@@ -258,18 +265,18 @@ bool AICmdKill::TimeStepUpdate()
 
 		double headdiff = (leaddir - heading).Length();
 		double leaddiff = (leaddir - targdir).Length();
-		m_leadTime = Pi::game->GetTime() + headdiff + (1.0*Pi::rng.Double()*skillShoot);
+		m_leadTime = Pi::game->GetTime() + headdiff + (1.0*m_rng.Double()*skillShoot);
 
 		// lead inaccuracy based on diff between heading and leaddir
-		vector3d r(Pi::rng.Double()-0.5, Pi::rng.Double()-0.5, Pi::rng.Double()-0.5);
-		vector3d newoffset = r * (0.02 + 2.0*leaddiff + 2.0*headdiff)*Pi::rng.Double()*skillShoot;
+		vector3d r(m_rng.Double()-0.5, m_rng.Double()-0.5, m_rng.Double()-0.5);
+		vector3d newoffset = r * (0.02 + 2.0*leaddiff + 2.0*headdiff)*m_rng.Double()*skillShoot;
 		m_leadOffset = (heading - leaddir);		// should be already...
 		m_leadDrift = (newoffset - m_leadOffset) / (m_leadTime - Pi::game->GetTime());
 
 		// Shoot only when close to target
 
 		double vissize = 1.3 * m_ship->GetPhysRadius() / targpos.Length();
-		vissize += (0.05 + 0.5*leaddiff)*Pi::rng.Double()*skillShoot;
+		vissize += (0.05 + 0.5*leaddiff)*m_rng.Double()*skillShoot;
 		if (vissize > headdiff) m_ship->SetGunState(0,1);
 		else m_ship->SetGunState(0,0);
 		if (targpos.LengthSqr() > 4000*4000) m_ship->SetGunState(0,0);		// temp
@@ -283,9 +290,9 @@ bool AICmdKill::TimeStepUpdate()
 	if (m_evadeTime < Pi::game->GetTime())		// evasion time!
 	{
 		double skillEvade = 0.5;			// todo: should come from AI stats
-		m_evadeTime = Pi::game->GetTime() + Pi::rng.Double(3.0,10.0) * skillEvade;
+		m_evadeTime = Pi::game->GetTime() + m_rng.Double(3.0,10.0) * skillEvade;
 		if (heading.Dot(targdir) < 0.7) skillEvade += 0.5;		// not in view
-		skillEvade += Pi::rng.Double(-0.5,0.5);
+		skillEvade += m_rng.Double(-0.5,0.5);
 
 		vector3d targhead = -m_target->GetOrient().VectorZ() * rot;		// obj space
 		vector3d targav = m_target->GetAngVelocity();
@@ -306,13 +313,13 @@ bool AICmdKill::TimeStepUpdate()
 				evadethrust.y = targhead.y < 0.0 ? 1.0 : -1.0;
 			}
 			else if (skillEvade < 1.3) {			// random two-thruster evade
-				evadethrust.x = (Pi::rng.Int32()&8) ? 1.0 : -1.0;
-				evadethrust.y = (Pi::rng.Int32()&4) ? 1.0 : -1.0;
+				evadethrust.x = (m_rng.Int32()&8) ? 1.0 : -1.0;
+				evadethrust.y = (m_rng.Int32()&4) ? 1.0 : -1.0;
 			}
 			else if (skillEvade < 1.6) {			// one thruster only
-				if (Pi::rng.Int32()&8)
-					evadethrust.x = (Pi::rng.Int32()&4) ? 1.0 : -1.0;
-				else evadethrust.y = (Pi::rng.Int32()&4) ? 1.0 : -1.0;
+				if (m_rng.Int32()&8)
+					evadethrust.x = (m_rng.Int32()&4) ? 1.0 : -1.0;
+				else evadethrust.y = (m_rng.Int32()&4) ? 1.0 : -1.0;
 			}
 			// else no evade thrust
 		}
@@ -326,9 +333,9 @@ bool AICmdKill::TimeStepUpdate()
 		double skillEvade = 0.5;
 		if (heading.Dot(targdir) < 0.7) skillEvade += 0.5;		// not in view
 
-		m_closeTime = Pi::game->GetTime() + skillEvade * Pi::rng.Double(1.0,5.0);
+		m_closeTime = Pi::game->GetTime() + skillEvade * m_rng.Double(1.0,5.0);
 
-		double reqdist = 500.0 + skillEvade * Pi::rng.Double(-500.0, 250);
+		double reqdist = 500.0 + skillEvade * m_rng.Double(-500.0, 250);
 		double dist = targpos.Length(), ispeed;
 		double rearaccel = stype.linThrust[ShipType::THRUSTER_REVERSE] / m_ship->GetMass();
 		rearaccel += targaccel.Dot(targdir);
@@ -337,7 +344,7 @@ bool AICmdKill::TimeStepUpdate()
 		if (as2 > 0) ispeed = sqrt(as2); else ispeed = -sqrt(-as2);
 		double vdiff = ispeed + targvel.Dot(targdir);
 
-		if (skillEvade + Pi::rng.Double() > 1.5) evadethrust.z = 0.0;
+		if (skillEvade + m_rng.Double() > 1.5) evadethrust.z = 0.0;
 		else if (vdiff*vdiff < 400.0) evadethrust.z = 0.0;
 		else evadethrust.z = (vdiff > 0.0) ? -1.0 : 1.0;
 	}
@@ -664,7 +671,7 @@ extern double calc_ivel(double dist, double vel, double acc);
 // Fly to vicinity of body
 AICmdFlyTo::AICmdFlyTo(Ship *ship, Body *target) : AICommand(ship, CMD_FLYTO)
 {
-	m_frame = 0; m_state = -6; m_lockhead = true; m_endvel = 0; m_tangent = false;
+	m_frame = 0; m_state = -6; m_lockhead = true; m_endvel = 0; m_tangent = false; m_coasting = false;
 	if (!target->IsType(Object::TERRAINBODY)) m_dist = VICINITY_MIN;
 	else m_dist = VICINITY_MUL*MaxEffectRad(target, ship);
 
@@ -674,6 +681,7 @@ AICmdFlyTo::AICmdFlyTo(Ship *ship, Body *target) : AICommand(ship, CMD_FLYTO)
 		m_targframe = target->GetFrame(); m_target = 0;
 	}
 	else { m_target = target; m_targframe = 0; }
+	m_ship->Watch(m_target);
 
 	if (ship->GetPositionRelTo(target).Length() <= 15000.0) m_targframe = 0;
 }
@@ -686,11 +694,12 @@ AICmdFlyTo::AICmdFlyTo(Ship *ship, Frame *targframe, const vector3d &posoff, dou
 	m_posoff = posoff;
 	m_endvel = endvel;
 	m_tangent = tangent;
-	m_frame = 0; m_state = -6; m_lockhead = true;
+	m_frame = 0; m_state = -6; m_lockhead = true; m_coasting = false;
 }
 
 bool AICmdFlyTo::TimeStepUpdate()
 {
+	m_coasting = false;
 	if (!m_target && !m_targframe) return true;			// deleted object
 
 	// sort out gear, launching
@@ -797,7 +806,22 @@ printf("Autopilot dist = %.1f, speed = %.1f, zthrust = %.2f, state = %i\n",
 	double fuelspeed = m_ship->GetSpeedReachedWithFuel();
 	if (m_target && m_target->IsType(Object::SHIP)) fuelspeed -=
 		m_ship->GetVelocityRelTo(Pi::game->GetSpace()->GetRootFrame()).Length();
-	if (ispeed > curspeed && curspeed > 0.9*fuelspeed) ispeed = curspeed;
+	bool cruising = false;
+	if (ispeed > curspeed && curspeed > 0.9*fuelspeed) { ispeed = curspeed; cruising = true; }
+
+	// nothing to do until it's nearly time to slow down, so cut the
+	// thrusters and let the ship coast. ships chasing ships don't, since
+	// their targets can turn at any time
+	if (cruising && !m_child && maxdecel > 1e-10 && !(m_target && m_target->IsType(Object::SHIP))
+		&& perpspeed < COAST_MAX_DRIFT*curspeed && m_ship->GetAngVelocity().Length() < COAST_MAX_ANGVEL) {
+		const double brakedist = (curspeed*curspeed - m_endvel*m_endvel) / (2.0*maxdecel);
+		if (targdist - brakedist > curspeed*timestep*COAST_MARGIN_STEPS) {
+			m_ship->ClearThrusterState();
+			m_ship->SetDecelerating(false);
+			m_coasting = true;
+			return false;
+		}
+	}
 
 	// Don't exit a frame faster than some fraction of radius
 //	double maxframespeed = 0.2 * m_frame->GetRadius() / timestep;
@@ -843,6 +867,7 @@ printf("Autopilot dist = %.1f, speed = %.1f, zthrust = %.2f, state = %i\n",
 AICmdDock::AICmdDock(Ship *ship, SpaceStation *target) : AICommand(ship, CMD_DOCK)
 {
 	m_target = target;
+	m_ship->Watch(m_target);
 	m_state = 0;
 	double grav = GetGravityAtPos(m_target->GetFrame(), m_target->GetPosition());
 	if (m_ship->GetAccelUp() < grav) {
@@ -1059,6 +1084,7 @@ AICmdFormation::AICmdFormation(Ship *ship, Ship *target, const vector3d &posoff)
 	: AICommand(ship, CMD_FORMATION)
 {
 	m_target = target;
+	m_ship->Watch(m_target);
 	m_posoff = posoff;
 }
 
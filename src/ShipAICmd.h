@@ -38,6 +38,16 @@ public:
 	// Signal functions
 	virtual void OnDeleted(const Body *body) { if (m_child) m_child->OnDeleted(body); }
 
+	// whether TimeStepUpdate, for a ship in flight, only reads other bodies
+	// and sets its own ship's controls, so that it can run in Space's
+	// parallel think phase
+	virtual bool IsThinkSafe() const { return false; }
+	bool CanThinkInParallel() const { return IsThinkSafe() && (!m_child || m_child->CanThinkInParallel()); }
+
+	// whether the ship has its thrusters off and nothing to do for a
+	// while, so it can take longer steps (see BodyActivity)
+	virtual bool IsCoasting() const { return false; }
+
 protected:
 	CmdName m_cmdName;
 	Ship *m_ship;
@@ -50,6 +60,8 @@ class AICmdDock : public AICommand {
 public:
 	virtual bool TimeStepUpdate();
 	AICmdDock(Ship *ship, SpaceStation *target);
+	// while it has a child it does nothing else
+	virtual bool IsCoasting() const { return m_child && m_child->IsCoasting(); }
 
 	virtual void GetStatusText(char *str) {
 		if (m_child) m_child->GetStatusText(str);
@@ -70,6 +82,7 @@ public:
 	virtual void PostLoadFixup(Space *space) {
 		AICommand::PostLoadFixup(space);
 		m_target = static_cast<SpaceStation *>(space->GetBodyByIndex(m_targetIndex));
+		m_ship->Watch(m_target);
 	}
 	virtual void OnDeleted(const Body *body) {
 		AICommand::OnDeleted(body);
@@ -87,6 +100,8 @@ private:
 class AICmdFlyTo : public AICommand {
 public:
 	virtual bool TimeStepUpdate();
+	virtual bool IsThinkSafe() const { return true; }
+	virtual bool IsCoasting() const { return m_coasting; }
 	AICmdFlyTo(Ship *ship, Frame *targframe, const vector3d &posoff, double endvel, bool tangent);
 	AICmdFlyTo(Ship *ship, Body *target);
 
@@ -116,10 +131,12 @@ public:
 		m_endvel = rd.Double();
 		m_tangent = rd.Bool();
 		m_state = rd.Int32();
+		m_coasting = false;
 	}
 	virtual void PostLoadFixup(Space *space) {
 		AICommand::PostLoadFixup(space);
 		m_target = space->GetBodyByIndex(m_targetIndex);
+		m_ship->Watch(m_target);
 		m_targframe = space->GetFrameByIndex(m_targframeIndex);
 		m_lockhead = true;
 	}
@@ -136,6 +153,7 @@ private:
 	double m_endvel;	// target speed in direction of motion at end of path, positive only
 	bool m_tangent;		// true if path is to a tangent of the target frame's body
 	int m_state;		
+	bool m_coasting;	// cruising with the thrusters off, see TimeStepUpdate
 
 	bool m_lockhead;
 	int m_targetIndex, m_targframeIndex;	// used during deserialisation
@@ -147,6 +165,7 @@ private:
 class AICmdFlyAround : public AICommand {
 public:
 	virtual bool TimeStepUpdate();
+	virtual bool IsThinkSafe() const { return true; }
 	AICmdFlyAround(Ship *ship, Body *obstructor, double relalt, int mode=2);
 	AICmdFlyAround(Ship *ship, Body *obstructor, double alt, double vel, int mode=1);
 
@@ -190,8 +209,10 @@ private:
 class AICmdKill : public AICommand {
 public:
 	virtual bool TimeStepUpdate();
-	AICmdKill(Ship *ship, Ship *target) : AICommand (ship, CMD_KILL) {
+	virtual bool IsThinkSafe() const { return true; }
+	AICmdKill(Ship *ship, Ship *target) : AICommand (ship, CMD_KILL), m_rng(Pi::rng.Int32()) {
 		m_target = target;
+		m_ship->Watch(m_target);
 		m_leadTime = m_evadeTime = m_closeTime = 0.0;
 		m_lastVel = m_target->GetVelocity();
 	}
@@ -202,12 +223,13 @@ public:
 		AICommand::Save(wr);
 		wr.Int32(space->GetIndexForBody(m_target));
 	}
-	AICmdKill(Serializer::Reader &rd) : AICommand(rd, CMD_KILL) {
+	AICmdKill(Serializer::Reader &rd) : AICommand(rd, CMD_KILL), m_rng(Pi::rng.Int32()) {
 		m_targetIndex = rd.Int32();
 	}
 	virtual void PostLoadFixup(Space *space) {
 		AICommand::PostLoadFixup(space);
 		m_target = static_cast<Ship *>(space->GetBodyByIndex(m_targetIndex));
+		m_ship->Watch(m_target);
 		m_leadTime = m_evadeTime = m_closeTime = 0.0;
 		m_lastVel = m_target->GetVelocity();
 	}
@@ -221,14 +243,18 @@ private:
 	Ship *m_target;
 	double m_leadTime, m_evadeTime, m_closeTime;
 	vector3d m_leadOffset, m_leadDrift, m_lastVel;
+	// its own, so that ships thinking in parallel don't share Pi::rng
+	MTRand m_rng;
 	int m_targetIndex;	// used during deserialisation
 };
 
 class AICmdKamikaze : public AICommand {
 public:
 	virtual bool TimeStepUpdate();
+	virtual bool IsThinkSafe() const { return true; }
 	AICmdKamikaze(Ship *ship, Body *target) : AICommand (ship, CMD_KAMIKAZE) {
 		m_target = target;
+		m_ship->Watch(m_target);
 	}
 
 	virtual void Save(Serializer::Writer &wr) {
@@ -242,6 +268,7 @@ public:
 	virtual void PostLoadFixup(Space *space) {
 		AICommand::PostLoadFixup(space);
 		m_target = space->GetBodyByIndex(m_targetIndex);
+		m_ship->Watch(m_target);
 	}
 
 	virtual void OnDeleted(const Body *body) {
@@ -257,6 +284,7 @@ private:
 class AICmdHoldPosition : public AICommand {
 public:
 	virtual bool TimeStepUpdate();
+	virtual bool IsThinkSafe() const { return true; }
 	AICmdHoldPosition(Ship *ship) : AICommand(ship, CMD_HOLDPOSITION) { }
 	AICmdHoldPosition(Serializer::Reader &rd) : AICommand(rd, CMD_HOLDPOSITION) { }
 };
@@ -264,6 +292,7 @@ public:
 class AICmdFormation : public AICommand {
 public:
 	virtual bool TimeStepUpdate();
+	virtual bool IsThinkSafe() const { return true; }
 	AICmdFormation(Ship *ship, Ship *target, const vector3d &posoff);
 
 	virtual void GetStatusText(char *str) {
@@ -284,6 +313,7 @@ public:
 	virtual void PostLoadFixup(Space *space) {
 		AICommand::PostLoadFixup(space);
 		m_target = static_cast<Ship*>(space->GetBodyByIndex(m_targetIndex));
+		m_ship->Watch(m_target);
 	}
 	virtual void OnDeleted(const Body *body) {
 		if (static_cast<Body *>(m_target) == body) m_target = 0;
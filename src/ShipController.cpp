@@ -14,6 +14,7 @@
 
 void ShipController::StaticUpdate(float timeStep)
 {
+	if (m_ship->AIFinishThink()) return;
 	OS::EnableFPE();
 	m_ship->AITimeStep(timeStep);
 	OS::DisableFPE();
@@ -78,6 +79,9 @@ void PlayerShipController::PostLoadFixup(Space *space)
 	m_combatTarget = space->GetBodyByIndex(m_combatTargetIndex);
 	m_navTarget = space->GetBodyByIndex(m_navTargetIndex);
 	m_setSpeedTarget = space->GetBodyByIndex(m_setSpeedTargetIndex);
+	m_ship->Watch(m_combatTarget);
+	m_ship->Watch(m_navTarget);
+	m_ship->Watch(m_setSpeedTarget);
 }
 
 void PlayerShipController::StaticUpdate(const float timeStep)
@@ -135,6 +139,7 @@ void PlayerShipController::CheckControlsLock()
 		|| Pi::player->IsDead()
 		|| (m_ship->GetFlightState() != Ship::FLYING)
 		|| Pi::IsConsoleActive()
+		|| !Pi::worldView //headless
 		|| (Pi::GetView() != Pi::worldView); //to prevent moving the ship in starmap etc.
 }
 
@@ -347,6 +352,7 @@ void PlayerShipController::SetCombatTarget(Body* const target, bool setSpeedTo)
 	else if (m_setSpeedTarget == m_combatTarget)
 		m_setSpeedTarget = 0;
 	m_combatTarget = target;
+	m_ship->Watch(target);
 }
 
 void PlayerShipController::SetNavTarget(Body* const target, bool setSpeedTo)
@@ -356,4 +362,5 @@ void PlayerShipController::SetNavTarget(Body* const target, bool setSpeedTo)
 	else if (m_setSpeedTarget == m_navTarget)
 		m_setSpeedTarget = 0;
 	m_navTarget = target;
+	m_ship->Watch(target);
 }
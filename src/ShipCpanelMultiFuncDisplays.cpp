@@ -222,7 +222,9 @@ void ScannerWidget::Update()
 	float combat_dist = 0, far_ship_dist = 0, nav_dist = 0, far_other_dist = 0;
 
 	// collect the bodies to be displayed, and if AUTO, distances
-	for (Space::BodyIterator i = Pi::game->GetSpace()->BodiesBegin(); i != Pi::game->GetSpace()->BodiesEnd(); ++i) {
+	std::vector<Body*> nearby;
+	Pi::game->GetSpace()->GetProximityIndex().FindInRadius(Pi::player->GetFrame(), Pi::player->GetPosition(), SCANNER_RANGE_MAX, Object::BODY, nearby);
+	for (std::vector<Body*>::const_iterator i = nearby.begin(); i != nearby.end(); ++i) {
 		if ((*i) == Pi::player) continue;
 
 		float dist = float((*i)->GetPositionRelTo(Pi::player).Length());
@@ -12,10 +12,12 @@
 #include "Pi.h"
 #include "Player.h"
 #include "galaxy/StarSystem.h"
+#include "galaxy/SectorCache.h"
 #include "SpaceStation.h"
 #include "Serializer.h"
 #include "collider/collider.h"
 #include "Missile.h"
+#include "Projectile.h"
 #include "HyperspaceCloud.h"
 #include "graphics/Graphics.h"
 #include "WorldView.h"
@@ -24,6 +26,9 @@
 #include "Game.h"
 #include "MathUtil.h"
 #include "LuaEvent.h"
+#include "JobQueue.h"
+#include "BodyActivity.h"
+#include "OS.h"
 
 Space::Space(Game *game)
 	: m_game(game)
@@ -82,7 +87,7 @@ Space::Space(Game *game, Serializer::Reader &rd)
 
 	Uint32 nbodies = rd.Int32();
 	for (Uint32 i = 0; i < nbodies; i++)
-		m_bodies.push_back(Body::Unserialize(rd, this));
+		AddBody(Body::Unserialize(rd, this));
 	RebuildBodyIndex();
 
 	Frame::PostUnserializeFixup(m_rootFrame.Get(), this);
@@ -222,7 +227,14 @@ void Space::RebuildSystemBodyIndex()
 
 void Space::AddBody(Body *b)
 {
+	assert(!b->m_inBodyList);
 	m_bodies.push_back(b);
+	b->m_bodyListEntry = --m_bodies.end();
+	b->m_inBodyList = true;
+	m_proximity.Add(b);
+	// added mid-step, it steps the rest of this one like anything else
+	b->m_stepping = true;
+	b->m_stepTime = m_game->GetTimeStep();
 }
 
 void Space::RemoveBody(Body *b)
@@ -259,11 +271,11 @@ vector3d Space::GetHyperspaceExitPoint(const SystemPath &source) const
 
 	const SystemPath &dest = m_starSystem->GetPath();
 
-	Sector source_sec(source.sectorX, source.sectorY, source.sectorZ);
-	Sector dest_sec(dest.sectorX, dest.sectorY, dest.sectorZ);
+	RefCountedPtr<const Sector> source_sec = SectorCache::Get(source);
+	RefCountedPtr<const Sector> dest_sec = SectorCache::Get(dest);
 
-	Sector::System source_sys = source_sec.m_systems[source.systemIndex];
-	Sector::System dest_sys = dest_sec.m_systems[dest.systemIndex];
+	const Sector::System &source_sys = source_sec->m_systems[source.systemIndex];
+	const Sector::System &dest_sys = dest_sec->m_systems[dest.systemIndex];
 
 	const vector3d sourcePos = vector3d(source_sys.p) + vector3d(source.sectorX, source.sectorY, source.sectorZ);
 	const vector3d destPos = vector3d(dest_sys.p) + vector3d(dest.sectorX, dest.sectorY, dest.sectorZ);
@@ -287,19 +299,16 @@ vector3d Space::GetHyperspaceExitPoint(const SystemPath &source) const
 
 Body *Space::FindNearestTo(const Body *b, Object::Type t) const
 {
-	Body *nearest = 0;
-	double dist = FLT_MAX;
-	for (std::list<Body*>::const_iterator i = m_bodies.begin(); i != m_bodies.end(); ++i) {
-		if ((*i)->IsDead()) continue;
-		if ((*i)->IsType(t)) {
-			double d = (*i)->GetPositionRelTo(b).Length();
-			if (d < dist) {
-				dist = d;
-				nearest = *i;
-			}
-		}
-	}
-	return nearest;
+	std::vector<Body*> nearest;
+	GetProximityIndex().FindNearest(b->GetFrame(), b->GetPosition(), t, 1, nearest);
+	return nearest.empty() ? 0 : nearest[0];
+}
+
+const ProximityIndex &Space::GetProximityIndex() const
+{
+	if (!m_proximity.IsBuilt())
+		m_proximity.Build(m_bodies);
+	return m_proximity;
 }
 
 Body *Space::FindBodyForPath(const SystemPath *path) const
@@ -673,62 +682,289 @@ static void hitCallback(CollisionContact *c)
 	}
 }
 
-// temporary one-point version
-static void CollideWithTerrain(Body *body)
+// temporary one-point version. bodies low enough to maybe be touching the
+// ground are grouped by the planet under them, so each planet's heights
+// are looked up in one go
+struct TerrainCollisionGroup {
+	TerrainBody *terrain;
+	std::vector<Body*> bodies;
+	std::vector<double> altitudes;
+	std::vector<vector3d> dirs;
+};
+
+static void CollideWithTerrain(const std::list<Body*> &bodies)
 {
-	if (!body->IsType(Object::DYNAMICBODY)) return;
-	DynamicBody *dynBody = static_cast<DynamicBody*>(body);
-	if (!dynBody->IsMoving()) return;
+	std::vector<TerrainCollisionGroup> groups;
+	for (std::list<Body*>::const_iterator i = bodies.begin(); i != bodies.end(); ++i) {
+		Body *body = *i;
+		if (!body->IsType(Object::DYNAMICBODY)) continue;
+		DynamicBody *dynBody = static_cast<DynamicBody*>(body);
+		if (!dynBody->IsMoving()) continue;
+
+		Frame *f = body->GetFrame();
+		if (!f || !f->IsRotFrame() || !f->GetBody()) continue;
+		if (!f->GetBody()->IsType(Object::TERRAINBODY)) continue;
+		TerrainBody *terrain = static_cast<TerrainBody*>(f->GetBody());
+
+		const Aabb &aabb = dynBody->GetAabb();
+		double altitude = body->GetPosition().Length() + aabb.min.y;
+		if (altitude >= terrain->GetMaxFeatureRadius()) continue;
+
+		std::vector<TerrainCollisionGroup>::iterator g = groups.begin();
+		while (g != groups.end() && g->terrain != terrain) ++g;
+		if (g == groups.end()) {
+			groups.push_back(TerrainCollisionGroup());
+			g = groups.end()-1;
+			g->terrain = terrain;
+		}
+		g->bodies.push_back(body);
+		g->altitudes.push_back(altitude);
+		g->dirs.push_back(body->GetPosition().Normalized());
+	}
 
-	Frame *f = body->GetFrame();
-	if (!f || !f->IsRotFrame() || !f->GetBody()) return;
-	if (!f->GetBody()->IsType(Object::TERRAINBODY)) return;
-	TerrainBody *terrain = static_cast<TerrainBody*>(f->GetBody());
+	std::vector<double> terrHeights;
+	for (std::vector<TerrainCollisionGroup>::const_iterator g = groups.begin(); g != groups.end(); ++g) {
+		const int count = int(g->bodies.size());
+		terrHeights.resize(count);
+		g->terrain->QueryTerrainHeights(&g->dirs[0], &terrHeights[0], count);
+
+		for (int i = 0; i < count; i++) {
+			if (g->altitudes[i] >= terrHeights[i]) continue;
+
+			Body *body = g->bodies[i];
+			CollisionContact c;
+			c.pos = body->GetPosition();
+			c.normal = c.pos.Normalized();
+			c.depth = terrHeights[i] - g->altitudes[i];
+			c.userData1 = static_cast<void*>(body);
+			c.userData2 = static_cast<void*>(g->terrain);
+			hitCallback(&c);
+		}
+	}
+}
+
+// geoms tested per narrow phase job. small enough that one busy frame
+// (a starport, say) is still spread over every worker
+static const int COLLIDE_GEOMS_PER_JOB = 16;
+
+// contacts found for a run of geoms in one frame
+struct ContactBatch {
+	CollisionSpace *space;
+	int first;
+	int count;
+	std::vector<CollisionContact> contacts;
+};
+
+class CollectContactsJob : public Job {
+public:
+	CollectContactsJob(ContactBatch *batch) : m_batch(batch) {}
+	virtual void OnRun() {
+		m_batch->space->CollectContacts(m_batch->first, m_batch->count, m_batch->contacts);
+	}
+private:
+	ContactBatch *m_batch;
+};
 
-	const Aabb &aabb = dynBody->GetAabb();
-	double altitude = body->GetPosition().Length() + aabb.min.y;
-	if (altitude >= terrain->GetMaxFeatureRadius()) return;
+static void make_contact_batches(Frame *f, std::vector<ContactBatch> &batches)
+{
+	CollisionSpace *space = f->GetCollisionSpace();
+	space->PrepareCollide();
+	const int numGeoms = space->GetNumGeoms();
+	for (int first = 0; first < numGeoms; first += COLLIDE_GEOMS_PER_JOB) {
+		batches.push_back(ContactBatch());
+		ContactBatch &batch = batches.back();
+		batch.space = space;
+		batch.first = first;
+		batch.count = std::min(COLLIDE_GEOMS_PER_JOB, numGeoms - first);
+	}
 
-	double terrHeight = terrain->GetTerrainHeight(body->GetPosition().Normalized());
-	if (altitude >= terrHeight) return;
-	
-	CollisionContact c;
-	c.pos = body->GetPosition();
-	c.normal = c.pos.Normalized();
-	c.depth = terrHeight - altitude;
-	c.userData1 = static_cast<void*>(body);
-	c.userData2 = static_cast<void*>(f->GetBody());
-	hitCallback(&c);
+	for (Frame::ChildIterator it = f->BeginChildren(); it != f->EndChildren(); ++it)
+		make_contact_batches(*it, batches);
 }
 
-void Space::CollideFrame(Frame *f)
+// an earlier contact's response can take a body out of collisions (a ship
+// starting to dock, say), in which case its later contacts don't count
+static bool is_still_colliding(Object *o)
 {
-	f->GetCollisionSpace()->Collide(&hitCallback);
-	for (Frame::ChildIterator it = f->BeginChildren(); it != f->EndChildren(); ++it)
-		CollideFrame(*it);
+	return !o->IsType(Object::MODELBODY) || static_cast<ModelBody*>(o)->IsColliding();
+}
+
+// finding contacts only reads positions, so it's spread over the sim
+// workers. responding to them changes velocities and can set off game
+// events, so it's done here, one contact at a time, in the order the
+// batches were made. that order is fixed by the frame tree and each
+// space's geom order, so results don't depend on how many threads there
+// are or which finished first
+void Space::CollideFrames()
+{
+	std::vector<ContactBatch> batches;
+	make_contact_batches(m_rootFrame.Get(), batches);
+
+	if (Pi::simJobQueue && batches.size() > 1) {
+		JobSet jobs(Pi::simJobQueue);
+		for (std::vector<ContactBatch>::iterator b = batches.begin(); b != batches.end(); ++b)
+			jobs.Queue(new CollectContactsJob(&*b));
+		jobs.Wait();
+	} else {
+		for (std::vector<ContactBatch>::iterator b = batches.begin(); b != batches.end(); ++b)
+			b->space->CollectContacts(b->first, b->count, b->contacts);
+	}
+
+	for (std::vector<ContactBatch>::iterator b = batches.begin(); b != batches.end(); ++b) {
+		for (std::vector<CollisionContact>::iterator c = b->contacts.begin(); c != b->contacts.end(); ++c) {
+			if (!is_still_colliding(static_cast<Object*>(c->userData1))) continue;
+			if (!is_still_colliding(static_cast<Object*>(c->userData2))) continue;
+			hitCallback(&*c);
+		}
+	}
+}
+
+// ships thought for per job. the AI is a lot more work per ship than a
+// contact test, so fewer
+static const int AI_SHIPS_PER_JOB = 4;
+
+class ThinkJob : public Job {
+public:
+	ThinkJob(Ship **ships, int count) : m_ships(ships), m_count(count) {}
+	virtual void OnRun() {
+		for (int i = 0; i < m_count; i++)
+			m_ships[i]->AIThink(m_ships[i]->GetStepTime());
+	}
+private:
+	Ship **m_ships;
+	int m_count;
+};
+
+// ships flying on AI commands that only read other bodies and set their own
+// controls do their thinking here, spread over the sim workers, before
+// StaticUpdate. anything else the AI does that reaches outside the ship
+// (Lua events, docking, launching) is left for StaticUpdate on this thread.
+// nothing a ship reads is written until every ship has thought, so results
+// don't depend on how many threads there are. new commands watch their
+// targets, which writes to the target, so watches are held on the watching
+// ship until the jobs are done
+void Space::ThinkAI()
+{
+	std::vector<Ship*> ships;
+	for (BodyIterator i = m_bodies.begin(); i != m_bodies.end(); ++i) {
+		if (!(*i)->IsType(Object::SHIP)) continue;
+		Ship *s = static_cast<Ship*>(*i);
+		if (s->IsStepping() && s->CanAIThink()) ships.push_back(s);
+	}
+
+	const int numShips = int(ships.size());
+	if (Pi::simJobQueue && numShips > AI_SHIPS_PER_JOB) {
+		Body::SetDeferWatches(true);
+		JobSet jobs(Pi::simJobQueue);
+		for (int first = 0; first < numShips; first += AI_SHIPS_PER_JOB)
+			jobs.Queue(new ThinkJob(&ships[first], std::min(AI_SHIPS_PER_JOB, numShips - first)));
+		jobs.Wait();
+		Body::SetDeferWatches(false);
+		for (int i = 0; i < numShips; i++)
+			ships[i]->ApplyDeferredWatches();
+	} else {
+		for (int i = 0; i < numShips; i++)
+			ships[i]->AIThink(ships[i]->GetStepTime());
+	}
+}
+
+static bool s_phaseTiming = false;
+static Uint64 s_phaseTimes[Space::PHASE_MAX];
+
+static const char *s_phaseNames[Space::PHASE_MAX] = {
+	"activity",
+	"collision",
+	"update_frame",
+	"projectiles",
+	"proximity",
+	"ai",
+	"static_update",
+	"orbit_rails",
+	"timestep_update",
+	"lua_events",
+	"lua_timers",
+	"update_bodies",
+};
+
+void Space::SetPhaseTiming(bool on)
+{
+	s_phaseTiming = on;
+}
+
+void Space::ResetPhaseTimes()
+{
+	std::fill(s_phaseTimes, s_phaseTimes + PHASE_MAX, 0);
+}
+
+Uint64 Space::GetPhaseTime(Phase p)
+{
+	return s_phaseTimes[p];
+}
+
+const char *Space::GetPhaseName(Phase p)
+{
+	return s_phaseNames[p];
+}
+
+// charges the time since mark to phase p and starts the next one
+static inline void end_phase(Space::Phase p, Uint64 &mark)
+{
+	if (!s_phaseTiming) return;
+	const Uint64 now = OS::HFTimer();
+	s_phaseTimes[p] += now - mark;
+	mark = now;
 }
 
 void Space::TimeStep(float step)
 {
 	m_frameIndexValid = m_bodyIndexValid = m_sbodyIndexValid = false;
 
+	Uint64 mark = s_phaseTiming ? OS::HFTimer() : 0;
+
+	// bodies with nothing going on may sit this step out
+	BodyActivity::Begin(m_bodies, step);
+	end_phase(PHASE_ACTIVITY, mark);
+
 	// XXX does not need to be done this often
-	CollideFrame(m_rootFrame.Get());
-	for (BodyIterator i = m_bodies.begin(); i != m_bodies.end(); ++i)
-		CollideWithTerrain(*i);
+	CollideFrames();
+	CollideWithTerrain(m_bodies);
+	end_phase(PHASE_COLLISION, mark);
 
 	// update frames of reference
 	for (BodyIterator i = m_bodies.begin(); i != m_bodies.end(); ++i)
-		(*i)->UpdateFrame();
+		if ((*i)->IsStepping()) (*i)->UpdateFrame();
+	end_phase(PHASE_UPDATE_FRAME, mark);
+
+	// nothing moves until the AI's done, so every projectile's ray for
+	// this step can be cast up front in one go
+	Projectile::TraceRays(m_bodies, step);
+	end_phase(PHASE_PROJECTILES, mark);
 
-	// AI acts here, then move all bodies and frames
+	// nor does anything else, so one index of where the bodies are
+	// serves every proximity query the AI makes
+	m_proximity.Build(m_bodies);
+	end_phase(PHASE_PROXIMITY, mark);
+
+	// and tells the ones stepping now how long they can wait next time
+	BodyActivity::Assess(m_bodies, m_proximity, m_game->GetPlayer(), step);
+	end_phase(PHASE_ACTIVITY, mark);
+
+	ThinkAI();
+	end_phase(PHASE_AI, mark);
+
+	// the rest of the AI acts here, then move all bodies and frames. bodies
+	// that sat out earlier steps catch up on them here
 	for (BodyIterator i = m_bodies.begin(); i != m_bodies.end(); ++i)
-		(*i)->StaticUpdate(step);
+		if ((*i)->IsStepping()) (*i)->StaticUpdate((*i)->GetStepTime());
+	end_phase(PHASE_STATIC_UPDATE, mark);
 
 	m_rootFrame->UpdateOrbitRails(m_game->GetTime(), m_game->GetTimeStep());
+	end_phase(PHASE_ORBIT_RAILS, mark);
 
 	for (BodyIterator i = m_bodies.begin(); i != m_bodies.end(); ++i)
-		(*i)->TimeStepUpdate(step);
+		if ((*i)->IsStepping()) (*i)->TimeStepUpdate((*i)->GetStepTime());
+	m_proximity.Clear();
+	end_phase(PHASE_TIMESTEP_UPDATE, mark);
 
 	// XXX don't emit events in hyperspace. this is mostly to maintain the
 	// status quo. in particular without this onEnterSystem will fire in the
@@ -737,30 +973,33 @@ void Space::TimeStep(float step)
 	// there's anything useful that can be done with events in hyperspace
 	if (m_starSystem) {
 		LuaEvent::Emit();
+		end_phase(PHASE_LUA_EVENTS, mark);
 		Pi::luaTimer->Tick();
+		end_phase(PHASE_LUA_TIMERS, mark);
 	}
 
 	UpdateBodies();
+	end_phase(PHASE_UPDATE_BODIES, mark);
 }
 
 void Space::UpdateBodies()
 {
+	m_proximity.Clear();
+
 #ifndef NDEBUG
 	m_processingFinalizationQueue = true;
 #endif
 
 	for (BodyIterator b = m_removeBodies.begin(); b != m_removeBodies.end(); ++b) {
 		(*b)->SetFrame(0);
-		for (BodyIterator i = m_bodies.begin(); i != m_bodies.end(); ++i)
-			(*i)->NotifyRemoved(*b);
-		m_bodies.remove(*b);
+		(*b)->ReleaseWatches(true);
+		EraseBody(*b);
 	}
 	m_removeBodies.clear();
 
 	for (BodyIterator b = m_killBodies.begin(); b != m_killBodies.end(); ++b) {
-		for (BodyIterator i = m_bodies.begin(); i != m_bodies.end(); ++i)
-			(*i)->NotifyRemoved(*b);
-		m_bodies.remove(*b);
+		(*b)->ReleaseWatches(true);
+		EraseBody(*b);
 		delete *b;
 	}
 	m_killBodies.clear();
@@ -770,6 +1009,14 @@ void Space::UpdateBodies()
 #endif
 }
 
+void Space::EraseBody(Body *b)
+{
+	// may have been removed and killed in the same step
+	if (!b->m_inBodyList) return;
+	m_bodies.erase(b->m_bodyListEntry);
+	b->m_inBodyList = false;
+}
+
 static char space[256];
 
 static void DebugDumpFrame(Frame *f, unsigned int indent)
@@ -11,6 +11,7 @@
 #include "RefCounted.h"
 #include "galaxy/StarSystem.h"
 #include "Background.h"
+#include "ProximityIndex.h"
 
 class Body;
 class Frame;
@@ -62,16 +63,46 @@ public:
 	const BodyIterator BodiesBegin() const { return m_bodies.begin(); }
 	const BodyIterator BodiesEnd() const { return m_bodies.end(); }
 
+	// where the bodies are, for finding the ones near somewhere. built
+	// once a step, or on first use after bodies have moved
+	const ProximityIndex &GetProximityIndex() const;
+
 	Background::Container& GetBackground() { return m_background; }
 
+	// the parts of TimeStep, for seeing where it spends its time
+	enum Phase {
+		PHASE_ACTIVITY,
+		PHASE_COLLISION,
+		PHASE_UPDATE_FRAME,
+		PHASE_PROJECTILES,
+		PHASE_PROXIMITY,
+		PHASE_AI,
+		PHASE_STATIC_UPDATE,
+		PHASE_ORBIT_RAILS,
+		PHASE_TIMESTEP_UPDATE,
+		PHASE_LUA_EVENTS,
+		PHASE_LUA_TIMERS,
+		PHASE_UPDATE_BODIES,
+		PHASE_MAX
+	};
+	// off by default. times are summed over every Space that steps while
+	// it's on (in OS::HFTimer ticks), so they carry on across hyperspace
+	static void SetPhaseTiming(bool on);
+	static void ResetPhaseTimes();
+	static Uint64 GetPhaseTime(Phase p);
+	static const char *GetPhaseName(Phase p);
+
 private:
 	void GenBody(SystemBody *b, Frame *f);
 	// make sure SystemBody* is in Pi::currentSystem
 	Frame *GetFrameWithSystemBody(const SystemBody *b) const;
 
 	void UpdateBodies();
+	// takes b out of m_bodies, if it's still there
+	void EraseBody(Body *b);
 
-	void CollideFrame(Frame *f);
+	void CollideFrames();
+	void ThinkAI();
 
 	ScopedPtr<Frame> m_rootFrame;
 
@@ -86,6 +117,8 @@ private:
 	std::list<Body*> m_removeBodies;
 	std::list<Body*> m_killBodies;
 
+	mutable ProximityIndex m_proximity;
+
 	void RebuildFrameIndex();
 	void RebuildBodyIndex();
 	void RebuildSystemBodyIndex();
@@ -113,6 +113,7 @@ void SpaceStation::PostLoadFixup(Space *space)
 	ModelBody::PostLoadFixup(space);
 	for (int i=0; i<MAX_DOCKING_PORTS; i++) {
 		m_shipDocking[i].ship = static_cast<Ship*>(space->GetBodyByIndex(m_shipDocking[i].shipIndex));
+		Watch(m_shipDocking[i].ship);
 	}
 }
 
@@ -231,6 +232,7 @@ int SpaceStation::GetFreeDockingPort() const
 void SpaceStation::SetDocked(Ship *ship, int port)
 {
 	m_shipDocking[port].ship = ship;
+	Watch(ship);
 	m_shipDocking[port].stage = m_type->numDockingStages+1;
 
 	// have to do this crap again in case it was called directly (Ship::SetDockWith())
@@ -249,6 +251,7 @@ bool SpaceStation::LaunchShip(Ship *ship, int port)
 	if (m_type->dockOneAtATimePlease) m_dockingLock = true;
 
 	sd.ship = ship;
+	Watch(ship);
 	sd.stage = -1;
 	sd.stagePos = 0;
 	sd.fromPos = (ship->GetPosition() - GetPosition()) * GetOrient();	// station space
@@ -272,6 +275,7 @@ bool SpaceStation::GetDockingClearance(Ship *s, std::string &outMsg)
 		if (m_shipDocking[i].ship != 0) continue;
 		shipDocking_t &sd = m_shipDocking[i];
 		sd.ship = s;
+		Watch(s);
 		sd.stage = 1;
 		sd.stagePos = 0;
 		outMsg = stringf(Lang::CLEARANCE_GRANTED_BAY_N, formatarg("bay", i+1));
@@ -313,6 +317,7 @@ bool SpaceStation::OnCollision(Object *b, Uint32 flags, double relVel)
 		if (m_type->numDockingStages >= 2) {
 			shipDocking_t &sd = m_shipDocking[port];
 			sd.ship = s;
+			Watch(s);
 			sd.stage = 2;
 			sd.stagePos = 0;
 			sd.fromPos = (s->GetPosition() - GetPosition()) * GetOrient();	// station space
@@ -134,6 +134,22 @@ double TerrainBody::GetTerrainHeight(const vector3d &pos_) const
 	}
 }
 
+double TerrainBody::QueryTerrainHeight(const vector3d &pos) const
+{
+	double height;
+	QueryTerrainHeights(&pos, &height, 1);
+	return height;
+}
+
+void TerrainBody::QueryTerrainHeights(const vector3d *pos, double *heights, int count) const
+{
+	const double radius = m_sbody->GetRadius();
+	assert(m_geosphere);
+	m_geosphere->GetLatticeHeights(pos, heights, count);
+	for (int i=0; i<count; i++)
+		heights[i] = radius * (1.0 + heights[i]);
+}
+
 bool TerrainBody::IsSuperType(SystemBody::BodySuperType t) const
 {
 	if (!m_sbody) return false;
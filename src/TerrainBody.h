@@ -22,6 +22,11 @@ public:
 	virtual bool OnCollision(Object *b, Uint32 flags, double relVel) { return true; }
 	virtual double GetMass() const { return m_mass; }
 	double GetTerrainHeight(const vector3d &pos) const;
+	// like GetTerrainHeight, but interpolated between heights kept on a
+	// fixed lattice, which is cheaper for points that keep being asked
+	// about. the same with or without a camera. for collisions
+	double QueryTerrainHeight(const vector3d &pos) const;
+	void QueryTerrainHeights(const vector3d *pos, double *heights, int count) const;
 	bool IsSuperType(SystemBody::BodySuperType t) const;
 	virtual const SystemBody *GetSystemBody() const { return m_sbody; }
 	GeoSphere *GetGeoSphere() const { return m_geosphere; }
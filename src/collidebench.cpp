@@ -0,0 +1,231 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+// times GeomTree ray casts through the wide tree against the plain binary
+// tree walk they replaced, on generated meshes. no window or GL needed.
+// output is tab separated, one line per test, lines starting with # are
+// comments:
+//
+//   test  tris  rays  binary_ns  wide_ns  speedup  mismatches
+//
+// *_ns are nanoseconds per ray, best of several runs. "rays" casts random
+// rays at a lumpy sphere; "edges" casts the edges of a smaller mesh poking
+// into it, as Geom::CollideEdgesTris does. mismatches counts rays where the
+// two walks found different hits.
+//
+// usage: collidebench [-s segments] [-n rays] [-r runs]
+
+#include "libs.h"
+#include "OS.h"
+#include "mtrand.h"
+#include "collider/GeomTree.h"
+#include "collider/BVHTree.h"
+
+struct Mesh {
+	std::vector<float> vertices;
+	std::vector<int> indices;
+	std::vector<unsigned int> flags;
+};
+
+// a sphere of the given radius with its surface pushed in and out a bit,
+// 2*segs*segs triangles
+static void make_mesh(Mesh &m, int segs, double radius, MTRand &rand)
+{
+	for (int i = 0; i <= segs; i++) {
+		for (int j = 0; j <= segs; j++) {
+			const double theta = M_PI * i / segs;
+			const double phi = 2.0 * M_PI * j / segs;
+			const double r = radius * (1.0 + rand.Double(-0.05, 0.05));
+			m.vertices.push_back(float(r * sin(theta) * cos(phi)));
+			m.vertices.push_back(float(r * sin(theta) * sin(phi)));
+			m.vertices.push_back(float(r * cos(theta)));
+		}
+	}
+	for (int i = 0; i < segs; i++) {
+		for (int j = 0; j < segs; j++) {
+			const int a = i*(segs+1) + j;
+			const int b = a + 1;
+			const int c = a + segs + 1;
+			const int d = c + 1;
+			m.indices.push_back(a); m.indices.push_back(c); m.indices.push_back(b);
+			m.indices.push_back(b); m.indices.push_back(c); m.indices.push_back(d);
+			m.flags.push_back(0);
+			m.flags.push_back(0);
+		}
+	}
+}
+
+// GeomTree::TraceRay as it was before the wide tree, for comparison
+static bool slabs_ray_aabb(const BVHNode *n, const vector3f &start, const vector3f &invDir, const isect_t *isect)
+{
+	float l1 = (n->aabb.min.x - start.x) * invDir.x;
+	float l2 = (n->aabb.max.x - start.x) * invDir.x;
+	float lmin = std::min(l1,l2);
+	float lmax = std::max(l1,l2);
+
+	l1 = (n->aabb.min.y - start.y) * invDir.y;
+	l2 = (n->aabb.max.y - start.y) * invDir.y;
+	lmin = std::max(std::min(l1,l2), lmin);
+	lmax = std::min(std::max(l1,l2), lmax);
+
+	l1 = (n->aabb.min.z - start.z) * invDir.z;
+	l2 = (n->aabb.max.z - start.z) * invDir.z;
+	lmin = std::max(std::min(l1,l2), lmin);
+	lmax = std::min(std::max(l1,l2), lmax);
+
+	return ((lmax >= 0.f) & (lmax >= lmin) & (lmin < isect->dist));
+}
+
+static void ray_tri(const GeomTree *tree, const vector3f &origin, const vector3f &dir, int triIdx, isect_t *isect)
+{
+	const int *indices = tree->GetIndices();
+	const vector3f a(&tree->m_vertices[3*indices[triIdx]]);
+	const vector3f b(&tree->m_vertices[3*indices[triIdx+1]]);
+	const vector3f c(&tree->m_vertices[3*indices[triIdx+2]]);
+
+	const vector3f n = (c-a).Cross(b-a);
+	const float nominator = n.Dot(a-origin);
+	const float v0d = (c-origin).Cross(b-origin).Dot(dir);
+	const float v1d = (b-origin).Cross(a-origin).Dot(dir);
+	const float v2d = (a-origin).Cross(c-origin).Dot(dir);
+
+	if (((v0d > 0) && (v1d > 0) && (v2d > 0)) || ((v0d < 0) && (v1d < 0) && (v2d < 0))) {
+		const float dist = nominator / dir.Dot(n);
+		if ((dist > 0) && (dist < isect->dist)) {
+			isect->dist = dist;
+			isect->triIdx = triIdx/3;
+		}
+	}
+}
+
+static void binary_trace_ray(const GeomTree *tree, const vector3f &origin, const vector3f &dir, isect_t *isect)
+{
+	const BVHNode *stack[64];
+	int stackpos = -1;
+	const BVHNode *currnode = tree->m_triTree->GetRoot();
+	const vector3f invDir(1.0f/dir.x, 1.0f/dir.y, 1.0f/dir.z);
+
+	for (;;) {
+		while (!currnode->IsLeaf()) {
+			if (!slabs_ray_aabb(currnode, origin, invDir, isect)) goto pop_bstack;
+			stack[++stackpos] = currnode->kids[1];
+			currnode = currnode->kids[0];
+		}
+		for (int i = 0; i < currnode->numTris; i++)
+			ray_tri(tree, origin, dir, currnode->triIndicesStart[i], isect);
+pop_bstack:
+		if (stackpos < 0) break;
+		currnode = stack[stackpos--];
+	}
+}
+
+struct Ray {
+	vector3f origin, dir;
+	float len;
+};
+
+static void run(const char *name, const GeomTree *tree, int numTris, const std::vector<Ray> &rays, int numRuns)
+{
+	const int numRays = int(rays.size());
+	std::vector<isect_t> binary(numRays), wide(numRays);
+	Uint64 best[2] = { ~Uint64(0), ~Uint64(0) };
+
+	for (int run = 0; run < numRuns; run++) {
+		for (int i = 0; i < numRays; i++) {
+			binary[i].dist = wide[i].dist = rays[i].len;
+			binary[i].triIdx = wide[i].triIdx = -1;
+		}
+
+		Uint64 t0 = OS::HFTimer();
+		for (int i = 0; i < numRays; i++)
+			binary_trace_ray(tree, rays[i].origin, rays[i].dir, &binary[i]);
+		Uint64 t1 = OS::HFTimer();
+		best[0] = std::min(best[0], t1-t0);
+
+		t0 = OS::HFTimer();
+		for (int i = 0; i < numRays; i++)
+			tree->TraceRay(rays[i].origin, rays[i].dir, &wide[i]);
+		t1 = OS::HFTimer();
+		best[1] = std::min(best[1], t1-t0);
+	}
+
+	// equally close triangles may be picked differently, so only count
+	// ones that are really different hits
+	int mismatches = 0;
+	for (int i = 0; i < numRays; i++) {
+		if (binary[i].triIdx != wide[i].triIdx && fabs(binary[i].dist - wide[i].dist) > 1e-4f * std::max(1.0f, binary[i].dist))
+			mismatches++;
+	}
+
+	const double freq = double(OS::HFTimerFreq());
+	const double binaryNs = double(best[0]) * 1e9 / (freq * numRays);
+	const double wideNs = double(best[1]) * 1e9 / (freq * numRays);
+	printf("%s\t%d\t%d\t%.1f\t%.1f\t%.2f\t%d\n", name, numTris, numRays, binaryNs, wideNs, binaryNs / std::max(wideNs, 1e-3), mismatches);
+	fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+	int segs = 128;
+	int numRays = 100000;
+	int numRuns = 5;
+
+	for (int i = 1; i < argc; i++) {
+		const std::string arg(argv[i]);
+		if (i+1 < argc && arg == "-s") segs = atoi(argv[++i]);
+		else if (i+1 < argc && arg == "-n") numRays = atoi(argv[++i]);
+		else if (i+1 < argc && arg == "-r") numRuns = atoi(argv[++i]);
+		else {
+			fprintf(stderr, "usage: collidebench [-s segments] [-n rays] [-r runs]\n");
+			return 1;
+		}
+	}
+	segs = std::max(segs, 4);
+	numRays = std::max(numRays, 1);
+	numRuns = std::max(numRuns, 1);
+
+	MTRand rand(1);
+	Mesh big, small;
+	make_mesh(big, segs, 1000.0, rand);
+	make_mesh(small, std::max(segs/4, 4), 50.0, rand);
+
+	const int bigTris = int(big.flags.size());
+	GeomTree *bigTree = new GeomTree(int(big.vertices.size()/3), bigTris, &big.vertices[0], &big.indices[0], &big.flags[0]);
+	GeomTree *smallTree = new GeomTree(int(small.vertices.size()/3), int(small.flags.size()), &small.vertices[0], &small.indices[0], &small.flags[0]);
+
+	printf("# collidebench: %d tris, best of %d runs\n", bigTris, numRuns);
+	printf("test\ttris\trays\tbinary_ns\twide_ns\tspeedup\tmismatches\n");
+
+	// from anywhere near the sphere, in any direction; some hit, some don't
+	std::vector<Ray> rays(numRays);
+	for (int i = 0; i < numRays; i++) {
+		Ray &r = rays[i];
+		r.origin = vector3f(float(rand.Double(-1500.0, 1500.0)), float(rand.Double(-1500.0, 1500.0)), float(rand.Double(-1500.0, 1500.0)));
+		r.dir = vector3f(float(rand.Double(-1.0, 1.0)), float(rand.Double(-1.0, 1.0)), float(rand.Double(-1.0, 1.0))).Normalized();
+		r.len = 3000.0f;
+	}
+	run("rays", bigTree, bigTris, rays, numRuns);
+
+	// the small mesh sat half way into the big one's surface at a few
+	// spots, its edges cast in the big one's space
+	rays.clear();
+	const GeomTree::Edge *edges = smallTree->GetEdges();
+	while (int(rays.size()) < numRays) {
+		const vector3d centre = vector3d(rand.Double(-1.0, 1.0), rand.Double(-1.0, 1.0), rand.Double(-1.0, 1.0)).Normalized() * 1000.0;
+		const matrix4x4d rot = matrix4x4d::RotateXMatrix(rand.Double(2.0*M_PI)) * matrix4x4d::RotateYMatrix(rand.Double(2.0*M_PI));
+		for (int i = 0; i < smallTree->GetNumEdges() && int(rays.size()) < numRays; i++) {
+			const vector3d v1 = rot * vector3d(&smallTree->m_vertices[edges[i].v1i]) + centre;
+			const vector3d dir = rot * vector3d(edges[i].dir.x, edges[i].dir.y, edges[i].dir.z);
+			Ray r;
+			r.origin = vector3f(float(v1.x), float(v1.y), float(v1.z));
+			r.dir = vector3f(float(dir.x), float(dir.y), float(dir.z));
+			r.len = edges[i].len;
+			rays.push_back(r);
+		}
+	}
+	run("edges", bigTree, bigTris, rays, numRuns);
+
+	delete smallTree;
+	delete bigTree;
+	return 0;
+}
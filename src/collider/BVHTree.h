@@ -40,7 +40,15 @@ public:
 		delete [] m_bvhNodes;
 	}
 	BVHNode *GetRoot() { return m_root; }
+	const BVHNode *GetRoot() const { return m_root; }
+	// all the nodes, in one array
+	const BVHNode *GetNodes() const { return m_bvhNodes; }
+	int GetNumNodes() const { return int(m_nodeAllocPos); }
 private:
+	// GeomTree saves and loads its trees
+	friend class GeomTree;
+	BVHTree() {}
+
 	void BuildNode(BVHNode *node,
 			const objPtr_t *objPtrs,
 			const Aabb *objAabbs,
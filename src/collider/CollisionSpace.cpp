@@ -4,7 +4,95 @@
 #include "CollisionSpace.h"
 #include "Geom.h"
 #include "GeomTree.h"
+#include "DynamicAabbTree.h"
 #include "../libs.h"
+#include <algorithm>
+
+// whether g should be collided with g2: they're allowed to and their
+// spheres touch
+static inline bool is_candidate(Geom *g, const vector3d &pos, double radius, Geom *g2, int minMailboxValue)
+{
+	if (!g2->IsEnabled()) return false;
+	if (g2->GetMailboxIndex() < minMailboxValue) return false;
+	if (g2 == g) return false;
+	if (g->GetGroup() && g2->GetGroup() == g->GetGroup()) return false;
+	double radius2 = g2->GetGeomTree()->GetRadius();
+	vector3d pos2 = g2->GetPosition();
+	return (pos-pos2).Length() <= (radius + radius2);
+}
+
+static bool mailbox_less(const Geom *a, const Geom *b)
+{
+	return a->GetMailboxIndex() < b->GetMailboxIndex();
+}
+
+// trace a ray against one geom, updating c if it's the closest hit so far
+static void trace_ray_geom(Geom *g, const vector3d &start, const vector3d &dir, double len, CollisionContact *c)
+{
+	const matrix4x4d &invTrans = g->GetInvTransform();
+	vector3d ms = invTrans * start;
+	vector3d md = invTrans.ApplyRotationOnly(dir);
+	vector3f modelStart = vector3f(ms.x, ms.y, ms.z);
+	vector3f modelDir = vector3f(md.x, md.y, md.z);
+
+	isect_t isect;
+	isect.dist = float(c->dist);
+	isect.triIdx = -1;
+	g->GetGeomTree()->TraceRay(modelStart, modelDir, &isect);
+	if (isect.triIdx != -1) {
+		c->pos = start + dir*double(isect.dist);
+
+		vector3f n = g->GetGeomTree()->GetTriNormal(isect.triIdx);
+		c->normal = vector3d(n.x, n.y, n.z);
+		c->normal = g->GetTransform().ApplyRotationOnly(c->normal);
+
+		c->depth = len - isect.dist;
+		c->triIdx = isect.triIdx;
+		c->userData1 = g->GetUserData();
+		c->userData2 = 0;
+		c->geomFlag = g->GetGeomTree()->GetTriFlag(isect.triIdx);
+		c->dist = isect.dist;
+	}
+}
+
+// rays that a TraceRays packet can hold
+static const int RAY_PACKET_SIZE = 8;
+
+static Aabb geom_aabb(Geom *g)
+{
+	const vector3d pos = g->GetPosition();
+	const double radius = g->GetGeomTree()->GetRadius();
+	Aabb aabb;
+	aabb.min = pos - vector3d(radius, radius, radius);
+	aabb.max = pos + vector3d(radius, radius, radius);
+	return aabb;
+}
+
+struct CandidateCallback {
+	Geom *g;
+	vector3d pos;
+	double radius;
+	int minMailboxValue;
+	std::vector<Geom*> *candidates;
+
+	void operator()(Geom *g2) {
+		if (is_candidate(g, pos, radius, g2, minMailboxValue))
+			candidates->push_back(g2);
+	}
+};
+
+struct TraceRayCallback {
+	vector3d start, dir;
+	double len;
+	CollisionContact *c;
+	Geom *ignore;
+
+	double operator()(Geom *g) {
+		if (g != ignore && g->IsEnabled())
+			trace_ray_geom(g, start, dir, len, c);
+		return c->dist;
+	}
+};
 
 /* volnode!!!!!!!!!!! */
 struct BvhNode {
@@ -67,7 +155,9 @@ public:
 		if (m_geoms) delete [] m_geoms;
 		if (m_nodesAlloc) delete [] m_nodesAlloc;
 	}
-	void CollideGeom(Geom *, const Aabb &, int minMailboxValue, void (*callback)(CollisionContact*));
+	void FindCandidates(Geom *, const Aabb &, int minMailboxValue, std::vector<Geom*> &candidates) const;
+	// every geom whose box overlaps aabb
+	void Query(const Aabb &aabb, std::vector<Geom*> &geoms) const;
 
 private:
 	void BuildNode(BvhNode *node, const std::list<Geom*> &a_geoms, int &outGeomPos);
@@ -92,7 +182,7 @@ BvhTree::BvhTree(const std::list<Geom*> &geoms)
 	assert(geomPos == numGeoms);
 }
 
-void BvhTree::CollideGeom(Geom *g, const Aabb &geomAabb, int minMailboxValue, void (*callback)(CollisionContact*))
+void BvhTree::FindCandidates(Geom *g, const Aabb &geomAabb, int minMailboxValue, std::vector<Geom*> &candidates) const
 {
 	if (!m_root) return;
 
@@ -109,15 +199,36 @@ void BvhTree::CollideGeom(Geom *g, const Aabb &geomAabb, int minMailboxValue, vo
 			if (node->geomStart) {
 				for (int i=0; i<node->numGeoms; i++) {
 					Geom *g2 = node->geomStart[i];
-					if (!g2->IsEnabled()) continue;
-					if (g2->GetMailboxIndex() < minMailboxValue) continue;
-					if (g2 == g) continue;
-					if (g->GetGroup() && g2->GetGroup() == g->GetGroup()) continue;
-					double radius2 = g2->GetGeomTree()->GetRadius();
-					vector3d pos2 = g2->GetPosition();
-					if ((pos-pos2).Length() <= (radius + radius2)) {
-						g->Collide(g2, callback);
-					}
+					if (is_candidate(g, pos, radius, g2, minMailboxValue))
+						candidates.push_back(g2);
+				}
+			}
+			else if (node->kids[0]) {
+				stack[++stackPos] = node->kids[0];
+				node = node->kids[1];
+				continue;
+			}
+		}
+
+		if (stackPos < 0) break;
+		node = stack[stackPos--];
+	}
+}
+
+void BvhTree::Query(const Aabb &aabb, std::vector<Geom*> &geoms) const
+{
+	if (!m_root) return;
+
+	int stackPos = -1;
+	BvhNode *stack[16];
+	BvhNode *node = m_root;
+
+	for (;;) {
+		if (aabb.Intersects(node->aabb)) {
+			if (node->geomStart) {
+				for (int i=0; i<node->numGeoms; i++) {
+					if (aabb.Intersects(geom_aabb(node->geomStart[i])))
+						geoms.push_back(node->geomStart[i]);
 				}
 			}
 			else if (node->kids[0]) {
@@ -201,23 +312,46 @@ CollisionSpace::CollisionSpace()
 	sphere.radius = 0;
 	m_needStaticGeomRebuild = true;
 	m_staticObjectTree = 0;
-	m_dynamicObjectTree = 0;
+	m_dynamicObjectTree = new DynamicAabbTree;
 }
 
 CollisionSpace::~CollisionSpace()
 {
+	for (std::vector<Geom*>::iterator i = m_geoms.begin(); i != m_geoms.end(); ++i)
+		(*i)->m_space = 0;
 	if (m_staticObjectTree) delete m_staticObjectTree;
-	if (m_dynamicObjectTree) delete m_dynamicObjectTree;
+	delete m_dynamicObjectTree;
 }
 
 void CollisionSpace::AddGeom(Geom *geom)
 {
+	assert(!geom->m_space);
+	geom->m_space = this;
+	geom->m_spaceIndex = int(m_geoms.size());
+	geom->m_spaceProxy = m_dynamicObjectTree->Insert(geom, geom_aabb(geom));
 	m_geoms.push_back(geom);
 }
 
 void CollisionSpace::RemoveGeom(Geom *geom)
 {
-	m_geoms.remove(geom);
+	if (geom->m_space != this) return;
+
+	// last one fills the hole
+	Geom *last = m_geoms.back();
+	m_geoms[geom->m_spaceIndex] = last;
+	last->m_spaceIndex = geom->m_spaceIndex;
+	m_geoms.pop_back();
+
+	m_dynamicObjectTree->Remove(geom->m_spaceProxy);
+
+	geom->m_space = 0;
+	geom->m_spaceIndex = -1;
+	geom->m_spaceProxy = -1;
+}
+
+void CollisionSpace::GeomMoved(Geom *geom, const vector3d &displacement)
+{
+	m_dynamicObjectTree->Move(geom->m_spaceProxy, geom_aabb(geom), displacement);
 }
 
 void CollisionSpace::AddStaticGeom(Geom *geom)
@@ -268,7 +402,7 @@ void CollisionSpace::TraceRay(const vector3d &start, const vector3d &dir, double
 	c->dist = len;
 
 	BvhNode *vn_stack[16];
-	BvhNode *node = m_staticObjectTree->m_root;
+	BvhNode *node = m_staticObjectTree ? m_staticObjectTree->m_root : 0;
 	int stackPos = -1;
 
 	for (;node;) {
@@ -283,34 +417,8 @@ void CollisionSpace::TraceRay(const vector3d &start, const vector3d &dir, double
 		if (node->geomStart) {
 			// it is a leaf node
 			// collide with all geoms
-			for (int i=0; i<node->numGeoms; i++) {
-				Geom *g = node->geomStart[i];
-
-				const matrix4x4d &invTrans = g->GetInvTransform();
-				vector3d ms = invTrans * start;
-				vector3d md = invTrans.ApplyRotationOnly(dir);
-				vector3f modelStart = vector3f(ms.x, ms.y, ms.z);
-				vector3f modelDir = vector3f(md.x, md.y, md.z);
-
-				isect_t isect;
-				isect.dist = float(c->dist);
-				isect.triIdx = -1;
-				g->GetGeomTree()->TraceRay(modelStart, modelDir, &isect);
-				if (isect.triIdx != -1) {
-					c->pos = start + dir*double(isect.dist);
-
-					vector3f n = g->GetGeomTree()->GetTriNormal(isect.triIdx);
-					c->normal = vector3d(n.x, n.y, n.z);
-					c->normal = g->GetTransform().ApplyRotationOnly(c->normal);
-
-					c->depth = len - isect.dist;
-					c->triIdx = isect.triIdx;
-					c->userData1 = g->GetUserData();
-					c->userData2 = 0;
-					c->geomFlag = g->GetGeomTree()->GetTriFlag(isect.triIdx);
-					c->dist = isect.dist;
-				}
-			}
+			for (int i=0; i<node->numGeoms; i++)
+				trace_ray_geom(node->geomStart[i], start, dir, len, c);
 		} else if (node->kids[0]) {
 			vn_stack[++stackPos] = node->kids[0];
 			node = node->kids[1];
@@ -321,56 +429,156 @@ pop_jizz:
 		node = vn_stack[stackPos--];
 	}
 
-	for (std::list<Geom*>::iterator i = m_geoms.begin(); i != m_geoms.end(); ++i) {
-		if ((*i) == ignore) continue;
-		if ((*i)->IsEnabled()) {
-			const matrix4x4d &invTrans = (*i)->GetInvTransform();
-			vector3d ms = invTrans * start;
-			vector3d md = invTrans.ApplyRotationOnly(dir);
-			vector3f modelStart = vector3f(ms.x, ms.y, ms.z);
-			vector3f modelDir = vector3f(md.x, md.y, md.z);
+	TraceRayCallback traceRay;
+	traceRay.start = start;
+	traceRay.dir = dir;
+	traceRay.len = len;
+	traceRay.c = c;
+	traceRay.ignore = ignore;
+	m_dynamicObjectTree->RayCast(start, invDir, c->dist, traceRay);
 
-			isect_t isect;
-			isect.dist = float(c->dist);
-			isect.triIdx = -1;
-			(*i)->GetGeomTree()->TraceRay(modelStart, modelDir, &isect);
-			if (isect.triIdx != -1) {
-				c->pos = start + dir*double(isect.dist);
-
-				vector3f n = (*i)->GetGeomTree()->GetTriNormal(isect.triIdx);
-				c->normal = vector3d(n.x, n.y, n.z);
-				c->normal = (*i)->GetTransform().ApplyRotationOnly(c->normal);
-
-				c->depth = len - isect.dist;
-				c->triIdx = isect.triIdx;
-				c->userData1 = (*i)->GetUserData();
-				c->userData2 = 0;
-				c->geomFlag = (*i)->GetGeomTree()->GetTriFlag(isect.triIdx);
-				c->dist = isect.dist;
-			}
-		}
+	TraceRaySphere(start, dir, len, c);
+}
+
+void CollisionSpace::TraceRaySphere(const vector3d &start, const vector3d &dir, double len, CollisionContact *c)
+{
+	isect_t isect;
+	isect.dist = float(c->dist);
+	isect.triIdx = -1;
+	CollideRaySphere(start, dir, &isect);
+	if (isect.triIdx != -1) {
+		c->pos = start + dir*double(isect.dist);
+		c->normal = vector3d(0.0);
+		c->depth = len - isect.dist;
+		c->triIdx = -1;
+		c->userData1 = sphere.userData;
+		c->userData2 = 0;
+		c->geomFlag = 0;
 	}
-	{
-		isect_t isect;
-		isect.dist = float(c->dist);
-		isect.triIdx = -1;
-		CollideRaySphere(start, dir, &isect);
-		if (isect.triIdx != -1) {
-			c->pos = start + dir*double(isect.dist);
-			c->normal = vector3d(0.0);
-			c->depth = len - isect.dist;
-			c->triIdx = -1;
-			c->userData1 = sphere.userData;
-			c->userData2 = 0;
-			c->geomFlag = 0;
+}
+
+// z-order curve position of p within bounds, ten bits an axis
+static Uint32 morton_code(const vector3d &p, const Aabb &bounds)
+{
+	const vector3d size = bounds.max - bounds.min;
+	Uint32 code = 0;
+	for (int axis = 0; axis < 3; axis++) {
+		const double t = size[axis] > 0.0 ? (p[axis] - bounds.min[axis]) / size[axis] : 0.0;
+		const Uint32 q = Uint32(Clamp(t, 0.0, 1.0) * 1023.0);
+		for (int bit = 0; bit < 10; bit++)
+			code |= ((q >> bit) & 1) << (3*bit + axis);
+	}
+	return code;
+}
+
+static Aabb ray_aabb(const CollisionRay &ray)
+{
+	const vector3d end = ray.start + ray.dir * ray.len;
+	Aabb aabb;
+	aabb.min = vector3d(std::min(ray.start.x, end.x), std::min(ray.start.y, end.y), std::min(ray.start.z, end.z));
+	aabb.max = vector3d(std::max(ray.start.x, end.x), std::max(ray.start.y, end.y), std::max(ray.start.z, end.z));
+	return aabb;
+}
+
+static Aabb combine(const Aabb &a, const Aabb &b)
+{
+	Aabb c;
+	c.min = vector3d(std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z));
+	c.max = vector3d(std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z));
+	return c;
+}
+
+// half the surface area, counting every side as at least a metre so that
+// rays along an axis still have some
+static double area(const Aabb &a)
+{
+	const vector3d d = a.max - a.min;
+	const double x = std::max(d.x, 1.0), y = std::max(d.y, 1.0), z = std::max(d.z, 1.0);
+	return x*y + y*z + z*x;
+}
+
+struct PacketQueryCallback {
+	std::vector<Geom*> *candidates;
+
+	void operator()(Geom *g) {
+		if (g->IsEnabled())
+			candidates->push_back(g);
+	}
+};
+
+// the rays are sorted along a z-order curve so neighbours in the list are
+// mostly neighbours in space, then cut into packets. a ray joins the packet
+// before it as long as one box around the lot is no bigger than separate
+// boxes would be. each packet walks both trees once with its box, and its
+// rays are only traced against the geoms that turned up
+void CollisionSpace::TraceRays(int numRays, const CollisionRay *rays, CollisionContact *contacts)
+{
+	if (numRays <= 0) return;
+
+	Aabb bounds = ray_aabb(rays[0]);
+	for (int i = 1; i < numRays; i++)
+		bounds = combine(bounds, ray_aabb(rays[i]));
+
+	std::vector<std::pair<Uint32,int> > order(numRays);
+	for (int i = 0; i < numRays; i++) {
+		const Aabb box = ray_aabb(rays[i]);
+		order[i] = std::make_pair(morton_code((box.min + box.max) * 0.5, bounds), i);
+	}
+	std::sort(order.begin(), order.end());
+
+	std::vector<Geom*> candidates;
+	PacketQueryCallback queryCallback;
+	queryCallback.candidates = &candidates;
+
+	int first = 0;
+	while (first < numRays) {
+		Aabb packet = ray_aabb(rays[order[first].second]);
+		double separateArea = area(packet);
+		int end = first + 1;
+		while (end < numRays && end - first < RAY_PACKET_SIZE) {
+			const Aabb box = ray_aabb(rays[order[end].second]);
+			const Aabb merged = combine(packet, box);
+			const double boxArea = area(box);
+			if (area(merged) > separateArea + boxArea) break;
+			packet = merged;
+			separateArea += boxArea;
+			end++;
+		}
+
+		candidates.clear();
+		if (m_staticObjectTree)
+			m_staticObjectTree->Query(packet, candidates);
+		const int numStatic = int(candidates.size());
+		m_dynamicObjectTree->Query(packet, queryCallback);
+
+		for (int k = first; k < end; k++) {
+			const int r = order[k].second;
+			TraceRayCandidates(rays[r], candidates, numStatic, &contacts[r]);
 		}
+		first = end;
+	}
+}
+
+// same tests as TraceRay: static geoms are traced whatever ray.ignore is
+void CollisionSpace::TraceRayCandidates(const CollisionRay &ray, const std::vector<Geom*> &candidates, int numStatic, CollisionContact *c)
+{
+	const vector3d invDir(1.0/ray.dir.x, 1.0/ray.dir.y, 1.0/ray.dir.z);
+	c->dist = ray.len;
+
+	for (int i = 0; i < int(candidates.size()); i++) {
+		Geom *g = candidates[i];
+		if (i >= numStatic && g == ray.ignore) continue;
+		if (!DynamicAabbTree::RayHitsAabb(geom_aabb(g), ray.start, invDir, c->dist)) continue;
+		trace_ray_geom(g, ray.start, ray.dir, ray.len, c);
 	}
+
+	TraceRaySphere(ray.start, ray.dir, ray.len, c);
 }
 
 /*
  * Do not collide objects with mailbox value < minMailboxValue
  */
-void CollisionSpace::CollideGeoms(Geom *a, int minMailboxValue, void (*callback)(CollisionContact*))
+void CollisionSpace::CollideGeom(Geom *a, int minMailboxValue, std::vector<Geom*> &candidates, std::vector<CollisionContact> &contacts)
 {
 	if (!a->IsEnabled()) return;
 	// our big aabb
@@ -380,12 +588,29 @@ void CollisionSpace::CollideGeoms(Geom *a, int minMailboxValue, void (*callback)
 	ourAabb.min = pos - vector3d(radius, radius, radius);
 	ourAabb.max = pos + vector3d(radius, radius, radius);
 
-	if (m_staticObjectTree) m_staticObjectTree->CollideGeom(a, ourAabb, 0, callback);
-	if (m_dynamicObjectTree) m_dynamicObjectTree->CollideGeom(a, ourAabb, minMailboxValue, callback);
+	// static geoms first, then moving ones, each in mailbox order. the trees
+	// find them in whatever order their shape gives, which isn't something
+	// the results should depend on
+	candidates.clear();
+	if (m_staticObjectTree) m_staticObjectTree->FindCandidates(a, ourAabb, 0, candidates);
+	const size_t numStatic = candidates.size();
+
+	CandidateCallback findCandidates;
+	findCandidates.g = a;
+	findCandidates.pos = pos;
+	findCandidates.radius = radius;
+	findCandidates.minMailboxValue = minMailboxValue;
+	findCandidates.candidates = &candidates;
+	m_dynamicObjectTree->Query(ourAabb, findCandidates);
+
+	std::sort(candidates.begin(), candidates.begin() + numStatic, mailbox_less);
+	std::sort(candidates.begin() + numStatic, candidates.end(), mailbox_less);
+	for (std::vector<Geom*>::const_iterator i = candidates.begin(); i != candidates.end(); ++i)
+		a->Collide(*i, contacts);
 
 	/* test the fucker against the planet sphere thing */
 	if (sphere.radius > 0.0) {
-		a->CollideSphere(sphere, callback);
+		a->CollideSphere(sphere, contacts);
 	}
 
 }
@@ -395,26 +620,44 @@ void CollisionSpace::RebuildObjectTrees()
 	if (m_needStaticGeomRebuild) {
 		if (m_staticObjectTree) delete m_staticObjectTree;
 		m_staticObjectTree = new BvhTree(m_staticGeoms);
+
+		// static geoms only use their mailbox to be put in order
+		int mailbox = 0;
+		for (std::list<Geom*>::iterator i = m_staticGeoms.begin(); i != m_staticGeoms.end(); ++i)
+			(*i)->SetMailboxIndex(mailbox++);
 	}
-	if (m_dynamicObjectTree) delete m_dynamicObjectTree;
-	m_dynamicObjectTree = new BvhTree(m_geoms);
 
 	m_needStaticGeomRebuild = false;
 }
 
-void CollisionSpace::Collide(void (*callback)(CollisionContact*))
+void CollisionSpace::PrepareCollide()
 {
 	RebuildObjectTrees();
 
-	int mailboxMin = 0;
-	for (std::list<Geom*>::iterator i = m_geoms.begin(); i != m_geoms.end(); ++i) {
-		(*i)->SetMailboxIndex(mailboxMin++);
+	const int numGeoms = int(m_geoms.size());
+	for (int i = 0; i < numGeoms; i++) {
+		m_geoms[i]->SetMailboxIndex(i);
 	}
+}
+
+void CollisionSpace::CollectContacts(int first, int count, std::vector<CollisionContact> &contacts)
+{
+	assert(first >= 0 && first + count <= int(m_geoms.size()));
 
 	/* This mailbox nonsense is so: after collision(a,b), we will not
 	 * attempt collision(b,a) */
-	mailboxMin = 1;
-	for (std::list<Geom*>::iterator i = m_geoms.begin(); i != m_geoms.end(); ++i, mailboxMin++) {
-		CollideGeoms(*i, mailboxMin, callback);
+	std::vector<Geom*> candidates;
+	for (int i = first; i < first + count; i++) {
+		CollideGeom(m_geoms[i], i+1, candidates, contacts);
 	}
 }
+
+void CollisionSpace::Collide(void (*callback)(CollisionContact*))
+{
+	PrepareCollide();
+
+	std::vector<CollisionContact> contacts;
+	CollectContacts(0, int(m_geoms.size()), contacts);
+	for (std::vector<CollisionContact>::iterator i = contacts.begin(); i != contacts.end(); ++i)
+		callback(&*i);
+}
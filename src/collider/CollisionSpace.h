@@ -5,11 +5,12 @@
 #define _COLLISION_SPACE
 
 #include <list>
+#include <vector>
 #include "../vector3.h"
+#include "CollisionContact.h"
 
 class Geom;
 struct isect_t;
-struct CollisionContact;
 
 struct Sphere {
 	vector3d pos;
@@ -17,12 +18,23 @@ struct Sphere {
 	void *userData;
 };
 
+// dir should be unit length. ignore is a moving geom the ray can't hit
+struct CollisionRay {
+	vector3d start, dir;
+	double len;
+	Geom *ignore;
+};
+
 class BvhTree;
+class DynamicAabbTree;
 
 /*
  * Collision spaces have a bunch of geoms and at most one sphere (for a planet).
+ * Static geoms go in a tree that's rebuilt when they change. Moving geoms go
+ * in a tree that's updated as they move (see DynamicAabbTree).
  */
 class CollisionSpace {
+	friend class Geom;
 public:
 	CollisionSpace();
 	~CollisionSpace();
@@ -31,11 +43,27 @@ public:
 	void AddStaticGeom(Geom*);
 	void RemoveStaticGeom(Geom*);
 	void TraceRay(const vector3d &start, const vector3d &dir, double len, CollisionContact *c, Geom *ignore = 0);
+	// TraceRay for each ray, contacts[i] getting ray i's hit, but nearby
+	// rays share their walks of the trees
+	void TraceRays(int numRays, const CollisionRay *rays, CollisionContact *contacts);
+
+	// collision is split in two so the slow part can be spread over
+	// threads. PrepareCollide goes first, on one thread. then
+	// CollectContacts can be run for different ranges of geoms on
+	// different threads at once, as long as nothing in the space is added,
+	// removed or moved meanwhile. putting each range's contacts end to end
+	// in range order gives the same contacts, in the same order, however
+	// the geoms were split up
+	void PrepareCollide();
+	int GetNumGeoms() const { return int(m_geoms.size()); }
+	void CollectContacts(int first, int count, std::vector<CollisionContact> &contacts);
+	// both of the above on this thread, then callback for each contact
 	void Collide(void (*callback)(CollisionContact*));
 	void SetSphere(const vector3d &pos, double radius, void *user_data) {
 		sphere.pos = pos; sphere.radius = radius; sphere.userData = user_data;
 	}
 	void FlagRebuildObjectTrees() { m_needStaticGeomRebuild = true; }
+	// only the static tree needs rebuilding; the moving one is kept up to date
 	void RebuildObjectTrees();
 
 	// Geoms with the same handle will not be collision tested against each other
@@ -44,13 +72,18 @@ public:
 	// zero means ungrouped. assumes that wraparound => no old crap left
 	static int GetGroupHandle() { if(!s_nextHandle) s_nextHandle++; return s_nextHandle++; }
 private:
-	void CollideGeoms(Geom *a, int minMailboxValue, void (*callback)(CollisionContact*));
+	void CollideGeom(Geom *a, int minMailboxValue, std::vector<Geom*> &candidates, std::vector<CollisionContact> &contacts);
 	void CollideRaySphere(const vector3d &start, const vector3d &dir, isect_t *isect);
-	std::list<Geom*> m_geoms;
+	void TraceRaySphere(const vector3d &start, const vector3d &dir, double len, CollisionContact *c);
+	void TraceRayCandidates(const CollisionRay &ray, const std::vector<Geom*> &candidates, int numStatic, CollisionContact *c);
+	// called by Geom::MoveTo
+	void GeomMoved(Geom *geom, const vector3d &displacement);
+	// swap-and-pop, each geom knows its index
+	std::vector<Geom*> m_geoms;
 	std::list<Geom*> m_staticGeoms;
 	bool m_needStaticGeomRebuild;
 	BvhTree *m_staticObjectTree;
-	BvhTree *m_dynamicObjectTree;
+	DynamicAabbTree *m_dynamicObjectTree;
 	Sphere sphere;
 
 	static int s_nextHandle;
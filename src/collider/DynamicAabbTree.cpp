@@ -0,0 +1,277 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "DynamicAabbTree.h"
+#include <algorithm>
+
+// how much bigger than the geom a fat box is, as a fraction of the geom's
+// size plus a bit, in metres
+static const double FAT_MARGIN_SCALE = 0.1;
+static const double FAT_MARGIN_MIN = 1.0;
+// how many steps of the last movement the fat box allows for
+static const double FAT_DISPLACEMENT_STEPS = 2.0;
+
+static Aabb combine(const Aabb &a, const Aabb &b)
+{
+	Aabb c;
+	c.min = vector3d(std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z));
+	c.max = vector3d(std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z));
+	return c;
+}
+
+static bool contains(const Aabb &outer, const Aabb &inner)
+{
+	return (outer.min.x <= inner.min.x) && (outer.min.y <= inner.min.y) && (outer.min.z <= inner.min.z) &&
+		(inner.max.x <= outer.max.x) && (inner.max.y <= outer.max.y) && (inner.max.z <= outer.max.z);
+}
+
+// half the surface area, which is all the insert cost needs
+static double area(const Aabb &a)
+{
+	const vector3d d = a.max - a.min;
+	return d.x*d.y + d.y*d.z + d.z*d.x;
+}
+
+static Aabb fatten(const Aabb &aabb, const vector3d &displacement)
+{
+	const vector3d size = aabb.max - aabb.min;
+	const double margin = FAT_MARGIN_MIN + FAT_MARGIN_SCALE * std::max(size.x, std::max(size.y, size.z));
+	Aabb fat;
+	fat.min = aabb.min - vector3d(margin);
+	fat.max = aabb.max + vector3d(margin);
+
+	const vector3d d = displacement * FAT_DISPLACEMENT_STEPS;
+	if (d.x < 0) fat.min.x += d.x; else fat.max.x += d.x;
+	if (d.y < 0) fat.min.y += d.y; else fat.max.y += d.y;
+	if (d.z < 0) fat.min.z += d.z; else fat.max.z += d.z;
+	return fat;
+}
+
+DynamicAabbTree::DynamicAabbTree() :
+	m_root(NULL_NODE),
+	m_freeList(NULL_NODE)
+{
+}
+
+int DynamicAabbTree::AllocNode()
+{
+	if (m_freeList == NULL_NODE) {
+		m_nodes.push_back(Node());
+		m_freeList = int(m_nodes.size()) - 1;
+		m_nodes.back().parent = NULL_NODE;
+	}
+	const int node = m_freeList;
+	Node &n = m_nodes[node];
+	m_freeList = n.parent;
+	n.parent = NULL_NODE;
+	n.kids[0] = n.kids[1] = NULL_NODE;
+	n.height = 0;
+	n.geom = 0;
+	return node;
+}
+
+void DynamicAabbTree::FreeNode(int node)
+{
+	m_nodes[node].parent = m_freeList;
+	m_nodes[node].height = -1;
+	m_freeList = node;
+}
+
+int DynamicAabbTree::Insert(Geom *geom, const Aabb &aabb)
+{
+	const int leaf = AllocNode();
+	m_nodes[leaf].aabb = fatten(aabb, vector3d(0.0));
+	m_nodes[leaf].geom = geom;
+	InsertLeaf(leaf);
+	return leaf;
+}
+
+void DynamicAabbTree::Remove(int proxy)
+{
+	assert(m_nodes[proxy].IsLeaf());
+	RemoveLeaf(proxy);
+	FreeNode(proxy);
+}
+
+bool DynamicAabbTree::Move(int proxy, const Aabb &aabb, const vector3d &displacement)
+{
+	assert(m_nodes[proxy].IsLeaf());
+	if (contains(m_nodes[proxy].aabb, aabb))
+		return false;
+
+	RemoveLeaf(proxy);
+	m_nodes[proxy].aabb = fatten(aabb, displacement);
+	InsertLeaf(proxy);
+	return true;
+}
+
+bool DynamicAabbTree::RayHitsAabb(const Aabb &aabb, const vector3d &start, const vector3d &invDir, double maxDist)
+{
+	double l1 = (aabb.min.x - start.x) * invDir.x;
+	double l2 = (aabb.max.x - start.x) * invDir.x;
+	double lmin = std::min(l1,l2);
+	double lmax = std::max(l1,l2);
+
+	l1 = (aabb.min.y - start.y) * invDir.y;
+	l2 = (aabb.max.y - start.y) * invDir.y;
+	lmin = std::max(std::min(l1,l2), lmin);
+	lmax = std::min(std::max(l1,l2), lmax);
+
+	l1 = (aabb.min.z - start.z) * invDir.z;
+	l2 = (aabb.max.z - start.z) * invDir.z;
+	lmin = std::max(std::min(l1,l2), lmin);
+	lmax = std::min(std::max(l1,l2), lmax);
+
+	return (lmax >= 0.0) && (lmax >= lmin) && (lmin < maxDist);
+}
+
+void DynamicAabbTree::InsertLeaf(int leaf)
+{
+	if (m_root == NULL_NODE) {
+		m_root = leaf;
+		m_nodes[leaf].parent = NULL_NODE;
+		return;
+	}
+
+	// walk down to the sibling that makes for the smallest total area
+	const Aabb leafAabb = m_nodes[leaf].aabb;
+	int index = m_root;
+	while (!m_nodes[index].IsLeaf()) {
+		const Node &node = m_nodes[index];
+		const double nodeArea = area(node.aabb);
+		const double combinedArea = area(combine(node.aabb, leafAabb));
+
+		// cost of a new parent for this node and the leaf
+		const double cost = 2.0 * combinedArea;
+		// cost pushed down to every level below if we go further
+		const double inheritance = 2.0 * (combinedArea - nodeArea);
+
+		double kidCost[2];
+		for (int i = 0; i < 2; i++) {
+			const Node &kid = m_nodes[node.kids[i]];
+			const double grown = area(combine(kid.aabb, leafAabb));
+			kidCost[i] = (kid.IsLeaf() ? grown : grown - area(kid.aabb)) + inheritance;
+		}
+
+		if (cost < kidCost[0] && cost < kidCost[1])
+			break;
+		index = kidCost[0] < kidCost[1] ? node.kids[0] : node.kids[1];
+	}
+	const int sibling = index;
+
+	// new parent for the sibling and the leaf
+	const int oldParent = m_nodes[sibling].parent;
+	const int newParent = AllocNode();
+	Node &p = m_nodes[newParent];
+	p.parent = oldParent;
+	p.aabb = combine(leafAabb, m_nodes[sibling].aabb);
+	p.height = m_nodes[sibling].height + 1;
+	p.kids[0] = sibling;
+	p.kids[1] = leaf;
+	m_nodes[sibling].parent = newParent;
+	m_nodes[leaf].parent = newParent;
+
+	if (oldParent == NULL_NODE) {
+		m_root = newParent;
+	} else {
+		Node &op = m_nodes[oldParent];
+		op.kids[op.kids[0] == sibling ? 0 : 1] = newParent;
+	}
+
+	Refit(m_nodes[leaf].parent);
+}
+
+void DynamicAabbTree::RemoveLeaf(int leaf)
+{
+	if (leaf == m_root) {
+		m_root = NULL_NODE;
+		return;
+	}
+
+	// the sibling takes the parent's place
+	const int parent = m_nodes[leaf].parent;
+	const int grandParent = m_nodes[parent].parent;
+	const int sibling = m_nodes[parent].kids[m_nodes[parent].kids[0] == leaf ? 1 : 0];
+
+	if (grandParent == NULL_NODE) {
+		m_root = sibling;
+		m_nodes[sibling].parent = NULL_NODE;
+		FreeNode(parent);
+	} else {
+		Node &gp = m_nodes[grandParent];
+		gp.kids[gp.kids[0] == parent ? 0 : 1] = sibling;
+		m_nodes[sibling].parent = grandParent;
+		FreeNode(parent);
+		Refit(grandParent);
+	}
+	m_nodes[leaf].parent = NULL_NODE;
+}
+
+// balance, then recompute boxes and heights from node up to the root
+void DynamicAabbTree::Refit(int index)
+{
+	while (index != NULL_NODE) {
+		index = Balance(index);
+
+		Node &node = m_nodes[index];
+		const Node &a = m_nodes[node.kids[0]];
+		const Node &b = m_nodes[node.kids[1]];
+		node.height = 1 + std::max(a.height, b.height);
+		node.aabb = combine(a.aabb, b.aabb);
+
+		index = node.parent;
+	}
+}
+
+// if one side of a is more than one level taller than the other, rotate it
+// up to take a's place. returns whichever node is now at a's old position
+int DynamicAabbTree::Balance(int iA)
+{
+	Node &A = m_nodes[iA];
+	if (A.IsLeaf() || A.height < 2)
+		return iA;
+
+	const int balance = m_nodes[A.kids[1]].height - m_nodes[A.kids[0]].height;
+	if (balance >= -1 && balance <= 1)
+		return iA;
+
+	// the taller kid (up) goes up, the shorter (down) stays under a
+	const int upIndex = balance > 1 ? 1 : 0;
+	const int iUp = A.kids[upIndex];
+	const int iDown = A.kids[1-upIndex];
+	Node &up = m_nodes[iUp];
+	Node &down = m_nodes[iDown];
+
+	const int iF = up.kids[0];
+	const int iG = up.kids[1];
+
+	// swap a and up
+	up.kids[0] = iA;
+	up.parent = A.parent;
+	A.parent = iUp;
+
+	if (up.parent == NULL_NODE) {
+		m_root = iUp;
+	} else {
+		Node &p = m_nodes[up.parent];
+		p.kids[p.kids[0] == iA ? 0 : 1] = iUp;
+	}
+
+	// up keeps its taller kid, a takes the other one in up's place
+	const bool keepF = m_nodes[iF].height > m_nodes[iG].height;
+	const int iKeep = keepF ? iF : iG;
+	const int iGive = keepF ? iG : iF;
+	Node &keep = m_nodes[iKeep];
+	Node &give = m_nodes[iGive];
+
+	up.kids[1] = iKeep;
+	A.kids[upIndex] = iGive;
+	give.parent = iA;
+
+	A.aabb = combine(down.aabb, give.aabb);
+	A.height = 1 + std::max(down.height, give.height);
+	up.aabb = combine(A.aabb, keep.aabb);
+	up.height = 1 + std::max(A.height, keep.height);
+
+	return iUp;
+}
@@ -0,0 +1,115 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _DYNAMICAABBTREE_H
+#define _DYNAMICAABBTREE_H
+
+#include <assert.h>
+#include <vector>
+#include "../vector3.h"
+#include "../Aabb.h"
+
+class Geom;
+
+/*
+ * Bounding volume tree of moving geoms, kept up to date as they move rather
+ * than rebuilt. Each leaf holds a "fat" box a bit bigger than its geom, so a
+ * geom can move a little without touching the tree; only when it leaves its
+ * fat box is it taken out and put back in. Inserts pick the cheapest place
+ * by surface area and rotations keep the tree balanced.
+ *
+ * Nodes live in one array and are referred to by index, so a geom's leaf
+ * (its "proxy") stays valid until it's removed.
+ */
+class DynamicAabbTree {
+public:
+	static const int NULL_NODE = -1;
+
+	DynamicAabbTree();
+
+	// returns the new leaf's proxy
+	int Insert(Geom *geom, const Aabb &aabb);
+	void Remove(int proxy);
+	// displacement is how far the geom just moved; the new fat box is
+	// stretched that way so a steady mover isn't reinserted every step.
+	// returns true if the leaf had to be reinserted
+	bool Move(int proxy, const Aabb &aabb, const vector3d &displacement);
+
+	const Aabb &GetFatAabb(int proxy) const { return m_nodes[proxy].aabb; }
+
+	// whether a ray hits aabb closer than maxDist
+	static bool RayHitsAabb(const Aabb &aabb, const vector3d &start, const vector3d &invDir, double maxDist);
+	int GetHeight() const { return m_root == NULL_NODE ? 0 : m_nodes[m_root].height; }
+
+	// calls callback(Geom*) for each leaf whose fat box overlaps aabb
+	template <typename T>
+	void Query(const Aabb &aabb, T &callback) const {
+		if (m_root == NULL_NODE) return;
+		int stack[MAX_STACK];
+		int stackPos = 0;
+		stack[stackPos++] = m_root;
+		while (stackPos > 0) {
+			const Node &node = m_nodes[stack[--stackPos]];
+			if (!node.aabb.Intersects(aabb)) continue;
+			if (node.IsLeaf()) {
+				callback(node.geom);
+			} else {
+				assert(stackPos+2 <= MAX_STACK);
+				stack[stackPos++] = node.kids[0];
+				stack[stackPos++] = node.kids[1];
+			}
+		}
+	}
+
+	// calls callback(Geom*) for each leaf whose fat box the ray hits
+	// closer than the distance callback returns, starting with maxDist.
+	// callback returns the new closest distance
+	template <typename T>
+	void RayCast(const vector3d &start, const vector3d &invDir, double maxDist, T &callback) const {
+		if (m_root == NULL_NODE) return;
+		int stack[MAX_STACK];
+		int stackPos = 0;
+		stack[stackPos++] = m_root;
+		while (stackPos > 0) {
+			const Node &node = m_nodes[stack[--stackPos]];
+			if (!RayHitsAabb(node.aabb, start, invDir, maxDist)) continue;
+			if (node.IsLeaf()) {
+				maxDist = callback(node.geom);
+			} else {
+				assert(stackPos+2 <= MAX_STACK);
+				stack[stackPos++] = node.kids[0];
+				stack[stackPos++] = node.kids[1];
+			}
+		}
+	}
+
+private:
+	// the tree is balanced, so this is good for far more geoms than
+	// will ever share a frame
+	enum { MAX_STACK = 128 };
+
+	struct Node {
+		Aabb aabb;
+		// next free node, for nodes on the free list
+		int parent;
+		int kids[2];
+		// leaves are 0, free nodes -1
+		int height;
+		Geom *geom;
+
+		bool IsLeaf() const { return kids[0] == NULL_NODE; }
+	};
+
+	int AllocNode();
+	void FreeNode(int node);
+	void InsertLeaf(int leaf);
+	void RemoveLeaf(int leaf);
+	int Balance(int node);
+	void Refit(int node);
+
+	std::vector<Node> m_nodes;
+	int m_root;
+	int m_freeList;
+};
+
+#endif /* _DYNAMICAABBTREE_H */
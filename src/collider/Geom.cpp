@@ -6,6 +6,7 @@
 #include "GeomTree.h"
 #include "collider.h"
 #include "BVHTree.h"
+#include "CollisionSpace.h"
 
 Geom::Geom(const GeomTree *geomtree)
 {
@@ -16,6 +17,14 @@ Geom::Geom(const GeomTree *geomtree)
 	m_data = 0;
 	m_mailboxIndex = 0;
 	m_group = 0;
+	m_space = 0;
+	m_spaceIndex = -1;
+	m_spaceProxy = -1;
+}
+
+Geom::~Geom()
+{
+	if (m_space) m_space->RemoveGeom(this);
 }
 
 matrix4x4d Geom::GetRotation() const
@@ -27,17 +36,21 @@ matrix4x4d Geom::GetRotation() const
 
 void Geom::MoveTo(const matrix4x4d &m)
 {
+	const vector3d oldPos = GetPosition();
 	m_orient = m;
 	m_invOrient = m.InverseOf();
+	if (m_space) m_space->GeomMoved(this, GetPosition() - oldPos);
 }
 
 void Geom::MoveTo(const matrix4x4d &m, const vector3d &pos)
 {
+	const vector3d oldPos = GetPosition();
 	m_orient = m;
 	m_orient[12] = pos.x;
 	m_orient[13] = pos.y;
 	m_orient[14] = pos.z;
 	m_invOrient = m_orient.InverseOf();
+	if (m_space) m_space->GeomMoved(this, pos - oldPos);
 }
 
 vector3d Geom::GetPosition() const
@@ -47,7 +60,7 @@ vector3d Geom::GetPosition() const
 		m_orient[14]);
 }
 
-void Geom::CollideSphere(Sphere &sphere, void (*callback)(CollisionContact*))
+void Geom::CollideSphere(Sphere &sphere, std::vector<CollisionContact> &contacts)
 {
 	/* if the geom is actually within the sphere, create a contact so
 	 * that we can't fall into spheres forever and ever */
@@ -62,7 +75,7 @@ void Geom::CollideSphere(Sphere &sphere, void (*callback)(CollisionContact*))
 		contact.userData1 = this->m_data;
 		contact.userData2 = sphere.userData;
 		contact.geomFlag = 0;
-		callback(&contact);
+		contacts.push_back(contact);
 		return;
 	}
 }
@@ -73,19 +86,19 @@ void Geom::CollideSphere(Sphere &sphere, void (*callback)(CollisionContact*))
  * This geom has moved, causing a possible collision with geom b.
  * Collide meshes to see.
  */
-void Geom::Collide(Geom *b, void (*callback)(CollisionContact*))
+void Geom::Collide(Geom *b, std::vector<CollisionContact> &contacts)
 {
 	int max_contacts = MAX_CONTACTS;
 	matrix4x4d transTo;
 	//unsigned int t = SDL_GetTicks();
 	/* Collide this geom's edges against tri-mesh of geom b */
 	transTo = b->m_invOrient * m_orient;
-	this->CollideEdgesWithTrisOf(max_contacts, b, transTo, callback);
+	this->CollideEdgesWithTrisOf(max_contacts, b, transTo, contacts);
 
 	/* Collide b's edges against this geom's tri-mesh */
 	if (max_contacts > 0) {
 		transTo = m_invOrient * b->m_orient;
-		b->CollideEdgesWithTrisOf(max_contacts, this, transTo, callback);
+		b->CollideEdgesWithTrisOf(max_contacts, this, transTo, contacts);
 	}
 
 //	t = SDL_GetTicks() - t;
@@ -114,7 +127,7 @@ static bool rotatedAabbIsectsNormalOne(Aabb &a, const matrix4x4d &transA, Aabb &
  * Intersect this Geom's edge BVH tree with geom b's triangle BVH tree.
  * Generate collision contacts.
  */
-void Geom::CollideEdgesWithTrisOf(int &maxContacts, Geom *b, const matrix4x4d &transTo, void (*callback)(CollisionContact*))
+void Geom::CollideEdgesWithTrisOf(int &maxContacts, Geom *b, const matrix4x4d &transTo, std::vector<CollisionContact> &contacts)
 {
 	struct stackobj {
 		BVHNode *edgeNode;
@@ -135,7 +148,7 @@ void Geom::CollideEdgesWithTrisOf(int &maxContacts, Geom *b, const matrix4x4d &t
 		if (triNode->triIndicesStart || edgeNode->triIndicesStart) {
 			// reached triangle leaf node or edge leaf node.
 			// Intersect all edges under edgeNode with this leaf
-			CollideEdgesTris(maxContacts, edgeNode, transTo, b, triNode, callback);
+			CollideEdgesTris(maxContacts, edgeNode, transTo, b, triNode, contacts);
 		} else {
 			BVHNode *left = triNode->kids[0];
 			BVHNode *right = triNode->kids[1];
@@ -175,7 +188,7 @@ void Geom::CollideEdgesWithTrisOf(int &maxContacts, Geom *b, const matrix4x4d &t
  * BVH of another geom (b), starting from btriNode.
  */
 void Geom::CollideEdgesTris(int &maxContacts, const BVHNode *edgeNode, const matrix4x4d &transToB,
-		Geom *b, const BVHNode *btriNode, void (*callback)(CollisionContact*))
+		Geom *b, const BVHNode *btriNode, std::vector<CollisionContact> &contacts)
 {
 	if (maxContacts <= 0) return;
 	if (edgeNode->triIndicesStart) {
@@ -217,12 +230,12 @@ void Geom::CollideEdgesTris(int &maxContacts, const BVHNode *edgeNode, const mat
 			// contact geomFlag is bitwise OR of triangle's and edge's flags
 			contact.geomFlag = b->m_geomtree->GetTriFlag(isect.triIdx) |
 				edges[ edgeNode->triIndicesStart[i] ].triFlag;
-			callback(&contact);
+			contacts.push_back(contact);
 			if (--maxContacts <= 0) return;
 		}
 	} else {
-		CollideEdgesTris(maxContacts, edgeNode->kids[0], transToB, b, btriNode, callback);
-		CollideEdgesTris(maxContacts, edgeNode->kids[1], transToB, b, btriNode, callback);
+		CollideEdgesTris(maxContacts, edgeNode->kids[0], transToB, b, btriNode, contacts);
+		CollideEdgesTris(maxContacts, edgeNode->kids[1], transToB, b, btriNode, contacts);
 	}
 }
 
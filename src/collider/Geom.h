@@ -7,15 +7,19 @@
 #include "../matrix4x4.h"
 #include "../vector3.h"
 #include "CollisionContact.h"
+#include <vector>
 
 class GeomTree;
 struct isect_t;
 struct Sphere;
 struct BVHNode;
+class CollisionSpace;
 
 class Geom {
+	friend class CollisionSpace;
 public:
 	Geom(const GeomTree *);
+	~Geom();
 	void MoveTo(const matrix4x4d &m);
 	void MoveTo(const matrix4x4d &m, const vector3d &pos);
 	const matrix4x4d &GetInvTransform() const { return m_invOrient; }
@@ -26,8 +30,8 @@ public:
 	void Disable() { m_active = false; }
 	bool IsEnabled() { return m_active; }
 	const GeomTree *GetGeomTree() { return m_geomtree; }
-	void Collide(Geom *b, void (*callback)(CollisionContact*));
-	void CollideSphere(Sphere &sphere, void (*callback)(CollisionContact*));
+	void Collide(Geom *b, std::vector<CollisionContact> &contacts);
+	void CollideSphere(Sphere &sphere, std::vector<CollisionContact> &contacts);
 	void SetUserData(void *d) { m_data = d; }
 	void *GetUserData() { return m_data; }
 	void SetMailboxIndex(int idx) { m_mailboxIndex = idx; }
@@ -35,17 +39,23 @@ public:
 	void SetGroup(int g) { m_group = g; }
 	int GetGroup() const { return m_group; }
 private:
-	void CollideEdgesWithTrisOf(int &maxContacts, Geom *b, const matrix4x4d &transTo, void (*callback)(CollisionContact*));
+	void CollideEdgesWithTrisOf(int &maxContacts, Geom *b, const matrix4x4d &transTo, std::vector<CollisionContact> &contacts);
 	void CollideEdgesTris(int &maxContacts, const BVHNode *edgeNode, const matrix4x4d &transToB,
-		Geom *b, const BVHNode *btriNode, void (*callback)(CollisionContact*));
+		Geom *b, const BVHNode *btriNode, std::vector<CollisionContact> &contacts);
 	int m_mailboxIndex; // used to avoid duplicate collisions
-	void CollideEdges(const matrix4x4d &transToB, Geom *b, void (*callback)(CollisionContact*));
+	void CollideEdges(const matrix4x4d &transToB, Geom *b, std::vector<CollisionContact> &contacts);
 	// double-buffer position so we can keep previous position
 	matrix4x4d m_orient, m_invOrient;
 	bool m_active;
 	const GeomTree *m_geomtree;
 	void *m_data;
 	int m_group;
+	// the space this geom moves in, if any; it's told about every move.
+	// static geoms don't have one
+	CollisionSpace *m_space;
+	// where the geom is in the space's list, and its leaf in the space's tree
+	int m_spaceIndex;
+	int m_spaceProxy;
 };
 
 #endif /* _GEOM_H */
@@ -4,22 +4,130 @@
 #include "../libs.h"
 #include "GeomTree.h"
 #include "BVHTree.h"
-#include <map>
-
-int GeomTree::stats_rayTriIntersections;
-
+#include "WideBVHTree.h"
+#include <algorithm>
 
 GeomTree::~GeomTree()
 {
 	delete [] m_edges;
+	delete m_wideTriTree;
 	delete m_triTree;
 	delete m_edgeTree;
 }
 
-#include <SDL.h>
+static inline Uint32 float_bits(float f)
+{
+	// -0 and 0 compare equal, so they have to hash the same
+	if (is_zero_exact(f)) return 0;
+	Uint32 bits;
+	memcpy(&bits, &f, sizeof(bits));
+	return bits;
+}
+
+static inline Uint32 hash_ints(Uint32 a, Uint32 b, Uint32 c)
+{
+	Uint32 h = a * 0x9e3779b1u;
+	h = (h ^ (h >> 15)) + b * 0x85ebca77u;
+	h = (h ^ (h >> 13)) + c * 0xc2b2ae3du;
+	return h ^ (h >> 16);
+}
+
+// open addressed hash table size for n entries, a power of two
+static inline Uint32 table_size(int n)
+{
+	Uint32 size = 16;
+	while (size < Uint32(n) * 2) size <<= 1;
+	return size;
+}
+
+// points every index of a collidable tri at the first vertex with exactly
+// the same position
+static void weld_vertices(int numVerts, const float *vertices, int numTris, int *indices, const unsigned int *triflags)
+{
+	std::vector<int> remap(numVerts);
+	const Uint32 mask = table_size(numVerts) - 1;
+	std::vector<int> table(mask + 1, -1);
+
+	for (int i=0; i<numVerts; i++) {
+		remap[i] = i;
+		const float *v = &vertices[3*i];
+		// NaN never equals anything, not even itself
+		if (is_nan(v[0]) || is_nan(v[1]) || is_nan(v[2])) continue;
+
+		Uint32 slot = hash_ints(float_bits(v[0]), float_bits(v[1]), float_bits(v[2])) & mask;
+		for (;;) {
+			const int j = table[slot];
+			if (j < 0) {
+				table[slot] = i;
+				break;
+			}
+			const float *v2 = &vertices[3*j];
+			if (is_equal_exact(v2[0], v[0]) && is_equal_exact(v2[1], v[1]) && is_equal_exact(v2[2], v[2])) {
+				remap[i] = j;
+				break;
+			}
+			slot = (slot + 1) & mask;
+		}
+	}
+
+	for (int k=0; k<numTris*3; k++) {
+		if (triflags[k/3] < 0x8000) indices[k] = remap[indices[k]];
+	}
+}
+
+namespace {
+	struct EdgeKey {
+		int v1, v2;
+		int triflag;
+		bool operator<(const EdgeKey &o) const { return v1 < o.v1 || (v1 == o.v1 && v2 < o.v2); }
+	};
+
+	// each edge once, lowest vertex first, in vertex order. where tris share
+	// an edge the last one's flag wins
+	class EdgeSet {
+	public:
+		EdgeSet(int maxEdges) : m_mask(table_size(maxEdges) - 1), m_table(m_mask + 1, -1) {
+			m_edges.reserve(maxEdges);
+		}
+
+		void Add(int i1, int i2, int triflag) {
+			if (i1 == i2) return;
+			EdgeKey key;
+			key.v1 = std::min(i1, i2);
+			key.v2 = std::max(i1, i2);
+			key.triflag = triflag;
+
+			Uint32 slot = hash_ints(Uint32(key.v1), Uint32(key.v2), 0) & m_mask;
+			for (;;) {
+				const int e = m_table[slot];
+				if (e < 0) {
+					m_table[slot] = int(m_edges.size());
+					m_edges.push_back(key);
+					return;
+				}
+				if (m_edges[e].v1 == key.v1 && m_edges[e].v2 == key.v2) {
+					m_edges[e].triflag = triflag;
+					return;
+				}
+				slot = (slot + 1) & m_mask;
+			}
+		}
+
+		std::vector<EdgeKey> &GetSortedEdges() {
+			std::sort(m_edges.begin(), m_edges.end());
+			return m_edges;
+		}
+
+	private:
+		Uint32 m_mask;
+		std::vector<int> m_table;
+		std::vector<EdgeKey> m_edges;
+	};
+}
 
 GeomTree::GeomTree(int numVerts, int numTris, float *vertices, int *indices, unsigned int *triflags): m_numVertices(numVerts)
 {
+	m_numTris = numTris;
 	m_vertices = vertices;
 	m_indices = indices;
 	m_triFlags = triflags;
@@ -34,25 +142,11 @@ GeomTree::GeomTree(int numVerts, int numTris, float *vertices, int *indices, uns
 		activeTris.push_back(i*3);
 	}
 
-	std::map< std::pair<int,int>, int > edges;
-#define ADD_EDGE(_i1,_i2,_triflag) \
-	if ((_i1) < (_i2)) edges[std::pair<int,int>(_i1,_i2)] = _triflag; \
-	else if ((_i1) > (_i2)) edges[std::pair<int,int>(_i2,_i1)] = _triflag;
-
 	// eliminate duplicate vertices
-	for (int i=0; i<numVerts; i++) {
-		vector3d v = vector3d(&m_vertices[3*i]);
-		for (int j=i+1; j<numVerts; j++) {
-			vector3d v2 = vector3d(&m_vertices[3*j]);
-			if (v2.ExactlyEqual(v)) {
-				for (int k=0; k<numTris*3; k++) {
-					if ((indices[k] == j) && (triflags[k/3] < 0x8000)) indices[k] = i;
-				}
-			}
-		}
-	}
+	weld_vertices(numVerts, vertices, numTris, indices, triflags);
 
 	/* Get radius, m_aabb, and merge duplicate edges */
+	EdgeSet edges(int(activeTris.size()) * 3);
 	m_radius = 0;
 	for (int i=0; i<numTris; i++) {
 		const int triflag = m_triFlags[i];
@@ -61,9 +155,9 @@ GeomTree::GeomTree(int numVerts, int numTris, float *vertices, int *indices, uns
 			int vi2 = 3*m_indices[3*i+1];
 			int vi3 = 3*m_indices[3*i+2];
 
-			ADD_EDGE(vi1, vi2, triflag);
-			ADD_EDGE(vi1, vi3, triflag);
-			ADD_EDGE(vi2, vi3, triflag);
+			edges.Add(vi1, vi2, triflag);
+			edges.Add(vi1, vi3, triflag);
+			edges.Add(vi2, vi3, triflag);
 
 			vector3d v[3];
 			v[0] = vector3d(&m_vertices[vi1]);
@@ -93,29 +187,28 @@ GeomTree::GeomTree(int numVerts, int numTris, float *vertices, int *indices, uns
 	//int t = SDL_GetTicks();
 	m_triTree = new BVHTree(activeTris.size(), &activeTris[0], aabbs);
 	delete [] aabbs;
+	m_wideTriTree = new WideBVHTree(m_triTree, m_vertices, m_indices);
 	//printf("Tri tree of %d tris build in %dms\n", activeTris.size(), SDL_GetTicks() - t);
 
-	m_numEdges = edges.size();
+	const std::vector<EdgeKey> &sortedEdges = edges.GetSortedEdges();
+	m_numEdges = sortedEdges.size();
 	m_edges = new Edge[m_numEdges];
 	// to build Edge bvh tree with.
 	aabbs = new Aabb[m_numEdges];
 	int *edgeIdxs = new int[m_numEdges];
 
-	int pos = 0;
-	for (std::map< std::pair<int,int>, int >::iterator i = edges.begin();
-			i != edges.end(); ++i, pos++) {
+	for (int pos = 0; pos < m_numEdges; pos++) {
 		// precalc some jizz
-		const std::pair<int, int> &vtx = (*i).first;
-		const int triflag = (*i).second;
-		vector3d v1 = vector3d(&m_vertices[vtx.first]);
-		vector3d v2 = vector3d(&m_vertices[vtx.second]);
+		const EdgeKey &e = sortedEdges[pos];
+		vector3d v1 = vector3d(&m_vertices[e.v1]);
+		vector3d v2 = vector3d(&m_vertices[e.v2]);
 		vector3d dir = (v2-v1);
 		double len = dir.Length();
 		dir *= 1.0/len;
 
-		m_edges[pos].v1i = vtx.first;
-		m_edges[pos].v2i = vtx.second;
-		m_edges[pos].triFlag = triflag;
+		m_edges[pos].v1i = e.v1;
+		m_edges[pos].v2i = e.v2;
+		m_edges[pos].triFlag = e.triflag;
 		m_edges[pos].len = float(len);
 		m_edges[pos].dir = vector3f(float(dir.x), float(dir.y), float(dir.z));
 
@@ -130,133 +223,214 @@ GeomTree::GeomTree(int numVerts, int numTris, float *vertices, int *indices, uns
 	//printf("Edge tree of %d edges build in %dms\n", m_numEdges, SDL_GetTicks() - t);
 }
 
-static bool SlabsRayAabbTest(const BVHNode *n, const vector3f &start, const vector3f &invDir, isect_t *isect)
+// for Load, which fills in the rest
+GeomTree::GeomTree(int numVerts, float *vertices, int *indices, unsigned int *triflags) :
+	m_numVertices(numVerts),
+	m_vertices(vertices),
+	m_triTree(0),
+	m_edgeTree(0),
+	m_wideTriTree(0),
+	m_numTris(0),
+	m_radius(0),
+	m_numEdges(0),
+	m_edges(0),
+	m_indices(indices),
+	m_triFlags(triflags)
 {
-	float
-	l1      = (n->aabb.min.x - start.x) * invDir.x,
-	l2      = (n->aabb.max.x - start.x) * invDir.x,
-	lmin    = std::min(l1,l2),
-	lmax    = std::max(l1,l2);
-
-	l1      = (n->aabb.min.y - start.y) * invDir.y;
-	l2      = (n->aabb.max.y - start.y) * invDir.y;
-	lmin    = std::max(std::min(l1,l2), lmin);
-	lmax    = std::min(std::max(l1,l2), lmax);
-
-	l1      = (n->aabb.min.z - start.z) * invDir.z;
-	l2      = (n->aabb.max.z - start.z) * invDir.z;
-	lmin    = std::max(std::min(l1,l2), lmin);
-	lmax    = std::min(std::max(l1,l2), lmax);
-
-	return ((lmax >= 0.f) & (lmax >= lmin) & (lmin < isect->dist));
 }
 
-void GeomTree::TraceRay(const vector3f &start, const vector3f &dir, isect_t *isect) const
-{
-	TraceRay(m_triTree->GetRoot(), start, dir, isect);
+static const char GEOMTREE_MAGIC[4] = { 'P', 'G', 'T', 'R' };
+static const Uint32 GEOMTREE_VERSION = 1;
+// the ray walks' stacks are sized for the trees BVHTree builds, which
+// don't come near this
+static const int MAX_LOADED_BVH_DEPTH = 32;
+
+namespace {
+	template <typename T>
+	void put(std::vector<char> &out, const T &v)
+	{
+		const char *p = reinterpret_cast<const char*>(&v);
+		out.insert(out.end(), p, p + sizeof(T));
+	}
+
+	void put_aabb(std::vector<char> &out, const Aabb &aabb)
+	{
+		put(out, aabb.min.x); put(out, aabb.min.y); put(out, aabb.min.z);
+		put(out, aabb.max.x); put(out, aabb.max.y); put(out, aabb.max.z);
+		put(out, aabb.radius);
+	}
+
 }
 
-void GeomTree::TraceRay(const BVHNode *currnode, const vector3f &a_origin, const vector3f &a_dir, isect_t *isect) const
-{
-	BVHNode *stack[32];
-	int stackpos = -1;
-	vector3f invDir(1.0f/a_dir.x, 1.0f/a_dir.y, 1.0f/a_dir.z);
+class GeomTree::BlobReader {
+public:
+	BlobReader(const char *data, size_t size) : m_pos(data), m_end(data + size), m_ok(true) {}
 
-	for (;;) {
-		while (!currnode->IsLeaf()) {
-			if (!SlabsRayAabbTest(currnode, a_origin, invDir, isect)) goto pop_bstack;
+	bool Ok() const { return m_ok; }
+	bool AtEnd() const { return m_pos == m_end; }
 
-			stackpos++;
-			stack[stackpos] = currnode->kids[1];
-			currnode = currnode->kids[0];
+	template <typename T>
+	T Get() {
+		T v = T();
+		if (!m_ok || size_t(m_end - m_pos) < sizeof(T)) {
+			m_ok = false;
+			return v;
 		}
-		// triangle intersection jizz
-		for (int i=0; i<currnode->numTris; i++) {
-			RayTriIntersect(1, a_origin, &a_dir, currnode->triIndicesStart[i], isect);
-		}
-pop_bstack:
-		if (stackpos < 0) break;
-		currnode = stack[stackpos];
-		stackpos--;
+		memcpy(&v, m_pos, sizeof(T));
+		m_pos += sizeof(T);
+		return v;
+	}
+
+	void GetAabb(Aabb &aabb) {
+		aabb.min.x = Get<double>(); aabb.min.y = Get<double>(); aabb.min.z = Get<double>();
+		aabb.max.x = Get<double>(); aabb.max.y = Get<double>(); aabb.max.z = Get<double>();
+		aabb.radius = Get<double>();
+	}
+
+	// count things of elemSize bytes each, unless that's more than is left
+	bool HasRoomFor(Uint32 count, size_t elemSize) {
+		if (m_ok && Uint64(count) * elemSize > Uint64(m_end - m_pos)) m_ok = false;
+		return m_ok;
 	}
-}
 
-struct bvhstack {
-	BVHNode *node;
-	int activeRay;
+private:
+	const char *m_pos, *m_end;
+	bool m_ok;
 };
 
-/*
- * Bundle of rays with common origin
- */
-void GeomTree::TraceCoherentRays(int numRays, const vector3f &a_origin, const vector3f *a_dirs, isect_t *isects) const
+// nodes are written with indices in place of pointers: triStart into the
+// object array or -1 for internal nodes, kids into the node array or -1
+void GeomTree::SaveBVH(std::vector<char> &out, const BVHTree &tree)
 {
-	TraceCoherentRays(m_triTree->GetRoot(), numRays, a_origin, a_dirs, isects);
+	put(out, Uint32(tree.m_nodeAllocPos));
+	put(out, Uint32(tree.m_objPtrAllocPos));
+	for (size_t i = 0; i < tree.m_objPtrAllocPos; i++)
+		put(out, Sint32(tree.m_objPtrAlloc[i]));
+	for (size_t i = 0; i < tree.m_nodeAllocPos; i++) {
+		const BVHNode &n = tree.m_bvhNodes[i];
+		put_aabb(out, n.aabb);
+		put(out, Sint32(n.numTris));
+		if (n.IsLeaf()) {
+			put(out, Sint32(n.triIndicesStart - tree.m_objPtrAlloc));
+			put(out, Sint32(-1));
+			put(out, Sint32(-1));
+		} else {
+			put(out, Sint32(-1));
+			put(out, Sint32(n.kids[0] - tree.m_bvhNodes));
+			put(out, Sint32(n.kids[1] - tree.m_bvhNodes));
+		}
+	}
 }
 
-void GeomTree::TraceCoherentRays(const BVHNode *currnode, int numRays, const vector3f &a_origin, const vector3f *a_dirs, isect_t *isects) const
+BVHTree *GeomTree::LoadBVH(BlobReader &in, Uint32 maxObjPtr)
 {
-	bvhstack stack[32];
-	int stackpos = -1;
-	vector3f *invDirs = reinterpret_cast<vector3f*>(alloca(sizeof(vector3f)*numRays));
-	for (int i=0; i<numRays; i++) {
-		invDirs[i] = vector3f(1.0f/a_dirs[i].x, 1.0f/a_dirs[i].y, 1.0f/a_dirs[i].z);
-	}
-	int activeRay = numRays - 1;
-
-	for (;;) {
-		while (!currnode->IsLeaf()) {
-			do {
-				if (SlabsRayAabbTest(currnode, a_origin, invDirs[activeRay], &isects[activeRay])) break;
-			} while (activeRay-- > 0);
-			if (activeRay < 0) goto pop_bstack;
-
-			stackpos++;
-			stack[stackpos].node = currnode->kids[1];
-			stack[stackpos].activeRay = activeRay;
-			currnode = currnode->kids[0];
+	const Uint32 numNodes = in.Get<Uint32>();
+	const Uint32 numObjs = in.Get<Uint32>();
+	if (!in.Ok() || numNodes == 0 || !in.HasRoomFor(numObjs, sizeof(Sint32)))
+		return 0;
+
+	BVHTree *tree = new BVHTree;
+	tree->m_objPtrAlloc = new BVHTree::objPtr_t[std::max(numObjs, Uint32(1))];
+	tree->m_objPtrAllocPos = tree->m_objPtrAllocMax = numObjs;
+	tree->m_bvhNodes = 0;
+	for (Uint32 i = 0; i < numObjs; i++) {
+		const Sint32 obj = in.Get<Sint32>();
+		if (obj < 0 || Uint32(obj) >= maxObjPtr) {
+			delete tree;
+			return 0;
 		}
-		// triangle intersection jizz
-		for (int i=0; i<currnode->numTris; i++) {
-			RayTriIntersect(activeRay+1, a_origin, a_dirs, currnode->triIndicesStart[i], isects);
+		tree->m_objPtrAlloc[i] = obj;
+	}
+
+	if (!in.HasRoomFor(numNodes, 7*sizeof(double) + 4*sizeof(Sint32))) {
+		delete tree;
+		return 0;
+	}
+	tree->m_bvhNodes = new BVHNode[numNodes];
+	tree->m_nodeAllocPos = tree->m_nodeAllocMax = numNodes;
+	tree->m_root = &tree->m_bvhNodes[0];
+
+	// has to be a proper tree: every node but the root the kid of exactly
+	// one node before it
+	std::vector<int> depth(numNodes, -1);
+	depth[0] = 0;
+	Uint32 i;
+	for (i = 0; i < numNodes; i++) {
+		BVHNode &n = tree->m_bvhNodes[i];
+		in.GetAabb(n.aabb);
+		n.numTris = in.Get<Sint32>();
+		const Sint32 triStart = in.Get<Sint32>();
+		const Sint32 kid0 = in.Get<Sint32>();
+		const Sint32 kid1 = in.Get<Sint32>();
+		if (depth[i] < 0) break;
+		if (triStart >= 0) {
+			if (n.numTris <= 0 || Uint64(triStart) + Uint64(n.numTris) > numObjs) break;
+			n.triIndicesStart = &tree->m_objPtrAlloc[triStart];
+		} else {
+			if (kid0 <= Sint32(i) || kid1 <= Sint32(i) || Uint32(kid0) >= numNodes || Uint32(kid1) >= numNodes) break;
+			if (kid0 == kid1 || depth[kid0] >= 0 || depth[kid1] >= 0 || depth[i] >= MAX_LOADED_BVH_DEPTH) break;
+			depth[kid0] = depth[kid1] = depth[i] + 1;
+			n.kids[0] = &tree->m_bvhNodes[kid0];
+			n.kids[1] = &tree->m_bvhNodes[kid1];
 		}
-pop_bstack:
-		if (stackpos < 0) break;
-		currnode = stack[stackpos].node;
-		activeRay = stack[stackpos].activeRay;
-		stackpos--;
 	}
+	if (i == numNodes && in.Ok())
+		return tree;
+
+	delete tree;
+	return 0;
 }
 
-void GeomTree::RayTriIntersect(int numRays, const vector3f &origin, const vector3f *dirs, int triIdx, isect_t *isects) const
+void GeomTree::Save(std::vector<char> &out) const
 {
-	stats_rayTriIntersections++;
-	const vector3f a(&m_vertices[3*m_indices[triIdx]]);
-	const vector3f b(&m_vertices[3*m_indices[triIdx+1]]);
-	const vector3f c(&m_vertices[3*m_indices[triIdx+2]]);
-
-	vector3f v0_cross, v1_cross, v2_cross;
-	const vector3f n = (c-a).Cross(b-a);
-	const float nominator = n.Dot(a-origin);
-
-	v0_cross = (c-origin).Cross(b-origin);
-	v1_cross = (b-origin).Cross(a-origin);
-	v2_cross = (a-origin).Cross(c-origin);
-
-	for (int i=0; i<numRays; i++) {
-		const float v0d = v0_cross.Dot(dirs[i]);
-		const float v1d = v1_cross.Dot(dirs[i]);
-		const float v2d = v2_cross.Dot(dirs[i]);
-
-		if (((v0d > 0) && (v1d > 0) && (v2d > 0)) ||
-		    ((v0d < 0) && (v1d < 0) && (v2d < 0))) {
-			const float dist = nominator / dirs[i].Dot(n);
-			if ((dist > 0) && (dist < isects[i].dist)) {
-				isects[i].dist = dist;
-				isects[i].triIdx = triIdx/3;
-			}
-		}
+	out.insert(out.end(), GEOMTREE_MAGIC, GEOMTREE_MAGIC + 4);
+	put(out, GEOMTREE_VERSION);
+	put(out, Sint32(m_numVertices));
+	put(out, Sint32(m_numTris));
+
+	put(out, m_radius);
+	put_aabb(out, m_aabb);
+	for (int i = 0; i < m_numTris*3; i++)
+		put(out, Sint32(m_indices[i]));
+
+	put(out, Sint32(m_numEdges));
+	for (int i = 0; i < m_numEdges; i++) {
+		const Edge &e = m_edges[i];
+		put(out, Sint32(e.v1i));
+		put(out, Sint32(e.v2i));
+		put(out, e.len);
+		put(out, e.dir.x); put(out, e.dir.y); put(out, e.dir.z);
+		put(out, Sint32(e.triFlag));
 	}
+
+	SaveBVH(out, *m_triTree);
+	SaveBVH(out, *m_edgeTree);
+}
+
+void GeomTree::TraceRay(const vector3f &start, const vector3f &dir, isect_t *isect) const
+{
+	TraceRay(m_triTree->GetRoot(), start, dir, isect);
+}
+
+void GeomTree::TraceRay(const BVHNode *startNode, const vector3f &a_origin, const vector3f &a_dir, isect_t *isect) const
+{
+	m_wideTriTree->TraceRay(startNode, a_origin, a_dir, isect);
+}
+
+/*
+ * Bundle of rays with common origin
+ */
+void GeomTree::TraceCoherentRays(int numRays, const vector3f &a_origin, const vector3f *a_dirs, isect_t *isects) const
+{
+	TraceCoherentRays(m_triTree->GetRoot(), numRays, a_origin, a_dirs, isects);
+}
+
+// the wide tree tests four boxes or triangles at once for one ray, which
+// beats walking the bundle down the binary tree together
+void GeomTree::TraceCoherentRays(const BVHNode *startNode, int numRays, const vector3f &a_origin, const vector3f *a_dirs, isect_t *isects) const
+{
+	for (int i=0; i<numRays; i++)
+		TraceRay(startNode, a_origin, a_dirs[i], &isects[i]);
 }
 
 vector3f GeomTree::GetTriNormal(int triIdx) const
@@ -267,3 +441,60 @@ vector3f GeomTree::GetTriNormal(int triIdx) const
 
 	return (b-a).Cross(c-a).Normalized();
 }
+
+GeomTree *GeomTree::Load(int numVerts, int numTris, float *vertices, int *indices, unsigned int *triflags, const char *data, size_t size)
+{
+	BlobReader in(data, size);
+	if (size < 4 || memcmp(data, GEOMTREE_MAGIC, 4) != 0) return 0;
+	for (int i = 0; i < 4; i++) in.Get<char>();
+	if (in.Get<Uint32>() != GEOMTREE_VERSION) return 0;
+	if (in.Get<Sint32>() != numVerts || in.Get<Sint32>() != numTris) return 0;
+
+	GeomTree *t = new GeomTree(numVerts, vertices, indices, triflags);
+	t->m_numTris = numTris;
+	t->m_radius = in.Get<double>();
+	in.GetAabb(t->m_aabb);
+
+	// checked before anything is written to the caller's indices
+	std::vector<int> welded(numTris*3);
+	for (int i = 0; i < numTris*3; i++) {
+		welded[i] = in.Get<Sint32>();
+		if (welded[i] < 0 || welded[i] >= numVerts) {
+			delete t;
+			return 0;
+		}
+	}
+
+	const Sint32 numEdges = in.Get<Sint32>();
+	if (numEdges < 0 || !in.HasRoomFor(numEdges, 3*sizeof(Sint32) + 4*sizeof(float))) {
+		delete t;
+		return 0;
+	}
+	t->m_numEdges = numEdges;
+	t->m_edges = new Edge[numEdges];
+	for (int i = 0; i < numEdges; i++) {
+		Edge &e = t->m_edges[i];
+		e.v1i = in.Get<Sint32>();
+		e.v2i = in.Get<Sint32>();
+		e.len = in.Get<float>();
+		e.dir.x = in.Get<float>(); e.dir.y = in.Get<float>(); e.dir.z = in.Get<float>();
+		e.triFlag = in.Get<Sint32>();
+		if (e.v1i < 0 || e.v2i < 0 || e.v1i >= 3*numVerts || e.v2i >= 3*numVerts) {
+			delete t;
+			return 0;
+		}
+	}
+
+	// the tri tree's objects are offsets of whole tris into indices, the
+	// edge tree's are edges
+	t->m_triTree = LoadBVH(in, Uint32(std::max(numTris*3 - 2, 0)));
+	t->m_edgeTree = t->m_triTree ? LoadBVH(in, Uint32(numEdges)) : 0;
+	if (!t->m_edgeTree || !in.Ok() || !in.AtEnd()) {
+		delete t;
+		return 0;
+	}
+
+	if (numTris) std::copy(welded.begin(), welded.end(), indices);
+	t->m_wideTriTree = new WideBVHTree(t->m_triTree, vertices, indices);
+	return t;
+}
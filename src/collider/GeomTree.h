@@ -19,11 +19,21 @@ struct isect_t {
 
 class BVHTree;
 struct BVHNode;
+class WideBVHTree;
 
 class GeomTree {
 public:
 	GeomTree(int numVerts, int numTris, float *vertices, int *indices, unsigned int *triflags);
 	~GeomTree();
+
+	// everything the constructor works out, so it can be cached. the blob
+	// is only good for the same vertices, indices and flags
+	void Save(std::vector<char> &out) const;
+	// same arguments as the constructor, which must be the ones the tree was
+	// saved from. indices gets the welded indices written back, as the
+	// constructor would. returns 0 if the blob is bad or truncated
+	static GeomTree *Load(int numVerts, int numTris, float *vertices, int *indices, unsigned int *triflags, const char *data, size_t size);
+
 	const Aabb &GetAabb() const { return m_aabb; }
 	// dir should be unit length,
 	// isect.dist should be ray length
@@ -47,15 +57,24 @@ public:
 	const Edge *GetEdges() const { return m_edges; }
 	int GetNumEdges() const { return m_numEdges; }
 
+	const int *GetIndices() const { return m_indices; }
+
 	const int m_numVertices;
 	const float *m_vertices;
-	static int stats_rayTriIntersections;
 
 	BVHTree *m_triTree;
 	BVHTree *m_edgeTree;
 private:
-	void RayTriIntersect(int numRays, const vector3f &origin, const vector3f *dirs, int triIdx, isect_t *isects) const;
+	GeomTree(int numVerts, float *vertices, int *indices, unsigned int *triflags);
+
+	class BlobReader;
+	static void SaveBVH(std::vector<char> &out, const BVHTree &tree);
+	static BVHTree *LoadBVH(BlobReader &in, Uint32 maxObjPtr);
+
+	// m_triTree collapsed for ray casts
+	WideBVHTree *m_wideTriTree;
 
+	int m_numTris;
 	double m_radius;
 	Aabb m_aabb;
 
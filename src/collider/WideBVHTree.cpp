@@ -0,0 +1,332 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "../libs.h"
+#include "WideBVHTree.h"
+#include "GeomTree.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define WIDEBVH_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+// each node pushes at most WIDTH kids and pops itself, and the binary trees
+// GeomTree builds are nowhere near this deep
+static const int MAX_STACK = 128;
+
+struct WideBVHTree::Ray {
+	vector3f origin, dir, invDir;
+#ifdef WIDEBVH_USE_SSE
+	__m128 ox, oy, oz;
+	__m128 dx, dy, dz;
+	__m128 ix, iy, iz;
+#endif
+};
+
+// half the surface area, to pick which kid to open up next
+static double area(const Aabb &a)
+{
+	const vector3d d = a.max - a.min;
+	return d.x*d.y + d.y*d.z + d.z*d.x;
+}
+
+WideBVHTree::WideBVHTree(const BVHTree *tree, const float *vertices, const int *indices) :
+	m_binaryNodes(tree->GetNodes()),
+	m_starts(tree->GetNumNodes())
+{
+	m_nodes.reserve(tree->GetNumNodes() / 2 + 1);
+	BuildNode(tree->GetRoot(), vertices, indices);
+}
+
+// takes binaryNode and opens up its biggest kids until there are WIDTH of
+// them (or nothing left to open); those become the lanes of the new node
+int WideBVHTree::BuildNode(const BVHNode *binaryNode, const float *vertices, const int *indices)
+{
+	struct Slot {
+		const BVHNode *node;
+		// binary nodes folded into this node that this slot is under
+		int folded[WIDTH];
+		int numFolded;
+	};
+
+	Slot slots[WIDTH];
+	int numSlots = 1;
+	slots[0].node = binaryNode;
+	slots[0].numFolded = 0;
+
+	while (numSlots < WIDTH) {
+		int open = -1;
+		double openArea = 0.0;
+		for (int i = 0; i < numSlots; i++) {
+			if (slots[i].node->IsLeaf()) continue;
+			const double a = area(slots[i].node->aabb);
+			if (open < 0 || a > openArea) {
+				open = i;
+				openArea = a;
+			}
+		}
+		if (open < 0) break;
+
+		// the two kids take the opened slot and a new one at the end
+		Slot &s = slots[open];
+		assert(s.numFolded < WIDTH);
+		s.folded[s.numFolded++] = int(s.node - m_binaryNodes);
+		slots[numSlots] = s;
+		slots[numSlots].node = s.node->kids[1];
+		s.node = s.node->kids[0];
+		numSlots++;
+	}
+
+	const int index = int(m_nodes.size());
+	m_nodes.push_back(Node());
+
+	Node node;
+	memset(&node, 0, sizeof(node));
+	node.laneMask = (1 << numSlots) - 1;
+	for (int i = 0; i < numSlots; i++) {
+		const Slot &s = slots[i];
+		const Aabb &aabb = s.node->aabb;
+		node.minX[i] = float(aabb.min.x); node.minY[i] = float(aabb.min.y); node.minZ[i] = float(aabb.min.z);
+		node.maxX[i] = float(aabb.max.x); node.maxY[i] = float(aabb.max.y); node.maxZ[i] = float(aabb.max.z);
+
+		for (int j = 0; j < s.numFolded; j++) {
+			Start &start = m_starts[s.folded[j]];
+			start.node = index;
+			start.laneMask |= 1 << i;
+		}
+
+		if (s.node->IsLeaf()) {
+			node.kids[i] = ~BuildLeaf(s.node, vertices, indices);
+			Start &start = m_starts[s.node - m_binaryNodes];
+			start.node = index;
+			start.laneMask = 1 << i;
+		} else {
+			// sets its own start
+			node.kids[i] = BuildNode(s.node, vertices, indices);
+		}
+	}
+	// a leaf at the root folds nothing, so needs its start set here
+	if (binaryNode->IsLeaf()) {
+		m_starts[binaryNode - m_binaryNodes].node = index;
+		m_starts[binaryNode - m_binaryNodes].laneMask = node.laneMask;
+	}
+
+	m_nodes[index] = node;
+	return index;
+}
+
+int WideBVHTree::BuildLeaf(const BVHNode *binaryNode, const float *vertices, const int *indices)
+{
+	Leaf leaf;
+	leaf.firstPack = int(m_packs.size());
+	leaf.numPacks = (binaryNode->numTris + WIDTH - 1) / WIDTH;
+
+	for (int p = 0; p < leaf.numPacks; p++) {
+		TriPack pack;
+		memset(&pack, 0, sizeof(pack));
+		for (int i = 0; i < WIDTH; i++) {
+			const int t = p*WIDTH + i;
+			if (t >= binaryNode->numTris) break;
+			const int triOffset = binaryNode->triIndicesStart[t];
+			const vector3f a(&vertices[3*indices[triOffset]]);
+			const vector3f b(&vertices[3*indices[triOffset+1]]);
+			const vector3f c(&vertices[3*indices[triOffset+2]]);
+			const vector3f e1 = b - a;
+			const vector3f e2 = c - a;
+			pack.v0x[i] = a.x; pack.v0y[i] = a.y; pack.v0z[i] = a.z;
+			pack.e1x[i] = e1.x; pack.e1y[i] = e1.y; pack.e1z[i] = e1.z;
+			pack.e2x[i] = e2.x; pack.e2y[i] = e2.y; pack.e2z[i] = e2.z;
+			pack.triIdx[i] = triOffset / 3;
+			pack.laneMask |= 1 << i;
+		}
+		m_packs.push_back(pack);
+	}
+
+	m_leaves.push_back(leaf);
+	return int(m_leaves.size()) - 1;
+}
+
+// returns the lanes whose box the ray hits closer than maxDist, and where
+// it goes into each box
+int WideBVHTree::SlabTest(const Node &node, const Ray &ray, float maxDist, float *entryDist) const
+{
+#ifdef WIDEBVH_USE_SSE
+	__m128 l1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minX), ray.ox), ray.ix);
+	__m128 l2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxX), ray.ox), ray.ix);
+	__m128 lmin = _mm_min_ps(l1, l2);
+	__m128 lmax = _mm_max_ps(l1, l2);
+
+	l1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minY), ray.oy), ray.iy);
+	l2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxY), ray.oy), ray.iy);
+	lmin = _mm_max_ps(_mm_min_ps(l1, l2), lmin);
+	lmax = _mm_min_ps(_mm_max_ps(l1, l2), lmax);
+
+	l1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minZ), ray.oz), ray.iz);
+	l2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxZ), ray.oz), ray.iz);
+	lmin = _mm_max_ps(_mm_min_ps(l1, l2), lmin);
+	lmax = _mm_min_ps(_mm_max_ps(l1, l2), lmax);
+
+	const __m128 hit = _mm_and_ps(
+		_mm_and_ps(_mm_cmpge_ps(lmax, _mm_setzero_ps()), _mm_cmpge_ps(lmax, lmin)),
+		_mm_cmplt_ps(lmin, _mm_set1_ps(maxDist)));
+	_mm_storeu_ps(entryDist, lmin);
+	return _mm_movemask_ps(hit) & node.laneMask;
+#else
+	int hits = 0;
+	for (int i = 0; i < WIDTH; i++) {
+		float l1 = (node.minX[i] - ray.origin.x) * ray.invDir.x;
+		float l2 = (node.maxX[i] - ray.origin.x) * ray.invDir.x;
+		float lmin = std::min(l1, l2);
+		float lmax = std::max(l1, l2);
+
+		l1 = (node.minY[i] - ray.origin.y) * ray.invDir.y;
+		l2 = (node.maxY[i] - ray.origin.y) * ray.invDir.y;
+		lmin = std::max(std::min(l1, l2), lmin);
+		lmax = std::min(std::max(l1, l2), lmax);
+
+		l1 = (node.minZ[i] - ray.origin.z) * ray.invDir.z;
+		l2 = (node.maxZ[i] - ray.origin.z) * ray.invDir.z;
+		lmin = std::max(std::min(l1, l2), lmin);
+		lmax = std::min(std::max(l1, l2), lmax);
+
+		entryDist[i] = lmin;
+		if ((lmax >= 0.f) & (lmax >= lmin) & (lmin < maxDist)) hits |= 1 << i;
+	}
+	return hits & node.laneMask;
+#endif
+}
+
+// two sided, and like GeomTree's old test a hit must be strictly inside the
+// triangle and strictly closer than isect->dist. the lanes of a pack are
+// taken in order, so the first of two equally close triangles wins
+int WideBVHTree::IntersectLeaf(int leafIdx, const Ray &ray, isect_t *isect) const
+{
+	const Leaf &leaf = m_leaves[leafIdx];
+	int tests = 0;
+
+	for (int p = leaf.firstPack; p < leaf.firstPack + leaf.numPacks; p++) {
+		const TriPack &pack = m_packs[p];
+		float dist[WIDTH];
+		int hits;
+
+#ifdef WIDEBVH_USE_SSE
+		const __m128 e1x = _mm_loadu_ps(pack.e1x), e1y = _mm_loadu_ps(pack.e1y), e1z = _mm_loadu_ps(pack.e1z);
+		const __m128 e2x = _mm_loadu_ps(pack.e2x), e2y = _mm_loadu_ps(pack.e2y), e2z = _mm_loadu_ps(pack.e2z);
+
+		// p = dir x e2
+		const __m128 px = _mm_sub_ps(_mm_mul_ps(ray.dy, e2z), _mm_mul_ps(ray.dz, e2y));
+		const __m128 py = _mm_sub_ps(_mm_mul_ps(ray.dz, e2x), _mm_mul_ps(ray.dx, e2z));
+		const __m128 pz = _mm_sub_ps(_mm_mul_ps(ray.dx, e2y), _mm_mul_ps(ray.dy, e2x));
+		const __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+		const __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+		// s = origin - v0
+		const __m128 sx = _mm_sub_ps(ray.ox, _mm_loadu_ps(pack.v0x));
+		const __m128 sy = _mm_sub_ps(ray.oy, _mm_loadu_ps(pack.v0y));
+		const __m128 sz = _mm_sub_ps(ray.oz, _mm_loadu_ps(pack.v0z));
+		const __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDet);
+
+		// q = s x e1
+		const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+		const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+		const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+		const __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ray.dx, qx), _mm_mul_ps(ray.dy, qy)), _mm_mul_ps(ray.dz, qz)), invDet);
+		const __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+
+		const __m128 zero = _mm_setzero_ps();
+		__m128 hit = _mm_cmpneq_ps(det, zero);
+		hit = _mm_and_ps(hit, _mm_cmpgt_ps(u, zero));
+		hit = _mm_and_ps(hit, _mm_cmpgt_ps(v, zero));
+		hit = _mm_and_ps(hit, _mm_cmplt_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+		hit = _mm_and_ps(hit, _mm_cmpgt_ps(t, zero));
+		hit = _mm_and_ps(hit, _mm_cmplt_ps(t, _mm_set1_ps(isect->dist)));
+		_mm_storeu_ps(dist, t);
+		hits = _mm_movemask_ps(hit) & pack.laneMask;
+#else
+		hits = 0;
+		for (int i = 0; i < WIDTH; i++) {
+			const vector3f e1(pack.e1x[i], pack.e1y[i], pack.e1z[i]);
+			const vector3f e2(pack.e2x[i], pack.e2y[i], pack.e2z[i]);
+			const vector3f pv = ray.dir.Cross(e2);
+			const float det = e1.Dot(pv);
+			if (is_zero_exact(det)) continue;
+			const float invDet = 1.0f / det;
+			const vector3f s = ray.origin - vector3f(pack.v0x[i], pack.v0y[i], pack.v0z[i]);
+			const float u = s.Dot(pv) * invDet;
+			const vector3f q = s.Cross(e1);
+			const float v = ray.dir.Dot(q) * invDet;
+			dist[i] = e2.Dot(q) * invDet;
+			if ((u > 0.f) && (v > 0.f) && (u + v < 1.f) && (dist[i] > 0.f) && (dist[i] < isect->dist))
+				hits |= 1 << i;
+		}
+		hits &= pack.laneMask;
+#endif
+
+		for (int i = 0; i < WIDTH; i++) {
+			if (!(pack.laneMask & (1 << i))) break;
+			tests++;
+			if ((hits & (1 << i)) && (dist[i] < isect->dist)) {
+				isect->dist = dist[i];
+				isect->triIdx = pack.triIdx[i];
+			}
+		}
+	}
+	return tests;
+}
+
+int WideBVHTree::TraceRay(const BVHNode *startNode, const vector3f &origin, const vector3f &dir, isect_t *isect) const
+{
+	Ray ray;
+	ray.origin = origin;
+	ray.dir = dir;
+	ray.invDir = vector3f(1.0f/dir.x, 1.0f/dir.y, 1.0f/dir.z);
+#ifdef WIDEBVH_USE_SSE
+	ray.ox = _mm_set1_ps(origin.x); ray.oy = _mm_set1_ps(origin.y); ray.oz = _mm_set1_ps(origin.z);
+	ray.dx = _mm_set1_ps(dir.x); ray.dy = _mm_set1_ps(dir.y); ray.dz = _mm_set1_ps(dir.z);
+	ray.ix = _mm_set1_ps(ray.invDir.x); ray.iy = _mm_set1_ps(ray.invDir.y); ray.iz = _mm_set1_ps(ray.invDir.z);
+#endif
+
+	// kids waiting to be looked at, and how far along the ray their box is
+	struct Entry {
+		int kid;
+		float dist;
+	} stack[MAX_STACK];
+	int stackPos = 0;
+	int tests = 0;
+
+	const Start &start = m_starts[startNode - m_binaryNodes];
+	int kid = start.node;
+	int laneMask = start.laneMask;
+
+	for (;;) {
+		if (kid < 0) {
+			tests += IntersectLeaf(~kid, ray, isect);
+		} else {
+			const Node &node = m_nodes[kid];
+			float entryDist[WIDTH];
+			int hits = SlabTest(node, ray, isect->dist, entryDist) & laneMask;
+
+			// nearest last, so it's popped first
+			while (hits) {
+				int farthest = -1;
+				for (int i = 0; i < WIDTH; i++) {
+					if ((hits & (1 << i)) && (farthest < 0 || entryDist[i] > entryDist[farthest]))
+						farthest = i;
+				}
+				hits &= ~(1 << farthest);
+				assert(stackPos < MAX_STACK);
+				stack[stackPos].kid = node.kids[farthest];
+				stack[stackPos].dist = entryDist[farthest];
+				stackPos++;
+			}
+		}
+		laneMask = ~0;
+
+		// boxes that are now further away than the closest hit can go
+		do {
+			if (stackPos == 0) return tests;
+			stackPos--;
+		} while (!(stack[stackPos].dist < isect->dist));
+		kid = stack[stackPos].kid;
+	}
+}
@@ -0,0 +1,83 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _WIDEBVHTREE_H
+#define _WIDEBVHTREE_H
+
+#include <vector>
+#include "../vector3.h"
+#include "BVHTree.h"
+
+struct isect_t;
+
+/*
+ * A triangle BVHTree collapsed so that each node has up to four kids, for
+ * casting rays. The kids' boxes are stored side by side so one SSE slab test
+ * covers all four, and the triangles under each leaf are packed four at a
+ * time for a four wide Moller-Trumbore test. Without SSE the same layout is
+ * walked a lane at a time.
+ *
+ * Every node of the binary tree maps to a node here plus the lanes under it,
+ * so a cast can still start part way down the binary tree.
+ */
+class WideBVHTree {
+public:
+	enum { WIDTH = 4 };
+
+	// the tree's objects are offsets into indices, three to a triangle;
+	// indices are vertex numbers. triangles are copied in, so neither
+	// needs to outlive this
+	WideBVHTree(const BVHTree *tree, const float *vertices, const int *indices);
+
+	// same rules as GeomTree::TraceRay. startNode is any node of the tree
+	// this was built from; only triangles under it are tried. returns how
+	// many triangle tests were done
+	int TraceRay(const BVHNode *startNode, const vector3f &origin, const vector3f &dir, isect_t *isect) const;
+
+	int GetNumNodes() const { return int(m_nodes.size()); }
+
+private:
+	struct Node {
+		float minX[WIDTH], minY[WIDTH], minZ[WIDTH];
+		float maxX[WIDTH], maxY[WIDTH], maxZ[WIDTH];
+		// >= 0 for another node, otherwise ~ the leaf's index
+		int kids[WIDTH];
+		// the lanes in use
+		int laneMask;
+	};
+
+	// first vertex and the two edges from it
+	struct TriPack {
+		float v0x[WIDTH], v0y[WIDTH], v0z[WIDTH];
+		float e1x[WIDTH], e1y[WIDTH], e1z[WIDTH];
+		float e2x[WIDTH], e2y[WIDTH], e2z[WIDTH];
+		int triIdx[WIDTH];
+		int laneMask;
+	};
+
+	struct Leaf {
+		int firstPack, numPacks;
+	};
+
+	// where a cast from a binary node begins
+	struct Start {
+		int node;
+		int laneMask;
+	};
+
+	struct Ray;
+
+	int BuildNode(const BVHNode *binaryNode, const float *vertices, const int *indices);
+	int BuildLeaf(const BVHNode *binaryNode, const float *vertices, const int *indices);
+
+	int SlabTest(const Node &node, const Ray &ray, float maxDist, float *entryDist) const;
+	int IntersectLeaf(int leaf, const Ray &ray, isect_t *isect) const;
+
+	const BVHNode *m_binaryNodes;
+	std::vector<Start> m_starts;
+	std::vector<Node> m_nodes;
+	std::vector<Leaf> m_leaves;
+	std::vector<TriPack> m_packs;
+};
+
+#endif /* _WIDEBVHTREE_H */
@@ -298,15 +298,12 @@ std::string Sector::GenName(System &sys, int si, MTRand &rng)
 	}
 }
 
-bool Sector::WithinBox(const int Xmin, const int Xmax, const int Ymin, const int Ymax, const int Zmin, const int Zmax) const {
-	if(sx >= Xmin && sx <= Xmax) {
-		if(sy >= Ymin && sy <= Ymax) {
-			if(sz >= Zmin && sz <= Zmax) {
-				return true;
-			}
-		}
-	}
-	return false;
+size_t Sector::GetMemoryUsage() const
+{
+	size_t size = sizeof(Sector) + m_systems.capacity() * sizeof(System);
+	for (std::vector<System>::const_iterator i = m_systems.begin(); i != m_systems.end(); ++i)
+		size += i->name.capacity();
+	return size;
 }
 
 void Sector::AssignFactions()
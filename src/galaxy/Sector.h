@@ -5,6 +5,7 @@
 #define _SECTOR_H
 
 #include "libs.h"
+#include "RefCounted.h"
 #include "galaxy/SystemPath.h"
 #include "galaxy/StarSystem.h"
 #include "galaxy/CustomSystem.h"
@@ -13,7 +14,12 @@
 
 class Faction;
 
-class Sector {
+/*
+ * A sector's systems depend on its coordinates alone, so each one need only
+ * be built once. Get them from SectorCache, which hands out shared read-only
+ * sectors with their factions assigned.
+ */
+class Sector : public AtomicRefCounted {
 public:
 	// lightyears
 	static const float SIZE;
@@ -21,8 +27,6 @@ public:
 	static float DistanceBetween(const Sector *a, int sysIdxA, const Sector *b, int sysIdxB);
 	static void Init();
 
-	// Sector is within a bounding rectangle - used for SectorView m_sectorCache pruning.
-	bool WithinBox(const int Xmin, const int Xmax, const int Ymin, const int Ymax, const int Zmin, const int Zmax) const;
 	bool Contains(const SystemPath sysPath) const;
 
 	// sets appropriate factions for all systems in the sector
@@ -30,7 +34,7 @@ public:
 
 	class System {
 	public:
-		System(int x, int y, int z, Uint32 si): customSys(0), population(-1), sx(x), sy(y), sz(z), idx(si) {};
+		System(int x, int y, int z, Uint32 si): customSys(0), faction(0), sx(x), sy(y), sz(z), idx(si) {};
 		~System() {};
 
 		// Check that we've had our habitation status set
@@ -43,9 +47,8 @@ public:
 		Uint32 seed;
 		const CustomSystem *customSys;
 		Faction *faction;
-		fixed population;
 
-		vector3f FullPosition() { return Sector::SIZE*vector3f(float(sx), float(sy), float(sz)) + p; };
+		vector3f FullPosition() const { return Sector::SIZE*vector3f(float(sx), float(sy), float(sz)) + p; };
 		bool IsSameSystem(const SystemPath &b) const { 
 			return sx == b.sectorX && sy == b.sectorY && sz == b.sectorZ && idx == b.systemIndex;
 		}
@@ -55,6 +58,9 @@ public:
 	};
 	std::vector<System> m_systems;
 
+	// roughly how much memory the sector takes up, strings and all
+	size_t GetMemoryUsage() const;
+
 private:
 	int sx, sy, sz;
 	void GetCustomSystems();
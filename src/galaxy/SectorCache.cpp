@@ -0,0 +1,111 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "SectorCache.h"
+#include <list>
+
+namespace SectorCache {
+
+struct Entry {
+	SystemPath path;
+	RefCountedPtr<const Sector> sector;
+	size_t size;
+};
+typedef std::list<Entry> EntryList;
+
+// most recently used first
+static EntryList s_entries;
+static std::map<SystemPath, EntryList::iterator> s_entriesByPath;
+static Uint64 s_totalSize = 0;
+static Uint64 s_maxSize = 0;
+static SDL_mutex *s_lock = 0;
+
+// must hold s_lock. only drops the cache's hold on each sector
+static void evict()
+{
+	while (s_totalSize > s_maxSize && !s_entries.empty()) {
+		const Entry &e = s_entries.back();
+		s_totalSize -= e.size;
+		s_entriesByPath.erase(e.path);
+		s_entries.pop_back();
+	}
+}
+
+void Init(Uint64 maxBytes)
+{
+	s_maxSize = maxBytes;
+	if (!IsEnabled()) return;
+
+	s_lock = SDL_CreateMutex();
+}
+
+void Uninit()
+{
+	if (!IsEnabled()) return;
+
+	s_entries.clear();
+	s_entriesByPath.clear();
+	s_totalSize = 0;
+	s_maxSize = 0;
+	SDL_DestroyMutex(s_lock);
+	s_lock = 0;
+}
+
+bool IsEnabled()
+{
+	return (s_maxSize > 0);
+}
+
+static RefCountedPtr<const Sector> build(int sectorX, int sectorY, int sectorZ)
+{
+	Sector *s = new Sector(sectorX, sectorY, sectorZ);
+	s->AssignFactions();
+	return RefCountedPtr<const Sector>(s);
+}
+
+RefCountedPtr<const Sector> Get(int sectorX, int sectorY, int sectorZ)
+{
+	if (!IsEnabled()) return build(sectorX, sectorY, sectorZ);
+
+	const SystemPath path(sectorX, sectorY, sectorZ);
+
+	PiVerify(SDL_mutexP(s_lock)==0);
+	std::map<SystemPath, EntryList::iterator>::iterator i = s_entriesByPath.find(path);
+	if (i != s_entriesByPath.end()) {
+		s_entries.splice(s_entries.begin(), s_entries, i->second);
+		RefCountedPtr<const Sector> sector = i->second->sector;
+		PiVerify(SDL_mutexV(s_lock)!=-1);
+		return sector;
+	}
+	PiVerify(SDL_mutexV(s_lock)!=-1);
+
+	// built outside the lock so other threads aren't held up meanwhile.
+	// if one of them builds the same sector at the same time, the first in
+	// wins and the other copy is thrown away
+	RefCountedPtr<const Sector> sector = build(sectorX, sectorY, sectorZ);
+
+	PiVerify(SDL_mutexP(s_lock)==0);
+	i = s_entriesByPath.find(path);
+	if (i != s_entriesByPath.end()) {
+		s_entries.splice(s_entries.begin(), s_entries, i->second);
+		sector = i->second->sector;
+	} else {
+		Entry e;
+		e.path = path;
+		e.sector = sector;
+		e.size = sector->GetMemoryUsage();
+		s_entriesByPath[path] = s_entries.insert(s_entries.begin(), e);
+		s_totalSize += e.size;
+		evict();
+	}
+	PiVerify(SDL_mutexV(s_lock)!=-1);
+
+	return sector;
+}
+
+RefCountedPtr<const Sector> Get(const SystemPath &path)
+{
+	return Get(path.sectorX, path.sectorY, path.sectorZ);
+}
+
+}
@@ -0,0 +1,35 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _SECTORCACHE_H
+#define _SECTORCACHE_H
+
+#include "libs.h"
+#include "RefCounted.h"
+#include "galaxy/Sector.h"
+
+/*
+ * The one place sectors are built, once the galaxy's set up. Sectors are
+ * handed out shared and read-only, with their systems' factions assigned,
+ * and kept around until the cache grows past its size cap, when the least
+ * recently used are let go. Anyone still holding one keeps it until they're
+ * done. Safe to call from any thread once Init has been called, since by
+ * then the factions and their home sectors are built and won't change.
+ */
+
+namespace SectorCache
+{
+	// call once factions and custom systems are loaded, since a sector's
+	// systems depend on both. maxBytes of 0 turns the cache off
+	void Init(Uint64 maxBytes);
+	void Uninit();
+
+	bool IsEnabled();
+
+	// until the cache is set up (or if it's off) this builds a new sector
+	// each time
+	RefCountedPtr<const Sector> Get(int sectorX, int sectorY, int sectorZ);
+	RefCountedPtr<const Sector> Get(const SystemPath &path);
+}
+
+#endif /* _SECTORCACHE_H */
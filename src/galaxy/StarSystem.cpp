@@ -3,12 +3,17 @@
 
 #include "StarSystem.h"
 #include "Sector.h"
+#include "SectorCache.h"
+#include "StarSystemSummary.h"
 #include "Factions.h"
 
 #include "Serializer.h"
 #include "Pi.h"
+#include "GameConfig.h"
+#include "JobQueue.h"
 #include "LuaNameGen.h"
 #include <map>
+#include <list>
 #include "utils.h"
 #include "Lang.h"
 #include "StringF.h"
@@ -1373,12 +1378,12 @@ StarSystem::StarSystem(const SystemPath &path) : m_path(path)
 	memset(m_tradeLevel, 0, sizeof(m_tradeLevel));
 	rootBody = 0;
 
-	Sector s = Sector(m_path.sectorX, m_path.sectorY, m_path.sectorZ);
-	assert(m_path.systemIndex >= 0 && m_path.systemIndex < s.m_systems.size());
+	RefCountedPtr<const Sector> s = SectorCache::Get(m_path);
+	assert(m_path.systemIndex >= 0 && m_path.systemIndex < s->m_systems.size());
 
-	m_seed    = s.m_systems[m_path.systemIndex].seed;
-	m_name    = s.m_systems[m_path.systemIndex].name;
-	m_faction = Faction::GetNearestFaction(s, m_path.systemIndex);
+	m_seed    = s->m_systems[m_path.systemIndex].seed;
+	m_name    = s->m_systems[m_path.systemIndex].name;
+	m_faction = s->m_systems[m_path.systemIndex].faction;
 
 	unsigned long _init[6] = { m_path.systemIndex, Uint32(m_path.sectorX), Uint32(m_path.sectorY), Uint32(m_path.sectorZ), UNIVERSE_SEED, Uint32(m_seed) };
 	MTRand rand(_init, 6);
@@ -1392,16 +1397,16 @@ StarSystem::StarSystem(const SystemPath &path) : m_path(path)
 	m_unexplored = !(((dist <= 90) && ( dist <= 65 || rand.Int32(dist) <= 40)) || Faction::IsHomeSystem(path));
 
 	m_isCustom = m_hasCustomBodies = false;
-	if (s.m_systems[m_path.systemIndex].customSys) {
+	if (s->m_systems[m_path.systemIndex].customSys) {
 		m_isCustom = true;
-		const CustomSystem *custom = s.m_systems[m_path.systemIndex].customSys;
+		const CustomSystem *custom = s->m_systems[m_path.systemIndex].customSys;
 		m_numStars = custom->numStars;
 		if (custom->shortDesc.length() > 0) m_shortDesc = custom->shortDesc;
 		if (custom->longDesc.length() > 0) m_longDesc = custom->longDesc;
 		if (!custom->want_rand_explored) m_unexplored = !custom->explored;
 		if (!custom->IsRandom()) {
 			m_hasCustomBodies = true;
-			GenerateFromCustom(s.m_systems[m_path.systemIndex].customSys, rand);
+			GenerateFromCustom(s->m_systems[m_path.systemIndex].customSys, rand);
 			return;
 		}
 	}
@@ -1409,14 +1414,14 @@ StarSystem::StarSystem(const SystemPath &path) : m_path(path)
 	SystemBody *star[4];
 	SystemBody *centGrav1(NULL), *centGrav2(NULL);
 
-	const int numStars = s.m_systems[m_path.systemIndex].numStars;
+	const int numStars = s->m_systems[m_path.systemIndex].numStars;
 	assert((numStars >= 1) && (numStars <= 4));
 
 	if (numStars == 1) {
-		SystemBody::BodyType type = s.m_systems[m_path.systemIndex].starType[0];
+		SystemBody::BodyType type = s->m_systems[m_path.systemIndex].starType[0];
 		star[0] = NewBody();
 		star[0]->parent = NULL;
-		star[0]->name = s.m_systems[m_path.systemIndex].name;
+		star[0]->name = s->m_systems[m_path.systemIndex].name;
 		star[0]->orbMin = 0;
 		star[0]->orbMax = 0;
 		MakeStarOfType(star[0], type, rand);
@@ -1426,19 +1431,19 @@ StarSystem::StarSystem(const SystemPath &path) : m_path(path)
 		centGrav1 = NewBody();
 		centGrav1->type = SystemBody::TYPE_GRAVPOINT;
 		centGrav1->parent = NULL;
-		centGrav1->name = s.m_systems[m_path.systemIndex].name+" A,B";
+		centGrav1->name = s->m_systems[m_path.systemIndex].name+" A,B";
 		rootBody = centGrav1;
 
-		SystemBody::BodyType type = s.m_systems[m_path.systemIndex].starType[0];
+		SystemBody::BodyType type = s->m_systems[m_path.systemIndex].starType[0];
 		star[0] = NewBody();
-		star[0]->name = s.m_systems[m_path.systemIndex].name+" A";
+		star[0]->name = s->m_systems[m_path.systemIndex].name+" A";
 		star[0]->parent = centGrav1;
 		MakeStarOfType(star[0], type, rand);
 
 		star[1] = NewBody();
-		star[1]->name = s.m_systems[m_path.systemIndex].name+" B";
+		star[1]->name = s->m_systems[m_path.systemIndex].name+" B";
 		star[1]->parent = centGrav1;
-		MakeStarOfTypeLighterThan(star[1], s.m_systems[m_path.systemIndex].starType[1],
+		MakeStarOfTypeLighterThan(star[1], s->m_systems[m_path.systemIndex].starType[1],
 				star[0]->mass, rand);
 
 		centGrav1->mass = star[0]->mass + star[1]->mass;
@@ -1458,29 +1463,29 @@ try_that_again_guvnah:
 			// 3rd and maybe 4th star
 			if (numStars == 3) {
 				star[2] = NewBody();
-				star[2]->name = s.m_systems[m_path.systemIndex].name+" C";
+				star[2]->name = s->m_systems[m_path.systemIndex].name+" C";
 				star[2]->orbMin = 0;
 				star[2]->orbMax = 0;
-				MakeStarOfTypeLighterThan(star[2], s.m_systems[m_path.systemIndex].starType[2],
+				MakeStarOfTypeLighterThan(star[2], s->m_systems[m_path.systemIndex].starType[2],
 					star[0]->mass, rand);
 				centGrav2 = star[2];
 				m_numStars = 3;
 			} else {
 				centGrav2 = NewBody();
 				centGrav2->type = SystemBody::TYPE_GRAVPOINT;
-				centGrav2->name = s.m_systems[m_path.systemIndex].name+" C,D";
+				centGrav2->name = s->m_systems[m_path.systemIndex].name+" C,D";
 				centGrav2->orbMax = 0;
 
 				star[2] = NewBody();
-				star[2]->name = s.m_systems[m_path.systemIndex].name+" C";
+				star[2]->name = s->m_systems[m_path.systemIndex].name+" C";
 				star[2]->parent = centGrav2;
-				MakeStarOfTypeLighterThan(star[2], s.m_systems[m_path.systemIndex].starType[2],
+				MakeStarOfTypeLighterThan(star[2], s->m_systems[m_path.systemIndex].starType[2],
 					star[0]->mass, rand);
 
 				star[3] = NewBody();
-				star[3]->name = s.m_systems[m_path.systemIndex].name+" D";
+				star[3]->name = s->m_systems[m_path.systemIndex].name+" D";
 				star[3]->parent = centGrav2;
-				MakeStarOfTypeLighterThan(star[3], s.m_systems[m_path.systemIndex].starType[3],
+				MakeStarOfTypeLighterThan(star[3], s->m_systems[m_path.systemIndex].starType[3],
 					star[2]->mass, rand);
 
 				const fixed minDist2 = (star[2]->radius + star[3]->radius) * AU_SOL_RADIUS;
@@ -1493,7 +1498,7 @@ try_that_again_guvnah:
 			SystemBody *superCentGrav = NewBody();
 			superCentGrav->type = SystemBody::TYPE_GRAVPOINT;
 			superCentGrav->parent = NULL;
-			superCentGrav->name = s.m_systems[m_path.systemIndex].name;
+			superCentGrav->name = s->m_systems[m_path.systemIndex].name;
 			centGrav1->parent = superCentGrav;
 			centGrav2->parent = superCentGrav;
 			rootBody = superCentGrav;
@@ -2023,9 +2028,8 @@ void SystemBody::PopulateStage1(StarSystem *system, fixed &outTotalPop)
 	unsigned long _init[6] = { system->m_path.systemIndex, Uint32(system->m_path.sectorX),
 			Uint32(system->m_path.sectorY), Uint32(system->m_path.sectorZ), UNIVERSE_SEED, Uint32(this->seed) };
 
-	MTRand rand, namerand;
+	MTRand rand;
 	rand.seed(_init, 6);
-	namerand.seed(_init, 6);
 
 	m_population = fixed(0);
 
@@ -2106,7 +2110,7 @@ void SystemBody::PopulateStage1(StarSystem *system, fixed &outTotalPop)
 	}
 
 	if (!system->m_hasCustomBodies && m_population > 0)
-		name = Pi::luaNameGen->BodyName(this, namerand);
+		system->WantName(this, system->NewNameRand(_init));
 
 	// Add a bunch of things people consume
 	for (int i=0; i<NUM_CONSUMABLES; i++) {
@@ -2140,12 +2144,13 @@ void SystemBody::PopulateAddStations(StarSystem *system)
 	unsigned long _init[6] = { system->m_path.systemIndex, Uint32(system->m_path.sectorX),
 			Uint32(system->m_path.sectorY), Uint32(system->m_path.sectorZ), this->seed, UNIVERSE_SEED };
 
-	MTRand rand, namerand;
+	MTRand rand;
 	rand.seed(_init, 6);
-	namerand.seed(_init, 6);
 
 	if (m_population < fixed(1,1000)) return;
 
+	const int namerand = system->NewNameRand(_init);
+
 	fixed pop = m_population + rand.Fixed();
 
 	fixed orbMaxS = fixed(1,4)*this->CalcHillRadius();
@@ -2177,7 +2182,7 @@ void SystemBody::PopulateAddStations(StarSystem *system)
 		sp->orbMin = sp->semiMajorAxis;
 		sp->orbMax = sp->semiMajorAxis;
 
-		sp->name = Pi::luaNameGen->BodyName(sp, namerand);
+		system->WantName(sp, namerand);
 
 		pop -= rand.Fixed();
 		if (pop > 0) {
@@ -2186,7 +2191,7 @@ void SystemBody::PopulateAddStations(StarSystem *system)
 			*sp2 = *sp;
 			sp2->path = path2;
 			sp2->orbit.rotMatrix = matrix3x3d::RotateZ(M_PI);
-			sp2->name = Pi::luaNameGen->BodyName(sp2, namerand);
+			system->WantName(sp2, namerand);
 			children.insert(children.begin(), sp2);
 			system->m_spaceStations.push_back(sp2);
 		}
@@ -2205,7 +2210,7 @@ void SystemBody::PopulateAddStations(StarSystem *system)
 		sp->parent = this;
 		sp->averageTemp = this->averageTemp;
 		sp->mass = 0;
-		sp->name = Pi::luaNameGen->BodyName(sp, namerand);
+		system->WantName(sp, namerand);
 		memset(&sp->orbit, 0, sizeof(Orbit));
 		position_settlement_on_planet(sp);
 		children.insert(children.begin(), sp);
@@ -2213,6 +2218,30 @@ void SystemBody::PopulateAddStations(StarSystem *system)
 	}
 }
 
+int StarSystem::NewNameRand(const unsigned long seed[6])
+{
+	NameRand r;
+	memcpy(r.seed, seed, sizeof(r.seed));
+	m_nameRands.push_back(r);
+	return int(m_nameRands.size()) - 1;
+}
+
+void StarSystem::NameBodies()
+{
+	// each rand's names were wanted one after another
+	MTRand namerand;
+	int current = -1;
+	for (std::vector< std::pair<SystemBody*,int> >::iterator i = m_unnamedBodies.begin(); i != m_unnamedBodies.end(); ++i) {
+		if (i->second != current) {
+			current = i->second;
+			namerand.seed(m_nameRands[current].seed, 6);
+		}
+		i->first->name = Pi::luaNameGen->BodyName(i->first, namerand);
+	}
+	m_unnamedBodies.clear();
+	m_nameRands.clear();
+}
+
 StarSystem::~StarSystem()
 {
 	if (rootBody) delete rootBody;
@@ -2251,38 +2280,231 @@ RefCountedPtr<StarSystem> StarSystem::Unserialize(Serializer::Reader &rd)
 	}
 }
 
-typedef std::map<SystemPath,StarSystem*> SystemCacheMap;
-static SystemCacheMap s_cachedSystems;
+struct CacheEntry {
+	StarSystem *system;
+	size_t size;
+};
+typedef std::list<CacheEntry> CacheList;
+
+// most recently used first. the cache holds one reference to each system.
+// main thread only
+static CacheList s_cache;
+static std::map<SystemPath, CacheList::iterator> s_cacheByPath;
+static int s_numCached = 0;
+static Uint64 s_cacheSize = 0;
+static Uint64 s_maxCacheSize = 0;
+static Uint32 s_cacheHits = 0;
+static Uint32 s_cacheMisses = 0;
+
+// drops systems nothing else holds, least recently used first, until the
+// cache is back under its budget
+static void evict()
+{
+	CacheList::iterator i = s_cache.end();
+	while (s_cacheSize > s_maxCacheSize && i != s_cache.begin()) {
+		--i;
+		if (i->system->GetRefCount() > 1) continue;
+		s_cacheSize -= i->size;
+		s_numCached--;
+		s_cacheByPath.erase(i->system->GetPath());
+		i->system->DecRefCount();
+		i = s_cache.erase(i);
+	}
+}
+
+// must not be cached already
+static RefCountedPtr<StarSystem> cache(StarSystem *s)
+{
+	RefCountedPtr<StarSystem> ret(s);
+
+	CacheEntry e;
+	e.system = s;
+	e.size = s->GetMemoryUsage();
+	s->IncRefCount();
+	s_cacheByPath[s->GetPath()] = s_cache.insert(s_cache.begin(), e);
+	s_numCached++;
+	s_cacheSize += e.size;
+
+	evict();
+	return ret;
+}
+
+static JobQueue *s_jobQueue = 0;
+// requests being generated, so asking again doesn't start another
+static std::map<SystemPath,StarSystemRequest*> s_requests;
+static SDL_mutex *s_requestsLock = 0;
+
+void StarSystem::Init()
+{
+	s_maxCacheSize = Uint64(std::max(Pi::config->Int("StarSystemCacheSizeMB"), 0)) << 20;
+
+	int numWorkers = Pi::config->Int("GalaxyWorkerThreads");
+	if (numWorkers <= 0) numWorkers = JobQueue::GetDefaultNumWorkers();
+	s_jobQueue = new JobQueue(numWorkers);
+	s_requestsLock = SDL_CreateMutex();
+}
+
+void StarSystem::Uninit()
+{
+	// anything not yet generated never will be
+	delete s_jobQueue;
+	s_jobQueue = 0;
+	s_requests.clear();
+	SDL_DestroyMutex(s_requestsLock);
+	s_requestsLock = 0;
+}
 
 RefCountedPtr<StarSystem> StarSystem::GetCached(const SystemPath &path)
 {
 	SystemPath sysPath(path.SystemOnly());
 
-	StarSystem *s = 0;
-	std::pair<SystemCacheMap::iterator, bool>
-		ret = s_cachedSystems.insert(SystemCacheMap::value_type(sysPath, static_cast<StarSystem*>(0)));
-	if (ret.second) {
-		s = new StarSystem(sysPath);
-		ret.first->second = s;
-		s->IncRefCount(); // the cache owns one reference
-	} else {
-		s = ret.first->second;
+	std::map<SystemPath, CacheList::iterator>::iterator i = s_cacheByPath.find(sysPath);
+	if (i != s_cacheByPath.end()) {
+		s_cacheHits++;
+		s_cache.splice(s_cache.begin(), s_cache, i->second);
+		return RefCountedPtr<StarSystem>(i->second->system);
 	}
-	return RefCountedPtr<StarSystem>(s);
+
+	s_cacheMisses++;
+	StarSystem *s = new StarSystem(sysPath);
+	s->NameBodies();
+	StarSystemSummary::Store(s);
+	return cache(s);
+}
+
+// a system generated on a worker, unless it was generated here meanwhile
+RefCountedPtr<StarSystem> StarSystem::AddToCache(StarSystem *s)
+{
+	std::map<SystemPath, CacheList::iterator>::iterator i = s_cacheByPath.find(s->m_path);
+	if (i != s_cacheByPath.end()) {
+		delete s;
+		s_cache.splice(s_cache.begin(), s_cache, i->second);
+		return RefCountedPtr<StarSystem>(i->second->system);
+	}
+
+	s->NameBodies();
+	return cache(s);
 }
 
 void StarSystem::ShrinkCache()
 {
-	std::map<SystemPath,StarSystem*>::iterator i = s_cachedSystems.begin();
-	while (i != s_cachedSystems.end()) {
-		StarSystem *s = (*i).second;
+	CacheList::iterator i = s_cache.begin();
+	while (i != s_cache.end()) {
+		StarSystem *s = i->system;
 		assert(s->GetRefCount() >= 1); // sanity check
 		// if the cache is the only owner, then delete it
 		if (s->GetRefCount() == 1) {
+			s_cacheSize -= i->size;
+			s_numCached--;
+			s_cacheByPath.erase(s->m_path);
 			delete s;
-			s_cachedSystems.erase(i++);
+			i = s_cache.erase(i);
 		}
 		else
-			i++;
+			++i;
+	}
+}
+
+void StarSystem::GetCacheStats(CacheStats &out)
+{
+	out.numSystems = s_numCached;
+	out.size = s_cacheSize;
+	out.hits = s_cacheHits;
+	out.misses = s_cacheMisses;
+}
+
+size_t StarSystem::GetMemoryUsage() const
+{
+	size_t size = sizeof(StarSystem) + m_name.capacity() + m_shortDesc.capacity() + m_longDesc.capacity()
+		+ (m_bodies.capacity() + m_spaceStations.capacity()) * sizeof(SystemBody*);
+	for (std::vector<SystemBody*>::const_iterator i = m_bodies.begin(); i != m_bodies.end(); ++i)
+		size += sizeof(SystemBody) + (*i)->name.capacity() + (*i)->children.capacity() * sizeof(SystemBody*);
+	return size;
+}
+
+class StarSystem::GenerateJob : public Job {
+public:
+	GenerateJob(StarSystemRequest *req) : m_request(req) {}
+	virtual void OnRun() { StarSystem::Generate(m_request.Get()); }
+private:
+	RefCountedPtr<StarSystemRequest> m_request;
+};
+
+RefCountedPtr<StarSystemRequest> StarSystem::RequestCached(const SystemPath &path)
+{
+	SystemPath sysPath(path.SystemOnly());
+
+	if (!s_jobQueue) {
+		GetCached(sysPath);
+		return RefCountedPtr<StarSystemRequest>(new StarSystemRequest(sysPath, true));
+	}
+	if (s_cacheByPath.find(sysPath) != s_cacheByPath.end()) {
+		// its summary may have been thrown out since
+		StarSystemSummary::Get(sysPath);
+		return RefCountedPtr<StarSystemRequest>(new StarSystemRequest(sysPath, true));
+	}
+
+	RefCountedPtr<StarSystemRequest> req;
+	bool queue = false;
+	PiVerify(SDL_mutexP(s_requestsLock)==0);
+	std::map<SystemPath,StarSystemRequest*>::iterator i = s_requests.find(sysPath);
+	if (i != s_requests.end())
+		req.Reset(i->second);
+	else {
+		req.Reset(new StarSystemRequest(sysPath, false));
+		s_requests[sysPath] = req.Get();
+		queue = true;
+	}
+	PiVerify(SDL_mutexV(s_requestsLock)!=-1);
+
+	if (queue)
+		s_jobQueue->Queue(new GenerateJob(req.Get()));
+	return req;
+}
+
+// on a worker thread
+void StarSystem::Generate(StarSystemRequest *req)
+{
+	StarSystem *s = new StarSystem(req->m_path);
+	StarSystemSummary::Store(s);
+
+	PiVerify(SDL_mutexP(s_requestsLock)==0);
+	req->m_system = s;
+	req->m_ready = true;
+	s_requests.erase(req->m_path);
+	PiVerify(SDL_mutexV(s_requestsLock)!=-1);
+}
+
+StarSystemRequest::StarSystemRequest(const SystemPath &path, bool ready) :
+	m_path(path),
+	m_ready(ready),
+	m_system(0)
+{
+}
+
+StarSystemRequest::~StarSystemRequest()
+{
+	delete m_system;
+}
+
+bool StarSystemRequest::IsReady() const
+{
+	if (!s_requestsLock) return m_ready;
+
+	PiVerify(SDL_mutexP(s_requestsLock)==0);
+	const bool ready = m_ready;
+	PiVerify(SDL_mutexV(s_requestsLock)!=-1);
+	return ready;
+}
+
+RefCountedPtr<StarSystem> StarSystemRequest::Get()
+{
+	if (!IsReady()) return RefCountedPtr<StarSystem>();
+
+	if (m_system) {
+		StarSystem *s = m_system;
+		m_system = 0;
+		return StarSystem::AddToCache(s);
 	}
+	return StarSystem::GetCached(m_path);
 }
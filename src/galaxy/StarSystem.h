@@ -28,6 +28,7 @@ enum EconType { // <enum name=EconType prefix=ECON_>
 };
 
 class StarSystem;
+class StarSystemRequest;
 class Faction;
 
 struct Orbit {
@@ -225,10 +226,28 @@ private:
 class StarSystem : public DeleteEmitter, public RefCounted {
 public:
 	friend class SystemBody;
+	friend class StarSystemRequest;
+
+	// start and stop the threads RequestCached generates systems on
+	static void Init();
+	static void Uninit();
 
 	static RefCountedPtr<StarSystem> GetCached(const SystemPath &path);
+	// as GetCached, but if the system isn't cached it's generated on a
+	// worker thread. main thread only
+	static RefCountedPtr<StarSystemRequest> RequestCached(const SystemPath &path);
+	// throws out every cached system nothing else holds. otherwise that
+	// only happens once the cache is over its budget
 	static void ShrinkCache();
 
+	struct CacheStats {
+		int numSystems;
+		Uint64 size;
+		Uint32 hits;
+		Uint32 misses;
+	};
+	static void GetCacheStats(CacheStats &out);
+
 	const std::string &GetName() const { return m_name; }
 	SystemPath GetPathOf(const SystemBody *sbody) const;
 	SystemBody *GetBodyByPath(const SystemPath &path) const;
@@ -267,6 +286,9 @@ public:
 	fixed GetHumanProx() const { return m_humanProx; }
 	fixed GetTotalPop() const { return m_totalPop; }
 
+	// roughly what the system and its bodies take up, for the cache budget
+	size_t GetMemoryUsage() const;
+
 private:
 	StarSystem(const SystemPath &path);
 	~StarSystem();
@@ -288,6 +310,18 @@ private:
 	void GenerateFromCustom(const CustomSystem *, MTRand &rand);
 	void Populate(bool addSpaceStations);
 
+	// body names come from Lua, which only the main thread may run. while
+	// generating, bodies that want a name are noted along with the seed of
+	// the rand they'd draw it from; NameBodies gives them out afterwards in
+	// the same order, so they come out as if they'd been named on the spot
+	int NewNameRand(const unsigned long seed[6]);
+	void WantName(SystemBody *body, int nameRand) { m_unnamedBodies.push_back(std::make_pair(body, nameRand)); }
+	void NameBodies();
+
+	class GenerateJob;
+	static void Generate(StarSystemRequest *req);
+	static RefCountedPtr<StarSystem> AddToCache(StarSystem *s);
+
 	SystemPath m_path;
 	int m_numStars;
 	std::string m_name;
@@ -310,6 +344,39 @@ private:
 	fixed m_agricultural;
 	fixed m_humanProx;
 	fixed m_totalPop;
+
+	struct NameRand {
+		unsigned long seed[6];
+	};
+	std::vector<NameRand> m_nameRands;
+	std::vector< std::pair<SystemBody*,int> > m_unnamedBodies;
+};
+
+/*
+ * A system being generated on a worker thread, from
+ * StarSystem::RequestCached. The worker does all of it but naming the
+ * bodies; Get does that on the main thread and puts the system in the
+ * cache. The system's summary is stored as soon as it's ready, so a caller
+ * that only wants that can let go of the request without ever calling Get.
+ */
+class StarSystemRequest : public AtomicRefCounted {
+public:
+	virtual ~StarSystemRequest();
+
+	const SystemPath &GetPath() const { return m_path; }
+	bool IsReady() const;
+	// the system, from the cache. null until IsReady. main thread only
+	RefCountedPtr<StarSystem> Get();
+
+private:
+	friend class StarSystem;
+	StarSystemRequest(const SystemPath &path, bool ready);
+
+	SystemPath m_path;
+	bool m_ready;
+	// generated but not yet named or cached. the request owns it until
+	// Get hands it over
+	StarSystem *m_system;
 };
 
 #endif /* _STARSYSTEM_H */
@@ -0,0 +1,119 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "StarSystemSummary.h"
+#include "Sector.h"
+#include "SectorCache.h"
+#include <list>
+
+// a little over a hundred bytes each
+static const size_t MAX_SUMMARIES = 65536;
+
+typedef std::list<StarSystemSummary> SummaryList;
+
+// most recently used first
+static SummaryList s_summaries;
+static size_t s_numSummaries = 0;
+static std::map<SystemPath, SummaryList::iterator> s_summariesByPath;
+static SDL_mutex *s_lock = 0;
+
+void StarSystemSummary::Init()
+{
+	s_lock = SDL_CreateMutex();
+}
+
+void StarSystemSummary::Uninit()
+{
+	s_summaries.clear();
+	s_summariesByPath.clear();
+	s_numSummaries = 0;
+	SDL_DestroyMutex(s_lock);
+	s_lock = 0;
+}
+
+StarSystemSummary::StarSystemSummary() :
+	numStars(0),
+	faction(0),
+	explored(false),
+	lawlessness(0),
+	population(0),
+	econType(0),
+	numStarports(0)
+{
+}
+
+bool StarSystemSummary::GetIfKnown(const SystemPath &path, StarSystemSummary &out)
+{
+	if (!s_lock) return false;
+
+	PiVerify(SDL_mutexP(s_lock)==0);
+	std::map<SystemPath, SummaryList::iterator>::iterator i = s_summariesByPath.find(path.SystemOnly());
+	const bool found = (i != s_summariesByPath.end());
+	if (found) {
+		s_summaries.splice(s_summaries.begin(), s_summaries, i->second);
+		out = *(i->second);
+	}
+	PiVerify(SDL_mutexV(s_lock)!=-1);
+	return found;
+}
+
+static StarSystemSummary summarise(const StarSystem *s)
+{
+	StarSystemSummary summary;
+	summary.path = s->GetPath();
+	summary.name = s->GetName();
+
+	RefCountedPtr<const Sector> sec = SectorCache::Get(summary.path);
+	const Sector::System &sys = sec->m_systems[summary.path.systemIndex];
+	summary.numStars = sys.numStars;
+	for (int i = 0; i < 4; i++)
+		summary.starType[i] = (i < sys.numStars) ? sys.starType[i] : SystemBody::TYPE_GRAVPOINT;
+
+	summary.faction = s->GetFaction();
+	summary.explored = !s->GetUnexplored();
+	summary.lawlessness = s->GetSysPolit().lawlessness;
+	summary.population = s->GetTotalPop();
+	summary.econType = s->GetEconType();
+	summary.numStarports = s->m_spaceStations.size();
+	return summary;
+}
+
+static void insert(const StarSystemSummary &summary)
+{
+	if (!s_lock) return;
+
+	PiVerify(SDL_mutexP(s_lock)==0);
+	std::map<SystemPath, SummaryList::iterator>::iterator i = s_summariesByPath.find(summary.path);
+	if (i != s_summariesByPath.end()) {
+		s_summaries.splice(s_summaries.begin(), s_summaries, i->second);
+		*(i->second) = summary;
+	} else {
+		s_summariesByPath[summary.path] = s_summaries.insert(s_summaries.begin(), summary);
+		s_numSummaries++;
+		while (s_numSummaries > MAX_SUMMARIES) {
+			s_summariesByPath.erase(s_summaries.back().path);
+			s_summaries.pop_back();
+			s_numSummaries--;
+		}
+	}
+	PiVerify(SDL_mutexV(s_lock)!=-1);
+}
+
+StarSystemSummary StarSystemSummary::Get(const SystemPath &path)
+{
+	StarSystemSummary summary;
+	if (GetIfKnown(path, summary))
+		return summary;
+
+	// the system may have been cached since before its summary was
+	// thrown out, so it's not always stored by generating it
+	RefCountedPtr<StarSystem> s = StarSystem::GetCached(path);
+	summary = summarise(s.Get());
+	insert(summary);
+	return summary;
+}
+
+void StarSystemSummary::Store(const StarSystem *s)
+{
+	insert(summarise(s));
+}
@@ -0,0 +1,49 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _STARSYSTEMSUMMARY_H
+#define _STARSYSTEMSUMMARY_H
+
+#include "libs.h"
+#include "galaxy/StarSystem.h"
+#include "galaxy/SystemPath.h"
+
+class Faction;
+
+/*
+ * What most callers want to know about a system, without its bodies. Some
+ * of it comes from the sector, but the rest can only be had by generating
+ * the whole system, so a summary is taken from every system as it's
+ * generated and kept after the system itself has gone. Summaries are
+ * kept up to a fixed count, least recently used thrown out first. Safe to
+ * call from any thread, though a miss in Get generates the system, which
+ * is main thread only.
+ */
+class StarSystemSummary {
+public:
+	static void Init();
+	static void Uninit();
+
+	// generates the system if its summary isn't known yet
+	static StarSystemSummary Get(const SystemPath &path);
+	// false if the summary isn't known yet
+	static bool GetIfKnown(const SystemPath &path, StarSystemSummary &out);
+	// StarSystem calls this for each system it generates
+	static void Store(const StarSystem *s);
+
+	StarSystemSummary();
+
+	SystemPath path;
+	std::string name;
+	int numStars;
+	SystemBody::BodyType starType[4];
+	Faction *faction;
+	bool explored;
+	fixed lawlessness;
+	fixed population;
+	// some of EconType, or 0 if nobody lives there
+	int econType;
+	Uint32 numStarports;
+};
+
+#endif /* _STARSYSTEMSUMMARY_H */
@@ -0,0 +1,234 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "SystemIndex.h"
+#include "Sector.h"
+#include "SectorCache.h"
+#include "RefCounted.h"
+#include <algorithm>
+#include <list>
+
+namespace SystemIndex {
+
+// a few megabytes at most; regions near the core are the biggest
+static const size_t MAX_REGIONS = 256;
+static const int LEAF_SIZE = 8;
+
+struct Entry {
+	// from the region's corner, in light years
+	vector3f pos;
+	SystemPath path;
+};
+
+struct Node {
+	vector3f min, max;
+	int first, count;
+	// the left child is the next node
+	int right;
+};
+
+class Region : public AtomicRefCounted {
+public:
+	Region(int rx, int ry, int rz);
+	void FindInRange(const vector3f &pos, float radius, std::vector<SystemPath> &out) const;
+
+private:
+	int BuildNode(int first, int count);
+	void RangeNode(int node, const vector3f &pos, float radius, std::vector<SystemPath> &out) const;
+
+	std::vector<Entry> m_entries;
+	std::vector<Node> m_nodes;
+};
+
+struct AxisLess {
+	AxisLess(int axis) : m_axis(axis) {}
+	bool operator()(const Entry &a, const Entry &b) const { return a.pos[m_axis] < b.pos[m_axis]; }
+	int m_axis;
+};
+
+static float dist_to_box(const vector3f &min, const vector3f &max, const vector3f &pos)
+{
+	vector3f d(0.0f);
+	for (int i = 0; i < 3; i++) {
+		if (pos[i] < min[i]) d[i] = min[i] - pos[i];
+		else if (pos[i] > max[i]) d[i] = pos[i] - max[i];
+	}
+	return d.Length();
+}
+
+Region::Region(int rx, int ry, int rz)
+{
+	const int ox = rx*REGION_SECTORS, oy = ry*REGION_SECTORS, oz = rz*REGION_SECTORS;
+	for (int x = 0; x < REGION_SECTORS; x++) {
+		for (int y = 0; y < REGION_SECTORS; y++) {
+			for (int z = 0; z < REGION_SECTORS; z++) {
+				RefCountedPtr<const Sector> sec = SectorCache::Get(ox+x, oy+y, oz+z);
+				const vector3f corner = Sector::SIZE * vector3f(float(x), float(y), float(z));
+				for (Uint32 i = 0; i < sec->m_systems.size(); i++) {
+					Entry e;
+					e.pos = corner + sec->m_systems[i].p;
+					e.path = SystemPath(ox+x, oy+y, oz+z, i);
+					m_entries.push_back(e);
+				}
+			}
+		}
+	}
+
+	if (!m_entries.empty()) {
+		m_nodes.reserve(2 * m_entries.size() / LEAF_SIZE + 1);
+		BuildNode(0, int(m_entries.size()));
+	}
+}
+
+// split at the median along the longest side until the leaves are small
+int Region::BuildNode(int first, int count)
+{
+	const int index = int(m_nodes.size());
+	m_nodes.push_back(Node());
+
+	Node n;
+	n.min = n.max = m_entries[first].pos;
+	for (int i = first + 1; i < first + count; i++) {
+		const vector3f &p = m_entries[i].pos;
+		n.min = vector3f(std::min(n.min.x, p.x), std::min(n.min.y, p.y), std::min(n.min.z, p.z));
+		n.max = vector3f(std::max(n.max.x, p.x), std::max(n.max.y, p.y), std::max(n.max.z, p.z));
+	}
+	n.first = first;
+	n.count = count;
+	n.right = -1;
+
+	if (count > LEAF_SIZE) {
+		const vector3f size = n.max - n.min;
+		const int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+		const int half = count / 2;
+		std::vector<Entry>::iterator begin = m_entries.begin() + first;
+		std::nth_element(begin, begin + half, begin + count, AxisLess(axis));
+
+		BuildNode(first, half);
+		n.right = BuildNode(first + half, count - half);
+	}
+
+	m_nodes[index] = n;
+	return index;
+}
+
+void Region::RangeNode(int node, const vector3f &pos, float radius, std::vector<SystemPath> &out) const
+{
+	const Node &n = m_nodes[node];
+	if (dist_to_box(n.min, n.max, pos) > radius)
+		return;
+
+	if (n.right >= 0) {
+		RangeNode(node+1, pos, radius, out);
+		RangeNode(n.right, pos, radius, out);
+		return;
+	}
+
+	for (int i = n.first; i < n.first + n.count; i++)
+		if ((m_entries[i].pos - pos).Length() <= radius)
+			out.push_back(m_entries[i].path);
+}
+
+void Region::FindInRange(const vector3f &pos, float radius, std::vector<SystemPath> &out) const
+{
+	if (!m_nodes.empty())
+		RangeNode(0, pos, radius, out);
+}
+
+typedef std::list<std::pair<SystemPath, RefCountedPtr<const Region> > > RegionList;
+
+// most recently used first
+static RegionList s_regions;
+static std::map<SystemPath, RegionList::iterator> s_regionsByPath;
+static SDL_mutex *s_lock = 0;
+
+void Init()
+{
+	s_lock = SDL_CreateMutex();
+}
+
+void Uninit()
+{
+	s_regions.clear();
+	s_regionsByPath.clear();
+	SDL_DestroyMutex(s_lock);
+	s_lock = 0;
+}
+
+static RefCountedPtr<const Region> get_region(int rx, int ry, int rz)
+{
+	if (!s_lock) return RefCountedPtr<const Region>(new Region(rx, ry, rz));
+
+	const SystemPath path(rx, ry, rz);
+
+	PiVerify(SDL_mutexP(s_lock)==0);
+	std::map<SystemPath, RegionList::iterator>::iterator i = s_regionsByPath.find(path);
+	if (i != s_regionsByPath.end()) {
+		s_regions.splice(s_regions.begin(), s_regions, i->second);
+		RefCountedPtr<const Region> region = i->second->second;
+		PiVerify(SDL_mutexV(s_lock)!=-1);
+		return region;
+	}
+	PiVerify(SDL_mutexV(s_lock)!=-1);
+
+	// as SectorCache, built outside the lock and the first one in wins
+	RefCountedPtr<const Region> region(new Region(rx, ry, rz));
+
+	PiVerify(SDL_mutexP(s_lock)==0);
+	i = s_regionsByPath.find(path);
+	if (i != s_regionsByPath.end()) {
+		s_regions.splice(s_regions.begin(), s_regions, i->second);
+		region = i->second->second;
+	} else {
+		s_regionsByPath[path] = s_regions.insert(s_regions.begin(), std::make_pair(path, region));
+		while (s_regions.size() > MAX_REGIONS) {
+			s_regionsByPath.erase(s_regions.back().first);
+			s_regions.pop_back();
+		}
+	}
+	PiVerify(SDL_mutexV(s_lock)!=-1);
+
+	return region;
+}
+
+// rounding down, for negative sectors too
+static int region_of(int s)
+{
+	return (s >= 0) ? s / REGION_SECTORS : -((-s - 1) / REGION_SECTORS) - 1;
+}
+
+void FindInRange(const SystemPath &centre, float radius, std::vector<SystemPath> &out)
+{
+	out.clear();
+
+	RefCountedPtr<const Sector> sec = SectorCache::Get(centre);
+	const vector3f &p = sec->m_systems[centre.systemIndex].p;
+
+	const int reach = int(ceil(radius/Sector::SIZE));
+	const int rxMin = region_of(centre.sectorX - reach), rxMax = region_of(centre.sectorX + reach);
+	const int ryMin = region_of(centre.sectorY - reach), ryMax = region_of(centre.sectorY + reach);
+	const int rzMin = region_of(centre.sectorZ - reach), rzMax = region_of(centre.sectorZ + reach);
+
+	const float regionSize = REGION_SECTORS * Sector::SIZE;
+	for (int rx = rxMin; rx <= rxMax; rx++) {
+		for (int ry = ryMin; ry <= ryMax; ry++) {
+			for (int rz = rzMin; rz <= rzMax; rz++) {
+				// the centre, from this region's corner
+				const vector3f pos = p + Sector::SIZE * vector3f(
+					float(centre.sectorX - rx*REGION_SECTORS),
+					float(centre.sectorY - ry*REGION_SECTORS),
+					float(centre.sectorZ - rz*REGION_SECTORS));
+				if (dist_to_box(vector3f(0.0f), vector3f(regionSize), pos) > radius)
+					continue;
+
+				get_region(rx, ry, rz)->FindInRange(pos, radius, out);
+			}
+		}
+	}
+
+	const SystemPath self = centre.SystemOnly();
+	out.erase(std::remove(out.begin(), out.end(), self), out.end());
+	std::sort(out.begin(), out.end());
+}
+
+}
@@ -0,0 +1,36 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _SYSTEMINDEX_H
+#define _SYSTEMINDEX_H
+
+#include "libs.h"
+#include "galaxy/SystemPath.h"
+#include <vector>
+
+/*
+ * Range queries over system positions, for "which systems are near here"
+ * questions that would otherwise look at every system in a cube of
+ * sectors. The galaxy is split into regions REGION_SECTORS sectors on a
+ * side. The first time a region is searched, its systems' positions are
+ * taken from SectorCache and split into a tree of boxes. Regions are
+ * kept, least recently used thrown out first, up to a fixed count. A
+ * search only looks at regions that reach the sphere, and only at the
+ * boxes inside those that reach it. Safe to call from any thread.
+ */
+
+namespace SystemIndex
+{
+	// sectors along each side of a region
+	static const int REGION_SECTORS = 4;
+
+	// call after SectorCache::Init
+	void Init();
+	void Uninit();
+
+	// the systems no more than radius light years from centre's system,
+	// not counting that one, in path order
+	void FindInRange(const SystemPath &centre, float radius, std::vector<SystemPath> &out);
+}
+
+#endif /* _SYSTEMINDEX_H */
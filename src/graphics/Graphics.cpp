@@ -6,6 +6,7 @@
 #include "Material.h"
 #include "RendererGL2.h"
 #include "RendererLegacy.h"
+#include "RendererNull.h"
 #include "OS.h"
 
 static GLuint boundArrayBufferObject = 0;
@@ -14,6 +15,7 @@ static GLuint boundElementArrayBufferObject = 0;
 namespace Graphics {
 
 static bool initted = false;
+static bool contextAvailable = false;
 bool shadersAvailable = false;
 bool shadersEnabled = false;
 Material *vtxColorMaterial;
@@ -169,6 +171,26 @@ Renderer* Init(Settings vs)
 
 	printf("Initialized %s\n", renderer->GetName());
 
+	initted = true;
+	contextAvailable = true;
+
+	MaterialDescriptor desc;
+	desc.vertexColors = true;
+	vtxColorMaterial = renderer->CreateMaterial(desc);
+	vtxColorMaterial->IncRefCount();
+
+	Graphics::settings = vs;
+
+	return renderer;
+}
+
+Renderer* InitNull(Settings vs)
+{
+	assert(!initted);
+	if (initted) return 0;
+
+	Renderer *renderer = new RendererNull(vs);
+
 	initted = true;
 
 	MaterialDescriptor desc;
@@ -196,6 +218,11 @@ bool AreShadersEnabled()
 	return shadersEnabled;
 }
 
+bool IsContextAvailable()
+{
+	return contextAvailable;
+}
+
 std::vector<VideoMode> GetAvailableVideoModes()
 {
 	std::vector<VideoMode> modes;
@@ -58,8 +58,12 @@ namespace Graphics {
 
 	// does SDL video init, constructs appropriate Renderer
 	Renderer* Init(Settings);
+	// no window or GL context, for running headless. nothing gets drawn
+	Renderer* InitNull(Settings);
 	void Uninit();
 	bool AreShadersEnabled();
+	// false under the null renderer, for the bits that still call GL directly
+	bool IsContextAvailable();
 	std::vector<VideoMode> GetAvailableVideoModes();
 
 	void UnbindAllBuffers();
@@ -90,6 +90,7 @@ protected:
 private:
 	friend class RendererLegacy;
 	friend class RendererGL2;
+	friend class RendererNull;
 };
 
 }
@@ -0,0 +1,49 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "RendererNull.h"
+#include "Graphics.h"
+#include "Material.h"
+#include "Texture.h"
+
+namespace Graphics {
+
+namespace {
+	class TextureNull : public Texture {
+	public:
+		TextureNull(const TextureDescriptor &descriptor) : Texture(descriptor) {}
+		virtual void Update(const void *data, const vector2f &dataSize, ImageFormat format, ImageType type) {}
+		virtual void SetSampleMode(TextureSampleMode) {}
+	};
+}
+
+RendererNull::RendererNull(const Graphics::Settings &vs)
+: Renderer(vs.width, vs.height)
+{
+}
+
+RendererNull::~RendererNull()
+{
+}
+
+bool RendererNull::GetNearFarRange(float &near, float &far) const
+{
+	near = 10.f;
+	far = 1000000.0f;
+	return true;
+}
+
+Material *RendererNull::CreateMaterial(const MaterialDescriptor &desc)
+{
+	Material *m = new Material();
+	m->twoSided = desc.twoSided;
+	m->m_descriptor = desc;
+	return m;
+}
+
+Texture *RendererNull::CreateTexture(const TextureDescriptor &descriptor)
+{
+	return new TextureNull(descriptor);
+}
+
+}
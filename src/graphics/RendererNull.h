@@ -0,0 +1,40 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _RENDERER_NULL_H
+#define _RENDERER_NULL_H
+/*
+ * Renderer that draws nothing and needs no window or GL context, for
+ * running the simulation headless. Materials and textures can still be
+ * created so models load; texture data is thrown away.
+ */
+#include "Renderer.h"
+
+namespace Graphics {
+
+struct Settings;
+
+class RendererNull : public Renderer
+{
+public:
+	RendererNull(const Graphics::Settings &vs);
+	virtual ~RendererNull();
+
+	virtual const char* GetName() const { return "Null renderer"; }
+	virtual bool GetNearFarRange(float &near, float &far) const;
+
+	virtual bool BeginFrame() { return true; }
+	virtual bool EndFrame() { return true; }
+	virtual bool SwapBuffers() { return true; }
+
+	virtual Material *CreateMaterial(const MaterialDescriptor &descriptor);
+	virtual Texture *CreateTexture(const TextureDescriptor &descriptor);
+
+protected:
+	virtual void PushState() { }
+	virtual void PopState() { }
+};
+
+}
+
+#endif
@@ -199,6 +199,117 @@ double noise( const double x, const double y, const double z ) {
 	return 32.0*(n0 + n1 + n2 + n3);
 }
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PERLIN_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef PERLIN_USE_SSE2
+
+// noise() for two points at once. this follows the scalar version operation
+// for operation (including the order of the final sum) so the results are
+// bit-identical; only the hash and gradient lookups are done per lane.
+// contribution of one simplex corner, zero where it's out of range
+static inline __m128d corner2(const __m128d x, const __m128d y, const __m128d z, const int gi[2])
+{
+	__m128d t = _mm_sub_pd(_mm_sub_pd(_mm_sub_pd(_mm_set1_pd(0.6),
+		_mm_mul_pd(x, x)), _mm_mul_pd(y, y)), _mm_mul_pd(z, z));
+	const __m128d inside = _mm_cmpge_pd(t, _mm_setzero_pd());
+	t = _mm_mul_pd(t, t);
+	const double *g0 = grad3[gi[0]], *g1 = grad3[gi[1]];
+	const __m128d d = _mm_add_pd(_mm_add_pd(
+		_mm_mul_pd(_mm_set_pd(g1[0], g0[0]), x),
+		_mm_mul_pd(_mm_set_pd(g1[1], g0[1]), y)),
+		_mm_mul_pd(_mm_set_pd(g1[2], g0[2]), z));
+	return _mm_and_pd(inside, _mm_mul_pd(_mm_mul_pd(t, t), d));
+}
+
+static inline __m128d noise2(const __m128d x, const __m128d y, const __m128d z)
+{
+	const __m128d zero = _mm_setzero_pd();
+	const __m128d one = _mm_set1_pd(1.0);
+	const __m128d F3 = _mm_set1_pd(1.0/3.0);
+	const __m128d G3 = _mm_set1_pd(1.0/6.0);
+	const __m128d G3x2 = _mm_set1_pd(2.0*(1.0/6.0));
+	const __m128d G3x3 = _mm_set1_pd(3.0*(1.0/6.0));
+	const __m128d all = _mm_cmpeq_pd(zero, zero);
+
+	const __m128d s = _mm_mul_pd(_mm_add_pd(_mm_add_pd(x, y), z), F3);
+
+	// fastfloor: truncate v if v > 0, else v-1
+	__m128d v;
+	v = _mm_add_pd(x, s);
+	const __m128i i = _mm_cvttpd_epi32(_mm_sub_pd(v, _mm_andnot_pd(_mm_cmpgt_pd(v, zero), one)));
+	v = _mm_add_pd(y, s);
+	const __m128i j = _mm_cvttpd_epi32(_mm_sub_pd(v, _mm_andnot_pd(_mm_cmpgt_pd(v, zero), one)));
+	v = _mm_add_pd(z, s);
+	const __m128i k = _mm_cvttpd_epi32(_mm_sub_pd(v, _mm_andnot_pd(_mm_cmpgt_pd(v, zero), one)));
+
+	const __m128d t = _mm_mul_pd(_mm_cvtepi32_pd(_mm_add_epi32(_mm_add_epi32(i, j), k)), G3);
+	const __m128d x0 = _mm_sub_pd(x, _mm_sub_pd(_mm_cvtepi32_pd(i), t));
+	const __m128d y0 = _mm_sub_pd(y, _mm_sub_pd(_mm_cvtepi32_pd(j), t));
+	const __m128d z0 = _mm_sub_pd(z, _mm_sub_pd(_mm_cvtepi32_pd(k), t));
+
+	// the six-way simplex choice, as masks
+	const __m128d xy = _mm_cmpge_pd(x0, y0);
+	const __m128d yz = _mm_cmpge_pd(y0, z0);
+	const __m128d xz = _mm_cmpge_pd(x0, z0);
+	const __m128d m_i1 = _mm_and_pd(xy, _mm_or_pd(yz, xz));
+	const __m128d m_j1 = _mm_andnot_pd(xy, yz);
+	const __m128d m_k1 = _mm_andnot_pd(_mm_or_pd(yz, _mm_and_pd(xy, xz)), all);
+	const __m128d m_i2 = _mm_or_pd(xy, _mm_and_pd(yz, xz));
+	const __m128d m_j2 = _mm_or_pd(_mm_andnot_pd(xy, _mm_cmpeq_pd(zero, zero)), yz);
+	const __m128d m_k2 = _mm_andnot_pd(_mm_and_pd(yz, _mm_or_pd(xy, xz)), all);
+
+	const __m128d x1 = _mm_add_pd(_mm_sub_pd(x0, _mm_and_pd(m_i1, one)), G3);
+	const __m128d y1 = _mm_add_pd(_mm_sub_pd(y0, _mm_and_pd(m_j1, one)), G3);
+	const __m128d z1 = _mm_add_pd(_mm_sub_pd(z0, _mm_and_pd(m_k1, one)), G3);
+	const __m128d x2 = _mm_add_pd(_mm_sub_pd(x0, _mm_and_pd(m_i2, one)), G3x2);
+	const __m128d y2 = _mm_add_pd(_mm_sub_pd(y0, _mm_and_pd(m_j2, one)), G3x2);
+	const __m128d z2 = _mm_add_pd(_mm_sub_pd(z0, _mm_and_pd(m_k2, one)), G3x2);
+	const __m128d x3 = _mm_add_pd(_mm_sub_pd(x0, one), G3x3);
+	const __m128d y3 = _mm_add_pd(_mm_sub_pd(y0, one), G3x3);
+	const __m128d z3 = _mm_add_pd(_mm_sub_pd(z0, one), G3x3);
+
+	// hashed gradients, per lane
+	int ia[4], ja[4], ka[4];
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(ia), i);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(ja), j);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(ka), k);
+	const int i1 = _mm_movemask_pd(m_i1), j1 = _mm_movemask_pd(m_j1), k1 = _mm_movemask_pd(m_k1);
+	const int i2 = _mm_movemask_pd(m_i2), j2 = _mm_movemask_pd(m_j2), k2 = _mm_movemask_pd(m_k2);
+	int gi[4][2];
+	for (int l = 0; l < 2; l++) {
+		const int ii = ia[l] & 255;
+		const int jj = ja[l] & 255;
+		const int kk = ka[l] & 255;
+		gi[0][l] = mod12[perm[ii+perm[jj+perm[kk]]]];
+		gi[1][l] = mod12[perm[ii+((i1>>l)&1)+perm[jj+((j1>>l)&1)+perm[kk+((k1>>l)&1)]]]];
+		gi[2][l] = mod12[perm[ii+((i2>>l)&1)+perm[jj+((j2>>l)&1)+perm[kk+((k2>>l)&1)]]]];
+		gi[3][l] = mod12[perm[ii+1+perm[jj+1+perm[kk+1]]]];
+	}
+
+	__m128d n;
+	n = corner2(x0, y0, z0, gi[0]);
+	n = _mm_add_pd(n, corner2(x1, y1, z1, gi[1]));
+	n = _mm_add_pd(n, corner2(x2, y2, z2, gi[2]));
+	n = _mm_add_pd(n, corner2(x3, y3, z3, gi[3]));
+	return _mm_mul_pd(_mm_set1_pd(32.0), n);
+}
+
+#endif /* PERLIN_USE_SSE2 */
+
+void noise(const double *x, const double *y, const double *z, double *out, int count)
+{
+	int n = 0;
+#ifdef PERLIN_USE_SSE2
+	for (; n + 2 <= count; n += 2)
+		_mm_storeu_pd(&out[n], noise2(_mm_loadu_pd(&x[n]), _mm_loadu_pd(&y[n]), _mm_loadu_pd(&z[n])));
+#endif
+	for (; n < count; n++)
+		out[n] = noise(x[n], y[n], z[n]);
+}
+
 #ifdef UNIT_TEST
 #include <stdlib.h>
 #include <stdio.h>
@@ -11,4 +11,8 @@ static inline double noise(const vector3d &p) {
 	return noise(p.x, p.y, p.z);
 }
 
+// noise() for count points given as separate x, y and z arrays. gives exactly
+// the same results as calling noise() on each point, just faster
+void noise(const double *x, const double *y, const double *z, double *out, int count);
+
 #endif /* _PERLIN_H */
@@ -10,6 +10,8 @@
 #include <sys/stat.h>
 #include <dirent.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 
 #ifdef _XCODE
 #include "CoreFoundation/CoreFoundation.h"
@@ -140,6 +142,34 @@ namespace FileSystem {
 		}
 	}
 
+	class FileDataMapped : public FileData {
+	public:
+		FileDataMapped(const FileInfo &info, size_t size, char *data):
+			FileData(info, size, data) {}
+		virtual ~FileDataMapped() { munmap(m_data, m_size); }
+	};
+
+	RefCountedPtr<FileData> FileSourceFS::MapFile(const std::string &path)
+	{
+		const std::string fullpath = JoinPathBelow(GetRoot(), path);
+		const int fd = open(fullpath.c_str(), O_RDONLY);
+		if (fd < 0) {
+			return RefCountedPtr<FileData>(0);
+		}
+		struct stat statinfo;
+		// empty files can't be mapped
+		if (fstat(fd, &statinfo) != 0 || statinfo.st_size == 0) {
+			close(fd);
+			return ReadFile(path);
+		}
+		void *data = mmap(0, statinfo.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (data == MAP_FAILED) {
+			return ReadFile(path);
+		}
+		return RefCountedPtr<FileData>(new FileDataMapped(MakeFileInfo(path, FileInfo::FT_FILE), statinfo.st_size, reinterpret_cast<char*>(data)));
+	}
+
 	bool FileSourceFS::ReadDirectory(const std::string &dirpath, std::vector<FileInfo> &output)
 	{
 		const std::string fulldirpath = JoinPathBelow(GetRoot(), dirpath);
@@ -238,4 +268,10 @@ namespace FileSystem {
 		const std::string fullpath = JoinPathBelow(GetRoot(), path);
 		return fopen(fullpath.c_str(), (flags & WRITE_TEXT) ? "w" : "wb");
 	}
+
+	bool FileSourceFS::RemoveFile(const std::string &path)
+	{
+		const std::string fullpath = JoinPathBelow(GetRoot(), path);
+		return (unlink(fullpath.c_str()) == 0);
+	}
 }
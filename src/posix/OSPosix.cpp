@@ -7,6 +7,7 @@
 #include <SDL.h>
 #include <sys/time.h>
 #include <fenv.h>
+#include <unistd.h>
 
 namespace OS {
 
@@ -104,4 +105,10 @@ Uint64 HFTimer()
 	return Uint64(t.tv_sec)*1000000 + Uint64(t.tv_usec);
 }
 
+int GetNumCores()
+{
+	const long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? int(n) : 1;
+}
+
 } // namespace OS
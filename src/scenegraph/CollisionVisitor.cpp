@@ -7,6 +7,7 @@
 #include "Group.h"
 #include "MatrixTransform.h"
 #include "StaticGeometry.h"
+#include "GeomTreeCache.h"
 #include "graphics/StaticMesh.h"
 #include "graphics/Surface.h"
 
@@ -140,7 +141,7 @@ RefCountedPtr<CollMesh> CollisionVisitor::CreateCollisionMesh()
 	assert(m_collMesh->GetGeomTree() == 0);
 	assert(!vts.empty() && !ind.empty());
 
-	GeomTree *t = new GeomTree(
+	GeomTree *t = GeomTreeCache::Build(
 		vts.size(), ind.size()/3, reinterpret_cast<float*>(&vts[0]), &ind[0], &m_collMesh->m_flags[0]);
 	m_collMesh->SetGeomTree(t);
 	m_boundingRadius = m_collMesh->GetAabb().GetRadius();
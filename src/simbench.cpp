@@ -0,0 +1,223 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+// runs the game headless for a fixed number of physics ticks and times
+// them. no window or GL needed. either loads a save or starts a game in a
+// system and fills it with AI ships, a third sat docked and the rest
+// flying to dock somewhere. output is tab separated, one line per part of
+// Space::TimeStep, lines starting with # are comments:
+//
+//   phase  ms  us_per_tick  percent
+//
+// "other" is what Game::TimeStep spends outside Space::TimeStep.
+//
+// usage: simbench [-l savefile | -p x,y,z,system[,body]] [-s ships] [-T]
+//                 [-n ticks] [-a accel] [-r seed]
+//
+// -T leaves the TradeShips module out. accel is 1, 10, 100, 1000 or 10000
+
+#include "libs.h"
+#include "Pi.h"
+#include "Game.h"
+#include "LuaEvent.h"
+#include "MathUtil.h"
+#include "OS.h"
+#include "Player.h"
+#include "Serializer.h"
+#include "Ship.h"
+#include "ShipType.h"
+#include "Space.h"
+#include "SpaceStation.h"
+#include "galaxy/StarSystem.h"
+
+static Game::TimeAccel accel_for_rate(int rate)
+{
+	switch (rate) {
+		case 1: return Game::TIMEACCEL_1X;
+		case 10: return Game::TIMEACCEL_10X;
+		case 100: return Game::TIMEACCEL_100X;
+		case 1000: return Game::TIMEACCEL_1000X;
+		case 10000: return Game::TIMEACCEL_10000X;
+		default: return Game::TIMEACCEL_PAUSED;
+	}
+}
+
+// a game in the system at path, docked at its first starport if no body
+// is given, as the main menu would start it
+static Game *start_game(SystemPath path)
+{
+	RefCountedPtr<StarSystem> system(StarSystem::GetCached(path));
+
+	if (!path.IsBodyPath()) {
+		if (system->m_spaceStations.empty())
+			path = system->rootBody->path;
+		else
+			path = system->m_spaceStations.front()->path;
+	}
+
+	SystemBody *sbody = system->GetBodyByPath(path);
+	if (sbody->GetSuperType() == SystemBody::SUPERTYPE_STARPORT)
+		return new Game(path);
+	else
+		return new Game(path, vector3d(0, 1.5*sbody->GetRadius(), 0));
+}
+
+static void spawn_ships(int count)
+{
+	Space *space = Pi::game->GetSpace();
+
+	std::vector<SpaceStation*> stations;
+	for (Space::BodyIterator i = space->BodiesBegin(); i != space->BodiesEnd(); ++i)
+		if ((*i)->IsType(Object::SPACESTATION))
+			stations.push_back(static_cast<SpaceStation*>(*i));
+	if (stations.empty()) {
+		printf("# no starports, no ships spawned\n");
+		return;
+	}
+
+	const std::vector<ShipType::Id> &types = ShipType::player_ships;
+
+	int docked = 0, flying = 0;
+	for (int n = 0; n < count; n++) {
+		SpaceStation *from = stations[n % stations.size()];
+		Ship *ship = new Ship(types[Pi::rng.Int32(types.size())]);
+
+		const int port = from->GetFreeDockingPort();
+		if (n % 3 == 0 && port >= 0) {
+			ship->SetFrame(from->GetFrame());
+			space->AddBody(ship);
+			ship->SetDockedWith(from, port);
+			docked++;
+			continue;
+		}
+
+		// as Space.SpawnShipNear does it
+		Frame *frame = from->GetFrame();
+		const vector3d pos = MathUtil::RandomPointOnSphere(10000.0, 20000.0) + from->GetPosition();
+		if (frame->IsRotFrame() && frame->GetRadius() < pos.Length())
+			frame = frame->GetParent();
+
+		ship->SetFrame(frame);
+		ship->SetPosition(pos);
+		ship->SetVelocity(vector3d(0.0));
+		space->AddBody(ship);
+		ship->AIDock(stations[Pi::rng.Int32(stations.size())]);
+		flying++;
+	}
+
+	printf("# spawned %d ships, %d docked, %d flying to dock\n", docked + flying, docked, flying);
+}
+
+static double ms(Uint64 ticks)
+{
+	return double(ticks) * 1000.0 / double(OS::HFTimerFreq());
+}
+
+int main(int argc, char **argv)
+{
+	std::string saveFile;
+	SystemPath path(0, 0, 0, 0);
+	int numShips = 50;
+	bool tradeShips = true;
+	int numTicks = 1000;
+	int accelRate = 1000;
+	Uint32 seed = 1;
+
+	for (int i = 1; i < argc; i++) {
+		const std::string arg(argv[i]);
+		int x, y, z, si, bi = -1;
+		if (i+1 < argc && arg == "-l") saveFile = argv[++i];
+		else if (i+1 < argc && arg == "-p" && sscanf(argv[i+1], "%d,%d,%d,%d,%d", &x, &y, &z, &si, &bi) >= 4) {
+			path = bi >= 0 ? SystemPath(x, y, z, si, bi) : SystemPath(x, y, z, si);
+			i++;
+		}
+		else if (i+1 < argc && arg == "-s") numShips = atoi(argv[++i]);
+		else if (arg == "-T") tradeShips = false;
+		else if (i+1 < argc && arg == "-n") numTicks = atoi(argv[++i]);
+		else if (i+1 < argc && arg == "-a") accelRate = atoi(argv[++i]);
+		else if (i+1 < argc && arg == "-r") seed = atoi(argv[++i]);
+		else {
+			fprintf(stderr, "usage: simbench [-l savefile | -p x,y,z,system[,body]] [-s ships] [-T] [-n ticks] [-a accel] [-r seed]\n");
+			return 1;
+		}
+	}
+
+	const Game::TimeAccel accel = accel_for_rate(accelRate);
+	if (accel == Game::TIMEACCEL_PAUSED) {
+		fprintf(stderr, "simbench: accel must be 1, 10, 100, 1000 or 10000\n");
+		return 1;
+	}
+	numTicks = std::max(numTicks, 1);
+
+	std::set<std::string> skipLua;
+	if (!tradeShips) skipLua.insert("modules/TradeShips.lua");
+	Pi::InitHeadless(skipLua);
+	Pi::rng.seed(seed);
+
+	Pi::InitGame();
+	if (!saveFile.empty()) {
+		try {
+			Pi::game = Game::LoadGame(saveFile);
+		}
+		catch (SavedGameCorruptException) {
+			fprintf(stderr, "simbench: %s is corrupt\n", saveFile.c_str());
+			return 1;
+		}
+		catch (CouldNotOpenFileException) {
+			fprintf(stderr, "simbench: couldn't open %s\n", saveFile.c_str());
+			return 1;
+		}
+	} else {
+		Pi::game = start_game(path);
+		spawn_ships(numShips);
+	}
+
+	// as Pi::StartGame does, so the modules set themselves up
+	LuaEvent::Queue("onGameStart");
+	LuaEvent::Emit();
+
+	Pi::game->SetTimeAccel(accel);
+	const float step = Pi::game->GetTimeStep();
+
+	int numBodies = 0;
+	for (Space::BodyIterator i = Pi::game->GetSpace()->BodiesBegin(); i != Pi::game->GetSpace()->BodiesEnd(); ++i)
+		numBodies++;
+	printf("# %s, %d bodies, %d ticks of %gs (%dx)%s\n",
+		Pi::game->GetSpace()->GetStarSystem() ? Pi::game->GetSpace()->GetStarSystem()->GetName().c_str() : "hyperspace",
+		numBodies, numTicks, step, accelRate, tradeShips ? "" : ", no TradeShips");
+
+	Space::ResetPhaseTimes();
+	Space::SetPhaseTiming(true);
+
+	const Uint64 start = OS::HFTimer();
+	int ticks = 0;
+	while (ticks < numTicks && Pi::game && !Pi::player->IsDead()) {
+		Pi::game->TimeStep(step);
+		ticks++;
+	}
+	const Uint64 total = OS::HFTimer() - start;
+
+	Space::SetPhaseTiming(false);
+
+	if (ticks < numTicks)
+		printf("# player died after %d ticks\n", ticks);
+
+	Uint64 phases = 0;
+	for (int p = 0; p < Space::PHASE_MAX; p++) {
+		const Uint64 t = Space::GetPhaseTime(Space::Phase(p));
+		phases += t;
+		printf("%s\t%.2f\t%.2f\t%.1f\n", Space::GetPhaseName(Space::Phase(p)), ms(t), ms(t) * 1000.0 / ticks, 100.0 * double(t) / double(total));
+	}
+	const Uint64 other = total > phases ? total - phases : 0;
+	printf("other\t%.2f\t%.2f\t%.1f\n", ms(other), ms(other) * 1000.0 / ticks, 100.0 * double(other) / double(total));
+
+	printf("# %d ticks in %.2fms, %.1f ticks/sec\n", ticks, ms(total), ticks * 1000.0 / ms(total));
+
+	StarSystem::CacheStats systems;
+	StarSystem::GetCacheStats(systems);
+	printf("# %d systems cached (%dKB), %u hits, %u misses\n", systems.numSystems, int(systems.size >> 10), systems.hits, systems.misses);
+
+	delete Pi::game;
+	Pi::game = 0;
+	Pi::Quit();
+}
@@ -329,63 +329,15 @@ Terrain *Terrain::InstanceTerrain(const SystemBody *body)
 	return gi(body);
 }
 
-static size_t bufread_or_die(void *ptr, size_t size, size_t nmemb, ByteRange &buf)
-{
-	size_t read_count = buf.read(reinterpret_cast<char*>(ptr), size, nmemb);
-	if (read_count < nmemb) {
-		fprintf(stderr, "Error: failed to read file (truncated)\n");
-		abort();
-	}
-	return read_count;
-}
-
-Terrain::Terrain(const SystemBody *body) : m_body(body), m_seed(body->seed), m_rand(body->seed), m_heightMap(0), m_heightMapScaled(0), m_heightScaling(0), m_minh(0) {
+Terrain::Terrain(const SystemBody *body) : m_body(body), m_seed(body->seed), m_rand(body->seed), m_heightMap(0), m_heightScaling(0), m_minh(0) {
 
-	// load the heightmap
+	// load the heightmap. tiled maps are mapped, not read, so this is cheap
 	if (m_body->heightMapFilename) {
-		RefCountedPtr<FileSystem::FileData> fdata = FileSystem::gameDataFiles.ReadFile(m_body->heightMapFilename);
-		if (!fdata) {
-			fprintf(stderr, "Error: could not open file '%s'\n", m_body->heightMapFilename);
-			abort();
-		}
-
-		ByteRange databuf = fdata->AsByteRange();
-
-		// read size!
-		Uint16 v;
-
-		// XXX unify heightmap types
-		switch (m_body->heightMapFractal) {
-			case 0: {
-				bufread_or_die(&v, 2, 1, databuf); m_heightMapSizeX = v;
-				bufread_or_die(&v, 2, 1, databuf); m_heightMapSizeY = v;
-
-				m_heightMap = new Sint16[m_heightMapSizeX * m_heightMapSizeY];
-				bufread_or_die(m_heightMap, sizeof(Sint16), m_heightMapSizeX * m_heightMapSizeY, databuf);
-				break;
-			}
-
-			case 1: {
-				// XXX x and y reversed from above *sigh*
-				bufread_or_die(&v, 2, 1, databuf); m_heightMapSizeY = v;
-				bufread_or_die(&v, 2, 1, databuf); m_heightMapSizeX = v;
-
-				// read height scaling and min height which are doubles
-				double te;
-				bufread_or_die(&te, 8, 1, databuf);
-				m_heightScaling = te;
-				bufread_or_die(&te, 8, 1, databuf);
-				m_minh = te;
-
-				m_heightMapScaled = new Uint16[m_heightMapSizeX * m_heightMapSizeY];
-				bufread_or_die(m_heightMapScaled, sizeof(Uint16), m_heightMapSizeX * m_heightMapSizeY, databuf);
-
-				break;
-			}
-
-			default:
-				assert(0);
-		}
+		m_heightMap = TiledHeightMap::Load(m_body->heightMapFilename, TiledHeightMap::Type(m_body->heightMapFractal));
+		m_heightMapSizeX = m_heightMap->GetSizeX();
+		m_heightMapSizeY = m_heightMap->GetSizeY();
+		m_heightScaling = m_heightMap->GetHeightScaling();
+		m_minh = m_heightMap->GetMinHeight();
 	}
 
 	switch (Pi::detail.textures) {
@@ -553,10 +505,7 @@ Terrain::Terrain(const SystemBody *body) : m_body(body), m_seed(body->seed), m_r
 
 Terrain::~Terrain()
 {
-	if (m_heightMap)
-		delete [] m_heightMap;
-	if (m_heightMapScaled)
-		delete [] m_heightMapScaled;
+	delete m_heightMap;
 }
 
 
@@ -573,3 +522,18 @@ void Terrain::SetFracDef(unsigned int index, double featureHeightMeters, double
 	m_fracdef[index].lacunarity = 2.0;
 	//printf("%d octaves\n", m_fracdef[index].octaves); //print
 }
+
+void Terrain::GetHeights(const double *x, const double *y, const double *z, double *heights, int count)
+{
+	for (int i = 0; i < count; i += MAX_BATCH)
+		GetHeightBatch(&x[i], &y[i], &z[i], &heights[i], std::min(count-i, int(MAX_BATCH)));
+}
+
+void Terrain::GetColors(const double *x, const double *y, const double *z, const double *heights,
+	const double *nx, const double *ny, const double *nz, vector3d *colors, int count)
+{
+	for (int i = 0; i < count; i += MAX_BATCH) {
+		const int n = std::min(count-i, int(MAX_BATCH));
+		GetColorBatch(&x[i], &y[i], &z[i], &heights[i], &nx[i], &ny[i], &nz[i], &colors[i], n);
+	}
+}
@@ -6,6 +6,7 @@
 
 #include "libs.h"
 #include "galaxy/StarSystem.h"
+#include "TiledHeightMap.h"
 
 #ifdef _MSC_VER
 #pragma warning(disable : 4250)			// workaround for MSVC 2008 multiple inheritance bug
@@ -43,6 +44,14 @@ public:
 	virtual double GetHeight(const vector3d &p) = 0;
 	virtual vector3d GetColor(const vector3d &p, double height, const vector3d &norm) = 0;
 
+	// batch versions of GetHeight() and GetColor(), for any number of points
+	// given as separate x, y and z arrays. results match the single-point
+	// calls exactly
+	enum { MAX_BATCH = 64 };
+	void GetHeights(const double *x, const double *y, const double *z, double *heights, int count);
+	void GetColors(const double *x, const double *y, const double *z, const double *heights,
+		const double *nx, const double *ny, const double *nz, vector3d *colors, int count);
+
 	virtual const char *GetHeightFractalName() const = 0;
 	virtual const char *GetColorFractalName() const = 0;
 
@@ -60,6 +69,11 @@ private:
 protected:
 	Terrain(const SystemBody *body);
 
+	// called by GetHeights() and GetColors() with at most MAX_BATCH points
+	virtual void GetHeightBatch(const double *x, const double *y, const double *z, double *heights, int count) = 0;
+	virtual void GetColorBatch(const double *x, const double *y, const double *z, const double *heights,
+		const double *nx, const double *ny, const double *nz, vector3d *colors, int count) = 0;
+
 	bool textures;
 	int m_fracnum;
 	double m_fracmult;
@@ -75,12 +89,9 @@ protected:
 
 	Uint32 m_surfaceEffects;
 
-	// heightmap stuff
-	// XXX unify heightmap types
-	// for the earth heightmap
-	Sint16 *m_heightMap;
-	// For the moon and other bodies (with height scaling)
-	Uint16 *m_heightMapScaled;
+	// heightmap stuff. TYPE_HEIGHTS for the earth heightmap, TYPE_SCALED
+	// for the moon and other bodies (with height scaling)
+	TiledHeightMap *m_heightMap;
 	double m_heightScaling, m_minh;
 
 	int m_heightMapSizeX;
@@ -123,6 +134,7 @@ public:
 	virtual const char *GetHeightFractalName() const;
 protected:
 	TerrainHeightFractal(const SystemBody *body);
+	virtual void GetHeightBatch(const double *x, const double *y, const double *z, double *heights, int count);
 private:
 	TerrainHeightFractal() {}
 };
@@ -134,6 +146,8 @@ public:
 	virtual const char *GetColorFractalName() const;
 protected:
 	TerrainColorFractal(const SystemBody *body);
+	virtual void GetColorBatch(const double *x, const double *y, const double *z, const double *heights,
+		const double *nx, const double *ny, const double *nz, vector3d *colors, int count);
 private:
 	TerrainColorFractal() {}
 };
@@ -242,6 +256,35 @@ class TerrainColorTFGood;
 class TerrainColorTFPoor;
 class TerrainColorVolcanic;
 
+
+// by default a batch just runs the single-point version over each point. the
+// call is direct rather than through the vtable, but fractals that are cheap
+// to vectorise should specialise these and use the batch noise functions
+template <typename HeightFractal>
+void TerrainHeightFractal<HeightFractal>::GetHeightBatch(const double *x, const double *y, const double *z, double *heights, int count)
+{
+	for (int i = 0; i < count; i++)
+		heights[i] = TerrainHeightFractal<HeightFractal>::GetHeight(vector3d(x[i], y[i], z[i]));
+}
+
+template <typename ColorFractal>
+void TerrainColorFractal<ColorFractal>::GetColorBatch(const double *x, const double *y, const double *z, const double *heights,
+	const double *nx, const double *ny, const double *nz, vector3d *colors, int count)
+{
+	for (int i = 0; i < count; i++)
+		colors[i] = TerrainColorFractal<ColorFractal>::GetColor(vector3d(x[i], y[i], z[i]), heights[i], vector3d(nx[i], ny[i], nz[i]));
+}
+
+// fractals with their own batch implementation
+template <> void TerrainHeightFractal<TerrainHeightFlat>::GetHeightBatch(const double *x, const double *y, const double *z, double *heights, int count);
+template <> void TerrainHeightFractal<TerrainHeightAsteroid>::GetHeightBatch(const double *x, const double *y, const double *z, double *heights, int count);
+template <> void TerrainHeightFractal<TerrainHeightAsteroid3>::GetHeightBatch(const double *x, const double *y, const double *z, double *heights, int count);
+template <> void TerrainHeightFractal<TerrainHeightBarrenRock>::GetHeightBatch(const double *x, const double *y, const double *z, double *heights, int count);
+template <> void TerrainHeightFractal<TerrainHeightBarrenRock2>::GetHeightBatch(const double *x, const double *y, const double *z, double *heights, int count);
+template <> void TerrainHeightFractal<TerrainHeightBarrenRock3>::GetHeightBatch(const double *x, const double *y, const double *z, double *heights, int count);
+template <> void TerrainColorFractal<TerrainColorAsteroid>::GetColorBatch(const double *x, const double *y, const double *z, const double *heights,
+	const double *nx, const double *ny, const double *nz, vector3d *colors, int count);
+
 #ifdef _MSC_VER
 #pragma warning(default : 4250)
 #endif
@@ -46,3 +46,37 @@ vector3d TerrainColorFractal<TerrainColorAsteroid>::GetColor(const vector3d &p,
 	}
 }
 
+
+template <>
+void TerrainColorFractal<TerrainColorAsteroid>::GetColorBatch(const double *x, const double *y, const double *z, const double *heights,
+	const double *nx, const double *ny, const double *nz, vector3d *colors, int count)
+{
+	double qx[MAX_BATCH], qy[MAX_BATCH], qz[MAX_BATCH], desert[MAX_BATCH];
+	for (int i = 0; i < count; i++) {
+		const double s = (m_invMaxHeight*heights[i]/2)*2.0;
+		qx[i] = s*x[i];
+		qy[i] = s*y[i];
+		qz[i] = s*z[i];
+	}
+	octavenoise(12, 0.5, 2.0, qx, qy, qz, desert, count);
+
+	for (int i = 0; i < count; i++) {
+		const vector3d p(x[i], y[i], z[i]);
+		const double n = m_invMaxHeight*heights[i]/2;
+		const double flatness = pow(p.Dot(vector3d(nx[i], ny[i], nz[i])), 6.0);
+		const double equatorial_desert = (2.0)*(-1.0+2.0*desert[i]) *
+			1.0*(2.0)*(1.0-p.y*p.y);
+
+		vector3d col;
+		if (n <= 0.02) {
+			col = interpolate_color(equatorial_desert, m_rockColor[0], m_greyrockColor[3]);
+			col = interpolate_color(n, col, vector3d(1.5,1.35,1.3));
+			col = interpolate_color(flatness, m_rockColor[1], col);
+		} else {
+			col = interpolate_color(equatorial_desert, m_greyrockColor[0], m_greyrockColor[2]);
+			col = interpolate_color(n, col, m_rockColor[3]);
+			col = interpolate_color(flatness, m_greyrockColor[1], col);
+		}
+		colors[i] = col;
+	}
+}
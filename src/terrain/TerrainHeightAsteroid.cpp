@@ -34,3 +34,12 @@ double TerrainHeightFractal<TerrainHeightAsteroid>::GetHeight(const vector3d &p)
 
 	return (n > 0.0? m_maxHeight*n : 0.0);
 }
+
+template <>
+void TerrainHeightFractal<TerrainHeightAsteroid>::GetHeightBatch(const double *x, const double *y, const double *z, double *heights, int count)
+{
+	octavenoise(8, 0.4, 2.4, x, y, z, heights, count);
+
+	for (int i = 0; i < count; i++)
+		heights[i] = (heights[i] > 0.0? m_maxHeight*heights[i] : 0.0);
+}
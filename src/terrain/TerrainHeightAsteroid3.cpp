@@ -25,3 +25,16 @@ double TerrainHeightFractal<TerrainHeightAsteroid3>::GetHeight(const vector3d &p
 
 	return (n > 0.0? m_maxHeight*n : 0.0);
 }
+
+template <>
+void TerrainHeightFractal<TerrainHeightAsteroid3>::GetHeightBatch(const double *x, const double *y, const double *z, double *heights, int count)
+{
+	double ridged[MAX_BATCH];
+	octavenoise(8, 0.5, 4.0, x, y, z, heights, count);
+	ridged_octavenoise(8, 0.5, 4.0, x, y, z, ridged, count);
+
+	for (int i = 0; i < count; i++) {
+		const double n = heights[i] * ridged[i];
+		heights[i] = (n > 0.0? m_maxHeight*n : 0.0);
+	}
+}
@@ -32,3 +32,21 @@ double TerrainHeightFractal<TerrainHeightBarrenRock>::GetHeight(const vector3d &
 
 	return (n > 0.0? n : 0.0);
 }
+
+template <>
+void TerrainHeightFractal<TerrainHeightBarrenRock>::GetHeightBatch(const double *x, const double *y, const double *z, double *heights, int count)
+{
+	double roughness[MAX_BATCH], lacunarity[MAX_BATCH];
+	octavenoise(8, 0.4, 2.5, x, y, z, roughness, count);
+	octavenoise(8, 0.257, 4.0, x, y, z, lacunarity, count);
+	for (int i = 0; i < count; i++) {
+		roughness[i] = 0.5*roughness[i];
+		lacunarity[i] = Clamp(5.0*lacunarity[i], 1.0, 5.0);
+	}
+	ridged_octavenoise(16, roughness, lacunarity, x, y, z, heights, count);
+
+	for (int i = 0; i < count; i++) {
+		const double n = m_maxHeight*2.0*heights[i]*heights[i];
+		heights[i] = (n > 0.0? n : 0.0);
+	}
+}
@@ -27,3 +27,19 @@ double TerrainHeightFractal<TerrainHeightBarrenRock2>::GetHeight(const vector3d
 
 	return (n > 0.0? m_maxHeight*n : 0.0);
 }
+
+template <>
+void TerrainHeightFractal<TerrainHeightBarrenRock2>::GetHeightBatch(const double *x, const double *y, const double *z, double *heights, int count)
+{
+	double roughness[MAX_BATCH], lacunarity[MAX_BATCH];
+	octavenoise(8, 0.4, 2.5, x, y, z, roughness, count);
+	ridged_octavenoise(8, 0.377, 4.0, x, y, z, lacunarity, count);
+	for (int i = 0; i < count; i++) {
+		roughness[i] = 0.3*roughness[i];
+		lacunarity[i] = Clamp(5.0*lacunarity[i], 1.0, 5.0);
+	}
+	billow_octavenoise(16, roughness, lacunarity, x, y, z, heights, count);
+
+	for (int i = 0; i < count; i++)
+		heights[i] = (heights[i] > 0.0? m_maxHeight*heights[i] : 0.0);
+}
@@ -26,3 +26,22 @@ double TerrainHeightFractal<TerrainHeightBarrenRock3>::GetHeight(const vector3d
 
 	return (n > 0.0? m_maxHeight*n : 0.0);
 }
+
+template <>
+void TerrainHeightFractal<TerrainHeightBarrenRock3>::GetHeightBatch(const double *x, const double *y, const double *z, double *heights, int count)
+{
+	double roughness[MAX_BATCH], lacunarity[MAX_BATCH];
+	river_octavenoise(12, 0.4, 2.5, x, y, z, roughness, count);
+	billow_octavenoise(12, 0.37, 4.0, x, y, z, lacunarity, count);
+	for (int i = 0; i < count; i++) {
+		roughness[i] = Clamp(fabs(0.165 - (0.38*roughness[i])), 0.15, 0.5);
+		lacunarity[i] = Clamp(8.0*lacunarity[i], 0.5, 9.0);
+	}
+	voronoiscam_octavenoise(12, roughness, lacunarity, x, y, z, heights, count);
+
+	for (int i = 0; i < count; i++) {
+		// float, as in GetHeight()
+		const float n = 0.07*heights[i];
+		heights[i] = (n > 0.0? m_maxHeight*n : 0.0);
+	}
+}
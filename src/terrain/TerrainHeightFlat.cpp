@@ -16,3 +16,10 @@ double TerrainHeightFractal<TerrainHeightFlat>::GetHeight(const vector3d &p)
 {
 	return 0.0;
 }
+
+template <>
+void TerrainHeightFractal<TerrainHeightFlat>::GetHeightBatch(const double *x, const double *y, const double *z, double *heights, int count)
+{
+	for (int i = 0; i < count; i++)
+		heights[i] = 0.0;
+}
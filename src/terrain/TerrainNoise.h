@@ -148,6 +148,99 @@ namespace TerrainNoise {
 		return sqrt(10.0 * fabs(n));
 	}
 
+	// batch versions of the above, over up to Terrain::MAX_BATCH points given
+	// as separate x, y and z arrays. roughness and lacunarity can be a single
+	// value or one value per point. results match the single-point versions
+	// exactly
+	struct batchparam_t {
+		batchparam_t(double v) : value(v), values(0) {}
+		batchparam_t(const double *v) : value(0.0), values(v) {}
+		double operator[](int i) const { return values ? values[i] : value; }
+		double value;
+		const double *values;
+	};
+
+	// out[i] = sum over the octaves of amplitude * noise (or fabs(noise))
+	inline void octave_sum(int octaves, double frequency, const batchparam_t &roughness, const batchparam_t &lacunarity,
+		bool absolute, const double *x, const double *y, const double *z, double *out, int count)
+	{
+		assert(count <= Terrain::MAX_BATCH);
+		double amp[Terrain::MAX_BATCH], jizm[Terrain::MAX_BATCH];
+		double px[Terrain::MAX_BATCH], py[Terrain::MAX_BATCH], pz[Terrain::MAX_BATCH], n[Terrain::MAX_BATCH];
+		for (int i = 0; i < count; i++) {
+			amp[i] = roughness[i];
+			jizm[i] = frequency;
+			out[i] = 0.0;
+		}
+		while (octaves--) {
+			for (int i = 0; i < count; i++) {
+				px[i] = jizm[i]*x[i];
+				py[i] = jizm[i]*y[i];
+				pz[i] = jizm[i]*z[i];
+			}
+			noise(px, py, pz, n, count);
+			for (int i = 0; i < count; i++) {
+				out[i] += amp[i] * (absolute ? fabs(n[i]) : n[i]);
+				amp[i] *= roughness[i];
+				jizm[i] *= lacunarity[i];
+			}
+		}
+	}
+
+	inline void octavenoise(const fracdef_t &def, double roughness, const double *x, const double *y, const double *z, double *out, int count) {
+		octave_sum(def.octaves, def.frequency, roughness, def.lacunarity, false, x, y, z, out, count);
+		for (int i = 0; i < count; i++) out[i] = (out[i]+1.0)*0.5;
+	}
+
+	inline void river_octavenoise(const fracdef_t &def, double roughness, const double *x, const double *y, const double *z, double *out, int count) {
+		octave_sum(def.octaves, def.frequency, roughness, def.lacunarity, true, x, y, z, out, count);
+		for (int i = 0; i < count; i++) out[i] = fabs(out[i]);
+	}
+
+	inline void ridged_octavenoise(const fracdef_t &def, double roughness, const double *x, const double *y, const double *z, double *out, int count) {
+		octave_sum(def.octaves, def.frequency, roughness, def.lacunarity, false, x, y, z, out, count);
+		for (int i = 0; i < count; i++) { const double n = 1.0 - fabs(out[i]); out[i] = n*n; }
+	}
+
+	inline void billow_octavenoise(const fracdef_t &def, double roughness, const double *x, const double *y, const double *z, double *out, int count) {
+		octave_sum(def.octaves, def.frequency, roughness, def.lacunarity, false, x, y, z, out, count);
+		for (int i = 0; i < count; i++) out[i] = (2.0 * fabs(out[i]) - 1.0)+1.0;
+	}
+
+	inline void voronoiscam_octavenoise(const fracdef_t &def, double roughness, const double *x, const double *y, const double *z, double *out, int count) {
+		octave_sum(def.octaves, def.frequency, roughness, def.lacunarity, false, x, y, z, out, count);
+		for (int i = 0; i < count; i++) out[i] = sqrt(10.0 * fabs(out[i]));
+	}
+
+	inline void dunes_octavenoise(const fracdef_t &def, double roughness, const double *x, const double *y, const double *z, double *out, int count) {
+		octave_sum(3, def.frequency, roughness, def.lacunarity, false, x, y, z, out, count);
+		for (int i = 0; i < count; i++) out[i] = 1.0 - fabs(out[i]);
+	}
+
+	inline void octavenoise(int octaves, const batchparam_t &roughness, const batchparam_t &lacunarity, const double *x, const double *y, const double *z, double *out, int count) {
+		octave_sum(octaves, 1.0, roughness, lacunarity, false, x, y, z, out, count);
+		for (int i = 0; i < count; i++) out[i] = (out[i]+1.0)*0.5;
+	}
+
+	inline void river_octavenoise(int octaves, const batchparam_t &roughness, const batchparam_t &lacunarity, const double *x, const double *y, const double *z, double *out, int count) {
+		octave_sum(octaves, 1.0, roughness, lacunarity, true, x, y, z, out, count);
+	}
+
+	inline void ridged_octavenoise(int octaves, const batchparam_t &roughness, const batchparam_t &lacunarity, const double *x, const double *y, const double *z, double *out, int count) {
+		octave_sum(octaves, 1.0, roughness, lacunarity, false, x, y, z, out, count);
+		for (int i = 0; i < count; i++) { const double n = 1.0 - fabs(out[i]); out[i] = n*n; }
+	}
+
+	inline void billow_octavenoise(int octaves, const batchparam_t &roughness, const batchparam_t &lacunarity, const double *x, const double *y, const double *z, double *out, int count) {
+		octave_sum(octaves, 1.0, roughness, lacunarity, false, x, y, z, out, count);
+		for (int i = 0; i < count; i++) out[i] = (2.0 * fabs(out[i]) - 1.0)+1.0;
+	}
+
+	inline void voronoiscam_octavenoise(int octaves, const batchparam_t &roughness, const batchparam_t &lacunarity, const double *x, const double *y, const double *z, double *out, int count) {
+		octave_sum(octaves, 1.0, roughness, lacunarity, false, x, y, z, out, count);
+		for (int i = 0; i < count; i++) out[i] = sqrt(10.0 * fabs(out[i]));
+	}
+
 	// not really a noise function but no better place for it
 	inline vector3d interpolate_color(double n, vector3d start, vector3d end) {
 		n = Clamp(n, 0.0, 1.0);
@@ -0,0 +1,182 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#include "TiledHeightMap.h"
+
+namespace {
+	struct TiledHeader {
+		char magic[4];
+		Uint32 version;
+		Uint32 type;
+		Uint32 sizeX;
+		Uint32 sizeY;
+		Uint32 tileSize;
+		double heightScaling;
+		double minh;
+	};
+
+	// foo.hmap -> foo.thmap
+	std::string tiled_path(const std::string &path)
+	{
+		const size_t dot = path.rfind('.');
+		const size_t slash = path.rfind('/');
+		if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+			return path + ".thmap";
+		return path.substr(0, dot) + ".thmap";
+	}
+
+	Uint32 tile_shift(Uint32 tileSize)
+	{
+		Uint32 shift = 0;
+		while ((Uint32(1) << shift) < tileSize) shift++;
+		return shift;
+	}
+}
+
+TiledHeightMap::TiledHeightMap(Type type) :
+	m_type(type),
+	m_sizeX(0),
+	m_sizeY(0),
+	m_heightScaling(0),
+	m_minh(0),
+	m_tileShift(0),
+	m_tileMask(0),
+	m_tilesX(0),
+	m_samples(0)
+{
+}
+
+TiledHeightMap::~TiledHeightMap()
+{
+}
+
+TiledHeightMap *TiledHeightMap::Load(const std::string &path, Type type)
+{
+	TiledHeightMap *map = new TiledHeightMap(type);
+	if (map->LoadTiled(tiled_path(path)) || map->LoadPlain(path))
+		return map;
+
+	fprintf(stderr, "Error: could not open file '%s'\n", path.c_str());
+	abort();
+	return 0;
+}
+
+bool TiledHeightMap::LoadTiled(const std::string &path)
+{
+	if (!FileSystem::gameDataFiles.Lookup(path).IsFile())
+		return false;
+
+	RefCountedPtr<FileSystem::FileData> fdata = FileSystem::gameDataFiles.MapFile(path);
+	if (!fdata || fdata->GetSize() < TILE_DATA_OFFSET)
+		return false;
+
+	TiledHeader h;
+	memcpy(&h, fdata->GetData(), sizeof(h));
+	if (memcmp(h.magic, "PHMT", 4) != 0 || h.version != VERSION) {
+		fprintf(stderr, "Warning: '%s' is not a tiled heightmap this version understands, ignoring it\n", path.c_str());
+		return false;
+	}
+	if (h.type != Uint32(m_type)) {
+		fprintf(stderr, "Warning: '%s' holds the wrong kind of heightmap, ignoring it\n", path.c_str());
+		return false;
+	}
+	if (h.sizeX == 0 || h.sizeY == 0 || h.sizeX > 0x7fffffff || h.sizeY > 0x7fffffff ||
+			h.tileSize == 0 || h.tileSize > 4096 || (h.tileSize & (h.tileSize-1)) != 0) {
+		fprintf(stderr, "Warning: '%s' has a bad header, ignoring it\n", path.c_str());
+		return false;
+	}
+
+	const Uint64 tilesX = (h.sizeX + h.tileSize - 1) / h.tileSize;
+	const Uint64 tilesY = (h.sizeY + h.tileSize - 1) / h.tileSize;
+	const Uint64 needed = TILE_DATA_OFFSET + tilesX * tilesY * h.tileSize * h.tileSize * sizeof(Uint16);
+	if (fdata->GetSize() < needed) {
+		fprintf(stderr, "Warning: '%s' is truncated, ignoring it\n", path.c_str());
+		return false;
+	}
+
+	m_sizeX = h.sizeX;
+	m_sizeY = h.sizeY;
+	m_heightScaling = h.heightScaling;
+	m_minh = h.minh;
+	m_tileShift = tile_shift(h.tileSize);
+	m_tileMask = h.tileSize - 1;
+	m_tilesX = Uint32(tilesX);
+
+	m_data = fdata;
+	m_samples = reinterpret_cast<const Uint16*>(m_data->GetData() + TILE_DATA_OFFSET);
+	return true;
+}
+
+static size_t bufread_or_die(void *ptr, size_t size, size_t nmemb, ByteRange &buf)
+{
+	size_t read_count = buf.read(reinterpret_cast<char*>(ptr), size, nmemb);
+	if (read_count < nmemb) {
+		fprintf(stderr, "Error: failed to read file (truncated)\n");
+		abort();
+	}
+	return read_count;
+}
+
+bool TiledHeightMap::LoadPlain(const std::string &path)
+{
+	RefCountedPtr<FileSystem::FileData> fdata = FileSystem::gameDataFiles.ReadFile(path);
+	if (!fdata)
+		return false;
+
+	ByteRange databuf = fdata->AsByteRange();
+
+	// read size!
+	Uint16 v;
+
+	switch (m_type) {
+		case TYPE_HEIGHTS: {
+			bufread_or_die(&v, 2, 1, databuf); m_sizeX = v;
+			bufread_or_die(&v, 2, 1, databuf); m_sizeY = v;
+			break;
+		}
+
+		case TYPE_SCALED: {
+			// XXX x and y reversed from above *sigh*
+			bufread_or_die(&v, 2, 1, databuf); m_sizeY = v;
+			bufread_or_die(&v, 2, 1, databuf); m_sizeX = v;
+
+			// read height scaling and min height which are doubles
+			double te;
+			bufread_or_die(&te, 8, 1, databuf);
+			m_heightScaling = te;
+			bufread_or_die(&te, 8, 1, databuf);
+			m_minh = te;
+			break;
+		}
+
+		default:
+			assert(0);
+	}
+
+	// both kinds are 16 bits a sample, which is all the tiles care about
+	std::vector<Uint16> plain(m_sizeX * m_sizeY);
+	if (!plain.empty())
+		bufread_or_die(&plain[0], sizeof(Uint16), plain.size(), databuf);
+
+	const Uint32 tileSize = DEFAULT_TILE_SIZE;
+	m_tileShift = tile_shift(tileSize);
+	m_tileMask = tileSize - 1;
+	m_tilesX = (m_sizeX + tileSize - 1) / tileSize;
+	const Uint32 tilesY = (m_sizeY + tileSize - 1) / tileSize;
+
+	m_tiles.resize(m_tilesX * tilesY * tileSize * tileSize);
+	Uint16 *out = m_tiles.empty() ? 0 : &m_tiles[0];
+	for (Uint32 ty = 0; ty < tilesY; ty++) {
+		for (Uint32 tx = 0; tx < m_tilesX; tx++) {
+			for (Uint32 y = 0; y < tileSize; y++) {
+				const int sy = std::min(int(ty*tileSize + y), m_sizeY-1);
+				for (Uint32 x = 0; x < tileSize; x++) {
+					const int sx = std::min(int(tx*tileSize + x), m_sizeX-1);
+					*out++ = plain[sy*m_sizeX + sx];
+				}
+			}
+		}
+	}
+	m_samples = out ? &m_tiles[0] : 0;
+	return true;
+}
@@ -0,0 +1,74 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+#ifndef _TILEDHEIGHTMAP_H
+#define _TILEDHEIGHTMAP_H
+
+#include "libs.h"
+#include "FileSystem.h"
+
+/*
+ * A heightmap stored as square tiles, so that samples close together on the
+ * planet are close together in memory. Maps converted with
+ * scripts/tile_heightmap.py (.thmap next to the .hmap) are mapped straight
+ * from disk and paged in by the OS as they're touched; plain .hmap files are
+ * read and tiled in memory.
+ *
+ * .thmap layout, little endian:
+ *   char[4] "PHMT", Uint32 version, Uint32 type, Uint32 sizeX, Uint32 sizeY,
+ *   Uint32 tileSize, double heightScaling, double minHeight
+ * then from TILE_DATA_OFFSET, tiles row by row, each tileSize*tileSize
+ * Uint16 samples row by row. tiles past the edge of the map repeat the edge.
+ */
+
+class TiledHeightMap {
+public:
+	// same numbers as SystemBody::heightMapFractal
+	enum Type {
+		TYPE_HEIGHTS = 0, // Sint16 heights in metres
+		TYPE_SCALED = 1   // Uint16, scaled by heightScaling
+	};
+
+	static const Uint32 VERSION = 1;
+	static const Uint32 TILE_DATA_OFFSET = 4096;
+	static const Uint32 DEFAULT_TILE_SIZE = 64;
+
+	// aborts if neither the tiled nor the plain file can be read
+	static TiledHeightMap *Load(const std::string &path, Type type);
+	~TiledHeightMap();
+
+	Type GetType() const { return m_type; }
+	int GetSizeX() const { return m_sizeX; }
+	int GetSizeY() const { return m_sizeY; }
+	double GetHeightScaling() const { return m_heightScaling; }
+	double GetMinHeight() const { return m_minh; }
+	bool IsMapped() const { return m_data.Valid(); }
+
+	// x and y must be in range
+	Uint16 GetRawSample(int x, int y) const {
+		assert(x >= 0 && x < m_sizeX && y >= 0 && y < m_sizeY);
+		const Uint32 tile = Uint32(y >> m_tileShift) * m_tilesX + Uint32(x >> m_tileShift);
+		return m_samples[(tile << (2*m_tileShift)) + ((Uint32(y) & m_tileMask) << m_tileShift) + (Uint32(x) & m_tileMask)];
+	}
+	Sint16 GetHeight(int x, int y) const { assert(m_type == TYPE_HEIGHTS); return Sint16(GetRawSample(x, y)); }
+	Uint16 GetScaledHeight(int x, int y) const { assert(m_type == TYPE_SCALED); return GetRawSample(x, y); }
+
+private:
+	TiledHeightMap(Type type);
+
+	bool LoadTiled(const std::string &path);
+	bool LoadPlain(const std::string &path);
+
+	Type m_type;
+	int m_sizeX, m_sizeY;
+	double m_heightScaling, m_minh;
+
+	Uint32 m_tileShift, m_tileMask, m_tilesX;
+
+	// either the mapped file or m_tiles, which m_samples points into
+	RefCountedPtr<FileSystem::FileData> m_data;
+	std::vector<Uint16> m_tiles;
+	const Uint16 *m_samples;
+};
+
+#endif /* _TILEDHEIGHTMAP_H */
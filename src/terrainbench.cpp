@@ -0,0 +1,236 @@
+// Copyright © 2008-2013 Pioneer Developers. See AUTHORS.txt for details
+// Licensed under the terms of the GPL v3. See licenses/GPL-3.txt
+
+// times every terrain height/colour fractal pairing that
+// Terrain::InstanceTerrain can hand out, over a fixed set of points on the
+// sphere. no window or GL needed. output is tab separated, one line per
+// pairing, lines starting with # are comments:
+//
+//   height  color  height_ns  heights_ns  color_ns  colors_ns
+//
+// *_ns are nanoseconds per sample for the single-point calls (GetHeight,
+// GetColor) and the batch calls (GetHeights, GetColors), best of several
+// runs.
+//
+// usage: terrainbench [-n points] [-r runs] [-t textures] [-f fracmult]
+
+#include "libs.h"
+#include "Pi.h"
+#include "FileSystem.h"
+#include "OS.h"
+#include "mtrand.h"
+#include "galaxy/StarSystem.h"
+#include "terrain/Terrain.h"
+#include <set>
+
+// seeds tried per body; enough to hit every choice InstanceTerrain makes
+static const int SEEDS_PER_BODY = 64;
+
+struct BodyDef {
+	SystemBody::BodyType type;
+	const char *heightMap;
+	unsigned int heightMapFractal;
+};
+
+// one of each kind of body InstanceTerrain tells apart (any other star
+// gets the default). terrestrial planets are also run through a grid of
+// compositions below
+static const BodyDef s_bodyDefs[] = {
+	{ SystemBody::TYPE_BROWN_DWARF, 0, 0 },
+	{ SystemBody::TYPE_WHITE_DWARF, 0, 0 },
+	{ SystemBody::TYPE_STAR_M, 0, 0 },
+	{ SystemBody::TYPE_STAR_K, 0, 0 },
+	{ SystemBody::TYPE_STAR_G, 0, 0 },
+	{ SystemBody::TYPE_STAR_F, 0, 0 },
+	{ SystemBody::TYPE_PLANET_GAS_GIANT, 0, 0 },
+	{ SystemBody::TYPE_PLANET_ASTEROID, 0, 0 },
+	{ SystemBody::TYPE_PLANET_TERRESTRIAL, 0, 0 },
+	{ SystemBody::TYPE_PLANET_TERRESTRIAL, "heightmaps/earth.hmap", 0 },
+	{ SystemBody::TYPE_PLANET_TERRESTRIAL, "heightmaps/moon.hmap", 1 }
+};
+
+// the composition thresholds InstanceTerrain picks between, and a bit either side
+static const fixed s_lifeLevels[] = { fixed(0,1), fixed(15,100), fixed(3,10), fixed(45,100), fixed(6,10), fixed(8,10) };
+static const fixed s_gasLevels[] = { fixed(0,1), fixed(15,100), fixed(3,10) };
+static const fixed s_liquidLevels[] = { fixed(0,1), fixed(5,10) };
+static const fixed s_iceLevels[] = { fixed(0,1), fixed(9,10) };
+static const fixed s_volcanicLevels[] = { fixed(0,1), fixed(8,10) };
+static const int s_tempLevels[] = { 200, 245, 300 };
+
+struct Pairing {
+	std::string height, color;
+	SystemBody body;
+};
+
+static void fill_body(SystemBody &body, const BodyDef &def, Uint32 seed)
+{
+	body.type = def.type;
+	body.seed = seed;
+	body.radius = fixed(1,1);
+	body.mass = fixed(1,1);
+	body.averageTemp = 280;
+	body.m_metallicity = fixed(5,10);
+	body.m_volatileGas = fixed(0,1);
+	body.m_volatileLiquid = fixed(0,1);
+	body.m_volatileIces = fixed(0,1);
+	body.m_volcanicity = fixed(0,1);
+	body.m_life = fixed(0,1);
+	body.heightMapFilename = def.heightMap;
+	body.heightMapFractal = def.heightMapFractal;
+}
+
+static void try_body(const SystemBody &body, std::vector<Pairing*> &pairings, std::set<std::pair<std::string,std::string> > &seen)
+{
+	Terrain *terrain = Terrain::InstanceTerrain(&body);
+	const std::pair<std::string,std::string> names(terrain->GetHeightFractalName(), terrain->GetColorFractalName());
+	delete terrain;
+	if (!seen.insert(names).second) return;
+
+	Pairing *p = new Pairing;
+	p->height = names.first;
+	p->color = names.second;
+	p->body = body;
+	pairings.push_back(p);
+}
+
+static void find_pairings(std::vector<Pairing*> &pairings)
+{
+	std::set<std::pair<std::string,std::string> > seen;
+	SystemBody body;
+
+	for (unsigned int d = 0; d < COUNTOF(s_bodyDefs); d++) {
+		const BodyDef &def = s_bodyDefs[d];
+		if (def.heightMap) {
+			if (!FileSystem::gameDataFiles.Lookup(def.heightMap).IsFile()) {
+				printf("# skipping %s, not found\n", def.heightMap);
+				continue;
+			}
+			fill_body(body, def, 0);
+			try_body(body, pairings, seen);
+			continue;
+		}
+
+		for (Uint32 seed = 0; seed < SEEDS_PER_BODY; seed++) {
+			fill_body(body, def, seed);
+			if (def.type != SystemBody::TYPE_PLANET_TERRESTRIAL) {
+				try_body(body, pairings, seen);
+				continue;
+			}
+
+			for (unsigned int a = 0; a < COUNTOF(s_lifeLevels); a++)
+			for (unsigned int b = 0; b < COUNTOF(s_gasLevels); b++)
+			for (unsigned int c = 0; c < COUNTOF(s_liquidLevels); c++)
+			for (unsigned int e = 0; e < COUNTOF(s_iceLevels); e++)
+			for (unsigned int f = 0; f < COUNTOF(s_volcanicLevels); f++)
+			for (unsigned int g = 0; g < COUNTOF(s_tempLevels); g++) {
+				body.m_life = s_lifeLevels[a];
+				body.m_volatileGas = s_gasLevels[b];
+				body.m_volatileLiquid = s_liquidLevels[c];
+				body.m_volatileIces = s_iceLevels[e];
+				body.m_volcanicity = s_volcanicLevels[f];
+				body.averageTemp = s_tempLevels[g];
+				try_body(body, pairings, seen);
+			}
+		}
+	}
+}
+
+// nanoseconds per sample
+static double ns_per_sample(Uint64 ticks, int samples)
+{
+	return double(ticks) * 1e9 / (double(OS::HFTimerFreq()) * samples);
+}
+
+int main(int argc, char **argv)
+{
+	int numPoints = 4096;
+	int numRuns = 5;
+	Pi::detail.textures = 1;
+	Pi::detail.fracmult = 2;
+
+	for (int i = 1; i < argc; i++) {
+		const std::string arg(argv[i]);
+		if (i+1 < argc && arg == "-n") numPoints = atoi(argv[++i]);
+		else if (i+1 < argc && arg == "-r") numRuns = atoi(argv[++i]);
+		else if (i+1 < argc && arg == "-t") Pi::detail.textures = atoi(argv[++i]);
+		else if (i+1 < argc && arg == "-f") Pi::detail.fracmult = atoi(argv[++i]);
+		else {
+			fprintf(stderr, "usage: terrainbench [-n points] [-r runs] [-t textures] [-f fracmult]\n");
+			return 1;
+		}
+	}
+	numPoints = std::max(numPoints, 1);
+	numRuns = std::max(numRuns, 1);
+
+	FileSystem::Init();
+
+	// same points every time, spread evenly over the sphere
+	MTRand rand(1);
+	std::vector<double> x(numPoints), y(numPoints), z(numPoints);
+	for (int i = 0; i < numPoints; i++) {
+		const double cz = rand.Double(-1.0, 1.0);
+		const double phi = rand.Double(2.0*M_PI);
+		const double r = sqrt(1.0 - cz*cz);
+		x[i] = r*cos(phi);
+		y[i] = r*sin(phi);
+		z[i] = cz;
+	}
+
+	std::vector<Pairing*> pairings;
+	find_pairings(pairings);
+
+	printf("# terrainbench: %d pairings, %d points, best of %d runs, textures %d, fracmult %d\n",
+		int(pairings.size()), numPoints, numRuns, Pi::detail.textures, Pi::detail.fracmult);
+	printf("height\tcolor\theight_ns\theights_ns\tcolor_ns\tcolors_ns\n");
+
+	std::vector<double> heights(numPoints);
+	std::vector<vector3d> colors(numPoints);
+	// a sink for the results, so the single-point loops can't be dropped
+	double sink = 0.0;
+
+	for (std::vector<Pairing*>::const_iterator p = pairings.begin(); p != pairings.end(); ++p) {
+		Terrain *terrain = Terrain::InstanceTerrain(&(*p)->body);
+
+		Uint64 best[4];
+		for (int k = 0; k < 4; k++) best[k] = ~Uint64(0);
+
+		for (int run = 0; run < numRuns; run++) {
+			Uint64 t0 = OS::HFTimer();
+			for (int i = 0; i < numPoints; i++)
+				sink += terrain->GetHeight(vector3d(x[i], y[i], z[i]));
+			Uint64 t1 = OS::HFTimer();
+			best[0] = std::min(best[0], t1-t0);
+
+			t0 = OS::HFTimer();
+			terrain->GetHeights(&x[0], &y[0], &z[0], &heights[0], numPoints);
+			t1 = OS::HFTimer();
+			best[1] = std::min(best[1], t1-t0);
+
+			// the point's own direction stands in for the surface normal
+			t0 = OS::HFTimer();
+			for (int i = 0; i < numPoints; i++) {
+				const vector3d v(x[i], y[i], z[i]);
+				sink += terrain->GetColor(v, heights[i], v).x;
+			}
+			t1 = OS::HFTimer();
+			best[2] = std::min(best[2], t1-t0);
+
+			t0 = OS::HFTimer();
+			terrain->GetColors(&x[0], &y[0], &z[0], &heights[0], &x[0], &y[0], &z[0], &colors[0], numPoints);
+			t1 = OS::HFTimer();
+			best[3] = std::min(best[3], t1-t0);
+		}
+
+		printf("%s\t%s\t%.1f\t%.1f\t%.1f\t%.1f\n", (*p)->height.c_str(), (*p)->color.c_str(),
+			ns_per_sample(best[0], numPoints), ns_per_sample(best[1], numPoints),
+			ns_per_sample(best[2], numPoints), ns_per_sample(best[3], numPoints));
+		fflush(stdout);
+
+		delete terrain;
+		delete *p;
+	}
+
+	printf("# checksum %g\n", sink);
+	FileSystem::Uninit();
+	return 0;
+}
@@ -155,6 +155,40 @@ namespace FileSystem {
 		}
 	}
 
+	class FileDataMapped : public FileData {
+	public:
+		FileDataMapped(const FileInfo &info, size_t size, char *data):
+			FileData(info, size, data) {}
+		virtual ~FileDataMapped() { UnmapViewOfFile(m_data); }
+	};
+
+	RefCountedPtr<FileData> FileSourceFS::MapFile(const std::string &path)
+	{
+		const std::string fullpath = JoinPathBelow(GetRoot(), path);
+		const std::wstring wfullpath = transcode_utf8_to_utf16(fullpath);
+		HANDLE filehandle = CreateFileW(wfullpath.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+		if (filehandle == INVALID_HANDLE_VALUE)
+			return RefCountedPtr<FileData>(0);
+
+		LARGE_INTEGER large_size;
+		// empty files can't be mapped
+		if (!GetFileSizeEx(filehandle, &large_size) || large_size.QuadPart == 0 || large_size.QuadPart > 0x7FFFFFFFll) {
+			CloseHandle(filehandle);
+			return ReadFile(path);
+		}
+		const size_t size = size_t(large_size.QuadPart);
+
+		// the view keeps the file open, so both handles can go straight away
+		HANDLE maphandle = CreateFileMappingW(filehandle, 0, PAGE_READONLY, 0, 0, 0);
+		void *data = maphandle ? MapViewOfFile(maphandle, FILE_MAP_READ, 0, 0, 0) : 0;
+		if (maphandle) CloseHandle(maphandle);
+		CloseHandle(filehandle);
+		if (!data)
+			return ReadFile(path);
+
+		return RefCountedPtr<FileData>(new FileDataMapped(MakeFileInfo(path, FileInfo::FT_FILE), size, reinterpret_cast<char*>(data)));
+	}
+
 	bool FileSourceFS::ReadDirectory(const std::string &dirpath, std::vector<FileInfo> &output)
 	{
 		size_t output_head_size = output.size();
@@ -240,4 +274,11 @@ namespace FileSystem {
 		const std::string fullpath = JoinPathBelow(GetRoot(), path);
 		return open_file_raw(fullpath, (flags & WRITE_TEXT) ? L"w" : L"wb");
 	}
+
+	bool FileSourceFS::RemoveFile(const std::string &path)
+	{
+		const std::string fullpath = JoinPathBelow(GetRoot(), path);
+		const std::wstring wfullpath = transcode_utf8_to_utf16(fullpath);
+		return (DeleteFileW(wfullpath.c_str()) != 0);
+	}
 }
@@ -117,4 +117,11 @@ Uint64 HFTimer()
 	return i.QuadPart;
 }
 
+int GetNumCores()
+{
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	return si.dwNumberOfProcessors > 0 ? int(si.dwNumberOfProcessors) : 1;
+}
+
 } // namespace OS